@@ -0,0 +1,41 @@
+#pragma once
+
+#include <memory>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "CommandLine.h"
+
+class Camera;
+class CameraPath;
+class FrameWorker;
+class OfflineRenderer;
+
+// --animation in the window: the OfflineRenderer for the options' output, and for a
+// --frame-worker its connection to the FrameCoordinator.
+class AnimationRun
+{
+public:
+    AnimationRun();
+    ~AnimationRun();
+
+    AnimationRun(const AnimationRun &) = delete;
+    AnimationRun &operator=(const AnimationRun &) = delete;
+
+    // Needs a current context; resolution is the framebuffer's and start the camera's
+    // position. cameraPath has to outlive the run. False after printing why the
+    // animation can't start.
+    bool open(const CommandLine::Options &options, const glm::ivec2 &resolution, const glm::vec3 &start,
+              const CameraPath *cameraPath);
+
+    bool isFinished();
+    void positionCamera(Camera &camera) const;
+    // Before the swap, with the renderer's output texture; see OfflineRenderer.
+    void captureFrame(GLuint texture);
+    bool finish();
+
+private:
+    std::unique_ptr<FrameWorker> worker;
+    std::unique_ptr<OfflineRenderer> renderer;
+};
@@ -6,4 +6,8 @@
 namespace AppPaths
 {
 std::filesystem::path findResource(const std::string &relativePath);
+
+// $XDG_CACHE_HOME/blackholesim, falling back to ~/.cache/blackholesim; empty if
+// neither is known.
+std::filesystem::path cacheDirectory();
 }
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "RayStatistics.h"
+
+class Camera;
+class CameraPath;
+
+// --benchmark: drives the camera through a fixed script instead of the keyboard and
+// mouse, and summarises the frames as JSON. The script holds each camera preset for
+// framesPerSegment frames, then orbits the hole once at preset 1's distance and
+// height over as many frames, or plays a --camera-path back over them instead. The
+// first WARMUP_FRAMES of every segment, which pay for preset changes (orbit tables,
+// caches), aren't timed.
+class Benchmark
+{
+public:
+    static constexpr unsigned int DEFAULT_FRAMES = 240;
+    static constexpr unsigned int WARMUP_FRAMES = 10;
+    static constexpr int SEGMENT_COUNT = 5;   // the camera presets, then the orbit
+
+    // What the numbers were measured on, echoed into the report.
+    struct Setup
+    {
+        std::string renderer;       // "gpu" or "cpu"
+        std::string glRenderer;
+        std::string glVendor;
+        std::string glVersion;
+        glm::ivec2 resolution;
+        std::string integrator;
+        std::string outputFormat;
+        unsigned int cpuThreads;
+        std::string cameraPath;     // file, empty for the orbit
+    };
+
+    // cameraPath, if not null, has to outlive the benchmark.
+    Benchmark(unsigned int framesPerSegment, const CameraPath *cameraPath);
+
+    bool isFinished() const { return segment() >= SEGMENT_COUNT; }
+    // Places the camera for the frame about to be drawn.
+    void positionCamera(Camera &camera) const;
+    bool isTimed() const;
+    bool isFirstTimedFrame() const;
+    bool isLastTimedFrame() const;
+
+    // Rays of the current frame (CPU backend); ignored outside the timed frames.
+    void addRays(const RayStatistics &statistics);
+    // Ends the current frame: its wall time and the part the CPU spent outside the swap.
+    void endFrame(double frameMilliseconds, double cpuMilliseconds);
+    // Rays of the whole segment the last endFrame() finished (GPU counter). Reading the
+    // counter waits for the GPU, so it happens after that frame's time was taken.
+    void addSegmentRays(const RayStatistics &statistics);
+    // GPU time of a frame, counted from 0 as endFrame() counts them; arrives late.
+    void addGpuTime(std::uint64_t frameIndex, double milliseconds);
+
+    void writeJson(std::ostream &out, const Setup &setup) const;
+
+private:
+    struct Segment
+    {
+        std::vector<double> frameMilliseconds;
+        std::vector<double> cpuMilliseconds;
+        std::vector<double> gpuMilliseconds;
+        RayStatistics rays;
+    };
+
+    unsigned int framesPerSegment;
+    const CameraPath *cameraPath;
+    std::uint64_t frame;
+    std::vector<Segment> segments;
+
+    int segment() const { return static_cast<int>(frame / (WARMUP_FRAMES + framesPerSegment)); }
+    unsigned int frameInSegment() const { return static_cast<unsigned int>(frame % (WARMUP_FRAMES + framesPerSegment)); }
+};
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <chrono>
+
+#include <glm/glm.hpp>
+
+#include "Benchmark.h"
+#include "CommandLine.h"
+
+class Camera;
+class CameraPath;
+class CpuTracer;
+class GpuTimer;
+class StepCounter;
+
+// --benchmark in the window: follows the Benchmark's script, times every frame,
+// credits the rays of the CPU tracer or of the GPU step counter, and writes the
+// report once the script is done.
+class BenchmarkRun
+{
+public:
+    // stepCounter is the compute shader's, null with the CPU tracer. It and cameraPath
+    // have to outlive the run.
+    BenchmarkRun(const CommandLine::Options &options, const CameraPath *cameraPath, StepCounter *stepCounter);
+
+    bool isFinished() const { return benchmark.isFinished(); }
+    void positionCamera(Camera &camera) const { benchmark.positionCamera(camera); }
+
+    // Starts the frame's clock, and on a segment's first timed frame its step count.
+    void beginFrame();
+    void cpuFrameRendered(const CpuTracer &tracer);
+    // Around the swap, which the CPU time leaves out.
+    void beginSwap();
+    void endSwap();
+    // CPU time is the frame's wall time outside the swap, where the driver blocks on
+    // the GPU; GPU time comes from the timer's queries at the end. The step counter is
+    // read once per segment, after its last frame was timed, so the wait for the GPU
+    // isn't in any frame's time.
+    void endFrame();
+
+    // Hands the GPU times, read back after the loop, to the benchmark and writes its
+    // report to --benchmark's file, or to stdout for "-".
+    bool write(const GpuTimer *gpuTimer, const CpuTracer *cpuTracer, const glm::ivec2 &resolution);
+
+private:
+    const CommandLine::Options &options;
+    Benchmark benchmark;
+    StepCounter *stepCounter;
+    std::chrono::steady_clock::time_point frameStart;
+    std::chrono::steady_clock::time_point swapStart;
+    std::chrono::steady_clock::time_point swapEnd;
+};
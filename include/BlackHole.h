@@ -1,8 +1,12 @@
 #pragma once
 
+#include <vector>
+
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
+#include "RenderTarget.h"
+#include "TracerParameters.h"
 #include "shader.h"
 
 class BlackHole
@@ -10,6 +14,8 @@ class BlackHole
 private:
     glm::vec3 position;
     float radius;
+    DiskParameters disk;
+    RenderTarget::Format outputFormat;
 
     unsigned int outputTexture;
     unsigned int screenVAO;
@@ -22,16 +28,21 @@ private:
     void createScreenQuad();
 
 public:
-    BlackHole(Shader *p_computeShader, glm::vec3 pos, float r, int width, int height);
+    // p_computeShader has to be built with RenderTarget::shaderDefines(format).
+    BlackHole(Shader *p_computeShader, glm::vec3 pos, float r, int width, int height,
+              RenderTarget::Format format = RenderTarget::DEFAULT_FORMAT);
     ~BlackHole();
     
     void draw(Shader &screenShader);
     void resizeOutputTexture(int width, int height);
+    void uploadImage(const std::vector<glm::vec4> &pixels);
 
     void setPosition(glm::vec3 pos) { position = pos; }
     void setRadius(float r) { radius = r; }
     glm::vec3 getPosition() const { return position; }
     float getRadius() const { return radius; }
+    const DiskParameters &getDiskParameters() const { return disk; }
+    RenderTarget::Format getOutputFormat() const { return outputFormat; }
 
     unsigned int getOutputTexture() const { return outputTexture; }
 };
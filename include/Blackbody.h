@@ -0,0 +1,28 @@
+#pragma once
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// Linear sRGB colour of a blackbody, from Planck's law integrated against the CIE
+// 1931 colour matching functions. A source at temperature T seen with Doppler factor
+// g = nu_observed / nu_emitted has I_nu = g^3 B_nu/g(T) = B_nu(g T): the shift and
+// the g^3 boost of the specific intensity (g^4 bolometric) together turn it into a
+// blackbody at g T. So the colour of a disk element is a table over the observed
+// temperature alone, log-spaced over [MIN_TEMPERATURE, MAX_TEMPERATURE] and built
+// once on first use. Colours are scaled so luminance(REFERENCE_TEMPERATURE) = 1.
+namespace Blackbody
+{
+constexpr int TABLE_SIZE = 1024;
+constexpr float MIN_TEMPERATURE = 500.0f;       // K; nearly black in the visible
+constexpr float MAX_TEMPERATURE = 100000.0f;    // K
+constexpr float REFERENCE_TEMPERATURE = 6500.0f;
+
+// Laid out as the RGB texels of the shader's blackbodyColors texture.
+const std::vector<glm::vec3> &table();
+// Table lookup, clamped to its temperature range; black for non-positive or NaN
+// temperatures.
+glm::vec3 color(float temperature);
+// Relative luminance (Y) of color(temperature).
+float luminance(float temperature);
+}
@@ -9,12 +9,23 @@
 class Camera
 {
 public:
+    static constexpr std::size_t PRESET_COUNT = 4;
+    static constexpr float DEFAULT_FOV = 45.0f;     // vertical, degrees
+
     Camera(glm::vec3 position = glm::vec3(0.0f, 0.0f, 5.0f));
     
     glm::mat4 viewMatrix() const;
     glm::mat4 invViewMatrix() const;
     glm::vec3 getPosition() const { return m_position; }
+    float getFov() const { return m_fov; }
+    void setFov(float fov) { m_fov = fov; }
     
+    void lookAt(const glm::vec3 &position, const glm::vec3 &target);
+    void applyPreset(std::size_t index);
+    static glm::vec3 presetPosition(std::size_t index);
+    // start turned by angle radians around the disk axis (y) through the hole.
+    static glm::vec3 orbitPosition(const glm::vec3 &start, float angle);
+
     void processInput(GLFWwindow* window, float deltaTime);
     static void mouse_callback(GLFWwindow* window, double xpos, double ypos);
     
@@ -22,6 +33,7 @@ private:
     glm::vec3 m_position;
     glm::vec3 m_front;
     glm::vec3 m_up;
+    float m_fov;
     
     float m_yaw;
     float m_pitch;
@@ -29,11 +41,11 @@ private:
     float m_lastX;
     float m_lastY;
     bool m_firstMouse;
-    std::array<bool, 4> m_presetKeyPressed;
+    std::array<bool, PRESET_COUNT> m_presetKeyPressed;
     
     float m_movementSpeed;
     float m_mouseSensitivity;
     
     void updateCameraVectors();
-    void snapToView(GLFWwindow *window, const glm::vec3 &position, const glm::vec3 &target);
+    void syncCursor(GLFWwindow *window);
 };
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+class Camera;
+
+// Keyframed camera path for --camera-path, so offline renders and benchmarks play
+// back the same views on every run and machine. A path file is plain text, one
+// keyframe per line:
+//
+//     # seconds  position x y z   target x y z   [fov degrees]
+//     0          6 4 6            0 0 0          45
+//     4          0 0.35 8         0 0 0
+//
+// Times have to increase; the fov carries over from the previous keyframe when left
+// out. Position, target and fov are each interpolated with a cubic Hermite spline
+// whose tangents are Catmull-Rom's, taken over the (not necessarily even) key times,
+// and one-sided at the first and last keyframe. Before the first and after the last
+// keyframe the camera holds still.
+class CameraPath
+{
+public:
+    struct Keyframe
+    {
+        double time;            // seconds
+        glm::vec3 position;
+        glm::vec3 target;
+        float fov;              // vertical, degrees
+    };
+
+    bool load(const std::filesystem::path &path, std::string &error);
+
+    bool isEmpty() const { return keyframes.empty(); }
+    double getDuration() const { return keyframes.empty() ? 0.0 : keyframes.back().time - keyframes.front().time; }
+    // Frames at fps that cover the path, both ends included.
+    std::uint64_t frameCount(unsigned int fps) const;
+
+    // The pose seconds after the first keyframe.
+    Keyframe evaluate(double seconds) const;
+    // The pose of frame at fps, frame 0 on the first keyframe.
+    Keyframe evaluateFrame(std::uint64_t frame, unsigned int fps) const;
+    static void apply(const Keyframe &pose, Camera &camera);
+
+private:
+    std::vector<Keyframe> keyframes;
+
+    Keyframe tangent(std::size_t index) const;
+};
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <ostream>
+#include <string>
+
+#include "Benchmark.h"
+#include "FrameEncoder.h"
+#include "Geodesic.h"
+#include "OfflineRenderer.h"
+#include "PacketKernel.h"
+#include "RayStatistics.h"
+#include "Regression.h"
+#include "RenderTarget.h"
+#include "StarfieldCubemap.h"
+#include "TracerParameters.h"
+
+namespace CommandLine
+{
+struct Options
+{
+    bool showHelp = false;
+    bool useCpuRenderer = false;
+    unsigned int cpuThreads = 0;     // 0 = one per hardware thread
+    PacketKernel::Isa simd = PacketKernel::detectIsa();
+    bool tileStats = false;          // print per-thread tile scheduler timings
+    Integrator integrator = Integrator::AdaptiveRk45;
+    float tolerance = Geodesic::DEFAULT_TOLERANCE;
+    bool stepStats = false;          // print steps per ray, ray outcomes and throughput
+    DebugView debugView = DebugView::None;  // steps or outcome per pixel instead of the image
+    bool gpuTimers = false;          // print rolling GPU time per frame phase
+    std::string gpuTimersCsv;        // write per-frame GPU phase times here at exit
+    std::string profilePath;         // record CPU zones and write a trace here (F9 or exit)
+    float weakFieldBudget = Geodesic::DEFAULT_WEAK_FIELD_BUDGET;    // pixels, 0 = no weak-field fast path
+    bool classifyTiles = true;       // skip integration for pure background and shadow tiles
+    int skySize = StarfieldCubemap::DEFAULT_FACE_SIZE;   // baked sky face size, 0 = evaluate the sky per ray
+    RenderTarget::Format outputFormat = RenderTarget::DEFAULT_FORMAT;   // storage of the rendered frame
+    bool formatBenchmark = false;    // time GPU frames with every output format and exit
+    std::string benchmarkPath;       // run the scripted benchmark and write JSON here ("-" = stdout)
+    unsigned int benchmarkFrames = Benchmark::DEFAULT_FRAMES;   // timed frames per benchmark segment
+    std::string animationPath;       // render the camera orbit to this image sequence, "-" = stream to stdout
+    unsigned int animationFrames = 0;   // 0 = the camera path's length, or OfflineRenderer::DEFAULT_FRAMES
+    std::string cameraPathFile;      // keyframes --animation and --benchmark play back
+    FrameEncoder::Output streamFormat = FrameEncoder::Output::Y4m;  // of the stdout stream
+    unsigned int fps = OfflineRenderer::DEFAULT_FPS;                // written into y4m headers
+    bool headless = false;           // render offscreen through EGL instead of into a window
+    int width = 1280;
+    int height = 720;
+    unsigned int preset = 0;         // 1-based camera preset, 0 = default start position
+    std::string outputPath;          // render a single frame to this file and exit
+    Regression::Test regression = Regression::Test::None;   // outputPath is then a directory
+    unsigned int tileWorkers = 0;    // split the --output frame over this many local worker processes
+    std::string listenAddress;       // and take workers connecting here, host:port or unix:/path
+    std::string tileWorkerAddress;   // render tiles for the coordinator at this address, then exit
+    unsigned int animationWorkers = 0;  // render the --animation sequence on this many worker processes
+    std::string frameWorkerAddress;  // render --animation frame ranges for the coordinator at this address
+};
+
+bool parse(int argc, char **argv, Options &options, std::string &error);
+void printUsage(std::ostream &out, const char *programName);
+// The --integrator name of integrator, as in reports.
+const char *integratorName(Integrator integrator);
+}
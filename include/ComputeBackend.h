@@ -0,0 +1,55 @@
+#pragma once
+
+#include <filesystem>
+#include <memory>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "CommandLine.h"
+#include "DiskEmissionTexture.h"
+#include "OrbitTableTexture.h"
+#include "StarfieldTexture.h"
+#include "shader.h"
+
+class Camera;
+class DiskEmissionMap;
+class PhotonOrbitTable;
+class StarfieldCubemap;
+
+// The window's compute shader renderer: the shader built for the options, the
+// uniforms that follow the camera and the framebuffer, and the textures it samples.
+// The CPU tracer's frames go through BlackHole::uploadImage() instead.
+class ComputeBackend
+{
+public:
+    // Needs a current context. sky is the baked starfield, or null for the per-ray
+    // sky; it has to outlive the backend.
+    ComputeBackend(const std::filesystem::path &shaderPath, const CommandLine::Options &options,
+                   const glm::ivec2 &resolution, const glm::mat4 &invProjection, const StarfieldCubemap *sky);
+
+    ComputeBackend(const ComputeBackend &) = delete;
+    ComputeBackend &operator=(const ComputeBackend &) = delete;
+
+    Shader &getShader() { return shader; }
+
+    void uploadDiskEmission(const DiskEmissionMap &diskEmission);
+    void uploadOrbitTable(const PhotonOrbitTable &orbitTable);
+    // After a resize or a change of the field of view.
+    void setProjection(const glm::ivec2 &resolution, const glm::mat4 &invProjection);
+
+    // Every frame before dispatch(): the camera's uniforms, and the textures bound.
+    void prepareFrame(const Camera &camera);
+    void dispatch(const glm::ivec2 &resolution);
+
+private:
+    const CommandLine::Options &options;
+    Shader shader;
+    GLint resolutionLocation;
+    GLint invProjectionLocation;
+    GLint cameraPosLocation;
+    GLint invViewLocation;
+    std::unique_ptr<OrbitTableTexture> orbitTableTexture;
+    std::unique_ptr<StarfieldTexture> starfieldTexture;
+    DiskEmissionTexture diskEmissionTexture;
+};
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "PacketKernel.h"
+#include "RayStatistics.h"
+#include "TileScheduler.h"
+#include "TracerParameters.h"
+
+// Multithreaded CPU backend for the geodesic tracer. Produces the same RGBA float
+// image the compute shader writes into BlackHole's output texture: row-major,
+// pixel (x, y) at index y * width + x, row 0 at the top of the view. Work is
+// handed out as 16x16 tiles by a work-stealing TileScheduler; tiles that
+// TileClassifier settles as pure background or shadow skip integration. With a
+// baked StarfieldCubemap the sky is sampled once a tile is traced, over footprints
+// from neighbouring pixels.
+class CpuTracer
+{
+private:
+    unsigned int threadCount;
+    PacketKernel::Isa isa;
+    std::unique_ptr<TileScheduler> scheduler;
+    RayStatistics lastFrameStatistics;
+    unsigned int lastFrameBackgroundTiles;
+    unsigned int lastFrameShadowTiles;
+
+public:
+    explicit CpuTracer(unsigned int threads = 0, PacketKernel::Isa kernelIsa = PacketKernel::detectIsa());
+
+    void render(const TracerParameters &params, std::vector<glm::vec4> &image);
+    // Renders only region of the frame into image, which then holds the region's
+    // rows. A corner on the TileScheduler::TILE_SIZE grid gives the same pixels as
+    // the whole frame does.
+    void render(const TracerParameters &params, const TileScheduler::Tile &region, std::vector<glm::vec4> &image);
+
+    unsigned int getThreadCount() const { return threadCount; }
+    PacketKernel::Isa getIsa() const { return isa; }
+    const TileScheduler &getScheduler() const { return *scheduler; }
+
+    // Integration steps and ray outcomes of the last frame; adaptive steps count
+    // rejected attempts too.
+    const RayStatistics &getLastFrameStatistics() const { return lastFrameStatistics; }
+    // Tiles of the last frame the classification pre-pass shaded without integrating.
+    unsigned int getLastFrameBackgroundTiles() const { return lastFrameBackgroundTiles; }
+    unsigned int getLastFrameShadowTiles() const { return lastFrameShadowTiles; }
+};
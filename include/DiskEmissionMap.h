@@ -0,0 +1,38 @@
+#pragma once
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "TracerParameters.h"
+
+// Geodesic::diskEmission baked over the annulus in polar coordinates: column j at
+// angle 2 pi (j + 0.5) / ANGLE_COUNT - pi from basisX towards basisZ, row i at
+// radius innerRadius + (i + 0.5) / RADIUS_COUNT of the annulus' width. The Doppler
+// factor depends on the camera and stays per hit. Laid out as the RG texels
+// (temperature, brightness) of the shader's diskEmissionMap.
+class DiskEmissionMap
+{
+public:
+    static constexpr int ANGLE_COUNT = 2048;     // a few texels per cell of the finer noise octave at the outer edge
+    static constexpr int RADIUS_COUNT = 256;
+
+    DiskEmissionMap();
+
+    // Bakes the map unless it was baked for the same emission parameters. Returns
+    // true if it changed.
+    bool prepare(const DiskParameters &disk);
+    void bake(const DiskParameters &disk);
+
+    // Bilinear lookup at radial = disk position - hole centre, r = |radial|.
+    glm::vec2 lookup(glm::vec3 radial, float r) const;
+
+    bool isReady() const { return !texels.empty(); }
+    const std::vector<glm::vec2> &getTexels() const { return texels; }
+
+private:
+    DiskParameters baked;
+    std::vector<glm::vec2> texels;     // row-major, ANGLE_COUNT per row
+
+    bool matches(const DiskParameters &disk) const;
+};
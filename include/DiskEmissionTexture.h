@@ -0,0 +1,25 @@
+#pragma once
+
+#include <glad/glad.h>
+
+class DiskEmissionMap;
+
+// The two textures the compute shader colours disk hits with: DiskEmissionMap as
+// diskEmissionMap (RG32F, angle along s repeating, radius along t) and the
+// Blackbody table as blackbodyColors (RGB32F, TABLE_SIZE x 1).
+class DiskEmissionTexture
+{
+private:
+    unsigned int emissionTexture;
+    unsigned int blackbodyTexture;
+
+public:
+    DiskEmissionTexture();
+    ~DiskEmissionTexture();
+
+    DiskEmissionTexture(const DiskEmissionTexture &) = delete;
+    DiskEmissionTexture &operator=(const DiskEmissionTexture &) = delete;
+
+    void upload(const DiskEmissionMap &map) const;
+    void bind(unsigned int emissionUnit, unsigned int blackbodyUnit) const;
+};
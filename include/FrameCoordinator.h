@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "FrameProtocol.h"
+#include "Socket.h"
+#include "WorkerProcesses.h"
+
+// Renders an --animation image sequence on worker processes, each a copy of this
+// executable that keeps its context, textures and caches for every frame it gets.
+// Frames are handed out in contiguous ranges, so a worker's consecutive frames see
+// nearly the same camera. Every frame written is appended to a manifest next to the
+// sequence; a later run of the same job skips the frames listed there, so a crashed
+// or interrupted render resumes where it stopped. Frames of a worker that exits go
+// back to the queue, up to MAX_FRAME_ATTEMPTS times, and a replacement is started.
+class FrameCoordinator
+{
+public:
+    static constexpr std::uint64_t MAX_RANGE = 32;
+    static constexpr unsigned int RANGES_PER_WORKER = 4;    // so late ranges balance the load
+    static constexpr int MAX_FRAME_ATTEMPTS = 3;
+
+    FrameCoordinator() = default;
+    // Tells the workers to exit and waits for them.
+    ~FrameCoordinator();
+
+    FrameCoordinator(const FrameCoordinator &) = delete;
+    FrameCoordinator &operator=(const FrameCoordinator &) = delete;
+
+    // pattern's directory and stem without the '#'s: frames/####.exr keeps its manifest
+    // in frames/manifest.txt.
+    static std::string manifestPath(const std::string &pattern);
+
+    // Reads the manifest of pattern, or starts one. job describes everything the frames
+    // depend on; a manifest written for a different job is an error.
+    bool open(const std::string &pattern, std::uint64_t frameCount, const std::string &job, std::string &error);
+
+    // Starts workerCount copies of this executable with arguments and
+    // --frame-worker ADDRESS and blocks until every frame is written.
+    bool run(unsigned int workerCount, const std::vector<std::string> &arguments, std::string &error);
+
+    void finish();
+
+    std::uint64_t getResumedFrames() const { return resumedFrames; }
+    std::uint64_t getRenderedFrames() const { return renderedFrames; }
+    std::uint64_t getRetriedFrames() const { return retriedFrames; }
+
+private:
+    using Range = std::pair<std::uint64_t, std::uint64_t>;   // first, end
+
+    struct Worker
+    {
+        Socket socket;
+        MessageReader reader{FrameProtocol::MAX_PAYLOAD};
+        std::vector<std::uint64_t> assigned;    // sent, not reported written yet
+        bool waiting = false;                   // asked for a range and got none yet
+        bool lost = false;
+    };
+
+    // Takes in what arrived from worker; false if it is lost, or with error if the
+    // run has to stop.
+    bool receive(Worker &worker, std::string &error);
+    bool handleMessage(Worker &worker, FrameProtocol::MessageType type, const std::vector<std::uint8_t> &payload,
+                       std::string &error);
+    // Queues frames again, first; false if one of them was tried too often.
+    bool requeue(const std::vector<std::uint64_t> &frames, std::string &error);
+
+    std::string pattern;
+    std::ofstream manifest;
+    std::vector<bool> done;
+    std::vector<int> attempts;
+    std::deque<Range> queue;
+    std::uint64_t remainingFrames = 0;
+    std::uint64_t resumedFrames = 0;
+    std::uint64_t renderedFrames = 0;
+    std::uint64_t retriedFrames = 0;
+
+    Socket listener;
+    std::string unixSocketPath;
+    std::vector<Worker> workers;
+    WorkerProcesses processes;
+};
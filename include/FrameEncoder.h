@@ -0,0 +1,110 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Encodes read back frames on a pool of worker threads, straight from the memory
+// they were read into: submit() only queues a pointer, which has to stay valid until
+// wait() returns for the frame. The LDR outputs get the framebuffer as shown (RGBA8,
+// rows bottom to top, as glReadPixels returns them); the HDR ones get the output
+// texture unclamped (RGB float for PFM, RGB half for EXR, rows top to bottom).
+//
+// Image sequences are one file per frame, written by the worker that finishes it;
+// an EXR frame is split into its compression blocks, encoded in parallel. A stream
+// (y4m or raw rgb24 on stdout, e.g. for ffmpeg) has to come out in frame order, so
+// the worker that finishes the frame due next also writes every finished frame
+// queued behind it.
+class FrameEncoder
+{
+public:
+    enum class Output
+    {
+        Ppm,        // 8-bit sequences
+        Pfm,        // float sequences
+        Exr,        // half float sequences, ZIP compressed when built with zlib
+        Y4m,        // stream: YUV4MPEG2, 4:4:4 BT.601 limited range
+        RawRgb      // stream: rgb24 without headers
+    };
+
+    FrameEncoder(Output output, const std::string &path, int width, int height, unsigned int fps,
+                 unsigned int workerCount);
+    ~FrameEncoder();
+
+    FrameEncoder(const FrameEncoder &) = delete;
+    FrameEncoder &operator=(const FrameEncoder &) = delete;
+
+    // "y4m" or "rgb".
+    static bool parseStreamFormat(const char *name, Output &output);
+    // The output for path: streamFormat for "-", else from the extension (.ppm, .pfm, .exr).
+    static bool outputFor(const std::string &path, Output streamFormat, Output &output);
+    static bool isHdr(Output output) { return output == Output::Pfm || output == Output::Exr; }
+    // Of the pixels submit() takes.
+    static std::size_t bytesPerPixel(Output output);
+
+    // Checks the path and writes the stream header.
+    bool open();
+    // Queues the frame at pixels, or records it as lost if pixels is null.
+    void submit(std::uint64_t frame, const std::uint8_t *pixels);
+    // Blocks until the encoder is done with the frame's pixels.
+    void wait(std::uint64_t frame);
+    // Waits for every queued frame; false if any of them couldn't be written.
+    bool finish();
+
+    // Called on an encoder thread once a sequence frame's file was written; set before
+    // the first submit().
+    void setFrameWritten(std::function<void(std::uint64_t)> callback) { frameWritten = std::move(callback); }
+
+    // Path of frame in a sequence: the run of '#' replaced by the zero-padded number.
+    static std::string framePath(const std::string &pattern, std::uint64_t frame);
+
+private:
+    struct Task
+    {
+        std::uint64_t frame;
+        const std::uint8_t *pixels;
+        int block;                  // EXR compression block, or -1 for the whole frame
+    };
+
+    struct PendingFrame
+    {
+        unsigned int remainingTasks;
+        std::vector<std::vector<std::uint8_t>> chunks;  // EXR only
+    };
+
+    const Output output;
+    const std::string path;
+    const int width;
+    const int height;
+    const unsigned int fps;
+    std::FILE *stream;
+
+    std::vector<std::thread> workers;
+    std::mutex queueMutex;
+    std::condition_variable queueChanged;
+    std::deque<Task> tasks;
+    std::map<std::uint64_t, PendingFrame> pendingFrames;
+    bool stopping;
+
+    std::mutex streamMutex;
+    std::map<std::uint64_t, std::vector<std::uint8_t>> finishedFrames;
+    std::uint64_t nextStreamFrame;
+    std::atomic<bool> failed;
+    std::function<void(std::uint64_t)> frameWritten;
+
+    void workerLoop();
+    // Each true if the frame's own file was written.
+    bool encodeFrame(const Task &task, std::vector<std::uint8_t> &encoded);
+    void encodeExrBlock(const Task &task, PendingFrame &pending) const;
+    bool write(std::uint64_t frame, std::vector<std::uint8_t> &encoded);
+    void reportWritten(std::uint64_t frame);
+};
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "CommandLine.h"
+
+class CameraPath;
+
+// The render farm's animation mode: the --animation sequence split into frame ranges
+// across worker processes, which run as --frame-worker (see AnimationRun).
+namespace FrameFarm
+{
+// The command line without --animation-workers: what every frame worker runs, and
+// what the manifest checks a resumed render against.
+std::vector<std::string> workerArguments(int argc, char **argv);
+// --animation-workers: renders the --animation sequence range by range on worker
+// processes, resuming from the manifest of an earlier run; the exit code.
+int renderAnimation(const CommandLine::Options &options, const std::vector<std::string> &arguments,
+                    const CameraPath *path);
+}
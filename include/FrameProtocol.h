@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+class Socket;
+
+// Messages between a FrameCoordinator and its workers, framed by Socket::sendMessage;
+// payloads are little-endian:
+//
+//   worker -> coordinator  NextRange  done with its frames (or just started), wants more
+//   coordinator -> worker  Range      first frame and one past the last to render
+//   worker -> coordinator  FrameDone  a frame whose file was written
+//   coordinator -> worker  Finish     every frame is done; the worker exits
+namespace FrameProtocol
+{
+enum class MessageType : std::uint32_t
+{
+    NextRange = 1,
+    Range = 2,
+    FrameDone = 3,
+    Finish = 4
+};
+
+// Largest payload of any message: a range.
+constexpr std::uint32_t MAX_PAYLOAD = 2 * sizeof(std::uint64_t);
+
+bool send(Socket &socket, MessageType type, const std::vector<std::uint8_t> &payload);
+// False if the connection broke or the message is malformed.
+bool receive(Socket &socket, MessageType &type, std::vector<std::uint8_t> &payload);
+
+std::vector<std::uint8_t> encodeRange(std::uint64_t first, std::uint64_t end);
+bool decodeRange(const std::vector<std::uint8_t> &payload, std::uint64_t &first, std::uint64_t &end);
+std::vector<std::uint8_t> encodeFrame(std::uint64_t frame);
+bool decodeFrame(const std::vector<std::uint8_t> &payload, std::uint64_t &frame);
+}
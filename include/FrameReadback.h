@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+
+#include <glad/glad.h>
+
+#include "FrameEncoder.h"
+
+// Reads frames back into a ring of RING_SIZE pixel pack buffers without stalling and
+// hands them to the encoder in place. Each read is fenced, and frame N is only
+// mapped MAP_DELAY captures later, so reading it back overlaps rendering the next
+// frames and its fence has normally long signalled by then. The buffer then stays
+// mapped while the encoder works on it and is only unmapped when its slot comes
+// round again, so no frame is copied on the CPU before it is encoded.
+//
+// The LDR outputs read the bound read framebuffer (RGBA8, rows bottom to top), i.e.
+// what was presented; the HDR ones read the output texture as it was rendered,
+// without tonemapping or clamping (RGB float or half, rows top to bottom).
+class FrameReadback
+{
+public:
+    static constexpr unsigned int RING_SIZE = 4;
+    static constexpr unsigned int MAP_DELAY = 2;
+
+    // Needs a current context.
+    FrameReadback(int width, int height, FrameEncoder::Output output, FrameEncoder &encoder);
+    ~FrameReadback();
+
+    FrameReadback(const FrameReadback &) = delete;
+    FrameReadback &operator=(const FrameReadback &) = delete;
+
+    // Starts reading the current frame back (from texture for the HDR outputs) as
+    // frameNumber and submits the frame captured MAP_DELAY calls ago.
+    void capture(GLuint texture, std::uint64_t frameNumber);
+    // Submits every frame still in flight, waits for the encoder and unmaps.
+    void flush();
+
+    std::uint64_t getFrameCount() const { return frame; }
+
+private:
+    const int width;
+    const int height;
+    const FrameEncoder::Output output;
+    const GLsizeiptr frameSize;
+    FrameEncoder &encoder;
+    GLuint buffers[RING_SIZE];
+    GLsync fences[RING_SIZE];
+    std::int64_t slotFrames[RING_SIZE];     // frame read into each slot, -1 if none
+    bool mapped[RING_SIZE];
+    std::uint64_t frame;                    // captures so far, which pick the slot
+    std::uint64_t submittedFrames;
+
+    void submit(unsigned int slot);
+    void release(unsigned int slot);
+};
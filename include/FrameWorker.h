@@ -0,0 +1,30 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+#include "Socket.h"
+
+// The worker end of FrameProtocol, driven by OfflineRenderer: asks its
+// FrameCoordinator for a range of frames whenever it finished the last one, and
+// reports each frame as soon as the encoder wrote it.
+class FrameWorker
+{
+public:
+    bool connect(const std::string &address, std::string &error);
+
+    // Blocks for the next range; false once the coordinator said Finish or the
+    // connection is gone (isLost()).
+    bool nextRange(std::uint64_t &first, std::uint64_t &end);
+    // Safe to call from the encoder threads.
+    void frameWritten(std::uint64_t frame);
+
+    bool isLost() const { return lost; }
+
+private:
+    Socket socket;
+    std::mutex sendMutex;
+    std::atomic<bool> lost{false};
+};
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include "Termination.h"
+#include "TracerParameters.h"
+
+// C++ port of the photon tracer in res/computeShader.glsl. Function names follow
+// the shader so the two can be kept in sync side by side.
+namespace Geodesic
+{
+constexpr int MAX_PHI_STEPS = 4000;
+constexpr float DPHI = 0.002f;
+constexpr float R_ESCAPE = 1e6f;
+constexpr float EPSILON_HORIZON = 1e-4f;
+constexpr float EPSILON = 1e-12f;
+constexpr float PI = 3.14159265358979f;
+
+// Adaptive integrator. The phi budget matches the angle the fixed scheme covers in
+// MAX_PHI_STEPS, so both give up on the same near-critical rays.
+constexpr float DEFAULT_TOLERANCE = 1e-5f;
+constexpr float ADAPTIVE_INITIAL_STEP = 0.01f;
+constexpr float ADAPTIVE_MIN_STEP = 1e-5f;
+constexpr float ADAPTIVE_MAX_STEP = 0.5f;
+constexpr float PHI_BUDGET = MAX_PHI_STEPS * DPHI;
+
+// Weak-field fast path: rays with impact parameter b above weakFieldImpactParameter()
+// follow the second order expansion of the orbit in M / b,
+//   b u = sin(psi) + (M/b) (1 + cos^2 psi)
+//       + (M/b)^2 (37/16 sin(psi) + 15/4 (pi/2 - psi) cos(psi) - 3/16 sin(3 psi)),
+// periapsis at psi = pi/2, without integrating. The deflection it leaves out is
+// 16/3 (Rs/b)^3 to leading order, which sets b from an error budget in pixels.
+constexpr float DEFAULT_WEAK_FIELD_BUDGET = 0.5f;  // pixels
+constexpr float WEAK_FIELD_MIN_IMPACT = 10.0f;      // Rs; the expansion is poor below this
+constexpr float WEAK_FIELD_DISK_MARGIN = 0.01f;     // relative, around the annulus edges
+
+// Influence sphere: past the disk and the photon sphere only gravity acts on a ray,
+// and its orbit angle there follows from escapeAngle() without stepping.
+constexpr float INFLUENCE_MARGIN = 0.01f;           // relative, beyond the disk's outer edge
+
+// Per-pixel state at the start of integration, in the ray's orbital plane basis.
+struct PrimaryRay
+{
+    glm::vec3 direction;
+    glm::vec3 e1;
+    glm::vec3 e2;
+    float u0;
+    float up0;
+    float phi0;
+};
+
+void generatePrimaryRay(glm::vec2 ndc, const glm::mat4 &invProj, const glm::mat4 &invView,
+                        glm::vec3 &direction);
+void buildPlaneBasis(glm::vec3 camPos, glm::vec3 rayDir, glm::vec3 bhCenter,
+                     glm::vec3 &e1, glm::vec3 &e2);
+void radialAngularVel(glm::vec3 rayDir, glm::vec3 e1, glm::vec3 e2, float r, float phi,
+                      float &vr, float &vphi);
+
+glm::vec2 rk4Step(glm::vec2 y, float h, float M);
+glm::vec2 dormandPrinceStep(glm::vec2 y, float h, float M, glm::vec2 &error);
+float stepScale(float errorNorm);
+
+// The orbit plane meets the disk plane where r * (cos(phi) n1 + sin(phi) n2), the
+// height above it, changes sign: every pi from the first crossing past phi, or
+// never (+infinity) for an orbit in the disk plane. A ray hits the disk where it
+// crosses inside the annulus; the steps only have to bracket the crossing.
+float nextDiskCrossing(const TracerParameters &params, const PrimaryRay &ray, float phi);
+bool crossesAnnulus(const DiskParameters &disk, float u);
+
+// Early outcome from the conserved 1/b^2 = u'^2 + u^2 (1 - Rs u): Horizon or Escape
+// once the ray's fate is settled and no disk crossing can come first, StepLimit
+// while it is still open.
+float inverseImpactParameterSq(float u, float up, float Rs);
+Termination classifyRay(const TracerParameters &params, float inverseImpactSq, float u, float up);
+float escapeAngle(float u, float up, float Rs);
+// u of the turning point of an orbit with impact parameter above the critical one.
+float turningPoint(float inverseImpactSq, float Rs);
+// Asymptotic phi of a ray that is known to miss the disk and escape: out through
+// its turning point first if it starts ingoing.
+float freeEscapeAngle(const PrimaryRay &ray, float Rs);
+// Angle an ingoing ray below the critical impact parameter covers from u to the horizon.
+float captureAngle(float u, float inverseImpactSq, float Rs);
+
+// Smallest impact parameter that keeps the weak-field error below budgetPixels at
+// pixelAngle radians per pixel; float max (never) for a budget of zero.
+float weakFieldImpactParameter(float Rs, float pixelAngle, float budgetPixels);
+// True with the asymptotic phi of a weak-field ray whose orbit misses the annulus.
+bool weakFieldEscape(const TracerParameters &params, const PrimaryRay &ray, float &phi);
+
+float influenceRadius(const TracerParameters &params);
+// Moves a ray from a camera outside the influence sphere to where it enters it;
+// false with the asymptotic phi for a ray that misses the sphere.
+bool enterInfluenceSphere(const TracerParameters &params, PrimaryRay &ray, float &phi);
+
+// Closed form orbits for Integrator::Analytic. In x = Rs u the Binet equation has the
+// first integral x'^2 = x^3 - x^2 + beta, beta = (Rs / b)^2, so phi is an incomplete
+// elliptic integral over x and x(phi) a Jacobi elliptic function: sn^2 while the cubic
+// has three real roots (b above critical), cn past that. The modulus reaches 1 at the
+// critical beta = 4/27, so rays this close to it in relative terms are left to rk45,
+// like every ray from a camera inside the photon sphere.
+constexpr float ANALYTIC_CRITICAL_MARGIN = 1e-3f;
+// True with the ray's outcome, its u and phi as integrateRay() would leave them.
+bool analyticTrace(const TracerParameters &params, const PrimaryRay &ray, Termination &termination, float &u,
+                   float &phi);
+
+// Procedural sky: at most one star per cell of a grid STARFIELD_CELLS cells per unit
+// direction, over a galactic band. StarfieldCubemap caches its bakes under both, so
+// bump the version with any change to the sky's look.
+constexpr float STARFIELD_CELLS = 180.0f;
+constexpr unsigned int STARFIELD_VERSION = 1;
+glm::vec3 backgroundStarfield(glm::vec3 rayDir);
+// Direction a ray that ends in the sky (Escape or StepLimit) shows it in.
+bool skyDirection(const PrimaryRay &ray, Termination termination, float phi, glm::vec3 &direction);
+
+bool hitDisk(glm::vec3 pos3, glm::vec3 bhCenter, const DiskParameters &disk,
+             float &diskR, glm::vec3 &diskPos);
+void projectOntoDisk(glm::vec3 pos3, glm::vec3 bhCenter, const DiskParameters &disk,
+                     float &diskR, glm::vec3 &diskPos);
+// Emitted temperature (K) and brightness of the disk at diskPos; the colour seen is
+// Blackbody::color(temperature * Doppler factor) * brightness. Brightness is scaled
+// so the inner edge's luminance is the disk's intensity.
+glm::vec2 diskEmission(glm::vec3 diskPos, glm::vec3 bhCenter, const DiskParameters &disk, float r);
+// g = nu_observed / nu_emitted of the orbiting disk at diskPos, blended towards 1
+// by dopplerStrength. Capped at MAX_DOPPLER_FACTOR, the old g^3 <= 8 beaming cap.
+constexpr float MAX_DOPPLER_FACTOR = 2.0f;
+float diskDopplerFactor(glm::vec3 diskPos, glm::vec3 bhCenter, glm::vec3 cameraPos,
+                        const DiskParameters &disk, float diskR);
+
+PrimaryRay setupPrimaryRay(const TracerParameters &params, glm::vec2 pixel);
+Termination integrateRay(const TracerParameters &params, const PrimaryRay &ray, float &u, float &phi,
+                         unsigned int &steps);
+glm::vec3 shadeRay(const TracerParameters &params, const PrimaryRay &ray, Termination termination, float u, float phi);
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <glad/glad.h>
+
+// GPU time of the phases of a frame (compute dispatch, present draw, swap) from
+// GL_TIMESTAMP queries at both ends of each phase. GL_TIME_ELAPSED queries can't be
+// open twice at once or span the swap, timestamps can. A frame's queries take one
+// slot of a ring of RING_SIZE and are only read when the slot comes round again,
+// RING_SIZE - 1 frames later, so reading them never stalls the pipeline; a slot the
+// GPU still hasn't finished then is dropped instead of waited for.
+class GpuTimer
+{
+public:
+    static constexpr unsigned int RING_SIZE = 5;
+    static constexpr std::size_t WINDOW = 240;  // frames the rolling statistics cover
+
+    struct Stats
+    {
+        double min;      // milliseconds
+        double average;
+        double p99;
+        std::size_t samples;
+    };
+
+    explicit GpuTimer(const std::vector<std::string> &phaseNames);
+    ~GpuTimer();
+
+    GpuTimer(const GpuTimer &) = delete;
+    GpuTimer &operator=(const GpuTimer &) = delete;
+
+    // False if the driver has no timestamp counter; every other call is a no-op then.
+    bool isAvailable() const { return available; }
+
+    // Reads the results of the slot this frame reuses, then times phases into it.
+    void beginFrame();
+    void beginPhase(std::size_t phase);
+    void endPhase(std::size_t phase);
+    void endFrame();
+    // Waits for and reads every frame still in flight, for the final statistics.
+    void finish();
+
+    Stats stats(std::size_t phase) const;
+    void printStats(std::ostream &out) const;
+    // One row per frame read back: frame number and milliseconds per phase.
+    bool writeCsv(const std::filesystem::path &path) const;
+
+    std::uint64_t getFrameCount() const { return frame; }
+    std::uint64_t getDroppedFrames() const { return dropped; }
+    // The rows writeCsv() writes; a row's total is the sum of its timed phases.
+    std::size_t getRowCount() const { return rowFrames.size(); }
+    std::uint64_t getRowFrame(std::size_t row) const { return rowFrames[row]; }
+    double getRowTotal(std::size_t row) const;
+
+private:
+    std::vector<std::string> phases;
+    bool available;
+    std::vector<GLuint> queries;            // RING_SIZE slots of (begin, end) per phase
+    std::vector<std::uint8_t> marked;       // per slot and phase: both queries issued
+    std::vector<std::int64_t> slotFrames;   // frame timed in each slot, -1 if none
+    std::uint64_t frame;
+    std::uint64_t dropped;
+    std::vector<std::deque<double>> recent; // last WINDOW times per phase
+    std::vector<std::uint64_t> rowFrames;
+    std::vector<double> rowTimes;           // phases.size() per row, negative if not timed
+
+    unsigned int currentSlot() const { return static_cast<unsigned int>(frame % RING_SIZE); }
+    GLuint query(unsigned int slot, std::size_t phase, bool end) const;
+    void collect(unsigned int slot, bool wait);
+};
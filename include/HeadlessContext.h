@@ -0,0 +1,42 @@
+#pragma once
+
+#include <string>
+
+#include <glad/glad.h>
+
+// OpenGL context without a window or a display server, for --headless: EGL on Mesa's
+// surfaceless platform (EGL_MESA_platform_surfaceless), which GPU drivers and
+// llvmpipe alike provide. Such a context has no default framebuffer, so frames are
+// drawn into an FBO of the window's size that stays bound. Only built when CMake
+// finds EGL; create() fails otherwise.
+class HeadlessContext
+{
+public:
+#if defined(BLACK_HOLE_SIM_HEADLESS)
+    static constexpr bool COMPILED_IN = true;
+#else
+    static constexpr bool COMPILED_IN = false;
+#endif
+
+    HeadlessContext(unsigned int width, unsigned int height);
+    ~HeadlessContext();
+
+    HeadlessContext(const HeadlessContext &) = delete;
+    HeadlessContext &operator=(const HeadlessContext &) = delete;
+
+    // Creates a core profile context of the given version and makes it current.
+    bool create(int majorVersion, int minorVersion, std::string &error);
+    // Creates and binds the framebuffer; needs the GL functions loaded.
+    bool createFramebuffer(std::string &error);
+
+    static void *getProcAddress(const char *name);
+    GLuint getFramebuffer() const { return framebuffer; }
+
+private:
+    const unsigned int width;
+    const unsigned int height;
+    void *display;      // EGLDisplay
+    void *context;      // EGLContext
+    GLuint framebuffer;
+    GLuint colorBuffer;
+};
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+namespace ImageWriter
+{
+// Writes a linear RGB float image (row 0 at the top) as a Portable Float Map.
+bool writePfm(const std::filesystem::path &path, const std::vector<glm::vec4> &pixels, int width, int height);
+// Same from tightly packed RGB float rows, row 0 at the top, written as they are.
+bool writePfm(const std::filesystem::path &path, const float *rgb, int width, int height);
+
+// OpenEXR: one scanline part, HALF B, G, R channels, lines top to bottom, unclamped.
+// Built with zlib, blocks of EXR_ZIP_LINES lines are ZIP compressed; without it every
+// line is stored as its own uncompressed block.
+constexpr int EXR_ZIP_LINES = 16;
+bool writeExr(const std::filesystem::path &path, const std::vector<glm::vec4> &pixels, int width, int height);
+
+// The pieces of writeExr, for writers that encode blocks on several threads.
+int exrLinesPerBlock();
+int exrBlockCount(int height);
+// Magic number, version and attributes; the offset table follows it.
+std::vector<std::uint8_t> exrHeader(int width, int height);
+// One chunk (line number, size, data) of lineCount lines from firstLine on, given
+// as rows of interleaved RGB halves rowStride halves apart, starting at the first line.
+void encodeExrBlock(const std::uint16_t *rows, std::size_t rowStride, int width, int firstLine, int lineCount,
+                    std::vector<std::uint8_t> &chunk);
+bool writeExrChunks(const std::filesystem::path &path, const std::vector<std::uint8_t> &header,
+                    const std::vector<std::vector<std::uint8_t>> &chunks);
+}
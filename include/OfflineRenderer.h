@@ -0,0 +1,69 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "FrameEncoder.h"
+
+class Camera;
+class CameraPath;
+class FrameReadback;
+class FrameWorker;
+
+// --animation: renders a camera path frame by frame as fast as the renderer allows
+// and encodes the frames instead of only showing them. The path turns the camera
+// once around the disk axis from its start position over frameCount frames, or is a
+// --camera-path sampled at fps, so every run renders the same frames. The 8-bit
+// outputs read each frame back from the framebuffer after the present draw, so they
+// are exactly what the window shows (or the headless framebuffer holds); PFM and EXR
+// read the radiance the renderer wrote, before tonemapping.
+//
+// A --frame-worker renders only the frame ranges its FrameCoordinator hands out,
+// with the same camera and file names as the whole animation.
+class OfflineRenderer
+{
+public:
+    static constexpr unsigned int DEFAULT_FRAMES = 240;
+    static constexpr unsigned int DEFAULT_FPS = 30;
+
+    // requested frames (--animation-frames), or else the camera path's length at fps,
+    // or else the default orbit.
+    static unsigned int framesFor(unsigned int requested, const CameraPath *cameraPath, unsigned int fps);
+
+    // Needs a current context; resolution is the framebuffer's, which must not change.
+    // cameraPath, if not null, replaces the orbit and has to outlive the renderer, as
+    // does worker.
+    OfflineRenderer(FrameEncoder::Output output, const std::string &path, unsigned int frameCount, unsigned int fps,
+                    const glm::ivec2 &resolution, const glm::vec3 &start,
+                    const CameraPath *cameraPath, FrameWorker *worker = nullptr);
+    ~OfflineRenderer();
+
+    bool open();
+    // With a worker, asks for the next range once the current one is rendered; that
+    // waits for its frames to be written first.
+    bool isFinished();
+    void positionCamera(Camera &camera) const;
+    // Starts reading the frame just drawn back; call before the swap. texture is the
+    // renderer's output, read by the HDR outputs.
+    void captureFrame(GLuint texture);
+    // Reads back and encodes every frame still in flight; false if any failed.
+    bool finish();
+
+private:
+    const unsigned int frameCount;
+    const unsigned int fps;
+    const glm::vec3 start;
+    const CameraPath *cameraPath;
+    FrameWorker *worker;
+    std::uint64_t frame;
+    std::uint64_t rangeEnd;
+    std::uint64_t renderedFrames;
+    std::chrono::steady_clock::time_point startTime;
+    FrameEncoder encoder;
+    std::unique_ptr<FrameReadback> readback;
+};
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <glad/glad.h>
+
+class PhotonOrbitTable;
+
+// PhotonOrbitTable in the two float textures the compute shader samples in table
+// mode: orbitSamples (COLUMN_COUNT x ANGLE_COUNT, RG = u and du/dphi in units of
+// 1/Rs) and orbitRows (ANGLE_COUNT x 1, RGB = PhotonOrbitTable::Row).
+class OrbitTableTexture
+{
+private:
+    unsigned int samplesTexture;
+    unsigned int rowsTexture;
+
+public:
+    OrbitTableTexture();
+    ~OrbitTableTexture();
+
+    OrbitTableTexture(const OrbitTableTexture &) = delete;
+    OrbitTableTexture &operator=(const OrbitTableTexture &) = delete;
+
+    void upload(const PhotonOrbitTable &table) const;
+    void bind(unsigned int samplesUnit, unsigned int rowsUnit) const;
+};
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Packet integrator for the Binet-equation loop in trace_ray(), either fixed-step
+// RK4 or adaptive Dormand-Prince. Rays are kept
+// in structure-of-arrays form and advanced 4, 8 or 16 at a time depending on the
+// instruction set picked at runtime. Lanes retire independently (horizon, disk,
+// escape, step limit) and are refilled from the stream straight away, so long
+// photon-sphere rays never hold a whole packet hostage.
+//
+// This header is included by the per-ISA translation units, so it must stay free
+// of glm and standard library templates.
+namespace PacketKernel
+{
+enum class Isa
+{
+    Scalar,     // no packets: one Geodesic::integrateRay per pixel
+    Generic,    // 4 lanes, baseline compiler flags
+    Sse,        // 4 lanes, SSE4.2
+    Avx2,       // 8 lanes, AVX2 + FMA
+    Avx512      // 16 lanes, AVX-512F
+};
+
+struct Constants
+{
+    float M;                    // GM/c^2 = Rs / 2
+    float horizonRadius;        // Rs * (1 + epsilon_horizon)
+    float escapeRadius;
+    float diskInnerRadius;
+    float diskOuterRadius;
+    float diskNormal[3];
+    float dphi;
+    std::int32_t maxSteps;
+
+    // Adaptive Dormand-Prince mode, see Geodesic::integrateRay
+    std::int32_t adaptive;
+    float tolerance;
+    float phiBudget;
+    float initialStep;
+    float minStep;
+    float maxStep;
+
+    // Early capture/escape from the conserved 1/b^2, see Geodesic::classifyRay
+    float Rs;
+    float criticalInverseImpactSq;  // 4 / (27 Rs^2)
+    float earlyCaptureRadius;       // ingoing rays past b_c stop inside this radius
+    float earlyEscapeRadius;        // outgoing rays stop outside this radius
+};
+
+// Caller-owned ray streams. u/up/phi hold the initial state on input and the state
+// at termination on output.
+struct RayStreams
+{
+    std::size_t count;
+
+    float *u;
+    float *up;
+    float *phi;
+
+    const float *e1x;
+    const float *e1y;
+    const float *e1z;
+    const float *e2x;
+    const float *e2y;
+    const float *e2z;
+
+    std::uint8_t *termination;  // Termination values
+    std::uint32_t *steps;       // attempted steps, including rejected adaptive ones
+};
+
+Isa detectIsa();
+bool isSupported(Isa isa);
+unsigned int laneCount(Isa isa);
+const char *isaName(Isa isa);
+bool parseIsa(const char *name, Isa &isa);
+
+void integrate(Isa isa, const Constants &constants, const RayStreams &rays);
+
+namespace detail
+{
+void integrateGeneric(const Constants &constants, const RayStreams &rays);
+void integrateSse(const Constants &constants, const RayStreams &rays);
+void integrateAvx2(const Constants &constants, const RayStreams &rays);
+void integrateAvx512(const Constants &constants, const RayStreams &rays);
+}
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <filesystem>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "Geodesic.h"
+#include "Termination.h"
+#include "TracerParameters.h"
+
+// Photon orbits from one camera radius, integrated once and looked up per pixel.
+// Every primary ray starts on an orbit u(phi - phi0) fixed by the camera radius and
+// the ray's starting angle phi0 alone, so one row per phi0 covers the whole frame:
+// disk hits are where the orbit plane meets the disk plane, the background comes
+// from the orbit's asymptotic angle. Lengths are in units of Rs, so a table only
+// depends on the camera radius and is cached on disk under it.
+class PhotonOrbitTable
+{
+public:
+    static constexpr int ANGLE_COUNT = 2048;                // rows, phi0 over (-pi, 0)
+    static constexpr float PHI_SAMPLE = 0.04f;              // column spacing in phi - phi0
+    static constexpr int COLUMN_COUNT = static_cast<int>(Geodesic::PHI_BUDGET / PHI_SAMPLE + 0.5f) + 1;
+    static constexpr int SUBSTEPS = static_cast<int>(PHI_SAMPLE / Geodesic::DPHI + 0.5f);
+    static constexpr float TABLE_RADIUS = 100.0f;           // outgoing rows stop past this radius (Rs)
+    static constexpr float MAX_ROW_GAP = 0.05f;             // end angles of neighbouring rows
+    static constexpr float EDGE_MARGIN = 0.01f;             // relative, around the annulus edges
+    static constexpr int MAX_CACHED_TABLES = 16;
+
+    // Laid out as the RGB texels of the shader's orbitRows texture.
+    struct Row
+    {
+        float termination;      // Termination::Horizon, Escape or StepLimit
+        float endAngle;         // phi - phi0 at the horizon, or asymptotic for escapes
+        float sampledAngle;     // phi - phi0 of the last column that holds a sample
+    };
+
+    PhotonOrbitTable();
+
+    // Makes the table match cameraRadius (in Rs): keeps it, loads it from
+    // cacheDirectory or integrates it. Returns true if it changed.
+    bool prepare(float cameraRadius, const std::filesystem::path &cacheDirectory);
+    // Writes a freshly integrated table to cacheDirectory. Callers wait until the
+    // camera radius settles so a moving camera doesn't fill the cache.
+    void persist(const std::filesystem::path &cacheDirectory);
+    void build(float cameraRadius);
+    bool load(const std::filesystem::path &path, float cameraRadius);
+    bool save(const std::filesystem::path &path) const;
+    static std::filesystem::path cachePath(const std::filesystem::path &cacheDirectory, float cameraRadius);
+
+    // Termination, u and phi as Geodesic::integrateRay would report them; false
+    // where the table can't be trusted and the ray has to be integrated.
+    bool trace(const TracerParameters &params, const Geodesic::PrimaryRay &ray,
+               Termination &termination, float &u, float &phi) const;
+
+    bool isReady() const { return !rows.empty(); }
+    float getRadius() const { return radius; }
+    bool wasLoadedFromCache() const { return loadedFromCache; }
+    const std::vector<Row> &getRows() const { return rows; }
+    const std::vector<glm::vec2> &getSamples() const { return samples; }
+
+private:
+    float radius;
+    bool loadedFromCache;
+    bool saved;
+    std::vector<Row> rows;
+    std::vector<glm::vec2> samples;    // (u, du/dphi) * Rs, row-major, COLUMN_COUNT per row
+
+    bool sampleAt(int row, float angle, glm::vec2 &y) const;
+};
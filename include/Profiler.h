@@ -0,0 +1,69 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+
+// Scoped CPU zones behind --profile, written as Chrome trace-event JSON for
+// chrome://tracing or ui.perfetto.dev. Zones are only compiled in with
+// -DBLACK_HOLE_SIM_PROFILER=ON; otherwise PROFILE_ZONE expands to nothing. Each
+// thread appends to a buffer of its own, so recording takes no lock, and a buffer
+// that is full drops further zones.
+namespace Profiler
+{
+#if defined(BLACK_HOLE_SIM_PROFILER)
+constexpr bool COMPILED_IN = true;
+#else
+constexpr bool COMPILED_IN = false;
+#endif
+
+namespace detail
+{
+inline std::atomic<bool> enabled{false};
+}
+
+// Zones are recorded once enabled; the calling thread is named "main" in the trace.
+void enable();
+inline bool isEnabled() { return detail::enabled.load(std::memory_order_relaxed); }
+
+inline std::uint64_t now()
+{
+    return static_cast<std::uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+// name has to outlive the profiler, a string literal in practice.
+void record(const char *name, std::uint64_t begin, std::uint64_t end);
+// Everything recorded so far; safe while other threads keep recording.
+bool writeTrace(const std::filesystem::path &path);
+std::uint64_t getDroppedZones();
+
+class Zone
+{
+public:
+    explicit Zone(const char *zoneName) : name(zoneName), begin(isEnabled() ? now() : 0) {}
+    ~Zone()
+    {
+        if (begin != 0)
+        {
+            record(name, begin, now());
+        }
+    }
+
+    Zone(const Zone &) = delete;
+    Zone &operator=(const Zone &) = delete;
+
+private:
+    const char *name;
+    std::uint64_t begin;
+};
+}
+
+#if defined(BLACK_HOLE_SIM_PROFILER)
+#define PROFILE_ZONE_JOIN(a, b) a##b
+#define PROFILE_ZONE_NAME(line) PROFILE_ZONE_JOIN(profileZone, line)
+#define PROFILE_ZONE(name) const Profiler::Zone PROFILE_ZONE_NAME(__LINE__)(name)
+#else
+#define PROFILE_ZONE(name) ((void)0)
+#endif
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+#include "Termination.h"
+
+// Integration cost and outcome of a frame's rays, gathered the same way by the CPU
+// tracer and by the compute shader's StepCounter block. Rays that never integrate
+// (closed form, weak field, orbit table, classified tiles) count with 0 steps.
+struct RayStatistics
+{
+    // Bin 0 holds rays without steps, bin k > 0 rays with [2^(k-1), 2^k) steps; the
+    // last bin, 2048 and up, ends at the MAX_PHI_STEPS cap.
+    static constexpr int BIN_COUNT = 13;
+    static constexpr int TERMINATION_COUNT = 4;
+
+    std::uint64_t steps = 0;
+    std::uint64_t rays = 0;
+    std::array<std::uint64_t, TERMINATION_COUNT> terminations{};   // indexed by Termination
+    std::array<std::uint64_t, BIN_COUNT> histogram{};
+
+    void add(unsigned int raySteps, Termination termination);
+    void merge(const RayStatistics &other);
+
+    static int bin(unsigned int raySteps);
+    static unsigned int binStart(int bin);
+};
+
+// What --debug-view shows instead of the image.
+enum class DebugView
+{
+    None,
+    Steps,          // steps per ray on a log scale, black (none) to white (the cap)
+    Termination     // horizon grey, disk orange, escape blue
+};
+
+const char *debugViewName(DebugView view);
+bool parseDebugView(const char *name, DebugView &view);
+// Pixel colour of a ray in view; rays that ran into the step cap are magenta in both.
+// Mirrors debug_color() in computeShader.glsl.
+glm::vec3 debugColor(DebugView view, unsigned int raySteps, Termination termination);
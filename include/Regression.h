@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// Offline comparisons of two tracer variants over every camera preset, run with
+// --regression NAME.
+namespace Regression
+{
+enum class Test
+{
+    None,
+    DiskCrossing,   // original slab disk test against the exact plane crossing
+    Analytic        // the integrators against the closed form orbits
+};
+
+// Pixels with a color channel further apart than this count as differing.
+constexpr float DIFFERENCE_THRESHOLD = 0.05f;
+
+struct ImageDifference
+{
+    double rms;                 // of the largest channel difference per pixel
+    float maxDifference;
+    std::size_t differingPixels;
+    std::size_t pixelCount;
+};
+
+// Most a comparison may differ by and still pass: rms of the per-pixel difference,
+// and the fraction of pixels off by more than DIFFERENCE_THRESHOLD.
+struct Tolerance
+{
+    double rms;
+    double differingFraction;
+};
+
+// slab -> crossing: the slab test misses or smears hits the crossing finds, most of
+// all edge-on (preset 4, about 45% of pixels), so this only catches a disk gone
+// missing or a wrong frame.
+constexpr Tolerance SLAB_TOLERANCE{2.5, 0.5};
+// crossing rk4 -> another integrator and the closed form -> each integrator: only
+// photon ring rays that wind past the phi budget differ, well under 0.1% of pixels.
+constexpr Tolerance INTEGRATOR_TOLERANCE{0.05, 0.001};
+
+bool parseTest(const char *name, Test &test);
+const char *testName(Test test);
+
+ImageDifference compare(const std::vector<glm::vec4> &reference, const std::vector<glm::vec4> &image);
+double differingFraction(const ImageDifference &difference);
+bool isWithin(const ImageDifference &difference, const Tolerance &tolerance);
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "CommandLine.h"
+#include "TracerParameters.h"
+
+class Camera;
+class DiskEmissionMap;
+class PhotonOrbitTable;
+class Shader;
+class StarfieldCubemap;
+
+// The scene, and the setup every render mode shares: the window, --output, the
+// benchmarks and the render farm's workers all render the same hole the same way.
+namespace RenderSetup
+{
+const glm::vec3 BLACK_HOLE_POSITION(0.0f, 0.0f, 0.0f);
+constexpr float SCHWARZSCHILD_RADIUS = 0.5f;
+
+constexpr unsigned int STEP_COUNTER_BINDING = 1;
+constexpr unsigned int ORBIT_SAMPLES_UNIT = 1;
+constexpr unsigned int ORBIT_ROWS_UNIT = 2;
+constexpr unsigned int STARFIELD_UNIT = 3;
+constexpr unsigned int DISK_EMISSION_UNIT = 4;
+constexpr unsigned int BLACKBODY_UNIT = 5;
+
+glm::mat4 inverseProjection(const glm::ivec2 &resolution, float fov);
+// Impact parameter beyond which rays take the weak-field fast path, from the error
+// budget and the angle the center pixel covers.
+float weakFieldImpact(const glm::ivec2 &resolution, const glm::mat4 &invProjection,
+                      const CommandLine::Options &options);
+TracerParameters tracerParameters(const glm::ivec2 &resolution, const glm::mat4 &invProjection,
+                                  const Camera &camera, const DiskParameters &disk,
+                                  const CommandLine::Options &options, const PhotonOrbitTable *orbitTable,
+                                  const StarfieldCubemap *starfield, const DiskEmissionMap *diskEmission);
+
+// Bakes or loads the sky cubemap unless --sky-size 0 asks for the per-ray sky;
+// null in that case.
+const StarfieldCubemap *prepareStarfield(StarfieldCubemap &starfield, const CommandLine::Options &options);
+// Camera distance from the hole in units of Rs, the key of the photon orbit table.
+float orbitTableRadius(const Camera &camera);
+// Loads or integrates the orbit table for the camera and caches it for later runs.
+void prepareOrbitTable(PhotonOrbitTable &orbitTable, const Camera &camera);
+
+// --step-stats, --benchmark and --debug-view steps: the modes the compute shader
+// counts steps and ray outcomes into the StepCounter buffer for.
+bool countsSteps(const CommandLine::Options &options);
+// RenderTarget::shaderDefines() for --output-format, and STEP_COUNTER where
+// countsSteps().
+std::vector<std::string> shaderDefines(const CommandLine::Options &options);
+
+// Compute shader uniforms that only change with the resolution or the options; the
+// shader has to be bound.
+void configureComputeShader(const Shader &computeShader, const glm::ivec2 &resolution, const glm::mat4 &invProjection,
+                            const CommandLine::Options &options, bool useStarfieldMap);
+
+// The --output camera: the preset, or the default start position.
+Camera outputCamera(const CommandLine::Options &options);
+// The --output image, as OpenEXR for a .exr path, else PFM.
+bool writeOutput(const CommandLine::Options &options, const std::vector<glm::vec4> &image,
+                 const glm::ivec2 &resolution);
+
+// glGetString, or "" where the driver has none.
+const char *glString(GLenum name);
+}
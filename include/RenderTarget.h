@@ -0,0 +1,32 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// Storage format of BlackHole's output texture, which the compute shader writes and
+// the present pass reads once per frame. The shader's image layout qualifier and
+// glBindImageTexture both follow from the format, see shaderDefines().
+namespace RenderTarget
+{
+enum class Format
+{
+    Rgba32f,    // 16 bytes per pixel, alpha unused
+    Rgba16f,    // 8 bytes, half float HDR
+    R11g11b10f, // 4 bytes, unsigned small floats, no alpha
+    Rgb10a2     // 4 bytes, normalized: the shader stores the colour clamped to [0, 1]
+};
+
+constexpr Format DEFAULT_FORMAT = Format::Rgba32f;
+
+const char *formatName(Format format);
+bool parseFormat(const char *name, Format &format);
+
+unsigned int internalFormat(Format format);   // GL_RGBA32F, ...
+const char *imageQualifier(Format format);    // rgba32f, ... as in layout(...)
+unsigned int bytesPerPixel(Format format);
+// True when the format only holds [0, 1], so HDR values are clamped before the store.
+bool isNormalized(Format format);
+
+// Compute shader defines: OUTPUT_FORMAT, and OUTPUT_NORMALIZED for normalized formats.
+std::vector<std::string> shaderDefines(Format format);
+}
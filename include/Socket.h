@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Blocking stream socket between coordinators and their worker processes:
+// TCP as "host:port", or a Unix domain socket as "unix:/path". Closed on
+// destruction; sends never raise SIGPIPE, a peer that went away is an error.
+class Socket
+{
+public:
+    Socket() : fd(-1) {}
+    explicit Socket(int fd) : fd(fd) {}
+    ~Socket() { close(); }
+
+    Socket(Socket &&other) noexcept : fd(other.fd) { other.fd = -1; }
+    Socket &operator=(Socket &&other) noexcept;
+    Socket(const Socket &) = delete;
+    Socket &operator=(const Socket &) = delete;
+
+    // A listening socket on address; an existing Unix socket file is replaced.
+    static Socket listen(const std::string &address, std::string &error);
+    static Socket connect(const std::string &address, std::string &error);
+    // Blocks for the next connection; an invalid socket on failure.
+    Socket accept();
+    // For MessageReader; sends still block until they went through.
+    bool setNonBlocking();
+
+    bool isValid() const { return fd >= 0; }
+    int getFd() const { return fd; }
+    void close();
+
+    // Both block until every byte went through; false once the peer is gone.
+    bool sendAll(const void *data, std::size_t size);
+    bool receiveAll(void *data, std::size_t size);
+
+    // A message: its type and payload size (uint32, little-endian), then the payload.
+    bool sendMessage(std::uint32_t type, const std::vector<std::uint8_t> &payload);
+    // False if the connection broke or the payload is implausibly large.
+    bool receiveMessage(std::uint32_t &type, std::vector<std::uint8_t> &payload);
+
+private:
+    int fd;
+};
+
+// Receives Socket messages in a poll() loop without ever waiting for the rest of one,
+// so a peer that stops halfway can't hold up the others: read() takes what has
+// arrived on a non-blocking socket, next() hands out the complete messages. Memory
+// only grows with bytes actually received, up to one message of maxPayload.
+class MessageReader
+{
+public:
+    explicit MessageReader(std::uint32_t maxPayload) : maxPayload(maxPayload) {}
+
+    // Applies to the messages not taken by next() yet.
+    void setMaxPayload(std::uint32_t limit) { maxPayload = limit; }
+
+    // False once the peer is gone, or announced a payload over maxPayload.
+    bool read(Socket &socket);
+    // Takes the next complete message; false if there is none (yet).
+    bool next(std::uint32_t &type, std::vector<std::uint8_t> &payload);
+
+private:
+    std::uint32_t maxPayload;
+    std::vector<std::uint8_t> buffer;
+    std::size_t offset = 0;     // start of the first message not taken yet
+};
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// Geodesic::backgroundStarfield baked once into a mipmapped HDR cubemap, so escaping
+// rays look the sky up instead of evaluating it, and sample it over their footprint
+// instead of point sampling single stars. Faces follow the OpenGL cube map layout,
+// row t of a face at tc = 2 t - 1; texels are RGB9E5 as GL_RGB9_E5 stores them.
+// The sky only depends on the generator constants, so bakes are cached on disk
+// under STARFIELD_CELLS, STARFIELD_VERSION and the face size.
+class StarfieldCubemap
+{
+public:
+    static constexpr int DEFAULT_FACE_SIZE = 1024;  // texels about a pixel wide at the default view
+    static constexpr int FACE_COUNT = 6;
+    static constexpr float REFINE_SPREAD = 1e-3f;   // 2x2 samples differing by more than this go to 4x4
+
+    StarfieldCubemap();
+
+    // Makes the cubemap match faceSize (a power of two): keeps it, loads it from
+    // cacheDirectory or bakes it on threads CPU threads (0 = all) and caches it there.
+    void prepare(int faceSize, const std::filesystem::path &cacheDirectory, unsigned int threads);
+    void bake(int faceSize, unsigned int threads);
+    bool load(const std::filesystem::path &path, int faceSize);
+    bool save(const std::filesystem::path &path) const;
+    static std::filesystem::path cachePath(const std::filesystem::path &cacheDirectory, int faceSize);
+
+    // Trilinear lookup of the sky along direction. Unlike GL_TEXTURE_CUBE_MAP_SEAMLESS
+    // it doesn't filter across face edges, which only matters at the coarsest levels.
+    glm::vec3 sample(glm::vec3 direction, float lod) const;
+    // Mip level whose texels span footprint radians, the angle a pixel covers on the sky.
+    float levelOfDetail(float footprint) const;
+
+    bool isReady() const { return !levels.empty(); }
+    int getFaceSize() const { return faceSize; }
+    int getLevelCount() const { return static_cast<int>(levels.size()); }
+    bool wasLoadedFromCache() const { return loadedFromCache; }
+    // Texels of one mip level: FACE_COUNT faces of size x size, face-major, rows by t.
+    const std::vector<std::uint32_t> &getLevel(int level) const { return levels[static_cast<std::size_t>(level)]; }
+
+    static std::uint32_t packRgb9e5(glm::vec3 color);
+    static glm::vec3 unpackRgb9e5(std::uint32_t texel);
+    // Unit direction through (s, t) in [0, 1]^2 of face, and the face and (s, t) of a direction.
+    static glm::vec3 faceDirection(int face, float s, float t);
+    static int faceCoordinates(glm::vec3 direction, float &s, float &t);
+
+private:
+    int faceSize;
+    bool loadedFromCache;
+    std::vector<std::vector<std::uint32_t>> levels;
+
+    glm::vec3 texel(int level, int face, int x, int y) const;
+    glm::vec3 sampleLevel(int level, int face, float s, float t) const;
+};
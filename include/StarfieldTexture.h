@@ -0,0 +1,23 @@
+#pragma once
+
+#include <glad/glad.h>
+
+class StarfieldCubemap;
+
+// StarfieldCubemap as the GL_RGB9_E5 cube map the compute shader samples as
+// starfieldMap, with its whole mip chain and seamless filtering across faces.
+class StarfieldTexture
+{
+private:
+    unsigned int texture;
+
+public:
+    StarfieldTexture();
+    ~StarfieldTexture();
+
+    StarfieldTexture(const StarfieldTexture &) = delete;
+    StarfieldTexture &operator=(const StarfieldTexture &) = delete;
+
+    void upload(const StarfieldCubemap &cubemap) const;
+    void bind(unsigned int unit) const;
+};
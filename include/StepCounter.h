@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstdint>
+
+#include <glad/glad.h>
+
+#include "RayStatistics.h"
+
+// Shader storage buffer the compute shader adds its integration step and ray counts,
+// ray outcomes and steps-per-ray histogram to (binding 1, block StepCounter).
+// Reading it stalls until the GPU catches up, so callers only sample it every so often.
+class StepCounter
+{
+private:
+    unsigned int bufferID;
+
+public:
+    StepCounter();
+    ~StepCounter();
+
+    StepCounter(const StepCounter &) = delete;
+    StepCounter &operator=(const StepCounter &) = delete;
+
+    void bind(unsigned int binding) const;
+    void reset() const;
+    void read(RayStatistics &statistics) const;
+};
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <chrono>
+#include <memory>
+#include <ostream>
+
+#include "CommandLine.h"
+#include "RayStatistics.h"
+
+class CpuTracer;
+class StepCounter;
+
+// --step-stats and --tile-stats: what the tracer spent its steps and threads on,
+// printed every INTERVAL frames in the window and once for --output. On the GPU the
+// counts come from the StepCounter buffer, which --benchmark reads as well.
+class StepStats
+{
+public:
+    static constexpr unsigned int INTERVAL = 60;   // frames between reports
+
+    // Needs a current context when gpu is set: the StepCounter is created and bound
+    // then, in the modes RenderSetup::countsSteps() builds the compute shader for.
+    StepStats(const CommandLine::Options &options, bool gpu);
+    ~StepStats();
+
+    StepStats(const StepStats &) = delete;
+    StepStats &operator=(const StepStats &) = delete;
+
+    // Null unless the compute shader counts steps.
+    StepCounter *getCounter() const { return counter.get(); }
+
+    // After the dispatch. The counter accumulates over the interval, so the average
+    // covers all its frames; rates are over the interval's wall time, swaps included.
+    void gpuFrameRendered();
+    // After CpuTracer::render(), which took seconds; reports the frame on its own.
+    void cpuFrameRendered(const CpuTracer &tracer, double seconds);
+
+    static void printTiles(std::ostream &out, const CpuTracer &tracer);
+    // Steps per ray and how rays ended, over seconds of rendering.
+    static void printSteps(std::ostream &out, const CommandLine::Options &options, const RayStatistics &statistics,
+                           double seconds);
+
+private:
+    const CommandLine::Options &options;
+    std::unique_ptr<StepCounter> counter;
+    unsigned int frameCount;
+    std::chrono::steady_clock::time_point intervalStart;
+};
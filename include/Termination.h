@@ -0,0 +1,13 @@
+#pragma once
+
+#include <cstdint>
+
+// Why the integrator stopped following a ray. Shared by the scalar tracer and the
+// packet kernels, which is why it lives in its own dependency-free header.
+enum class Termination : std::uint8_t
+{
+    Horizon,
+    Disk,
+    Escape,
+    StepLimit
+};
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "Geodesic.h"
+#include "TracerParameters.h"
+
+// Pre-pass over a screen tile: bounds on the impact parameters of its rays and on
+// how far their directions clear the disk plane decide whether any of them can
+// reach the disk. Tiles that can't are shaded without integrating a single ray.
+// Mirrored by classify_tile() in computeShader.glsl.
+namespace TileClassifier
+{
+enum class TileClass : int
+{
+    Trace = 0,          // integrate every ray
+    Background = 1,     // every ray escapes on the camera's side of the disk plane
+    Shadow = 2          // every ray falls into the hole before reaching the disk plane
+};
+
+// Relative distance from the critical impact parameter 3*sqrt(3)/2 Rs a tile has to
+// keep, so the sweep and deflection bounds below stay well conditioned.
+constexpr float CRITICAL_MARGIN = 0.05f;
+
+struct Bounds
+{
+    float minInverseImpactSq;   // the tile's largest impact parameter
+    float maxInverseImpactSq;   // and its smallest
+    float minClearance;         // sine of the lowest ray direction above the disk plane, seen from the camera's side
+    bool outgoing;              // some ray starts moving away from the hole
+};
+
+Bounds emptyBounds();
+void include(Bounds &bounds, const TracerParameters &params, const Geodesic::PrimaryRay &ray);
+TileClass classify(const TracerParameters &params, const Bounds &bounds);
+
+// Largest angle an ingoing ray of impact parameter b (or larger) from the camera
+// at 1 / u bends away from its starting direction before it escapes.
+float deflectionFromCamera(float u, float inverseImpactSq, float Rs);
+}
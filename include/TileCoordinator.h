@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "Socket.h"
+#include "TileProtocol.h"
+#include "WorkerProcesses.h"
+
+// Splits frames into TileProtocol::TILE_SIZE tiles and hands them to worker processes
+// over a socket: local ones it starts itself, and any that connect to the listening
+// address from other machines. Tiles of a worker that disconnects or exits go back
+// to the queue for the others, up to MAX_TILE_ATTEMPTS times. Workers are read
+// without blocking, and only take tile-sized messages once they said Hello, so
+// anything else connecting can't stall or bloat the coordinator. A worker that hangs
+// without dropping its connection keeps its tiles, though.
+class TileCoordinator
+{
+public:
+    static constexpr std::size_t TILES_IN_FLIGHT = 2;   // per worker, so it never waits for the next tile
+    static constexpr int MAX_TILE_ATTEMPTS = 3;
+
+    TileCoordinator() = default;
+    // Tells the workers to exit and waits for the local ones.
+    ~TileCoordinator();
+
+    TileCoordinator(const TileCoordinator &) = delete;
+    TileCoordinator &operator=(const TileCoordinator &) = delete;
+
+    // address as for Socket; empty for a private Unix socket only local workers know.
+    bool listen(const std::string &address, std::string &error);
+    const std::string &getAddress() const { return address; }
+
+    // Starts count copies of this executable with --tile-worker getAddress() and
+    // arguments.
+    bool spawnWorkers(unsigned int count, const std::vector<std::string> &arguments, std::string &error);
+
+    // Blocks until every tile of job arrived in image (resolution sized, alpha 1). Fails
+    // when a tile failed too often, or when no worker is left and none can connect.
+    bool render(const TileProtocol::Job &job, std::vector<glm::vec4> &image, std::string &error);
+
+    void finish();
+
+    // Connected workers that said Hello.
+    unsigned int getWorkerCount() const;
+    unsigned int getRetriedTiles() const { return retriedTiles; }
+
+private:
+    struct Worker
+    {
+        Socket socket;
+        MessageReader reader{TileProtocol::MAX_HELLO_PAYLOAD};
+        std::string backend;
+        bool hasJob = false;            // said Hello and got the current job
+        std::vector<std::uint32_t> inFlight;
+        bool lost = false;
+    };
+
+    void acceptWorker();
+    // Takes in what arrived from worker; false if it is lost.
+    bool receive(Worker &worker, const TileProtocol::Job &job, const std::vector<TileScheduler::Tile> &tiles,
+                 std::vector<glm::vec4> &image, std::size_t &completed);
+    bool handleMessage(Worker &worker, TileProtocol::MessageType type, const std::vector<std::uint8_t> &payload,
+                       const TileProtocol::Job &job, const std::vector<TileScheduler::Tile> &tiles,
+                       std::vector<glm::vec4> &image, std::size_t &completed);
+
+    Socket listener;
+    std::string address;
+    std::string unixSocketPath;     // removed again by finish()
+    bool acceptsRemoteWorkers = false;
+    std::vector<Worker> workers;
+    WorkerProcesses processes;
+    unsigned int retriedTiles = 0;
+};
@@ -0,0 +1,14 @@
+#pragma once
+
+#include "CommandLine.h"
+
+// The render farm's still modes: the --output frame split into tiles across worker
+// processes, and the --tile-worker end that renders them.
+namespace TileFarm
+{
+// --tile-workers/--listen: renders and writes the --output frame; the exit code.
+int renderFrame(const CommandLine::Options &options);
+// --tile-worker: renders tiles for the coordinator at --tile-worker's address until
+// it says Finish; the exit code.
+int runWorker(const CommandLine::Options &options);
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "RayStatistics.h"
+#include "TileScheduler.h"
+#include "TracerParameters.h"
+
+class Socket;
+
+// Messages between a TileCoordinator and its workers, framed by Socket::sendMessage;
+// payloads are little-endian:
+//
+//   worker -> coordinator  Hello       protocol version, backend name
+//   coordinator -> worker  Job         the frame: resolution, camera and render options
+//   coordinator -> worker  Tile        tile index and its pixel rectangle
+//   worker -> coordinator  TileResult  job id, tile index, RGB float rows of the tile
+//   coordinator -> worker  Finish      no more tiles; the worker exits
+namespace TileProtocol
+{
+constexpr std::uint32_t VERSION = 1;
+// Side of a distributed tile: large enough that a tile outweighs its round trip, a
+// multiple of TileScheduler::TILE_SIZE so workers tile it exactly as a whole frame.
+constexpr int TILE_SIZE = 128;
+static_assert(TILE_SIZE % TileScheduler::TILE_SIZE == 0, "distributed tiles are made of scheduler tiles");
+// Payload limits the coordinator enforces while receiving: until a peer said Hello it
+// may be anything that connected, after that the largest message is a full tile.
+constexpr std::size_t MAX_BACKEND_NAME = 256;    // longer names are cut
+constexpr std::uint32_t MAX_HELLO_PAYLOAD = sizeof(std::uint32_t) + MAX_BACKEND_NAME;
+constexpr std::uint32_t MAX_RESULT_PAYLOAD =
+    2 * sizeof(std::uint32_t) + TILE_SIZE * TILE_SIZE * 3 * sizeof(float);
+
+enum class MessageType : std::uint32_t
+{
+    Hello = 1,
+    Job = 2,
+    Tile = 3,
+    TileResult = 4,
+    Finish = 5
+};
+
+// Everything a worker needs to render any tile exactly as a single process would.
+struct Job
+{
+    std::uint32_t id;
+    glm::ivec2 resolution;
+    glm::vec3 cameraPosition;
+    glm::mat4 invView;
+    float fov;                  // vertical, degrees
+    Integrator integrator;
+    float tolerance;
+    float weakFieldBudget;
+    bool classifyTiles;
+    int skySize;                // 0 = sky per ray
+    DebugView debugView;
+};
+
+bool send(Socket &socket, MessageType type, const std::vector<std::uint8_t> &payload);
+// False if the connection broke or the message is malformed.
+bool receive(Socket &socket, MessageType &type, std::vector<std::uint8_t> &payload);
+
+std::vector<std::uint8_t> encodeHello(const std::string &backend);
+bool decodeHello(const std::vector<std::uint8_t> &payload, std::uint32_t &version, std::string &backend);
+std::vector<std::uint8_t> encodeJob(const Job &job);
+bool decodeJob(const std::vector<std::uint8_t> &payload, Job &job);
+std::vector<std::uint8_t> encodeTile(std::uint32_t index, const TileScheduler::Tile &tile);
+bool decodeTile(const std::vector<std::uint8_t> &payload, std::uint32_t &index, TileScheduler::Tile &tile);
+// pixels holds the tile's rows, RGBA; alpha isn't sent.
+std::vector<std::uint8_t> encodeTileResult(std::uint32_t jobId, std::uint32_t index,
+                                           const std::vector<glm::vec4> &pixels);
+// rgb points into payload, at pixelCount RGB triples.
+bool decodeTileResult(const std::vector<std::uint8_t> &payload, std::uint32_t &jobId, std::uint32_t &index,
+                      std::size_t &pixelCount, const float *&rgb);
+
+// The frame's tiles in scanline order.
+std::vector<TileScheduler::Tile> splitFrame(const glm::ivec2 &resolution);
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Persistent worker pool that renders a frame as 16x16 tiles. Each worker owns a
+// deque seeded with a contiguous run of tiles; it takes work from the front of its
+// own deque and, once that is empty, steals from the back of the others. The
+// calling thread of run() acts as worker 0.
+class TileScheduler
+{
+public:
+    static constexpr int TILE_SIZE = 16; // matches local_size in computeShader.glsl
+
+    struct Tile
+    {
+        int x0;
+        int y0;
+        int x1;
+        int y1;
+    };
+
+    // Per-worker counters for the most recent frame. Idle time is the part of the
+    // frame's wall time the worker spent not rendering tiles.
+    struct WorkerStats
+    {
+        double busySeconds = 0.0;
+        double idleSeconds = 0.0;
+        unsigned int tiles = 0;
+        unsigned int steals = 0;
+    };
+
+    typedef std::function<void(unsigned int worker, const Tile &tile)> TileTask;
+
+private:
+    struct TileQueue
+    {
+        std::mutex mutex;
+        std::deque<Tile> tiles;
+    };
+
+    std::vector<std::unique_ptr<TileQueue>> queues;
+    std::vector<WorkerStats> stats;
+    std::vector<std::thread> helpers;
+    double frameSeconds = 0.0;
+
+    std::mutex frameMutex;
+    std::condition_variable frameStarted;
+    std::condition_variable frameFinished;
+    const TileTask *currentTask = nullptr;
+    std::uint64_t generation = 0;
+    unsigned int pendingHelpers = 0;
+    bool stopping = false;
+
+    void helperLoop(unsigned int worker);
+    void drain(unsigned int worker);
+    bool popOwn(unsigned int worker, Tile &tile);
+    bool steal(unsigned int worker, Tile &tile);
+
+public:
+    explicit TileScheduler(unsigned int workerCount);
+    ~TileScheduler();
+
+    TileScheduler(const TileScheduler &) = delete;
+    TileScheduler &operator=(const TileScheduler &) = delete;
+
+    // Splits a width x height image into tiles and blocks until task has run on every one.
+    void run(int width, int height, const TileTask &task);
+    // Same for a region of an image, tiled from its corner; tiles line up with the
+    // whole image's when the corner is on the TILE_SIZE grid.
+    void run(const Tile &region, const TileTask &task);
+
+    unsigned int getWorkerCount() const { return static_cast<unsigned int>(queues.size()); }
+    const std::vector<WorkerStats> &getStats() const { return stats; }
+    double getFrameSeconds() const { return frameSeconds; }
+};
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "TileProtocol.h"
+
+// The worker end of TileProtocol: connects to a TileCoordinator and renders the
+// tiles it is sent until it is told to finish.
+namespace TileWorker
+{
+// Fills pixels with the tile's rows; false gives up on the connection, and the
+// coordinator hands the tile to another worker.
+using RenderTile =
+    std::function<bool(const TileProtocol::Job &job, const TileScheduler::Tile &tile, std::vector<glm::vec4> &pixels)>;
+
+// backend names the renderer in the coordinator's messages. Returns once the
+// coordinator said Finish (true) or the connection failed (false, with error).
+bool run(const std::string &address, const std::string &backend, const RenderTile &renderTile, std::string &error);
+}
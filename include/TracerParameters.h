@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cmath>
+
+#include <glm/glm.hpp>
+
+#include "RayStatistics.h"
+
+class DiskEmissionMap;
+class PhotonOrbitTable;
+class StarfieldCubemap;
+
+// Accretion disk setup shared by the compute shader uniforms and the CPU tracer.
+struct DiskParameters
+{
+    float innerRadius;
+    float outerRadius;
+    float innerTemperature;     // K at the inner edge, falling as r^(-3/4)
+    float intensity;
+    glm::vec3 normal;
+    glm::vec3 basisX;       // in-plane axes from updateBasis(); angles around the disk
+    glm::vec3 basisZ;       // run from basisX towards basisZ
+    float betaInner;
+    float betaMax;
+    float dopplerStrength;
+    bool enableDopplerBeaming;
+
+    static DiskParameters defaultsFor(float schwarzschildRadius)
+    {
+        DiskParameters disk{};
+        disk.innerRadius = schwarzschildRadius * 3.0f;     // ISCO for Schwarzschild
+        disk.outerRadius = schwarzschildRadius * 20.0f;
+        disk.innerTemperature = 10000.0f;                  // blue-white inside, orange-red outside
+        disk.intensity = 2.0f;
+        disk.normal = glm::vec3(0.0f, 1.0f, 0.0f);         // horizontal disk
+        disk.betaInner = 0.42f;
+        disk.betaMax = 0.45f;
+        disk.dopplerStrength = 0.85f;
+        disk.enableDopplerBeaming = true;
+        disk.updateBasis();
+        return disk;
+    }
+
+    // Recomputes basisX and basisZ after a change of normal.
+    void updateBasis()
+    {
+        const glm::vec3 normalDir = glm::normalize(normal);
+        basisX = glm::normalize(std::abs(normalDir.y) < 0.9f ? glm::cross(normalDir, glm::vec3(0.0f, 1.0f, 0.0f))
+                                                             : glm::cross(normalDir, glm::vec3(1.0f, 0.0f, 0.0f)));
+        basisZ = glm::normalize(glm::cross(normalDir, basisX));
+    }
+};
+
+// Photon path integrator, mirrored by the integratorMode uniform of the compute shader.
+enum class Integrator : int
+{
+    FixedRk4 = 0,       // dphi = 0.002 steps, the original scheme
+    AdaptiveRk45 = 1,   // Dormand-Prince 5(4) with local error control
+    OrbitTable = 2,     // PhotonOrbitTable lookups, AdaptiveRk45 where the table can't be trusted
+    Analytic = 3        // closed form elliptic orbits, AdaptiveRk45 close to the critical impact parameter
+};
+
+// How the CPU tracer finds disk hits; the compute shader always uses Crossing.
+enum class DiskTest : int
+{
+    Crossing = 0,       // exact crossing of the disk plane, refined between steps
+    Slab = 1            // per-step |height| <= 0.01 * outer radius, the original test; scalar reference only
+};
+
+// Everything trace_ray() reads from its uniforms for one frame.
+struct TracerParameters
+{
+    glm::ivec2 resolution;
+    glm::vec3 cameraPos;
+    glm::mat4 invProjection;
+    glm::mat4 invView;
+
+    glm::vec3 bhCenter;
+    float Rs;
+    DiskParameters disk;
+
+    Integrator integrator;
+    float tolerance;            // relative local error per step for AdaptiveRk45
+    const PhotonOrbitTable *orbitTable; // prepared for this camera radius, OrbitTable only
+    DiskTest diskTest;
+    float weakFieldImpact;      // rays with a larger impact parameter skip integration
+    bool classifyTiles;         // shade pure background and shadow tiles without integrating
+    const StarfieldCubemap *starfield;  // baked sky to sample; null evaluates it per ray
+    const DiskEmissionMap *diskEmission; // baked disk emission; null evaluates it per hit
+    DebugView debugView;        // cost or outcome per pixel instead of the image
+};
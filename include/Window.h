@@ -1,10 +1,13 @@
 #pragma once
 
+#include <memory>
 #include <string>
 
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 
+#include "HeadlessContext.h"
+
 class Window
 {
 private:
@@ -16,21 +19,36 @@ private:
     GLFWwindow *window;
     const unsigned int width;
     const unsigned int height;
+    const bool requireComputeShaders;
+    const bool headless;
     bool glfwInitialized;
+    std::unique_ptr<HeadlessContext> headlessContext;
     std::string lastError;
 
     bool initializeGlfw();
     bool createContext();
+    bool createHeadlessContext();
     bool initializeGlad();
     bool validateRuntimeCapabilities();
     void shutdown();
 
 public:
-    Window(unsigned int width, unsigned int height);
+    // A headless window has no GLFW window: it draws into an offscreen framebuffer of
+    // its size (see HeadlessContext), never closes by itself and has no input.
+    Window(unsigned int width, unsigned int height, bool requireComputeShaders = true, bool headless = false);
     ~Window();
 
     bool initialize();
-    GLFWwindow *p_GLFWwindow() const { return window; }
+    bool isHeadless() const { return headless; }
+    bool shouldClose() const;
+    void close();
+    bool isKeyPressed(int key) const;
+    void getFramebufferSize(int &framebufferWidth, int &framebufferHeight) const;
+    void swapBuffers();
+    void pollEvents();
+    // On by default; benchmarks turn it off so frames aren't paced to the display.
+    void setVsync(bool enabled);
+    GLFWwindow *p_GLFWwindow() const { return window; }     // nullptr when headless
     unsigned int getWidth() const { return width; }
     unsigned int getHeight() const { return height; }
     const std::string &getLastError() const { return lastError; }
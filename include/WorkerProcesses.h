@@ -0,0 +1,29 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <sys/types.h>
+
+// Copies of this executable started as workers by TileCoordinator and
+// FrameCoordinator. They share the terminal, so their messages show up as well.
+class WorkerProcesses
+{
+public:
+    WorkerProcesses() = default;
+    // Waits for every worker still running.
+    ~WorkerProcesses() { reap(true); }
+
+    WorkerProcesses(const WorkerProcesses &) = delete;
+    WorkerProcesses &operator=(const WorkerProcesses &) = delete;
+
+    // Starts count workers with arguments.
+    bool spawn(unsigned int count, const std::vector<std::string> &arguments, std::string &error);
+    // Forgets workers that exited; with wait, blocks until all of them did.
+    void reap(bool wait);
+
+    std::size_t getRunningCount() const { return children.size(); }
+
+private:
+    std::vector<pid_t> children;
+};
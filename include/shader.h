@@ -6,6 +6,7 @@
 #include <glad/glad.h>
 #include <sstream>
 #include <string>
+#include <vector>
 
 class Shader
 {
@@ -20,7 +21,8 @@ private:
 
 public:
     Shader(const std::string &vertexPath, const std::string &fragmentPath);
-    explicit Shader(const std::string &computePath);
+    // Each of defines ("NAME" or "NAME VALUE") becomes a #define after the #version line.
+    explicit Shader(const std::string &computePath, const std::vector<std::string> &defines = {});
     ~Shader();
 
     void bind() const;
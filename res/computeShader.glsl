@@ -1,17 +1,21 @@
-#version 460
+#version 430
 
 // ===============================
 // Compute Shader Configuration
 // ===============================
 layout(local_size_x = 16, local_size_y = 16, local_size_z = 1) in;
 
-// Output image
-layout(rgba32f, binding = 0) uniform image2D outputImage;
+// Output image; OUTPUT_FORMAT is injected from RenderTarget::shaderDefines()
+#ifndef OUTPUT_FORMAT
+#define OUTPUT_FORMAT rgba32f
+#endif
+layout(OUTPUT_FORMAT, binding = 0) uniform image2D outputImage;
 
 // ===============================
 // Uniforms
 // ===============================
 uniform ivec2 resolutionVector;   // image_width, image_height
+uniform ivec2 tileOrigin;         // frame pixel of outputImage's (0, 0) when rendering a tile, else (0, 0)
 uniform vec3 cameraPos;
 uniform mat4 invProjection;
 uniform mat4 invView;
@@ -22,14 +26,62 @@ uniform float Rs;                 // Schwarzschild radius
 // Accretion disk parameters
 uniform float diskInnerRadius;   // typically ~3*Rs (ISCO)
 uniform float diskOuterRadius;   // typically ~20*Rs
-uniform vec3 diskColor;           // base color (orange/red)
-uniform float diskIntensity;      // brightness multiplier
 uniform vec3 diskNormal;          // disk plane normal (usually (0,1,0))
+uniform vec3 diskBasisX;          // in-plane axes; disk angles run from X towards Z
+uniform vec3 diskBasisZ;
+uniform sampler2D diskEmissionMap; // angle x radius: (temperature, brightness), see DiskEmissionMap
+uniform sampler2D blackbodyColors; // TABLE_SIZE x 1, see Blackbody
 uniform float diskBetaInner;      // signed orbital speed at inner edge, in units of c
 uniform float diskBetaMax;        // cap for orbital speed, in units of c
 uniform float dopplerStrength;    // blends between no beaming and full beaming
 uniform int enableDopplerBeaming;
 
+// Integrator selection
+uniform int integratorMode;       // 0 = fixed-step RK4, 1 = adaptive Dormand-Prince 5(4), 2 = orbit table, 3 = analytic
+uniform float integratorTolerance; // relative local error per adaptive step
+uniform float weakFieldImpact;    // rays with a larger impact parameter skip integration
+uniform int classifyTiles;        // shade pure background and shadow work groups without integrating
+uniform int debugView;            // 0 = image, 1 = steps per ray, 2 = termination, see DebugView
+
+// Photon orbit table for integratorMode 2, see PhotonOrbitTable
+uniform sampler2D orbitSamples;   // column x row: (u, du/dphi) * Rs
+uniform sampler2D orbitRows;      // row x 1: (termination, end angle, last sampled angle)
+uniform float orbitTableRadius;   // camera radius the table was integrated for, in Rs
+
+// Baked sky, see StarfieldCubemap; without it the sky is evaluated per ray
+uniform samplerCube starfieldMap;
+uniform int useStarfieldMap;
+
+// Integration steps taken, summed over all rays since the host last reset it, with
+// the rays' outcomes and a histogram of their steps, see RayStatistics. Only built
+// with STEP_COUNTER, see RenderSetup::shaderDefines(), so other frames don't pay for
+// the atomics.
+#ifdef STEP_COUNTER
+layout(std430, binding = 1) buffer StepCounter {
+    uint totalStepsLow;
+    uint totalStepsHigh;
+    uint totalRays;
+    uint totalTerminations[4];
+    uint stepHistogram[13];
+};
+
+shared uint groupSteps;
+shared uint groupRays;
+shared uint groupTerminations[4];
+shared uint groupHistogram[13];
+#endif
+
+// Tile pre-pass bounds over the work group's rays, see TileClassifier. Non-negative
+// floats keep their order as uint bits, which lets atomicMin/atomicMax combine them.
+shared uint tileMinInverseImpactSq;
+shared uint tileMaxInverseImpactSq;
+shared uint tileMinClearance;
+shared uint tileOutgoing;
+shared int tileClass;
+
+// Sky directions of the work group's invocations for the baked sky's footprints
+shared vec3 groupSky[256];
+
 // ===============================
 // Constants
 // ===============================
@@ -38,7 +90,52 @@ const float dphi = 0.002;
 const float r_escape = 1e6;
 const float epsilon_horizon = 1e-4;
 const vec3 background_color = vec3(0.003, 0.004, 0.008);
+const float starfield_cells = 180.0;    // Geodesic::STARFIELD_CELLS
+const float blackbody_min_temperature = 500.0;      // Blackbody::MIN_TEMPERATURE
+const float blackbody_max_temperature = 100000.0;   // Blackbody::MAX_TEMPERATURE
+const float max_doppler_factor = 2.0;               // Geodesic::MAX_DOPPLER_FACTOR
 const float EPSILON = 1e-12;
+const float PI = 3.14159265358979;
+const float NO_CROSSING = 1e30;
+
+// Ray outcomes, as the Termination enum
+const int TERMINATION_HORIZON = 0;
+const int TERMINATION_DISK = 1;
+const int TERMINATION_ESCAPE = 2;
+const int TERMINATION_STEP_LIMIT = 3;
+
+// Adaptive integrator. The phi budget matches the angle the fixed scheme covers.
+const float adaptive_initial_step = 0.01;
+const float adaptive_min_step = 1e-5;
+const float adaptive_max_step = 0.5;
+const float phi_budget = float(max_phi_steps) * dphi;
+
+// Weak-field fast path, as in Geodesic.h
+const float weak_field_disk_margin = 0.01;
+const float influence_margin = 0.01;   // influence sphere past the disk's outer edge
+
+// Tile classes, as TileClassifier::TileClass
+const int TILE_TRACE = 0;
+const int TILE_BACKGROUND = 1;
+const int TILE_SHADOW = 2;
+const float tile_critical_margin = 0.05;
+
+// 8 point Gauss-Legendre rule on [-1, 1], symmetric halves
+const float gauss_nodes[4] = float[4](0.1834346425, 0.5255324099, 0.7966664774, 0.9602898565);
+const float gauss_weights[4] = float[4](0.3626837834, 0.3137066459, 0.2223810345, 0.1012285363);
+
+// Photon orbit table layout and trust limits, as in PhotonOrbitTable.h
+const int orbit_angle_count = 2048;
+const int orbit_column_count = 201;
+const float orbit_phi_sample = 0.04;
+const float orbit_max_row_gap = 0.05;
+const float orbit_edge_margin = 0.01;
+
+// Closed form orbits for integratorMode 3, as in Geodesic.h
+const float analytic_critical_margin = 1e-3;
+const int carlson_iterations = 10;
+const int landen_levels = 13;
+const float landen_tolerance = 3e-4;
 
 // ===============================
 // Helper Functions
@@ -113,34 +210,54 @@ vec2 rk4_step(float phi, vec2 y, float h, float M) {
     return y + (h / 6.0) * (k1 + 2.0 * k2 + 2.0 * k3 + k4);
 }
 
-float hash13(vec3 p) {
-    p = fract(p * 0.1031);
-    p += dot(p, p.yzx + 33.33);
-    return fract((p.x + p.y) * p.z);
-}
+// Dormand-Prince 5(4) step: returns the fifth order solution, error receives
+// its difference to the embedded fourth order one
+vec2 dormand_prince_step(vec2 y, float h, float M, out vec2 error) {
+    vec2 k1 = f(0.0, y, M);
+    vec2 k2 = f(0.0, y + h * (1.0 / 5.0) * k1, M);
+    vec2 k3 = f(0.0, y + h * ((3.0 / 40.0) * k1 + (9.0 / 40.0) * k2), M);
+    vec2 k4 = f(0.0, y + h * ((44.0 / 45.0) * k1 - (56.0 / 15.0) * k2 + (32.0 / 9.0) * k3), M);
+    vec2 k5 = f(0.0, y + h * ((19372.0 / 6561.0) * k1 - (25360.0 / 2187.0) * k2
+                              + (64448.0 / 6561.0) * k3 - (212.0 / 729.0) * k4), M);
+    vec2 k6 = f(0.0, y + h * ((9017.0 / 3168.0) * k1 - (355.0 / 33.0) * k2 + (46732.0 / 5247.0) * k3
+                              + (49.0 / 176.0) * k4 - (5103.0 / 18656.0) * k5), M);
+    vec2 next = y + h * ((35.0 / 384.0) * k1 + (500.0 / 1113.0) * k3 + (125.0 / 192.0) * k4
+                         - (2187.0 / 6784.0) * k5 + (11.0 / 84.0) * k6);
+    vec2 k7 = f(0.0, next, M);
 
-float hash12(vec2 p) {
-    vec3 p3 = fract(vec3(p.xyx) * 0.1031);
-    p3 += dot(p3, p3.yzx + 33.33);
-    return fract((p3.x + p3.y) * p3.z);
+    error = h * ((71.0 / 57600.0) * k1 - (71.0 / 16695.0) * k3 + (71.0 / 1920.0) * k4
+                 - (17253.0 / 339200.0) * k5 + (22.0 / 525.0) * k6 - (1.0 / 40.0) * k7);
+    return next;
 }
 
-float noise2(vec2 p) {
-    vec2 i = floor(p);
-    vec2 f = fract(p);
-    vec2 u = f * f * (3.0 - 2.0 * f);
+// Step size multiplier for a step whose error was error_norm times the tolerance
+float step_scale(float error_norm) {
+    if (error_norm <= 0.0) {
+        return 5.0;
+    }
+    return clamp(0.9 * pow(error_norm, -0.2), 0.2, 5.0);
+}
 
-    float a = hash12(i);
-    float b = hash12(i + vec2(1.0, 0.0));
-    float c = hash12(i + vec2(0.0, 1.0));
-    float d = hash12(i + vec2(1.0, 1.0));
+// The orbit plane meets the disk plane where the height r * (cos(phi) n1 + sin(phi) n2)
+// changes sign: every pi from the first crossing past phi, or never for an orbit in
+// the disk plane. Mirrors Geodesic::nextDiskCrossing.
+float next_disk_crossing(float n1, float n2, float phi) {
+    if (n1 * n1 + n2 * n2 <= EPSILON * dot(diskNormal, diskNormal)) {
+        return NO_CROSSING;
+    }
+    float line = atan(n2, n1) + 0.5 * PI;
+    return line + PI * (floor((phi - line) / PI) + 1.0);
+}
 
-    return mix(mix(a, b, u.x), mix(c, d, u.x), u.y);
+float hash13(vec3 p) {
+    p = fract(p * 0.1031);
+    p += dot(p, p.yzx + 33.33);
+    return fract((p.x + p.y) * p.z);
 }
 
 vec3 background_starfield(vec3 ray_dir) {
     vec3 dir = normalize(ray_dir);
-    vec3 scaled = dir * 180.0;
+    vec3 scaled = dir * starfield_cells;
     vec3 cell = floor(scaled);
     vec3 local = fract(scaled) - 0.5;
 
@@ -161,63 +278,43 @@ vec3 background_starfield(vec3 ray_dir) {
     return background_color + galactic_glow + star_color * brightness;
 }
 
-// Check if position intersects the accretion disk
-bool hit_disk(vec3 pos3, vec3 bh_ctr, vec3 disk_norm, float inner_r, float outer_r,
-              out float disk_r, out vec3 disk_pos) {
-    // Project position onto disk plane
-    vec3 to_pos = pos3 - bh_ctr;
-    float height = dot(to_pos, disk_norm);
-    
-    // Check if close to disk plane (thin disk approximation)
-    if (abs(height) > 0.01 * outer_r) {
-        return false;
+// Direction the invocation's ray ended up showing the sky in, zero if it didn't.
+// With the baked sky main() samples it once the work group's footprints are known.
+vec3 sky_direction = vec3(0.0);
+// How the invocation's ray ended; shading the sky or the disk sets it
+int ray_termination = TERMINATION_HORIZON;
+
+vec3 sky(vec3 ray_dir) {
+    ray_termination = TERMINATION_ESCAPE;
+    if (useStarfieldMap != 0) {
+        sky_direction = normalize(ray_dir);
+        return vec3(0.0);
     }
-    
-    // Position in disk plane
-    disk_pos = pos3 - height * disk_norm;
-    vec3 radial = disk_pos - bh_ctr;
-    disk_r = length(radial);
-    
-    // Check if within disk radii
-    return disk_r >= inner_r && disk_r <= outer_r;
+    return background_starfield(ray_dir);
 }
 
-// Calculate disk emission based on radius (simple temperature profile)
-vec3 disk_emission(vec3 disk_pos, vec3 bh_ctr, vec3 disk_norm,
-                   float r, float inner_r, float outer_r,
-                   vec3 base_color, float intensity) {
-    // Simple temperature profile: T ~ r^(-3/4) for thin disk
-    float t = (r - inner_r) / (outer_r - inner_r);
-    float temp_factor = pow(1.0 - t, 0.75);  // hotter near inner edge
-
-    vec3 normal_dir = normalize(disk_norm);
-    vec3 basis_x = normalize(abs(normal_dir.y) < 0.9 ? cross(normal_dir, vec3(0.0, 1.0, 0.0))
-                                                     : cross(normal_dir, vec3(1.0, 0.0, 0.0)));
-    vec3 basis_z = normalize(cross(normal_dir, basis_x));
-    vec3 radial = disk_pos - bh_ctr;
-    vec2 local_uv = vec2(dot(radial, basis_x), dot(radial, basis_z));
-    local_uv /= outer_r;
-
-    float radial_coord = (r - inner_r) / max(outer_r - inner_r, EPSILON);
-    float turbulence = noise2(local_uv * 12.0);
-    turbulence += 0.5 * noise2(local_uv * 24.0);
-    turbulence /= 1.5;
-    float warped_radius = radial_coord + (turbulence * 0.06);
-
-    float banding = 0.5 + 0.5 * sin(warped_radius * 45.0);
-    banding *= 0.5 + 0.5 * sin(warped_radius * 15.0 + 0.8);
-    banding = pow(banding, 1.2);
-
-    float variation = mix(0.65, 1.4, banding) * mix(0.8, 1.2, turbulence);
+// Disk temperature and brightness baked in polar coordinates on the host, see DiskEmissionMap
+vec2 disk_emission(vec3 disk_pos, float r) {
+    vec3 radial = disk_pos - bh_center;
+    float angle = atan(dot(radial, diskBasisZ), dot(radial, diskBasisX));
+    vec2 coord = vec2(angle / (2.0 * PI) + 0.5, (r - diskInnerRadius) / (diskOuterRadius - diskInnerRadius));
+    return texture(diskEmissionMap, coord).rg;
+}
 
-    vec3 hot_color = vec3(1.0, 0.95, 0.8);
-    float heat = clamp(temp_factor + banding * 0.25, 0.0, 1.0);
-    vec3 color = mix(base_color, hot_color, heat);
-    
-    return color * intensity * temp_factor * variation;
+// Colour of a blackbody at temperature, from the log-spaced table, see Blackbody::color
+vec3 blackbody(float temperature) {
+    if (!(temperature > 0.0)) {
+        return vec3(0.0);
+    }
+    float size = float(textureSize(blackbodyColors, 0).x);
+    float position = log(clamp(temperature, blackbody_min_temperature, blackbody_max_temperature) /
+                         blackbody_min_temperature) /
+                     log(blackbody_max_temperature / blackbody_min_temperature);
+    return texture(blackbodyColors, vec2((position * (size - 1.0) + 0.5) / size, 0.5)).rgb;
 }
 
-float disk_beaming_factor(vec3 disk_pos, vec3 bh_ctr, vec3 disk_norm, float disk_r) {
+// Doppler factor g of the orbiting disk at disk_pos, see Geodesic::diskDopplerFactor
+float disk_doppler_factor(vec3 disk_pos, vec3 bh_ctr, vec3 disk_norm, float disk_r) {
     vec3 radial = disk_pos - bh_ctr;
     float radial_len = length(radial);
     if (radial_len <= EPSILON) {
@@ -239,20 +336,562 @@ float disk_beaming_factor(vec3 disk_pos, vec3 bh_ctr, vec3 disk_norm, float disk
                        diskBetaMax);
     tangential_dir *= sign(diskBetaInner == 0.0 ? 1.0 : diskBetaInner);
 
-    vec3 view_dir = normalize(cameraPos - disk_pos);
+    vec3 to_camera = cameraPos - disk_pos;
+    float view_len = length(to_camera);
+    if (view_len <= EPSILON) {
+        return 1.0;
+    }
+
+    vec3 view_dir = to_camera / view_len;
     float cos_theta = clamp(dot(tangential_dir, view_dir), -0.999, 0.999);
     float numerator = sqrt(max(1.0 - beta * beta, 1e-4));
     float denominator = max(1.0 - beta * cos_theta, 0.05);
-    float doppler_factor = numerator / denominator;
-    float beaming = pow(max(doppler_factor, 0.0), 3.0);
+    float doppler_factor = min(numerator / denominator, max_doppler_factor);
 
-    return mix(1.0, min(beaming, 8.0), clamp(dopplerStrength, 0.0, 1.0));
+    return mix(1.0, doppler_factor, clamp(dopplerStrength, 0.0, 1.0));
 }
 
 // ===============================
 // Main Ray Tracing Function
 // ===============================
-vec3 trace_ray(vec2 pixel) {
+
+// b u - sin(psi) of the second order weak-field orbit and its derivative, for
+// epsilon = M / b; see Geodesic.h
+vec2 weak_field_correction(float psi, float epsilon) {
+    float s = sin(psi);
+    float c = cos(psi);
+    float lever = 0.5 * PI - psi;
+    float value = epsilon * (1.0 + c * c) +
+                  epsilon * epsilon * ((37.0 / 16.0) * s + 3.75 * lever * c - (3.0 / 16.0) * sin(3.0 * psi));
+    float slope = -2.0 * epsilon * c * s +
+                  epsilon * epsilon * (-(23.0 / 16.0) * c - 3.75 * lever * s - (9.0 / 16.0) * cos(3.0 * psi));
+    return vec2(value, slope);
+}
+
+// True with the asymptotic phi of a ray whose impact parameter is past
+// weakFieldImpact and whose weak-field orbit misses the annulus. Mirrors
+// Geodesic::weakFieldEscape.
+bool weak_field_escape(float u0, float up0, float phi0, vec3 e1, vec3 e2, out float phi) {
+    phi = phi0;
+    float inverse_impact_sq = up0 * up0 + u0 * u0 * (1.0 - Rs * u0);
+    if (inverse_impact_sq * weakFieldImpact * weakFieldImpact >= 1.0) {
+        return false;
+    }
+
+    float b = 1.0 / sqrt(inverse_impact_sq);
+    float epsilon = 0.5 * Rs / b;
+    float psi = atan(b * u0, b * up0);
+    float overshoot = 0.0;
+    for (int i = 0; i < 3; i++) {
+        vec2 correction = weak_field_correction(psi, epsilon);
+        psi = atan(b * u0 - correction.x, b * up0 - correction.y);
+        overshoot = asin(clamp(weak_field_correction(PI + overshoot, epsilon).x, -1.0, 1.0));
+    }
+
+    float end = phi0 + PI + overshoot - psi;
+    for (float crossing = next_disk_crossing(dot(e1, diskNormal), dot(e2, diskNormal), phi0);
+         crossing < end; crossing += PI) {
+        float angle = psi + (crossing - phi0);
+        float r = b / max(sin(angle) + weak_field_correction(angle, epsilon).x, EPSILON);
+        if (r * (1.0 + weak_field_disk_margin) >= diskInnerRadius &&
+            r * (1.0 - weak_field_disk_margin) <= diskOuterRadius) {
+            return false;
+        }
+    }
+
+    phi = end;
+    return true;
+}
+
+// Emission of the disk at disk_pos, disk_r from the hole, Doppler shifted
+vec3 disk_color(vec3 disk_pos, float disk_r) {
+    ray_termination = TERMINATION_DISK;
+    vec2 emission = disk_emission(disk_pos, disk_r);
+    float doppler = enableDopplerBeaming != 0 ? disk_doppler_factor(disk_pos, bh_center, diskNormal, disk_r) : 1.0;
+    return blackbody(emission.x * doppler) * emission.y;
+}
+
+// True with the disk's color if a crossing of the disk plane at (u, phi) lies
+// inside the annulus
+bool land_on_disk(float u, float phi, vec3 e1, vec3 e2, out vec3 color) {
+    color = vec3(0.0);
+    float r = 1.0 / max(u, EPSILON);
+    if (r < diskInnerRadius || r > diskOuterRadius) {
+        return false;
+    }
+    vec3 pos3 = from_plane_coords(r * cos(phi), r * sin(phi), e1, e2, bh_center);
+    vec3 disk_pos = pos3 - dot(pos3 - bh_center, diskNormal) * diskNormal;
+    color = disk_color(disk_pos, length(disk_pos - bh_center));
+    return true;
+}
+
+// Horizon and escape tests at (r, phi); returns true with the final color when
+// the ray is done. Disk hits are found between steps, see next_disk_crossing.
+bool check_termination(float r, float phi, vec3 e1, vec3 e2, out vec3 color) {
+    float x = r * cos(phi);
+    float y2d = r * sin(phi);
+    vec3 pos3 = from_plane_coords(x, y2d, e1, e2, bh_center);
+    color = vec3(0.0);
+
+    // Check if absorbed by horizon
+    if (r <= Rs * (1.0 + epsilon_horizon)) {
+        return true;  // Black hole absorption
+    }
+
+    // Check if escaped to infinity
+    if (r >= r_escape) {
+        color = sky(pos3 - bh_center);
+        return true;
+    }
+
+    return false;
+}
+
+// Angle still to go until u falls to 1 / r_escape on an outgoing ray, by 8 point
+// Gauss-Legendre on the substitution u = u_esc + (u - u_esc)(1 - t^2); mirrors
+// Geodesic::escapeAngle on the CPU
+float escape_angle(float u, float up) {
+    float u_escape = 1.0 / r_escape;
+    float span = max(u - u_escape, 0.0);
+    float inverse_impact_sq = up * up + u * u * (1.0 - Rs * u);
+
+    float angle = 0.0;
+    for (int i = 0; i < 8; i++) {
+        float node = i < 4 ? -gauss_nodes[i] : gauss_nodes[i - 4];
+        float t = 0.5 * (1.0 + node);
+        float ut = u_escape + span * (1.0 - t * t);
+        float radicand = max(inverse_impact_sq - ut * ut * (1.0 - Rs * ut), EPSILON);
+        angle += gauss_weights[i % 4] * span * t / sqrt(radicand);
+    }
+    return angle;
+}
+
+// Integral of du / sqrt(1/b^2 - u^2 (1 - Rs u)) over [u0, u1], no turning point inside
+float orbit_angle(float u0, float u1, float inverse_impact_sq) {
+    float half_span = 0.5 * (u1 - u0);
+    float angle = 0.0;
+    for (int i = 0; i < 8; i++) {
+        float node = i < 4 ? -gauss_nodes[i] : gauss_nodes[i - 4];
+        float u = u0 + half_span * (1.0 + node);
+        float radicand = max(inverse_impact_sq - u * u * (1.0 - Rs * u), EPSILON);
+        angle += gauss_weights[i % 4] * half_span / sqrt(radicand);
+    }
+    return angle;
+}
+
+// u of the turning point for an impact parameter above the critical one; mirrors
+// Geodesic::turningPoint
+float turning_point(float inverse_impact_sq) {
+    float turn = sqrt(inverse_impact_sq);
+    for (int i = 0; i < 6; i++) {
+        turn -= (turn * turn * (1.0 - Rs * turn) - inverse_impact_sq) / (turn * (2.0 - 3.0 * Rs * turn));
+    }
+    return turn;
+}
+
+// Asymptotic phi of a ray known to miss the disk; mirrors Geodesic::freeEscapeAngle
+float free_escape_angle(float u0, float up0, float phi0) {
+    float start_angle = escape_angle(u0, up0);
+    if (up0 <= 0.0) {
+        return phi0 + start_angle;
+    }
+    float turn = turning_point(up0 * up0 + u0 * u0 * (1.0 - Rs * u0));
+    return phi0 + 2.0 * escape_angle(turn, 0.0) - start_angle;
+}
+
+// Angle an ingoing ray below the critical impact parameter covers from u to the
+// horizon, split at the photon sphere; mirrors Geodesic::captureAngle
+float capture_angle(float u, float inverse_impact_sq) {
+    float u_photon_sphere = 2.0 / (3.0 * Rs);
+    if (u >= u_photon_sphere) {
+        return orbit_angle(u, 1.0 / Rs, inverse_impact_sq);
+    }
+    return orbit_angle(u, u_photon_sphere, inverse_impact_sq) +
+           orbit_angle(u_photon_sphere, 1.0 / Rs, inverse_impact_sq);
+}
+
+// Moves y and phi from a camera outside the influence sphere to where the ray
+// enters it; false with phi at the asymptotic angle for a ray that misses it.
+// Mirrors Geodesic::enterInfluenceSphere
+bool enter_influence_sphere(inout vec2 y, inout float phi) {
+    float u_sphere = 1.0 / (max(diskOuterRadius, 1.5 * Rs) * (1.0 + influence_margin));
+    if (y.x >= u_sphere || y.y <= 0.0) {
+        return true;
+    }
+
+    float inverse_impact_sq = y.y * y.y + y.x * y.x * (1.0 - Rs * y.x);
+    float start_angle = escape_angle(y.x, y.y);
+    float up_sphere_sq = inverse_impact_sq - u_sphere * u_sphere * (1.0 - Rs * u_sphere);
+    if (up_sphere_sq > 0.0) {
+        float up_sphere = sqrt(up_sphere_sq);
+        phi += escape_angle(u_sphere, up_sphere) - start_angle;
+        y = vec2(u_sphere, up_sphere);
+        return true;
+    }
+
+    phi = free_escape_angle(y.x, y.y, phi);
+    return false;
+}
+
+// Settles capture or escape from the conserved 1/b^2 = u'^2 + u^2 (1 - Rs u)
+// before the integrator gets there; mirrors Geodesic::classifyRay
+bool early_outcome(vec2 y, float inverse_impact_sq, float phi, vec3 e1, vec3 e2, out vec3 color) {
+    float r = 1.0 / max(y.x, EPSILON);
+    color = vec3(0.0);
+
+    // Past the critical impact parameter, falling in, inside the disk: captured
+    if (y.y > 0.0 && inverse_impact_sq > 4.0 / (27.0 * Rs * Rs) && r < diskInnerRadius) {
+        return true;
+    }
+
+    // Outgoing beyond the disk and the photon sphere: escapes at a known angle
+    if (y.y < 0.0 && r > max(diskOuterRadius, 1.5 * Rs)) {
+        float phi_inf = phi + escape_angle(y.x, y.y);
+        color = sky(cos(phi_inf) * e1 + sin(phi_inf) * e2);
+        return true;
+    }
+
+    return false;
+}
+
+// The two table rows bracketing a ray's phi0 and its weight between them
+struct OrbitRows {
+    int first;
+    vec3 a;
+    vec3 b;
+    float weight;
+    float phi0;
+};
+
+// Cubic Hermite interpolation of (u, du/dphi) * Rs along one row; false past its
+// last sample, with y holding that sample
+bool orbit_row_sample(int row, vec3 info, float angle, out vec2 y) {
+    if (angle > info.z) {
+        y = texelFetch(orbitSamples, ivec2(int(info.z / orbit_phi_sample + 0.5), row), 0).xy;
+        return false;
+    }
+
+    float position = max(angle, 0.0) / orbit_phi_sample;
+    int column = min(int(position), orbit_column_count - 2);
+    float t = position - float(column);
+    vec2 y0 = texelFetch(orbitSamples, ivec2(column, row), 0).xy;
+    vec2 y1 = texelFetch(orbitSamples, ivec2(column + 1, row), 0).xy;
+
+    float t2 = t * t;
+    float t3 = t2 * t;
+    y.x = (2.0 * t3 - 3.0 * t2 + 1.0) * y0.x + (t3 - 2.0 * t2 + t) * orbit_phi_sample * y0.y +
+          (-2.0 * t3 + 3.0 * t2) * y1.x + (t3 - t2) * orbit_phi_sample * y1.y;
+    y.y = (6.0 * t2 - 6.0 * t) * (y0.x - y1.x) / orbit_phi_sample + (3.0 * t2 - 4.0 * t + 1.0) * y0.y +
+          (3.0 * t2 - 2.0 * t) * y1.y;
+    return true;
+}
+
+// (u, du/dphi) along the blended orbit at phi = angle
+bool orbit_at(OrbitRows rows, float angle, out vec2 y) {
+    vec2 ya;
+    vec2 yb;
+    bool sampled_a = orbit_row_sample(rows.first, rows.a, angle - rows.phi0, ya);
+    bool sampled_b = orbit_row_sample(rows.first + 1, rows.b, angle - rows.phi0, yb);
+    y = mix(ya, yb, rows.weight) / Rs;
+    return sampled_a && sampled_b;
+}
+
+// Looks the ray up in the photon orbit table; false where the table can't be
+// trusted and the ray has to be integrated. Mirrors PhotonOrbitTable::trace.
+bool trace_orbit_table(float u0, float phi0, vec3 e1, vec3 e2, out vec3 color) {
+    color = vec3(0.0);
+    float r0 = 1.0 / max(u0, EPSILON);
+    if (abs(r0 / Rs - orbitTableRadius) > 1e-4 * orbitTableRadius) {
+        return false;
+    }
+
+    float position = (clamp(phi0, -PI, 0.0) + PI) * float(orbit_angle_count) / PI - 0.5;
+    OrbitRows rows;
+    rows.first = clamp(int(floor(position)), 0, orbit_angle_count - 2);
+    rows.weight = clamp(position - float(rows.first), 0.0, 1.0);
+    rows.a = texelFetch(orbitRows, ivec2(rows.first, 0), 0).xyz;
+    rows.b = texelFetch(orbitRows, ivec2(rows.first + 1, 0), 0).xyz;
+    rows.phi0 = phi0;
+    // Termination::Escape = 2, StepLimit = 3
+    if (rows.a.x != rows.b.x || rows.a.x == 3.0 || abs(rows.a.y - rows.b.y) > orbit_max_row_gap) {
+        return false;
+    }
+    bool escapes = rows.a.x == 2.0;
+    float end = phi0 + mix(rows.a.y, rows.b.y, rows.weight);
+
+    for (float crossing = next_disk_crossing(dot(e1, diskNormal), dot(e2, diskNormal), phi0);
+         crossing < end; crossing += PI) {
+        vec2 y;
+        bool sampled = orbit_at(rows, crossing, y);
+        float crossing_r = 1.0 / max(y.x, EPSILON);
+        if (!sampled) {
+            if (escapes ? crossing_r > diskOuterRadius * (1.0 + orbit_edge_margin)
+                        : crossing_r < diskInnerRadius * (1.0 - orbit_edge_margin)) {
+                continue;
+            }
+            return false;
+        }
+
+        if (crossing_r >= diskInnerRadius * (1.0 + orbit_edge_margin) &&
+            crossing_r <= diskOuterRadius * (1.0 - orbit_edge_margin)) {
+            return land_on_disk(y.x, crossing, e1, e2, color);
+        }
+        if (crossing_r * (1.0 + orbit_edge_margin) >= diskInnerRadius &&
+            crossing_r * (1.0 - orbit_edge_margin) <= diskOuterRadius) {
+            return false;
+        }
+    }
+
+    if (escapes) {
+        color = sky(cos(end) * e1 + sin(end) * e2);
+    }
+    return true;
+}
+
+// Carlson's symmetric R_F(x, y, z), by duplication and a fifth order series
+float carlson_rf(float x, float y, float z) {
+    for (int i = 0; i < carlson_iterations; i++) {
+        float sx = sqrt(x);
+        float sy = sqrt(y);
+        float sz = sqrt(z);
+        float lambda = sx * (sy + sz) + sy * sz;
+        x = 0.25 * (x + lambda);
+        y = 0.25 * (y + lambda);
+        z = 0.25 * (z + lambda);
+    }
+    float mean = (x + y + z) / 3.0;
+    float dx = 1.0 - x / mean;
+    float dy = 1.0 - y / mean;
+    float dz = -dx - dy;
+    float e2 = dx * dy - dz * dz;
+    float e3 = dx * dy * dz;
+    return (1.0 - e2 / 10.0 + e3 / 14.0 + e2 * e2 / 24.0 - 3.0 * e2 * e3 / 44.0) / sqrt(mean);
+}
+
+// F of the amplitude with sin^2 = sin_sq, cos^2 = cos_sq, for parameter 1 - complement
+float elliptic_f(float sin_sq, float cos_sq, float complement) {
+    return sqrt(sin_sq) * carlson_rf(cos_sq, cos_sq + complement * sin_sq, 1.0);
+}
+
+// Jacobi sn and cn of w for parameter 1 - complement, by descending Landen transformations
+vec2 jacobi_sn_cn(float w, float complement) {
+    float means[landen_levels];
+    float roots[landen_levels];
+    float a = 1.0;
+    float c = 1.0;
+    int levels = 0;
+    while (levels < landen_levels) {
+        means[levels] = a;
+        complement = sqrt(complement);
+        roots[levels] = complement;
+        c = 0.5 * (a + complement);
+        levels++;
+        if (abs(a - complement) <= landen_tolerance * a) {
+            break;
+        }
+        complement *= a;
+        a = c;
+    }
+
+    w *= c;
+    float sn = sin(w);
+    float cn = cos(w);
+    if (sn == 0.0) {
+        return vec2(sn, cn);
+    }
+
+    float ratio = cn / sn;
+    c *= ratio;
+    float dn = 1.0;
+    for (int level = levels - 1; level >= 0; level--) {
+        float mean = means[level];
+        ratio *= c;
+        c *= dn;
+        dn = (roots[level] + ratio) / (mean + ratio);
+        ratio = c / mean;
+    }
+    ratio = 1.0 / sqrt(c * c + 1.0);
+    sn = sn >= 0.0 ? ratio : -ratio;
+    return vec2(sn, c * sn);
+}
+
+// x = Rs u as an elliptic function of w = rate * phi + const; see Geodesic.cpp
+struct EllipticOrbit {
+    bool bounded;       // three real roots: turns around at x2
+    float root;         // x1
+    float scale;        // x2 - x1, or A
+    float complement;   // 1 - k^2
+    float rate;
+    float quarter;      // K(k)
+};
+
+EllipticOrbit elliptic_orbit(float beta) {
+    const float critical_beta = 4.0 / 27.0;
+    const float two_over_root3 = 1.1547005384;
+    EllipticOrbit orbit;
+    orbit.bounded = beta < critical_beta;
+    if (orbit.bounded) {
+        float t = (2.0 / 3.0) * asin(min(sqrt(6.75 * beta), 1.0));
+        float gap = (2.0 / 3.0) * asin(min(sqrt(6.75 * (critical_beta - beta)), 1.0));
+        float span = two_over_root3 * sin(t);
+        float upper = two_over_root3 * sin(gap);
+        orbit.root = -(4.0 / 3.0) * sin(0.5 * t) * sin(gap + 0.5 * t);
+        orbit.scale = span;
+        orbit.complement = upper / (span + upper);
+        orbit.rate = 0.5 * sqrt(span + upper);
+    } else {
+        float h = (2.0 / 3.0) * asinh(sqrt(6.75 * (beta - critical_beta)));
+        float sinh_half = sinh(0.5 * h);
+        float x1 = 1.0 / 3.0 - (2.0 / 3.0) * cosh(h);
+        float m_offset = 0.5 * (1.0 - 3.0 * x1);
+        float n_sq = sinh_half * sinh_half * (1.0 - x1);
+        float a = sqrt(m_offset * m_offset + n_sq);
+        orbit.root = x1;
+        orbit.scale = a;
+        orbit.complement = n_sq / (2.0 * a * (a + m_offset));
+        orbit.rate = sqrt(a);
+    }
+    orbit.quarter = carlson_rf(0.0, orbit.complement, 1.0);
+    return orbit;
+}
+
+// w in [0, K] (bounded) or [0, 2K) of the orbit point x with slope x'^2 = slope_sq
+float orbit_argument(EllipticOrbit orbit, float x, float slope_sq) {
+    float offset = max(x - orbit.root, 0.0);
+    if (orbit.bounded) {
+        float sin_sq = min(offset / orbit.scale, 1.0);
+        float outer = 4.0 * orbit.rate * orbit.rate;
+        float cos_sq = sin_sq > 0.5 ? min(slope_sq / (offset * (outer - offset) * orbit.scale), 1.0)
+                                    : 1.0 - sin_sq;
+        return elliptic_f(sin_sq, cos_sq, orbit.complement);
+    }
+    float sum = orbit.scale + offset;
+    float cn = (orbit.scale - offset) / sum;
+    float half_argument = elliptic_f(4.0 * orbit.scale * offset / (sum * sum), cn * cn, orbit.complement);
+    return cn >= 0.0 ? half_argument : 2.0 * orbit.quarter - half_argument;
+}
+
+float orbit_point(EllipticOrbit orbit, float w) {
+    vec2 sn_cn = jacobi_sn_cn(w, orbit.complement);
+    if (orbit.bounded) {
+        return orbit.root + orbit.scale * sn_cn.x * sn_cn.x;
+    }
+    return orbit.root + orbit.scale * (1.0 - sn_cn.y) / max(1.0 + sn_cn.y, EPSILON);
+}
+
+// Follows the ray along its closed form orbit; false for the rays left to rk45
+// (close to the critical impact parameter, or a camera inside the photon sphere).
+// Mirrors Geodesic::analyticTrace.
+bool analytic_trace(float u0, float up0, float phi0, vec3 e1, vec3 e2, out vec3 color) {
+    color = vec3(0.0);
+    float x0 = Rs * u0;
+    float xp0 = Rs * up0;
+    float beta = xp0 * xp0 + x0 * x0 * (1.0 - x0);
+    const float critical_beta = 4.0 / 27.0;
+    if (x0 >= 2.0 / 3.0 || abs(beta - critical_beta) <= analytic_critical_margin * critical_beta) {
+        return false;
+    }
+
+    EllipticOrbit orbit = elliptic_orbit(beta);
+    bool ingoing = up0 > 0.0;
+    float start = orbit_argument(orbit, x0, xp0 * xp0) * (ingoing ? 1.0 : -1.0);
+    bool escapes = !ingoing || orbit.bounded;
+    float end;
+    if (!ingoing) {
+        end = -orbit_argument(orbit, 0.0, beta);
+    } else if (orbit.bounded) {
+        end = 2.0 * orbit.quarter - orbit_argument(orbit, 0.0, beta);
+    } else {
+        end = orbit_argument(orbit, 1.0, beta);
+    }
+    float end_phi = phi0 + (end - start) / orbit.rate;
+
+    for (float crossing = next_disk_crossing(dot(e1, diskNormal), dot(e2, diskNormal), phi0);
+         crossing < end_phi; crossing += PI) {
+        float x = orbit_point(orbit, start + orbit.rate * (crossing - phi0));
+        if (land_on_disk(x / Rs, crossing, e1, e2, color)) {
+            return true;
+        }
+    }
+
+    if (escapes) {
+        color = sky(cos(end_phi) * e1 + sin(end_phi) * e2);
+    }
+    return true;
+}
+
+// Adaptive Dormand-Prince integration of y = [u, up] from phi0; mirrors
+// Geodesic::integrateRay on the CPU
+vec3 integrate_adaptive(vec2 y, float phi0, vec3 e1, vec3 e2, vec3 ray_dir, float M, out uint steps) {
+    float phi = phi0;
+    float h = adaptive_initial_step;
+    float inverse_impact_sq = y.y * y.y + y.x * y.x * (1.0 - Rs * y.x);
+    float crossing = next_disk_crossing(dot(e1, diskNormal), dot(e2, diskNormal), phi0);
+
+    bool moved = true;
+    vec3 color;
+    for (steps = 0u; steps < uint(max_phi_steps); steps++) {
+        if (moved) {
+            float r = 1.0 / max(y.x, EPSILON);
+            if (check_termination(r, phi, e1, e2, color) ||
+                early_outcome(y, inverse_impact_sq, phi, e1, e2, color)) {
+                return color;
+            }
+            if (phi - phi0 >= phi_budget) {
+                break;
+            }
+            moved = false;
+        }
+
+        vec2 error;
+        vec2 next = dormand_prince_step(y, h, M, error);
+        float scale = integratorTolerance * max(abs(y.x) + abs(y.y), abs(next.x) + abs(next.y));
+        float error_norm = (abs(error.x) + abs(error.y)) / max(scale, EPSILON);
+        if (error_norm > 1.0 && h > adaptive_min_step) {
+            h = max(h * step_scale(error_norm), adaptive_min_step);
+            continue;
+        }
+
+        float next_phi = phi + h;
+        if (crossing <= next_phi) {
+            // A shorter step from the same point lands exactly on the disk plane
+            vec2 crossing_error;
+            vec2 on_plane = dormand_prince_step(y, crossing - phi, M, crossing_error);
+            if (land_on_disk(on_plane.x, crossing, e1, e2, color)) {
+                return color;
+            }
+            crossing += PI;
+        }
+
+        // Escaping: pull phi back to where u reached 1 / r_escape
+        if (next.x <= 1.0 / r_escape && next.y < 0.0) {
+            next_phi -= (next.x - 1.0 / r_escape) / next.y;
+            next.x = 0.0;
+        }
+
+        y = next;
+        phi = next_phi;
+        h = min(h * step_scale(error_norm), adaptive_max_step);
+        moved = true;
+    }
+
+    // Phi budget or max steps reached - return background
+    vec3 background = sky(ray_dir);
+    ray_termination = TERMINATION_STEP_LIMIT;
+    return background;
+}
+
+// Per-pixel state at the start of integration, in the ray's orbital plane basis
+struct PrimaryRay {
+    vec3 dir;
+    vec3 e1;
+    vec3 e2;
+    float u0;
+    float up0;
+    float phi0;
+};
+
+PrimaryRay setup_primary_ray(vec2 pixel) {
     // 1) Map pixel to NDC coordinates
     vec2 uv = (vec2(pixel) + 0.5) / vec2(resolutionVector);
     vec2 ndc = vec2(uv.x * 2.0 - 1.0, -(uv.y * 2.0 - 1.0));
@@ -278,67 +917,272 @@ vec3 trace_ray(vec2 pixel) {
     float dphidl = max(vphi, EPSILON);
     float u0 = 1.0 / max(r0, EPSILON);
     float up0 = -(1.0 / (r0 * r0)) * (vr / dphidl);
-    
-    // 6) Integrate photon path using RK4
+    return PrimaryRay(ray_dir, e1, e2, u0, up0, phi0);
+}
+
+// Bend an ingoing ray of 1/b^2 = inverse_impact_sq from the camera at 1 / u picks
+// up before it escapes; mirrors TileClassifier::deflectionFromCamera
+float deflection_from_camera(float u, float inverse_impact_sq) {
+    float up = sqrt(max(inverse_impact_sq - u * u * (1.0 - Rs * u), 0.0));
+    float sin_theta = sqrt(clamp(u * u / (inverse_impact_sq + Rs * u * u * u), 0.0, 1.0));
+    float sweep = 2.0 * escape_angle(turning_point(inverse_impact_sq), 0.0) - escape_angle(u, up);
+    return sweep - (PI - asin(sin_theta));
+}
+
+// Tile pre-pass: TILE_BACKGROUND if no ray of the work group can reach the disk
+// before escaping, TILE_SHADOW if all fall in first; mirrors TileClassifier::classify
+int classify_tile(float min_inverse_impact_sq, float max_inverse_impact_sq, float min_clearance, bool outgoing) {
+    vec3 offset = cameraPos - bh_center;
+    float elevation = dot(normalize(offset), normalize(diskNormal));
+    float u = 1.0 / max(length(offset), EPSILON);
+    if (abs(elevation) <= 1e-4 || u * Rs >= 2.0 / 3.0 || min_inverse_impact_sq > max_inverse_impact_sq) {
+        return TILE_TRACE;
+    }
+
+    float critical_inverse_impact_sq = 4.0 / (27.0 * Rs * Rs);
+    float below = (1.0 - tile_critical_margin) * (1.0 - tile_critical_margin);
+    float above = (1.0 + tile_critical_margin) * (1.0 + tile_critical_margin);
+
+    if (!outgoing && min_inverse_impact_sq * below > critical_inverse_impact_sq) {
+        float sweep = capture_angle(u, min_inverse_impact_sq);
+        return sweep < asin(abs(elevation)) ? TILE_SHADOW : TILE_TRACE;
+    }
+
+    if (max_inverse_impact_sq * above < critical_inverse_impact_sq) {
+        float deflection = max(deflection_from_camera(u, max_inverse_impact_sq), 0.0);
+        if (deflection < 0.5 * PI && min_clearance > sin(deflection)) {
+            return TILE_BACKGROUND;
+        }
+    }
+    return TILE_TRACE;
+}
+
+vec3 trace_ray(PrimaryRay ray, out uint steps) {
+    vec3 ray_dir = ray.dir;
+    vec3 e1 = ray.e1;
+    vec3 e2 = ray.e2;
+    float u0 = ray.u0;
+    float up0 = ray.up0;
+    float phi0 = ray.phi0;
+
+    // Integrate photon path
     vec2 y = vec2(u0, up0);
     float phi = phi0;
     float M = 0.5 * Rs;  // GM/c^2
+
+    if (integratorMode == 3) {
+        vec3 color;
+        steps = 0u;
+        if (analytic_trace(u0, up0, phi0, e1, e2, color)) {
+            return color;
+        }
+    }
+
+    float escape_phi;
+    if (weak_field_escape(u0, up0, phi0, e1, e2, escape_phi)) {
+        steps = 0u;
+        return sky(cos(escape_phi) * e1 + sin(escape_phi) * e2);
+    }
+
+    if (integratorMode == 2) {
+        vec3 color;
+        steps = 0u;
+        if (trace_orbit_table(u0, phi0, e1, e2, color)) {
+            return color;
+        }
+    }
+    if (!enter_influence_sphere(y, phi)) {
+        steps = 0u;
+        return sky(cos(phi) * e1 + sin(phi) * e2);
+    }
+    if (integratorMode != 0) {
+        return integrate_adaptive(y, phi, e1, e2, ray_dir, M, steps);
+    }
+
+    float inverse_impact_sq = y.y * y.y + y.x * y.x * (1.0 - Rs * y.x);
+    float crossing = next_disk_crossing(dot(e1, diskNormal), dot(e2, diskNormal), phi);
     
     for (int i = 0; i < max_phi_steps; i++) {
+        steps = uint(i);
+
         // Current position from u and phi
         float u = max(y.x, EPSILON);
         float r = 1.0 / u;
-        float x = r * cos(phi);
-        float y2d = r * sin(phi);
-        vec3 pos3 = from_plane_coords(x, y2d, e1, e2, bh_center);
-        
-        // Check if absorbed by horizon
-        if (r <= Rs * (1.0 + epsilon_horizon)) {
-            return vec3(0.0);  // Black hole absorption
+        vec3 color;
+        if (check_termination(r, phi, e1, e2, color) ||
+            early_outcome(y, inverse_impact_sq, phi, e1, e2, color)) {
+            return color;
         }
         
-        // Check if hit accretion disk
-        float disk_r;
-        vec3 disk_pos;
-        if (hit_disk(pos3, bh_center, diskNormal, diskInnerRadius, diskOuterRadius, 
-                     disk_r, disk_pos)) {
-            vec3 emission = disk_emission(disk_pos, bh_center, diskNormal,
-                                          disk_r, diskInnerRadius, diskOuterRadius, 
-                                          diskColor, diskIntensity);
-            if (enableDopplerBeaming != 0) {
-                emission *= disk_beaming_factor(disk_pos, bh_center, diskNormal, disk_r);
+        if (crossing <= phi + dphi) {
+            if (land_on_disk(rk4_step(phi, y, crossing - phi, M).x, crossing, e1, e2, color)) {
+                return color;
             }
-            return emission;
+            crossing += PI;
         }
-        
-        // Check if escaped to infinity
-        if (r >= r_escape) {
-            return background_starfield(pos3 - bh_center);
-        }
-        
+
         // RK4 integration step
         y = rk4_step(phi, y, dphi, M);
         phi += dphi;
     }
     
     // Max steps reached - return background
-    return background_starfield(ray_dir);
+    steps = uint(max_phi_steps);
+    vec3 background = sky(ray_dir);
+    ray_termination = TERMINATION_STEP_LIMIT;
+    return background;
+}
+
+// How far the sky direction moves to the neighbouring invocations that show the sky:
+// the nearer one along each axis, then the wider axis. Without such a neighbour it
+// is the camera's pixel angle. Invocations past the image edge show no sky.
+float starfield_footprint(ivec2 local) {
+    const float none = 3.0e38;
+    float along[2] = float[2](none, none);
+    for (int axis = 0; axis < 2; ++axis) {
+        for (int side = -1; side <= 1; side += 2) {
+            ivec2 neighbour = local + (axis == 0 ? ivec2(side, 0) : ivec2(0, side));
+            if (any(lessThan(neighbour, ivec2(0))) || any(greaterThanEqual(neighbour, ivec2(16)))) {
+                continue;
+            }
+            vec3 direction = groupSky[neighbour.y * 16 + neighbour.x];
+            if (direction != vec3(0.0)) {
+                along[axis] = min(along[axis], length(sky_direction - direction));
+            }
+        }
+    }
+    if (along[0] == none && along[1] == none) {
+        return 2.0 * invProjection[1][1] / float(resolutionVector.y);
+    }
+    return max(along[0] == none ? 0.0 : along[0], along[1] == none ? 0.0 : along[1]);
+}
+
+// Bin of the steps histogram: 0 without steps, k for [2^(k-1), 2^k), see RayStatistics::bin
+int step_bin(uint steps) {
+    return steps == 0u ? 0 : min(findMSB(steps) + 1, 12);
+}
+
+// --debug-view colours; mirrors debugColor() in RayStatistics.cpp
+vec3 debug_color(uint steps, int termination) {
+    if (termination == TERMINATION_STEP_LIMIT) {
+        return vec3(1.0, 0.0, 1.0);
+    }
+    if (debugView == 2) {
+        return termination == TERMINATION_HORIZON ? vec3(0.15) :
+               termination == TERMINATION_DISK ? vec3(1.0, 0.55, 0.1) : vec3(0.15, 0.35, 1.0);
+    }
+
+    const vec3 stops[5] = vec3[5](vec3(0.0), vec3(0.1, 0.1, 0.6), vec3(0.8, 0.1, 0.2), vec3(1.0, 0.8, 0.1), vec3(1.0));
+    float t = log2(1.0 + float(steps)) / log2(1.0 + float(max_phi_steps));
+    float position = clamp(t, 0.0, 1.0) * 4.0;
+    int stop = min(int(position), 3);
+    return mix(stops[stop], stops[stop + 1], position - float(stop));
 }
 
 // ===============================
 // Main Compute Shader Entry Point
 // ===============================
 void main() {
-    ivec2 pixel = ivec2(gl_GlobalInvocationID.xy);
-    
-    // Check bounds
-    if (pixel.x >= (resolutionVector.x) || pixel.y >= (resolutionVector.y)) {
-        return;
+    ivec2 pixel = ivec2(gl_GlobalInvocationID.xy) + tileOrigin;
+    bool inside = pixel.x < resolutionVector.x && pixel.y < resolutionVector.y;
+
+    if (gl_LocalInvocationIndex == 0u) {
+#ifdef STEP_COUNTER
+        groupSteps = 0u;
+        groupRays = 0u;
+        for (int i = 0; i < 4; ++i) {
+            groupTerminations[i] = 0u;
+        }
+        for (int i = 0; i < 13; ++i) {
+            groupHistogram[i] = 0u;
+        }
+#endif
+        tileMinInverseImpactSq = floatBitsToUint(3.0e38);
+        tileMaxInverseImpactSq = 0u;
+        tileMinClearance = floatBitsToUint(3.0e38);
+        tileOutgoing = 0u;
     }
+    barrier();
+
+    // Tile pre-pass: bounds over the group's rays decide whether any needs integrating
+    PrimaryRay ray;
+    vec3 side_normal = normalize(diskNormal) * (dot(cameraPos - bh_center, diskNormal) < 0.0 ? -1.0 : 1.0);
+    if (inside) {
+        ray = setup_primary_ray(vec2(pixel));
+        float inverse_impact_sq = ray.up0 * ray.up0 + ray.u0 * ray.u0 * (1.0 - Rs * ray.u0);
+        atomicMin(tileMinInverseImpactSq, floatBitsToUint(inverse_impact_sq));
+        atomicMax(tileMaxInverseImpactSq, floatBitsToUint(inverse_impact_sq));
+        atomicMin(tileMinClearance, floatBitsToUint(max(dot(ray.dir, side_normal), 0.0)));
+        if (ray.up0 <= 0.0) {
+            atomicOr(tileOutgoing, 1u);
+        }
+    }
+    barrier();
+    if (gl_LocalInvocationIndex == 0u) {
+        tileClass = classifyTiles == 0 ? TILE_TRACE :
+            classify_tile(uintBitsToFloat(tileMinInverseImpactSq), uintBitsToFloat(tileMaxInverseImpactSq),
+                          uintBitsToFloat(tileMinClearance), tileOutgoing != 0u);
+    }
+    barrier();
     
-    // Trace ray for this pixel
-    vec3 color = trace_ray(vec2(pixel));
-    
-    // Write to output image
-    imageStore(outputImage, pixel, vec4(color, 1.0));
+    // Trace ray for this pixel, skipping invocations past the image edge
+    vec3 color = vec3(0.0);
+    uint steps = 0u;
+    if (inside) {
+        if (tileClass == TILE_BACKGROUND) {
+            float phi = free_escape_angle(ray.u0, ray.up0, ray.phi0);
+            color = sky(cos(phi) * ray.e1 + sin(phi) * ray.e2);
+        } else if (tileClass == TILE_TRACE) {
+            color = trace_ray(ray, steps);
+        }
+
+#ifdef STEP_COUNTER
+        atomicAdd(groupSteps, steps);
+        atomicAdd(groupRays, 1u);
+        atomicAdd(groupTerminations[ray_termination], 1u);
+        atomicAdd(groupHistogram[step_bin(steps)], 1u);
+#endif
+    }
+    groupSky[gl_LocalInvocationIndex] = sky_direction;
+    barrier();
+
+    if (inside) {
+        // Baked sky over the pixel's footprint, see CpuTracer's shadeSky()
+        if (debugView != 0) {
+            color = debug_color(steps, ray_termination);
+        } else if (sky_direction != vec3(0.0)) {
+            float footprint = starfield_footprint(ivec2(gl_LocalInvocationID.xy));
+            float texels = footprint * 0.5 * float(textureSize(starfieldMap, 0).x);
+            float lod = clamp(log2(max(texels, 1.0)), 0.0, float(textureQueryLevels(starfieldMap) - 1));
+            color = textureLod(starfieldMap, sky_direction, lod).rgb;
+        }
+
+        // Write to output image. Normalized formats get what the present pass would
+        // show anyway: the default framebuffer clamps to [0, 1].
+#ifdef OUTPUT_NORMALIZED
+        color = clamp(color, 0.0, 1.0);
+#endif
+        imageStore(outputImage, pixel - tileOrigin, vec4(color, 1.0));
+    }
+
+#ifdef STEP_COUNTER
+    // One global update per work group, carrying into the high word on overflow
+    if (gl_LocalInvocationIndex == 0u) {
+        uint previous = atomicAdd(totalStepsLow, groupSteps);
+        if (previous + groupSteps < previous) {
+            atomicAdd(totalStepsHigh, 1u);
+        }
+        atomicAdd(totalRays, groupRays);
+        for (int i = 0; i < 4; ++i) {
+            if (groupTerminations[i] != 0u) {
+                atomicAdd(totalTerminations[i], groupTerminations[i]);
+            }
+        }
+        for (int i = 0; i < 13; ++i) {
+            if (groupHistogram[i] != 0u) {
+                atomicAdd(stepHistogram[i], groupHistogram[i]);
+            }
+        }
+    }
+#endif
 }
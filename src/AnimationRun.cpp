@@ -0,0 +1,54 @@
+#include "AnimationRun.h"
+
+#include <iostream>
+#include <string>
+
+#include "FrameEncoder.h"
+#include "FrameWorker.h"
+#include "OfflineRenderer.h"
+
+AnimationRun::AnimationRun() = default;
+
+AnimationRun::~AnimationRun() = default;
+
+bool AnimationRun::open(const CommandLine::Options &options, const glm::ivec2 &resolution, const glm::vec3 &start,
+                        const CameraPath *cameraPath)
+{
+    FrameEncoder::Output output = options.streamFormat;
+    FrameEncoder::outputFor(options.animationPath, options.streamFormat, output);
+    if (!options.frameWorkerAddress.empty())
+    {
+        std::string error;
+        worker = std::make_unique<FrameWorker>();
+        if (!worker->connect(options.frameWorkerAddress, error))
+        {
+            std::cerr << "Frame worker: " << error << std::endl;
+            return false;
+        }
+    }
+
+    const unsigned int frames = OfflineRenderer::framesFor(options.animationFrames, cameraPath, options.fps);
+    renderer = std::make_unique<OfflineRenderer>(output, options.animationPath, frames, options.fps, resolution, start,
+                                                 cameraPath, worker.get());
+    return renderer->open();
+}
+
+bool AnimationRun::isFinished()
+{
+    return renderer->isFinished();
+}
+
+void AnimationRun::positionCamera(Camera &camera) const
+{
+    renderer->positionCamera(camera);
+}
+
+void AnimationRun::captureFrame(GLuint texture)
+{
+    renderer->captureFrame(texture);
+}
+
+bool AnimationRun::finish()
+{
+    return renderer->finish();
+}
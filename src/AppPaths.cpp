@@ -1,6 +1,7 @@
 #include "AppPaths.h"
 
 #include <array>
+#include <cstdlib>
 #include <limits.h>
 #include <unistd.h>
 
@@ -49,3 +50,20 @@ std::filesystem::path AppPaths::findResource(const std::string &relativePath)
 
     return {};
 }
+
+std::filesystem::path AppPaths::cacheDirectory()
+{
+    const char *cacheHome = std::getenv("XDG_CACHE_HOME");
+    if (cacheHome != nullptr && cacheHome[0] != '\0')
+    {
+        return std::filesystem::path(cacheHome) / "blackholesim";
+    }
+
+    const char *home = std::getenv("HOME");
+    if (home != nullptr && home[0] != '\0')
+    {
+        return std::filesystem::path(home) / ".cache" / "blackholesim";
+    }
+
+    return {};
+}
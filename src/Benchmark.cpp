@@ -0,0 +1,232 @@
+#include "Benchmark.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+
+#include "Camera.h"
+#include "CameraPath.h"
+
+static_assert(Benchmark::SEGMENT_COUNT == static_cast<int>(Camera::PRESET_COUNT) + 1,
+              "a benchmark segment per camera preset and one for the orbit");
+
+namespace
+{
+const char *SEGMENT_NAMES[Benchmark::SEGMENT_COUNT] = {"orbit", "edge-on", "face-on", "near-horizon", "scripted-orbit"};
+
+struct Summary
+{
+    double mean;
+    double median;
+    double p95;
+    double p99;
+    double min;
+    double max;
+};
+
+// Nearest-rank percentiles.
+Summary summarize(std::vector<double> values)
+{
+    Summary summary{0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+    if (values.empty())
+    {
+        return summary;
+    }
+
+    std::sort(values.begin(), values.end());
+    auto percentile = [&](double p) {
+        const std::size_t rank = static_cast<std::size_t>(std::ceil(p * static_cast<double>(values.size())));
+        return values[std::max<std::size_t>(rank, 1) - 1];
+    };
+
+    double sum = 0.0;
+    for (const double value : values)
+    {
+        sum += value;
+    }
+    summary.mean = sum / static_cast<double>(values.size());
+    summary.median = percentile(0.5);
+    summary.p95 = percentile(0.95);
+    summary.p99 = percentile(0.99);
+    summary.min = values.front();
+    summary.max = values.back();
+    return summary;
+}
+
+void writeString(std::ostream &out, const std::string &text)
+{
+    out << '"';
+    for (const char c : text)
+    {
+        if (c == '"' || c == '\\')
+        {
+            out << '\\' << c;
+        }
+        else if (static_cast<unsigned char>(c) >= 0x20)
+        {
+            out << c;
+        }
+    }
+    out << '"';
+}
+
+void writeSummary(std::ostream &out, const char *name, const std::vector<double> &values)
+{
+    const Summary summary = summarize(values);
+    out << "\"" << name << "\": {\"samples\": " << values.size() << ", \"mean\": " << summary.mean
+        << ", \"median\": " << summary.median << ", \"p95\": " << summary.p95 << ", \"p99\": " << summary.p99
+        << ", \"min\": " << summary.min << ", \"max\": " << summary.max << "}";
+}
+
+// Frame times, rays/s and steps/s of frames that together took frameMilliseconds.
+void writeMeasurements(std::ostream &out, const std::vector<double> &frameMilliseconds,
+                       const std::vector<double> &cpuMilliseconds, const std::vector<double> &gpuMilliseconds,
+                       const RayStatistics &rays, const char *indent)
+{
+    double seconds = 0.0;
+    for (const double milliseconds : frameMilliseconds)
+    {
+        seconds += milliseconds * 1e-3;
+    }
+
+    out << indent;
+    writeSummary(out, "frame_ms", frameMilliseconds);
+    out << ",\n" << indent;
+    writeSummary(out, "cpu_ms", cpuMilliseconds);
+    out << ",\n" << indent;
+    writeSummary(out, "gpu_ms", gpuMilliseconds);
+    out << ",\n" << indent << "\"rays\": " << rays.rays << ", \"steps\": " << rays.steps
+        << ", \"rays_per_second\": " << (seconds > 0.0 ? static_cast<double>(rays.rays) / seconds : 0.0)
+        << ", \"steps_per_second\": " << (seconds > 0.0 ? static_cast<double>(rays.steps) / seconds : 0.0)
+        << ", \"step_limit_rays\": " << rays.terminations[static_cast<std::size_t>(Termination::StepLimit)] << "\n";
+}
+}
+
+Benchmark::Benchmark(unsigned int framesPerSegment, const CameraPath *cameraPath)
+    : framesPerSegment(std::max(framesPerSegment, 1u)), cameraPath(cameraPath), frame(0), segments(SEGMENT_COUNT)
+{
+}
+
+void Benchmark::positionCamera(Camera &camera) const
+{
+    const int current = segment();
+    if (current < static_cast<int>(Camera::PRESET_COUNT))
+    {
+        camera.applyPreset(static_cast<std::size_t>(current));
+        return;
+    }
+
+    // The camera path stretched over the timed frames, both ends included, or one
+    // turn around the disk axis.
+    const unsigned int timedFrame = std::max(frameInSegment(), WARMUP_FRAMES) - WARMUP_FRAMES;
+    if (cameraPath != nullptr)
+    {
+        const double progress =
+            framesPerSegment > 1 ? static_cast<double>(timedFrame) / static_cast<double>(framesPerSegment - 1) : 0.0;
+        CameraPath::apply(cameraPath->evaluate(progress * cameraPath->getDuration()), camera);
+        return;
+    }
+
+    const float timed = static_cast<float>(timedFrame);
+    const float angle = 2.0f * 3.14159265358979f * timed / static_cast<float>(framesPerSegment);
+    camera.lookAt(Camera::orbitPosition(Camera::presetPosition(0), angle), glm::vec3(0.0f));
+}
+
+bool Benchmark::isTimed() const
+{
+    return !isFinished() && frameInSegment() >= WARMUP_FRAMES;
+}
+
+bool Benchmark::isFirstTimedFrame() const
+{
+    return !isFinished() && frameInSegment() == WARMUP_FRAMES;
+}
+
+bool Benchmark::isLastTimedFrame() const
+{
+    return !isFinished() && frameInSegment() == WARMUP_FRAMES + framesPerSegment - 1;
+}
+
+void Benchmark::addRays(const RayStatistics &statistics)
+{
+    if (isTimed())
+    {
+        segments[static_cast<std::size_t>(segment())].rays.merge(statistics);
+    }
+}
+
+void Benchmark::endFrame(double frameMilliseconds, double cpuMilliseconds)
+{
+    if (isTimed())
+    {
+        Segment &current = segments[static_cast<std::size_t>(segment())];
+        current.frameMilliseconds.push_back(frameMilliseconds);
+        current.cpuMilliseconds.push_back(cpuMilliseconds);
+    }
+    ++frame;
+}
+
+void Benchmark::addSegmentRays(const RayStatistics &statistics)
+{
+    const std::uint64_t period = WARMUP_FRAMES + framesPerSegment;
+    if (frame > 0 && frame % period == 0)
+    {
+        segments[static_cast<std::size_t>((frame - 1) / period)].rays.merge(statistics);
+    }
+}
+
+void Benchmark::addGpuTime(std::uint64_t frameIndex, double milliseconds)
+{
+    const std::uint64_t period = WARMUP_FRAMES + framesPerSegment;
+    const std::uint64_t index = frameIndex / period;
+    if (index < segments.size() && frameIndex % period >= WARMUP_FRAMES)
+    {
+        segments[static_cast<std::size_t>(index)].gpuMilliseconds.push_back(milliseconds);
+    }
+}
+
+void Benchmark::writeJson(std::ostream &out, const Setup &setup) const
+{
+    out << std::setprecision(6) << "{\n  \"renderer\": ";
+    writeString(out, setup.renderer);
+    out << ",\n  \"gl_renderer\": ";
+    writeString(out, setup.glRenderer);
+    out << ",\n  \"gl_vendor\": ";
+    writeString(out, setup.glVendor);
+    out << ",\n  \"gl_version\": ";
+    writeString(out, setup.glVersion);
+    out << ",\n  \"resolution\": [" << setup.resolution.x << ", " << setup.resolution.y << "],\n  \"integrator\": ";
+    writeString(out, setup.integrator);
+    out << ",\n  \"output_format\": ";
+    writeString(out, setup.outputFormat);
+    if (!setup.cameraPath.empty())
+    {
+        out << ",\n  \"camera_path\": ";
+        writeString(out, setup.cameraPath);
+    }
+    out << ",\n  \"cpu_threads\": " << setup.cpuThreads << ",\n  \"frames_per_segment\": " << framesPerSegment
+        << ",\n  \"warmup_frames\": " << WARMUP_FRAMES << ",\n  \"segments\": [\n";
+
+    std::vector<double> allFrames;
+    std::vector<double> allCpu;
+    std::vector<double> allGpu;
+    RayStatistics allRays;
+    for (int i = 0; i < SEGMENT_COUNT; ++i)
+    {
+        const Segment &current = segments[static_cast<std::size_t>(i)];
+        const bool pathSegment = i == SEGMENT_COUNT - 1 && cameraPath != nullptr;
+        out << "    {\n      \"name\": \"" << (pathSegment ? "camera-path" : SEGMENT_NAMES[i]) << "\",\n";
+        writeMeasurements(out, current.frameMilliseconds, current.cpuMilliseconds, current.gpuMilliseconds, current.rays,
+                          "      ");
+        out << "    }" << (i + 1 < SEGMENT_COUNT ? "," : "") << "\n";
+
+        allFrames.insert(allFrames.end(), current.frameMilliseconds.begin(), current.frameMilliseconds.end());
+        allCpu.insert(allCpu.end(), current.cpuMilliseconds.begin(), current.cpuMilliseconds.end());
+        allGpu.insert(allGpu.end(), current.gpuMilliseconds.begin(), current.gpuMilliseconds.end());
+        allRays.merge(current.rays);
+    }
+
+    out << "  ],\n  \"total\": {\n";
+    writeMeasurements(out, allFrames, allCpu, allGpu, allRays, "    ");
+    out << "  }\n}\n";
+}
@@ -0,0 +1,104 @@
+#include "BenchmarkRun.h"
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include "CpuTracer.h"
+#include "GpuTimer.h"
+#include "RenderSetup.h"
+#include "StepCounter.h"
+
+BenchmarkRun::BenchmarkRun(const CommandLine::Options &options, const CameraPath *cameraPath,
+                           StepCounter *stepCounter)
+    : options(options), benchmark(options.benchmarkFrames, cameraPath), stepCounter(stepCounter)
+{
+}
+
+void BenchmarkRun::beginFrame()
+{
+    frameStart = std::chrono::steady_clock::now();
+    if (stepCounter != nullptr && benchmark.isFirstTimedFrame())
+    {
+        stepCounter->reset();
+    }
+}
+
+void BenchmarkRun::cpuFrameRendered(const CpuTracer &tracer)
+{
+    benchmark.addRays(tracer.getLastFrameStatistics());
+}
+
+void BenchmarkRun::beginSwap()
+{
+    swapStart = std::chrono::steady_clock::now();
+}
+
+void BenchmarkRun::endSwap()
+{
+    swapEnd = std::chrono::steady_clock::now();
+}
+
+void BenchmarkRun::endFrame()
+{
+    const double frameMilliseconds =
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frameStart).count();
+    const double swapMilliseconds = std::chrono::duration<double, std::milli>(swapEnd - swapStart).count();
+    const bool segmentEnds = benchmark.isLastTimedFrame();
+    benchmark.endFrame(frameMilliseconds, frameMilliseconds - swapMilliseconds);
+
+    if (segmentEnds && stepCounter != nullptr)
+    {
+        RayStatistics statistics;
+        stepCounter->read(statistics);
+        benchmark.addSegmentRays(statistics);
+    }
+}
+
+bool BenchmarkRun::write(const GpuTimer *gpuTimer, const CpuTracer *cpuTracer, const glm::ivec2 &resolution)
+{
+    if (gpuTimer != nullptr && gpuTimer->isAvailable())
+    {
+        for (std::size_t row = 0; row < gpuTimer->getRowCount(); ++row)
+        {
+            benchmark.addGpuTime(gpuTimer->getRowFrame(row), gpuTimer->getRowTotal(row));
+        }
+    }
+
+    const Benchmark::Setup setup{
+        cpuTracer != nullptr ? "cpu" : "gpu",
+        RenderSetup::glString(GL_RENDERER),
+        RenderSetup::glString(GL_VENDOR),
+        RenderSetup::glString(GL_VERSION),
+        resolution,
+        CommandLine::integratorName(options.integrator),
+        RenderTarget::formatName(options.outputFormat),
+        cpuTracer != nullptr ? cpuTracer->getThreadCount() : 0,
+        options.cameraPathFile
+    };
+
+    // std::cout is stderr for --benchmark -, so the report goes to stdout itself.
+    if (options.benchmarkPath == "-")
+    {
+        std::ostringstream json;
+        benchmark.writeJson(json, setup);
+        const std::string report = json.str();
+        return std::fwrite(report.data(), 1, report.size(), stdout) == report.size() && std::fflush(stdout) == 0;
+    }
+
+    std::ofstream file(options.benchmarkPath);
+    if (!file)
+    {
+        std::cerr << "Failed to open " << options.benchmarkPath << " for writing." << std::endl;
+        return false;
+    }
+    benchmark.writeJson(file, setup);
+    if (!file)
+    {
+        return false;
+    }
+    std::cout << "Benchmark written to " << options.benchmarkPath << "." << std::endl;
+    return true;
+}
@@ -1,24 +1,30 @@
 #include "BlackHole.h"
 
-BlackHole::BlackHole(Shader *p_computeShader, glm::vec3 pos, float r, int width, int height) 
-    : position(pos), radius(r), outputTexture(0), screenVAO(0), screenVBO(0), textureWidth(width), textureHeight(height)
+BlackHole::BlackHole(Shader *p_computeShader, glm::vec3 pos, float r, int width, int height, RenderTarget::Format format)
+    : position(pos), radius(r), disk(DiskParameters::defaultsFor(r)), outputFormat(format), outputTexture(0), screenVAO(0), screenVBO(0), textureWidth(width), textureHeight(height)
 {
     createOutputTexture();
     createScreenQuad();
+
+    // The CPU backend runs without a compute shader and uploads its image instead.
+    if (p_computeShader == nullptr)
+    {
+        return;
+    }
     
     p_computeShader->setUniform3fv("bh_center", position);
     p_computeShader->setUniform1f("Rs", radius);
-    p_computeShader->setUniform1f("diskInnerRadius", radius * 3.0f);     // ISCO for Schwarzschild
-    p_computeShader->setUniform1f("diskOuterRadius", radius * 20.0f);    
-    p_computeShader->setUniform3fv("diskColor", glm::vec3(1.0f, 0.3f, 0.05f)); // orange-red
-    p_computeShader->setUniform1f("diskIntensity", 2.0f);
-    p_computeShader->setUniform3fv("diskNormal", glm::vec3(0.0f, 1.0f, 0.0f)); // horizontal disk
-    p_computeShader->setUniform1f("diskBetaInner", 0.42f);
-    p_computeShader->setUniform1f("diskBetaMax", 0.45f);
-    p_computeShader->setUniform1f("dopplerStrength", 0.85f);
-    p_computeShader->setUniform1i("enableDopplerBeaming", 1);
+    p_computeShader->setUniform1f("diskInnerRadius", disk.innerRadius);
+    p_computeShader->setUniform1f("diskOuterRadius", disk.outerRadius);
+    p_computeShader->setUniform3fv("diskNormal", disk.normal);
+    p_computeShader->setUniform3fv("diskBasisX", disk.basisX);
+    p_computeShader->setUniform3fv("diskBasisZ", disk.basisZ);
+    p_computeShader->setUniform1f("diskBetaInner", disk.betaInner);
+    p_computeShader->setUniform1f("diskBetaMax", disk.betaMax);
+    p_computeShader->setUniform1f("dopplerStrength", disk.dopplerStrength);
+    p_computeShader->setUniform1i("enableDopplerBeaming", disk.enableDopplerBeaming ? 1 : 0);
 
-    glBindImageTexture(0, outputTexture, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA32F);
+    glBindImageTexture(0, outputTexture, 0, GL_FALSE, 0, GL_WRITE_ONLY, RenderTarget::internalFormat(outputFormat));
 }
 
 BlackHole::~BlackHole()
@@ -32,7 +38,7 @@ void BlackHole::createOutputTexture()
 {
     glGenTextures(1, &outputTexture);
     glBindTexture(GL_TEXTURE_2D, outputTexture);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, textureWidth, textureHeight, 0, GL_RGBA, GL_FLOAT, NULL);
+    glTexImage2D(GL_TEXTURE_2D, 0, static_cast<GLint>(RenderTarget::internalFormat(outputFormat)), textureWidth, textureHeight, 0, GL_RGBA, GL_FLOAT, NULL);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
@@ -56,9 +62,24 @@ void BlackHole::resizeOutputTexture(int width, int height)
     textureHeight = height;
 
     glBindTexture(GL_TEXTURE_2D, outputTexture);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, textureWidth, textureHeight, 0, GL_RGBA, GL_FLOAT, nullptr);
+    glTexImage2D(GL_TEXTURE_2D, 0, static_cast<GLint>(RenderTarget::internalFormat(outputFormat)), textureWidth, textureHeight, 0, GL_RGBA, GL_FLOAT, nullptr);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    if (GLAD_GL_VERSION_4_2)
+    {
+        glBindImageTexture(0, outputTexture, 0, GL_FALSE, 0, GL_WRITE_ONLY, RenderTarget::internalFormat(outputFormat));
+    }
+}
+
+void BlackHole::uploadImage(const std::vector<glm::vec4> &pixels)
+{
+    if (pixels.size() < static_cast<std::size_t>(textureWidth) * static_cast<std::size_t>(textureHeight))
+    {
+        return;
+    }
+
+    glBindTexture(GL_TEXTURE_2D, outputTexture);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, textureWidth, textureHeight, GL_RGBA, GL_FLOAT, pixels.data());
     glBindTexture(GL_TEXTURE_2D, 0);
-    glBindImageTexture(0, outputTexture, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA32F);
 }
 
 void BlackHole::createScreenQuad()
@@ -0,0 +1,99 @@
+#include "Blackbody.h"
+
+#include <cmath>
+
+namespace
+{
+constexpr double PLANCK = 6.62607015e-34;       // J s
+constexpr double LIGHT_SPEED = 2.99792458e8;    // m / s
+constexpr double BOLTZMANN = 1.380649e-23;      // J / K
+constexpr int FIRST_WAVELENGTH = 360;           // nm
+constexpr int LAST_WAVELENGTH = 830;            // nm
+
+// Piecewise Gaussian lobe of the analytic colour matching function fit by Wyman,
+// Sloan and Shirley (2013).
+double lobe(double wavelength, double mean, double below, double above)
+{
+    const double t = (wavelength - mean) / (wavelength < mean ? below : above);
+    return std::exp(-0.5 * t * t);
+}
+
+glm::dvec3 colorMatching(double wavelength)
+{
+    return glm::dvec3(1.056 * lobe(wavelength, 599.8, 37.9, 31.0) + 0.362 * lobe(wavelength, 442.0, 16.0, 26.7) -
+                          0.065 * lobe(wavelength, 501.1, 20.4, 26.2),
+                      0.821 * lobe(wavelength, 568.8, 46.9, 40.5) + 0.286 * lobe(wavelength, 530.9, 16.3, 31.1),
+                      1.217 * lobe(wavelength, 437.0, 11.8, 36.0) + 0.681 * lobe(wavelength, 459.0, 26.0, 13.8));
+}
+
+// Spectral radiance B_lambda(T), per nm; constant factors cancel in the normalisation.
+double planck(double wavelength, double temperature)
+{
+    const double metres = wavelength * 1e-9;
+    const double exponent = PLANCK * LIGHT_SPEED / (metres * BOLTZMANN * temperature);
+    return 1.0 / (std::pow(metres, 5.0) * std::expm1(exponent));
+}
+
+glm::dvec3 tristimulus(double temperature)
+{
+    glm::dvec3 xyz(0.0);
+    for (int wavelength = FIRST_WAVELENGTH; wavelength <= LAST_WAVELENGTH; ++wavelength)
+    {
+        xyz += colorMatching(wavelength) * planck(wavelength, temperature);
+    }
+    return xyz;
+}
+
+// XYZ to linear sRGB (D65); out of gamut components are clipped.
+glm::vec3 toLinearSrgb(const glm::dvec3 &xyz)
+{
+    const glm::dvec3 rgb(3.2406 * xyz.x - 1.5372 * xyz.y - 0.4986 * xyz.z,
+                         -0.9689 * xyz.x + 1.8758 * xyz.y + 0.0415 * xyz.z,
+                         0.0557 * xyz.x - 0.2040 * xyz.y + 1.0570 * xyz.z);
+    return glm::vec3(glm::max(rgb, glm::dvec3(0.0)));
+}
+
+float temperatureAt(int index)
+{
+    const float t = static_cast<float>(index) / static_cast<float>(Blackbody::TABLE_SIZE - 1);
+    return Blackbody::MIN_TEMPERATURE * std::pow(Blackbody::MAX_TEMPERATURE / Blackbody::MIN_TEMPERATURE, t);
+}
+
+std::vector<glm::vec3> buildTable()
+{
+    const double reference = tristimulus(Blackbody::REFERENCE_TEMPERATURE).y;
+    std::vector<glm::vec3> colors(Blackbody::TABLE_SIZE);
+    for (int i = 0; i < Blackbody::TABLE_SIZE; ++i)
+    {
+        colors[static_cast<std::size_t>(i)] = toLinearSrgb(tristimulus(temperatureAt(i)) / reference);
+    }
+    return colors;
+}
+}
+
+const std::vector<glm::vec3> &Blackbody::table()
+{
+    static const std::vector<glm::vec3> colors = buildTable();
+    return colors;
+}
+
+glm::vec3 Blackbody::color(float temperature)
+{
+    // Also catches NaN, which the clamp below would let through into the index.
+    if (!(temperature > 0.0f))
+    {
+        return glm::vec3(0.0f);
+    }
+
+    const std::vector<glm::vec3> &colors = table();
+    const float position = std::log(glm::clamp(temperature, MIN_TEMPERATURE, MAX_TEMPERATURE) / MIN_TEMPERATURE) /
+                           std::log(MAX_TEMPERATURE / MIN_TEMPERATURE) * static_cast<float>(TABLE_SIZE - 1);
+    const int index = glm::min(static_cast<int>(position), TABLE_SIZE - 2);
+    const float fraction = position - static_cast<float>(index);
+    return glm::mix(colors[static_cast<std::size_t>(index)], colors[static_cast<std::size_t>(index) + 1], fraction);
+}
+
+float Blackbody::luminance(float temperature)
+{
+    return glm::dot(color(temperature), glm::vec3(0.2126f, 0.7152f, 0.0722f));
+}
@@ -1,9 +1,14 @@
 #include "Camera.h"
 
+#include <cmath>
+
+#include "Profiler.h"
+
 Camera::Camera(glm::vec3 position)
     : m_position(position)
     , m_front(glm::vec3(0.0f, 0.0f, -1.0f))
     , m_up(glm::vec3(0.0f, 1.0f, 0.0f))
+    , m_fov(DEFAULT_FOV)
     , m_yaw(-90.0f)
     , m_pitch(0.0f)
     , m_lastX(640.0f)
@@ -28,6 +33,7 @@ glm::mat4 Camera::invViewMatrix() const
 
 void Camera::processInput(GLFWwindow* window, float deltaTime)
 {
+    PROFILE_ZONE("Camera::processInput");
     float velocity = m_movementSpeed * deltaTime;
     
     if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
@@ -43,30 +49,50 @@ void Camera::processInput(GLFWwindow* window, float deltaTime)
     if (glfwGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS)
         m_position += m_up * velocity;
 
-    const int presetKeys[4] = {
+    const int presetKeys[PRESET_COUNT] = {
         GLFW_KEY_1,
         GLFW_KEY_2,
         GLFW_KEY_3,
         GLFW_KEY_4
     };
 
-    const glm::vec3 presetPositions[4] = {
+    for (std::size_t i = 0; i < PRESET_COUNT; ++i)
+    {
+        const bool isPressed = glfwGetKey(window, presetKeys[i]) == GLFW_PRESS;
+        if (isPressed && !m_presetKeyPressed[i])
+        {
+            applyPreset(i);
+            syncCursor(window);
+        }
+
+        m_presetKeyPressed[i] = isPressed;
+    }
+}
+
+glm::vec3 Camera::presetPosition(std::size_t index)
+{
+    // 1: high angled orbit, 2: edge-on disk, 3: face-on top-down, 4: near-horizon close-up
+    const glm::vec3 presetPositions[PRESET_COUNT] = {
         glm::vec3(6.0f, 4.0f, 6.0f),
         glm::vec3(0.0f, 0.35f, 8.0f),
         glm::vec3(0.0f, 8.0f, 0.01f),
         glm::vec3(1.2f, 0.25f, 2.0f)
     };
 
-    for (int i = 0; i < 4; ++i)
-    {
-        const bool isPressed = glfwGetKey(window, presetKeys[i]) == GLFW_PRESS;
-        if (isPressed && !m_presetKeyPressed[static_cast<std::size_t>(i)])
-        {
-            snapToView(window, presetPositions[i], glm::vec3(0.0f));
-        }
+    return presetPositions[index % PRESET_COUNT];
+}
 
-        m_presetKeyPressed[static_cast<std::size_t>(i)] = isPressed;
-    }
+glm::vec3 Camera::orbitPosition(const glm::vec3 &start, float angle)
+{
+    const float c = std::cos(angle);
+    const float s = std::sin(angle);
+    return glm::vec3(c * start.x - s * start.z, start.y, s * start.x + c * start.z);
+}
+
+void Camera::applyPreset(std::size_t index)
+{
+    lookAt(presetPosition(index), glm::vec3(0.0f));
+    m_fov = DEFAULT_FOV;
 }
 
 void Camera::mouse_callback(GLFWwindow* window, double xpos, double ypos)
@@ -109,7 +135,7 @@ void Camera::updateCameraVectors()
     m_front = glm::normalize(front);
 }
 
-void Camera::snapToView(GLFWwindow *window, const glm::vec3 &position, const glm::vec3 &target)
+void Camera::lookAt(const glm::vec3 &position, const glm::vec3 &target)
 {
     m_position = position;
 
@@ -117,7 +143,10 @@ void Camera::snapToView(GLFWwindow *window, const glm::vec3 &position, const glm
     m_yaw = glm::degrees(atan2(direction.z, direction.x));
     m_pitch = glm::degrees(asin(glm::clamp(direction.y, -1.0f, 1.0f)));
     updateCameraVectors();
+}
 
+void Camera::syncCursor(GLFWwindow *window)
+{
     double cursorX = 0.0;
     double cursorY = 0.0;
     glfwGetCursorPos(window, &cursorX, &cursorY);
@@ -0,0 +1,172 @@
+#include "CameraPath.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+
+#include "Camera.h"
+
+namespace
+{
+constexpr float MIN_FOV = 1.0f;
+constexpr float MAX_FOV = 179.0f;
+
+// Everything after the time: position, target, the optional fov and nothing else.
+bool parseKeyframeRest(std::istringstream &fields, CameraPath::Keyframe &key)
+{
+    if (!(fields >> key.position.x >> key.position.y >> key.position.z >> key.target.x >> key.target.y >>
+          key.target.z))
+    {
+        return false;
+    }
+    float fov = 0.0f;
+    if (!(fields >> fov))
+    {
+        return fields.eof();
+    }
+    key.fov = fov;
+
+    std::string rest;
+    return !(fields >> rest);
+}
+}
+
+bool CameraPath::load(const std::filesystem::path &path, std::string &error)
+{
+    std::ifstream file(path);
+    if (!file)
+    {
+        error = "Failed to open camera path " + path.string() + ".";
+        return false;
+    }
+
+    std::vector<Keyframe> loaded;
+    std::string line;
+    for (int lineNumber = 1; std::getline(file, line); ++lineNumber)
+    {
+        const std::size_t comment = line.find('#');
+        if (comment != std::string::npos)
+        {
+            line.erase(comment);
+        }
+
+        std::istringstream fields(line);
+        Keyframe key{0.0, glm::vec3(0.0f), glm::vec3(0.0f), loaded.empty() ? Camera::DEFAULT_FOV : loaded.back().fov};
+        if (!(fields >> key.time))
+        {
+            if (fields.eof())
+            {
+                continue;   // blank or comment only
+            }
+            error = path.string() + ":" + std::to_string(lineNumber) + ": expected a keyframe time.";
+            return false;
+        }
+
+        if (!parseKeyframeRest(fields, key))
+        {
+            error = path.string() + ":" + std::to_string(lineNumber) +
+                    ": expected time, position x y z, target x y z and an optional fov.";
+            return false;
+        }
+        if (!loaded.empty() && !(key.time > loaded.back().time))
+        {
+            error = path.string() + ":" + std::to_string(lineNumber) + ": keyframe times have to increase.";
+            return false;
+        }
+        if (!(key.fov >= MIN_FOV && key.fov <= MAX_FOV))
+        {
+            error = path.string() + ":" + std::to_string(lineNumber) + ": fov has to be between 1 and 179 degrees.";
+            return false;
+        }
+        if (glm::length(key.target - key.position) < 1e-4f)
+        {
+            error = path.string() + ":" + std::to_string(lineNumber) + ": the camera can't look at its own position.";
+            return false;
+        }
+        loaded.push_back(key);
+    }
+
+    if (loaded.empty())
+    {
+        error = "Camera path " + path.string() + " has no keyframes.";
+        return false;
+    }
+
+    keyframes = std::move(loaded);
+    return true;
+}
+
+std::uint64_t CameraPath::frameCount(unsigned int fps) const
+{
+    return static_cast<std::uint64_t>(std::floor(getDuration() * static_cast<double>(fps) + 1e-6)) + 1;
+}
+
+CameraPath::Keyframe CameraPath::evaluate(double seconds) const
+{
+    if (keyframes.size() == 1 || seconds <= 0.0)
+    {
+        return keyframes.front();
+    }
+
+    const double time = keyframes.front().time + seconds;
+    if (time >= keyframes.back().time)
+    {
+        return keyframes.back();
+    }
+
+    // The segment [first, first + 1] that holds time.
+    const auto after = std::upper_bound(keyframes.begin(), keyframes.end(), time,
+                                        [](double t, const Keyframe &key) { return t < key.time; });
+    const std::size_t first = static_cast<std::size_t>(after - keyframes.begin()) - 1;
+    const Keyframe &from = keyframes[first];
+    const Keyframe &to = keyframes[first + 1];
+    const Keyframe fromTangent = tangent(first);
+    const Keyframe toTangent = tangent(first + 1);
+
+    const float span = static_cast<float>(to.time - from.time);
+    const float s = static_cast<float>((time - from.time) / (to.time - from.time));
+    const float s2 = s * s;
+    const float s3 = s2 * s;
+    const float h00 = 2.0f * s3 - 3.0f * s2 + 1.0f;
+    const float h10 = s3 - 2.0f * s2 + s;
+    const float h01 = -2.0f * s3 + 3.0f * s2;
+    const float h11 = s3 - s2;
+
+    Keyframe pose;
+    pose.time = time;
+    pose.position = h00 * from.position + h10 * span * fromTangent.position + h01 * to.position +
+                    h11 * span * toTangent.position;
+    pose.target = h00 * from.target + h10 * span * fromTangent.target + h01 * to.target + h11 * span * toTangent.target;
+    pose.fov = glm::clamp(h00 * from.fov + h10 * span * fromTangent.fov + h01 * to.fov + h11 * span * toTangent.fov,
+                          MIN_FOV, MAX_FOV);
+    return pose;
+}
+
+CameraPath::Keyframe CameraPath::evaluateFrame(std::uint64_t frame, unsigned int fps) const
+{
+    return evaluate(static_cast<double>(frame) / static_cast<double>(fps));
+}
+
+void CameraPath::apply(const Keyframe &pose, Camera &camera)
+{
+    camera.lookAt(pose.position, pose.target);
+    camera.setFov(pose.fov);
+}
+
+CameraPath::Keyframe CameraPath::tangent(std::size_t index) const
+{
+    // Derivatives per second; one-sided at the ends.
+    const std::size_t previous = index > 0 ? index - 1 : index;
+    const std::size_t next = index + 1 < keyframes.size() ? index + 1 : index;
+    const Keyframe &a = keyframes[previous];
+    const Keyframe &b = keyframes[next];
+    const float span = static_cast<float>(b.time - a.time);
+
+    Keyframe derivative;
+    derivative.time = keyframes[index].time;
+    derivative.position = (b.position - a.position) / span;
+    derivative.target = (b.target - a.target) / span;
+    derivative.fov = (b.fov - a.fov) / span;
+    return derivative;
+}
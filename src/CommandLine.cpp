@@ -0,0 +1,490 @@
+#include "CommandLine.h"
+
+#include <cstdlib>
+#include <cstring>
+
+#include "HeadlessContext.h"
+#include "Profiler.h"
+
+namespace
+{
+bool parseUnsigned(const char *text, unsigned int &value)
+{
+    char *end = nullptr;
+    const unsigned long parsed = std::strtoul(text, &end, 10);
+    if (end == text || *end != '\0')
+    {
+        return false;
+    }
+
+    value = static_cast<unsigned int>(parsed);
+    return true;
+}
+
+bool parseFloat(const char *text, float &value)
+{
+    char *end = nullptr;
+    const float parsed = std::strtof(text, &end);
+    if (end == text || *end != '\0')
+    {
+        return false;
+    }
+
+    value = parsed;
+    return true;
+}
+
+bool parseSize(const char *text, int &width, int &height)
+{
+    char *end = nullptr;
+    const long w = std::strtol(text, &end, 10);
+    if (end == text || (*end != 'x' && *end != 'X'))
+    {
+        return false;
+    }
+
+    const char *heightText = end + 1;
+    const long h = std::strtol(heightText, &end, 10);
+    if (end == heightText || *end != '\0' || w <= 0 || h <= 0)
+    {
+        return false;
+    }
+
+    width = static_cast<int>(w);
+    height = static_cast<int>(h);
+    return true;
+}
+}
+
+bool CommandLine::parse(int argc, char **argv, Options &options, std::string &error)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        const char *arg = argv[i];
+        const bool hasValue = i + 1 < argc;
+
+        if (std::strcmp(arg, "--help") == 0 || std::strcmp(arg, "-h") == 0)
+        {
+            options.showHelp = true;
+        }
+        else if (std::strcmp(arg, "--cpu") == 0)
+        {
+            options.useCpuRenderer = true;
+        }
+        else if (std::strcmp(arg, "--threads") == 0 && hasValue)
+        {
+            if (!parseUnsigned(argv[++i], options.cpuThreads))
+            {
+                error = "Invalid thread count: " + std::string(argv[i]);
+                return false;
+            }
+        }
+        else if (std::strcmp(arg, "--simd") == 0 && hasValue)
+        {
+            const char *name = argv[++i];
+            if (std::strcmp(name, "auto") == 0)
+            {
+                options.simd = PacketKernel::detectIsa();
+            }
+            else if (!PacketKernel::parseIsa(name, options.simd))
+            {
+                error = "Unknown SIMD kernel: " + std::string(name);
+                return false;
+            }
+            else if (!PacketKernel::isSupported(options.simd))
+            {
+                error = "SIMD kernel '" + std::string(name) + "' is not supported by this CPU or build.";
+                return false;
+            }
+        }
+        else if (std::strcmp(arg, "--tile-stats") == 0)
+        {
+            options.tileStats = true;
+        }
+        else if (std::strcmp(arg, "--integrator") == 0 && hasValue)
+        {
+            const char *name = argv[++i];
+            if (std::strcmp(name, "rk4") == 0)
+            {
+                options.integrator = Integrator::FixedRk4;
+            }
+            else if (std::strcmp(name, "rk45") == 0)
+            {
+                options.integrator = Integrator::AdaptiveRk45;
+            }
+            else if (std::strcmp(name, "table") == 0)
+            {
+                options.integrator = Integrator::OrbitTable;
+            }
+            else if (std::strcmp(name, "analytic") == 0)
+            {
+                options.integrator = Integrator::Analytic;
+            }
+            else
+            {
+                error = "Unknown integrator (expected rk4, rk45, table or analytic): " + std::string(name);
+                return false;
+            }
+        }
+        else if (std::strcmp(arg, "--tolerance") == 0 && hasValue)
+        {
+            if (!parseFloat(argv[++i], options.tolerance) || !(options.tolerance > 0.0f))
+            {
+                error = "Invalid integrator tolerance: " + std::string(argv[i]);
+                return false;
+            }
+        }
+        else if (std::strcmp(arg, "--weak-field-budget") == 0 && hasValue)
+        {
+            if (!parseFloat(argv[++i], options.weakFieldBudget) || !(options.weakFieldBudget >= 0.0f))
+            {
+                error = "Invalid weak-field error budget: " + std::string(argv[i]);
+                return false;
+            }
+        }
+        else if (std::strcmp(arg, "--full-tiles") == 0)
+        {
+            options.classifyTiles = false;
+        }
+        else if (std::strcmp(arg, "--sky-size") == 0 && hasValue)
+        {
+            unsigned int size = 0;
+            if (!parseUnsigned(argv[++i], size) || size > 16384 || (size & (size - 1)) != 0)
+            {
+                error = "Invalid sky cubemap size (expected 0 or a power of two): " + std::string(argv[i]);
+                return false;
+            }
+            options.skySize = static_cast<int>(size);
+        }
+        else if (std::strcmp(arg, "--output-format") == 0 && hasValue)
+        {
+            if (!RenderTarget::parseFormat(argv[++i], options.outputFormat))
+            {
+                error = "Unknown output format (expected rgba32f, rgba16f, r11g11b10f or rgb10a2): " +
+                        std::string(argv[i]);
+                return false;
+            }
+        }
+        else if (std::strcmp(arg, "--format-benchmark") == 0)
+        {
+            options.formatBenchmark = true;
+        }
+        else if (std::strcmp(arg, "--benchmark") == 0 && hasValue)
+        {
+            options.benchmarkPath = argv[++i];
+        }
+        else if (std::strcmp(arg, "--benchmark-frames") == 0 && hasValue)
+        {
+            if (!parseUnsigned(argv[++i], options.benchmarkFrames) || options.benchmarkFrames == 0)
+            {
+                error = "Invalid benchmark frame count: " + std::string(argv[i]);
+                return false;
+            }
+        }
+        else if (std::strcmp(arg, "--animation") == 0 && hasValue)
+        {
+            options.animationPath = argv[++i];
+        }
+        else if (std::strcmp(arg, "--animation-frames") == 0 && hasValue)
+        {
+            if (!parseUnsigned(argv[++i], options.animationFrames) || options.animationFrames == 0)
+            {
+                error = "Invalid animation frame count: " + std::string(argv[i]);
+                return false;
+            }
+        }
+        else if (std::strcmp(arg, "--camera-path") == 0 && hasValue)
+        {
+            options.cameraPathFile = argv[++i];
+        }
+        else if (std::strcmp(arg, "--stream-format") == 0 && hasValue)
+        {
+            if (!FrameEncoder::parseStreamFormat(argv[++i], options.streamFormat))
+            {
+                error = "Unknown stream format (expected y4m or rgb): " + std::string(argv[i]);
+                return false;
+            }
+        }
+        else if (std::strcmp(arg, "--fps") == 0 && hasValue)
+        {
+            if (!parseUnsigned(argv[++i], options.fps) || options.fps == 0)
+            {
+                error = "Invalid frame rate: " + std::string(argv[i]);
+                return false;
+            }
+        }
+        else if (std::strcmp(arg, "--headless") == 0)
+        {
+            if (!HeadlessContext::COMPILED_IN)
+            {
+                error = "--headless needs a build with EGL (libEGL and its headers were not found).";
+                return false;
+            }
+            options.headless = true;
+        }
+        else if (std::strcmp(arg, "--step-stats") == 0)
+        {
+            options.stepStats = true;
+        }
+        else if (std::strcmp(arg, "--debug-view") == 0 && hasValue)
+        {
+            if (!parseDebugView(argv[++i], options.debugView))
+            {
+                error = "Unknown debug view (expected none, steps or termination): " + std::string(argv[i]);
+                return false;
+            }
+        }
+        else if (std::strcmp(arg, "--gpu-timers") == 0)
+        {
+            options.gpuTimers = true;
+        }
+        else if (std::strcmp(arg, "--gpu-timers-csv") == 0 && hasValue)
+        {
+            options.gpuTimersCsv = argv[++i];
+        }
+        else if (std::strcmp(arg, "--profile") == 0 && hasValue)
+        {
+            if (!Profiler::COMPILED_IN)
+            {
+                error = "--profile needs a build configured with -DBLACK_HOLE_SIM_PROFILER=ON.";
+                return false;
+            }
+            options.profilePath = argv[++i];
+        }
+        else if (std::strcmp(arg, "--size") == 0 && hasValue)
+        {
+            if (!parseSize(argv[++i], options.width, options.height))
+            {
+                error = "Invalid size (expected WIDTHxHEIGHT): " + std::string(argv[i]);
+                return false;
+            }
+        }
+        else if (std::strcmp(arg, "--preset") == 0 && hasValue)
+        {
+            if (!parseUnsigned(argv[++i], options.preset) || options.preset == 0 || options.preset > 4)
+            {
+                error = "Invalid camera preset (expected 1-4): " + std::string(argv[i]);
+                return false;
+            }
+        }
+        else if (std::strcmp(arg, "--output") == 0 && hasValue)
+        {
+            options.outputPath = argv[++i];
+        }
+        else if (std::strcmp(arg, "--tile-workers") == 0 && hasValue)
+        {
+            if (!parseUnsigned(argv[++i], options.tileWorkers))
+            {
+                error = "Invalid tile worker count: " + std::string(argv[i]);
+                return false;
+            }
+        }
+        else if (std::strcmp(arg, "--listen") == 0 && hasValue)
+        {
+            options.listenAddress = argv[++i];
+        }
+        else if (std::strcmp(arg, "--tile-worker") == 0 && hasValue)
+        {
+            options.tileWorkerAddress = argv[++i];
+        }
+        else if (std::strcmp(arg, "--animation-workers") == 0 && hasValue)
+        {
+            if (!parseUnsigned(argv[++i], options.animationWorkers) || options.animationWorkers == 0)
+            {
+                error = "Invalid animation worker count: " + std::string(argv[i]);
+                return false;
+            }
+        }
+        else if (std::strcmp(arg, "--frame-worker") == 0 && hasValue)
+        {
+            options.frameWorkerAddress = argv[++i];
+        }
+        else if (std::strcmp(arg, "--regression") == 0 && hasValue)
+        {
+            if (!Regression::parseTest(argv[++i], options.regression))
+            {
+                error = "Unknown regression test (expected disk-crossing or analytic): " + std::string(argv[i]);
+                return false;
+            }
+        }
+        else
+        {
+            error = "Unknown or incomplete option: " + std::string(arg);
+            return false;
+        }
+    }
+
+    if (options.formatBenchmark && options.useCpuRenderer)
+    {
+        error = "--format-benchmark times the compute shader and can't be combined with --cpu.";
+        return false;
+    }
+    if (!options.benchmarkPath.empty() && options.stepStats)
+    {
+        error = "--benchmark reads the step counter itself and can't be combined with --step-stats.";
+        return false;
+    }
+    FrameEncoder::Output animationOutput;
+    if (!options.animationPath.empty() &&
+        !FrameEncoder::outputFor(options.animationPath, options.streamFormat, animationOutput))
+    {
+        error = "--animation writes .ppm, .pfm or .exr sequences or streams to -: " + options.animationPath;
+        return false;
+    }
+    if (!options.cameraPathFile.empty() && options.animationPath.empty() && options.benchmarkPath.empty())
+    {
+        error = "--camera-path is played back by --animation or --benchmark; use it with one of them.";
+        return false;
+    }
+    if (!options.animationPath.empty() && !options.benchmarkPath.empty())
+    {
+        error = "--animation and --benchmark both drive the camera; run them separately.";
+        return false;
+    }
+    const bool distributed = options.tileWorkers > 0 || !options.listenAddress.empty();
+    if (distributed && (options.outputPath.empty() || options.regression != Regression::Test::None))
+    {
+        error = "--tile-workers and --listen split an --output frame into tiles; use them with --output.";
+        return false;
+    }
+    if (!options.tileWorkerAddress.empty() && (distributed || !options.outputPath.empty() ||
+                                               !options.animationPath.empty() || !options.benchmarkPath.empty() ||
+                                               options.formatBenchmark || options.regression != Regression::Test::None))
+    {
+        error = "--tile-worker renders what its coordinator sends and can't be combined with other modes.";
+        return false;
+    }
+    const bool frameParallel = options.animationWorkers > 0 || !options.frameWorkerAddress.empty();
+    if (frameParallel && (options.animationPath.empty() || options.animationPath == "-"))
+    {
+        error = "--animation-workers and --frame-worker split an --animation image sequence; a stream has to be "
+                "rendered in order by one process.";
+        return false;
+    }
+    if (frameParallel && options.animationPath.find('#') == std::string::npos)
+    {
+        error = "--animation-workers writes one file per frame; --animation needs '#' for the frame number, e.g. "
+                "frames/####.exr: " + options.animationPath;
+        return false;
+    }
+    if (options.animationWorkers > 0 && !options.headless)
+    {
+        error = "--animation-workers renders on headless worker processes; add --headless.";
+        return false;
+    }
+    if (options.animationWorkers > 0 && !options.frameWorkerAddress.empty())
+    {
+        error = "--frame-worker renders the ranges its coordinator sends and can't start workers itself.";
+        return false;
+    }
+    if (options.headless && options.benchmarkPath.empty() && options.animationPath.empty() && !options.formatBenchmark &&
+        !distributed && options.tileWorkerAddress.empty())
+    {
+        error = "--headless has no window to show frames in; use it with --animation, --benchmark, --format-benchmark, "
+                "--tile-workers or --tile-worker.";
+        return false;
+    }
+
+    return true;
+}
+
+void CommandLine::printUsage(std::ostream &out, const char *programName)
+{
+    out << "Usage: " << programName << " [options]\n"
+        << "  --help             show this message\n"
+        << "  --cpu              trace rays on the CPU instead of the compute shader\n"
+        << "  --threads N        CPU worker threads (default: all hardware threads)\n"
+        << "  --simd KERNEL      CPU ray packet kernel: auto, scalar, generic, sse, avx2, avx512\n"
+        << "  --tile-stats       print per-thread busy/idle time of the CPU tile scheduler\n"
+        << "  --integrator NAME  photon path integrator: rk45 (adaptive, default), rk4 (fixed step)\n"
+        << "                     table (cached photon orbit table, rk45 where it can't be used)\n"
+        << "                     or analytic (closed form elliptic orbits, rk45 near the photon ring)\n"
+        << "  --tolerance T      relative error per step of the rk45 integrator (default: 1e-5)\n"
+        << "  --weak-field-budget PX\n"
+        << "                     error in pixels allowed for rays far from the hole, which skip\n"
+        << "                     integration (default: 0.5, 0 integrates every ray)\n"
+        << "  --full-tiles       integrate every tile, without the pre-pass that shades pure\n"
+        << "                     background and shadow tiles directly\n"
+        << "  --sky-size N       face size of the starfield cubemap baked at startup and cached\n"
+        << "                     (power of two, default: 1024, 0 evaluates the sky per ray)\n"
+        << "  --output-format F  storage of the rendered frame: rgba32f (default), rgba16f,\n"
+        << "                     r11g11b10f or rgb10a2 (clamped to [0, 1] like the display)\n"
+        << "  --format-benchmark time GPU frames at the window size with every output format\n"
+        << "                     and exit\n"
+        << "  --benchmark FILE   hold each camera preset, then orbit the hole, with vsync off,\n"
+        << "                     and write frame times, rays/s and GPU vs CPU time to FILE as\n"
+        << "                     JSON (- for stdout)\n"
+        << "  --benchmark-frames N\n"
+        << "                     timed frames per preset and for the orbit (default: 240)\n"
+        << "  --animation OUT    orbit the hole once from the start position and write every\n"
+        << "                     frame to OUT, a .ppm, .pfm or .exr path with '#' for the frame\n"
+        << "                     number (e.g. frames/####.exr), or - to stream them to stdout for\n"
+        << "                     ffmpeg; .pfm and .exr keep the unclamped radiance\n"
+        << "  --animation-frames N\n"
+        << "                     frames of the orbit (default: 240) or of the camera path (default:\n"
+        << "                     its length at --fps)\n"
+        << "  --camera-path FILE play back the keyframes in FILE (time, position, target and\n"
+        << "                     optionally fov per line) instead of the orbit in --animation\n"
+        << "                     and instead of the orbit segment in --benchmark\n"
+        << "  --stream-format F  y4m (default) or rgb (raw rgb24) for --animation -\n"
+        << "  --fps N            frame rate of --animation: in the y4m header, and the one the\n"
+        << "                     camera path is sampled at (default: 30)\n"
+        << "  --headless         render offscreen through EGL without a window or display, for\n"
+        << "                     --animation, the benchmarks and tile workers on servers and in\n"
+        << "                     containers\n"
+        << "  --step-stats       print the average number of integration steps per ray, rays/s,\n"
+        << "                     steps/s, how rays ended and a histogram of steps per ray\n"
+        << "  --debug-view NAME  show steps per ray (steps: black none, white the step cap) or\n"
+        << "                     how each ray ended (termination: horizon grey, disk orange,\n"
+        << "                     sky blue) instead of the image; rays that hit the step cap\n"
+        << "                     and fell back to the unlensed sky are magenta in both\n"
+        << "  --gpu-timers       print the GPU time of the dispatch (or upload), draw and swap\n"
+        << "                     over the last 240 frames: min/avg/p99\n"
+        << "  --gpu-timers-csv FILE\n"
+        << "                     write every frame's GPU phase times to FILE on exit\n"
+        << "  --profile FILE     record CPU zones of the render loop and write them to FILE as\n"
+        << "                     Chrome trace JSON on exit or when F9 is pressed (needs a build\n"
+        << "                     with -DBLACK_HOLE_SIM_PROFILER=ON)\n"
+        << "  --size WxH         initial render resolution (default: 1280x720)\n"
+        << "  --preset N         start from camera preset N (1-4)\n"
+        << "  --output FILE.pfm  render one frame with the CPU tracer and exit (no window);\n"
+        << "                     a .exr FILE is written as OpenEXR\n"
+        << "  --tile-workers N   split the --output frame into 128x128 tiles and render them on N\n"
+        << "                     worker processes (CPU tracer, or the compute shader with\n"
+        << "                     --headless); tiles of a worker that dies go to the others\n"
+        << "  --listen ADDR      also hand --output tiles to workers on other machines that\n"
+        << "                     connect to ADDR: host:port (e.g. :7000) or unix:/path\n"
+        << "  --tile-worker ADDR render tiles for the coordinator at ADDR until it is done\n"
+        << "                     (CPU tracer, or the compute shader with --headless)\n"
+        << "  --animation-workers N\n"
+        << "                     render the --animation sequence on N headless worker processes,\n"
+        << "                     each taking ranges of consecutive frames; finished frames are\n"
+        << "                     listed in a manifest next to the sequence (frames/####.exr:\n"
+        << "                     frames/manifest.txt), and running the same command again only\n"
+        << "                     renders the frames missing from it\n"
+        << "  --frame-worker ADDR\n"
+        << "                     render --animation frames for the coordinator at ADDR until it\n"
+        << "                     is done (started by --animation-workers)\n"
+        << "  --regression NAME  render every camera preset both ways with the CPU tracer, print\n"
+        << "                     the differences and exit, with status 1 if any is out of\n"
+        << "                     tolerance; with --output DIR, keep the images.\n"
+        << "                     disk-crossing: original slab disk test (rk4) against the exact\n"
+        << "                     disk plane crossing, with rk4 and with --integrator\n"
+        << "                     analytic: rk4, rk45 and table against the closed form orbits\n";
+}
+
+const char *CommandLine::integratorName(Integrator integrator)
+{
+    switch (integrator)
+    {
+    case Integrator::FixedRk4:
+        return "rk4";
+    case Integrator::AdaptiveRk45:
+        return "rk45";
+    case Integrator::OrbitTable:
+        return "table";
+    case Integrator::Analytic:
+        return "analytic";
+    }
+    return "unknown";
+}
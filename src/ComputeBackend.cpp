@@ -0,0 +1,76 @@
+#include "ComputeBackend.h"
+
+#include "Camera.h"
+#include "PhotonOrbitTable.h"
+#include "Profiler.h"
+#include "RenderSetup.h"
+#include "StarfieldCubemap.h"
+
+ComputeBackend::ComputeBackend(const std::filesystem::path &shaderPath, const CommandLine::Options &options,
+                               const glm::ivec2 &resolution, const glm::mat4 &invProjection,
+                               const StarfieldCubemap *sky)
+    : options(options), shader(shaderPath.string(), RenderSetup::shaderDefines(options))
+{
+    shader.bind();
+    resolutionLocation = shader.getUniformLocation("resolutionVector");
+    invProjectionLocation = shader.getUniformLocation("invProjection");
+    cameraPosLocation = shader.getUniformLocation("cameraPos");
+    invViewLocation = shader.getUniformLocation("invView");
+    RenderSetup::configureComputeShader(shader, resolution, invProjection, options, sky != nullptr);
+
+    if (options.integrator == Integrator::OrbitTable)
+    {
+        orbitTableTexture = std::make_unique<OrbitTableTexture>();
+    }
+    if (sky != nullptr)
+    {
+        starfieldTexture = std::make_unique<StarfieldTexture>();
+        starfieldTexture->upload(*sky);
+    }
+}
+
+void ComputeBackend::uploadDiskEmission(const DiskEmissionMap &diskEmission)
+{
+    PROFILE_ZONE("disk emission upload");
+    diskEmissionTexture.upload(diskEmission);
+}
+
+void ComputeBackend::uploadOrbitTable(const PhotonOrbitTable &orbitTable)
+{
+    PROFILE_ZONE("orbit table upload");
+    orbitTableTexture->upload(orbitTable);
+    shader.bind();
+    shader.setUniform1f("orbitTableRadius", orbitTable.getRadius());
+}
+
+void ComputeBackend::setProjection(const glm::ivec2 &resolution, const glm::mat4 &invProjection)
+{
+    shader.bind();
+    shader.setUniform2i(resolutionLocation, resolution);
+    shader.setUniformMatrix4fv(invProjectionLocation, invProjection);
+    shader.setUniform1f("weakFieldImpact", RenderSetup::weakFieldImpact(resolution, invProjection, options));
+}
+
+void ComputeBackend::prepareFrame(const Camera &camera)
+{
+    PROFILE_ZONE("uniforms");
+    shader.bind();
+    shader.setUniform3fv(cameraPosLocation, camera.getPosition());
+    shader.setUniformMatrix4fv(invViewLocation, camera.invViewMatrix());
+    if (orbitTableTexture)
+    {
+        orbitTableTexture->bind(RenderSetup::ORBIT_SAMPLES_UNIT, RenderSetup::ORBIT_ROWS_UNIT);
+    }
+    if (starfieldTexture)
+    {
+        starfieldTexture->bind(RenderSetup::STARFIELD_UNIT);
+    }
+    diskEmissionTexture.bind(RenderSetup::DISK_EMISSION_UNIT, RenderSetup::BLACKBODY_UNIT);
+}
+
+void ComputeBackend::dispatch(const glm::ivec2 &resolution)
+{
+    PROFILE_ZONE("dispatch");
+    shader.dispatch((resolution.x + 15) / 16, (resolution.y + 15) / 16, 1);
+    shader.memoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+}
@@ -0,0 +1,405 @@
+#include "CpuTracer.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <thread>
+
+#include "Geodesic.h"
+#include "PhotonOrbitTable.h"
+#include "StarfieldCubemap.h"
+#include "Termination.h"
+#include "TileClassifier.h"
+
+namespace
+{
+// Ray state for one batch of pixels in the structure-of-arrays layout the packet kernels read.
+struct RayBatch
+{
+    std::vector<float> u;
+    std::vector<float> up;
+    std::vector<float> phi;
+    std::vector<float> e1x, e1y, e1z;
+    std::vector<float> e2x, e2y, e2z;
+    std::vector<std::uint8_t> termination;
+    std::vector<std::uint32_t> steps;
+    std::vector<Geodesic::PrimaryRay> primary;
+    std::vector<std::size_t> pixel;     // index of each ray in its tile, row-major
+
+    void resize(std::size_t count)
+    {
+        for (auto *stream : {&u, &up, &phi, &e1x, &e1y, &e1z, &e2x, &e2y, &e2z})
+        {
+            stream->resize(count);
+        }
+        termination.resize(count);
+        steps.resize(count);
+        primary.resize(count);
+        pixel.resize(count);
+    }
+
+    void store(std::size_t i, std::size_t tileIndex, const Geodesic::PrimaryRay &ray)
+    {
+        primary[i] = ray;
+        pixel[i] = tileIndex;
+        u[i] = ray.u0;
+        up[i] = ray.up0;
+        phi[i] = ray.phi0;
+        e1x[i] = ray.e1.x;
+        e1y[i] = ray.e1.y;
+        e1z[i] = ray.e1.z;
+        e2x[i] = ray.e2.x;
+        e2y[i] = ray.e2.y;
+        e2z[i] = ray.e2.z;
+    }
+
+    PacketKernel::RayStreams streams()
+    {
+        return PacketKernel::RayStreams{
+            u.size(),
+            u.data(), up.data(), phi.data(),
+            e1x.data(), e1y.data(), e1z.data(),
+            e2x.data(), e2y.data(), e2z.data(),
+            termination.data(), steps.data()
+        };
+    }
+};
+
+PacketKernel::Constants kernelConstants(const TracerParameters &params)
+{
+    PacketKernel::Constants constants{};
+    constants.M = 0.5f * params.Rs;
+    constants.horizonRadius = params.Rs * (1.0f + Geodesic::EPSILON_HORIZON);
+    constants.escapeRadius = Geodesic::R_ESCAPE;
+    constants.diskInnerRadius = params.disk.innerRadius;
+    constants.diskOuterRadius = params.disk.outerRadius;
+    constants.diskNormal[0] = params.disk.normal.x;
+    constants.diskNormal[1] = params.disk.normal.y;
+    constants.diskNormal[2] = params.disk.normal.z;
+    constants.dphi = Geodesic::DPHI;
+    constants.maxSteps = Geodesic::MAX_PHI_STEPS;
+    constants.adaptive = params.integrator != Integrator::FixedRk4 ? 1 : 0;
+    constants.tolerance = params.tolerance;
+    constants.phiBudget = Geodesic::PHI_BUDGET;
+    constants.initialStep = Geodesic::ADAPTIVE_INITIAL_STEP;
+    constants.minStep = Geodesic::ADAPTIVE_MIN_STEP;
+    constants.maxStep = Geodesic::ADAPTIVE_MAX_STEP;
+    constants.Rs = params.Rs;
+    constants.criticalInverseImpactSq = 4.0f / (27.0f * params.Rs * params.Rs);
+    constants.earlyCaptureRadius = params.disk.innerRadius;
+    constants.earlyEscapeRadius = glm::max(params.disk.outerRadius, 1.5f * params.Rs);
+    return constants;
+}
+
+// Resolves the ray without integrating it: the closed form orbit when the integrator
+// asks for it, which is exact and so comes before the weak-field expansion, then
+// weak-field escapes and the photon orbit table when the integrator asks for it and
+// the table covers it. Rays left to integrate are moved to where they enter the
+// influence sphere.
+bool resolveDirectly(const TracerParameters &params, Geodesic::PrimaryRay &ray, Termination &termination,
+                     float &u, float &phi)
+{
+    if (params.diskTest != DiskTest::Crossing)
+    {
+        return false;
+    }
+    if (params.integrator == Integrator::Analytic && Geodesic::analyticTrace(params, ray, termination, u, phi))
+    {
+        return true;
+    }
+    if (Geodesic::weakFieldEscape(params, ray, phi))
+    {
+        termination = Termination::Escape;
+        u = 0.0f;
+        return true;
+    }
+    if (params.integrator == Integrator::OrbitTable && params.orbitTable != nullptr &&
+        params.orbitTable->trace(params, ray, termination, u, phi))
+    {
+        return true;
+    }
+    if (!Geodesic::enterInfluenceSphere(params, ray, phi))
+    {
+        termination = Termination::Escape;
+        u = 0.0f;
+        return true;
+    }
+    return false;
+}
+
+// shadeRay(), except that with a baked starfield the pixels that show the sky are
+// left black and their direction goes to sky for shadeSky(). Also counts the ray.
+glm::vec3 shadePixel(const TracerParameters &params, const Geodesic::PrimaryRay &ray, Termination termination,
+                     float u, float phi, unsigned int steps, glm::vec3 &sky, RayStatistics &statistics)
+{
+    statistics.add(steps, termination);
+    if (params.debugView != DebugView::None)
+    {
+        return debugColor(params.debugView, steps, termination);
+    }
+    if (params.starfield != nullptr && Geodesic::skyDirection(ray, termination, phi, sky))
+    {
+        return glm::vec3(0.0f);
+    }
+    return Geodesic::shadeRay(params, ray, termination, u, phi);
+}
+
+// Where the rendered region goes: pixel (x, y) of the frame is at
+// pixels[(y - y0) * width + (x - x0)].
+struct ImageRegion
+{
+    glm::vec4 *pixels;
+    int x0;
+    int y0;
+    std::size_t width;
+
+    glm::vec4 &at(int x, int y) const
+    {
+        return pixels[static_cast<std::size_t>(y - y0) * width + static_cast<std::size_t>(x - x0)];
+    }
+};
+
+// Samples the baked starfield for the tile's sky pixels (nonzero directions in sky,
+// row-major in the tile). Lensing stretches and squeezes the sky, so a pixel's
+// footprint is how far the direction moves to its neighbours: the nearer one along
+// each axis, so it doesn't blur across the edge of a lensed image, then the wider
+// axis. Pixels without a sky neighbour use the camera's pixel angle.
+void shadeSky(const TracerParameters &params, const TileScheduler::Tile &tile, const std::vector<glm::vec3> &sky,
+              const ImageRegion &image)
+{
+    const StarfieldCubemap &starfield = *params.starfield;
+    const float pixelAngle = 2.0f * params.invProjection[1][1] / static_cast<float>(params.resolution.y);
+    const int tileWidth = tile.x1 - tile.x0;
+    const int tileHeight = tile.y1 - tile.y0;
+
+    auto distanceTo = [&](glm::vec3 direction, int x, int y, float &nearest) {
+        if (x < 0 || y < 0 || x >= tileWidth || y >= tileHeight)
+        {
+            return;
+        }
+        const glm::vec3 neighbour = sky[static_cast<std::size_t>(y * tileWidth + x)];
+        if (neighbour != glm::vec3(0.0f))
+        {
+            nearest = glm::min(nearest, glm::length(direction - neighbour));
+        }
+    };
+
+    for (int y = 0; y < tileHeight; ++y)
+    {
+        for (int x = 0; x < tileWidth; ++x)
+        {
+            const glm::vec3 direction = sky[static_cast<std::size_t>(y * tileWidth + x)];
+            if (direction == glm::vec3(0.0f))
+            {
+                continue;
+            }
+
+            const float none = std::numeric_limits<float>::max();
+            float alongX = none;
+            float alongY = none;
+            distanceTo(direction, x - 1, y, alongX);
+            distanceTo(direction, x + 1, y, alongX);
+            distanceTo(direction, x, y - 1, alongY);
+            distanceTo(direction, x, y + 1, alongY);
+            float footprint = glm::max(alongX == none ? 0.0f : alongX, alongY == none ? 0.0f : alongY);
+            if (alongX == none && alongY == none)
+            {
+                footprint = pixelAngle;
+            }
+
+            const glm::vec3 color = starfield.sample(direction, starfield.levelOfDetail(footprint));
+            image.at(tile.x0 + x, tile.y0 + y) = glm::vec4(color, 1.0f);
+        }
+    }
+}
+
+// Sets up the tile's primary rays, row-major, and runs the classification pre-pass
+// over them when the parameters ask for it.
+TileClassifier::TileClass setUpTile(const TracerParameters &params, const TileScheduler::Tile &tile,
+                                    std::vector<Geodesic::PrimaryRay> &rays)
+{
+    rays.clear();
+    TileClassifier::Bounds bounds = TileClassifier::emptyBounds();
+    for (int y = tile.y0; y < tile.y1; ++y)
+    {
+        for (int x = tile.x0; x < tile.x1; ++x)
+        {
+            rays.push_back(Geodesic::setupPrimaryRay(params, glm::vec2(static_cast<float>(x), static_cast<float>(y))));
+            TileClassifier::include(bounds, params, rays.back());
+        }
+    }
+
+    if (!params.classifyTiles || params.diskTest != DiskTest::Crossing)
+    {
+        return TileClassifier::TileClass::Trace;
+    }
+    return TileClassifier::classify(params, bounds);
+}
+
+// Shades a tile the pre-pass settled without integrating any of its rays.
+void shadeClassifiedTile(const TracerParameters &params, TileClassifier::TileClass tileClass,
+                         const std::vector<Geodesic::PrimaryRay> &rays, const ImageRegion &image,
+                         const TileScheduler::Tile &tile, std::vector<glm::vec3> &sky, RayStatistics &statistics)
+{
+    std::size_t i = 0;
+    for (int y = tile.y0; y < tile.y1; ++y)
+    {
+        for (int x = tile.x0; x < tile.x1; ++x, ++i)
+        {
+            glm::vec3 color;
+            if (tileClass == TileClassifier::TileClass::Background)
+            {
+                color = shadePixel(params, rays[i], Termination::Escape, 0.0f,
+                                   Geodesic::freeEscapeAngle(rays[i], params.Rs), 0, sky[i], statistics);
+            }
+            else
+            {
+                color = shadePixel(params, rays[i], Termination::Horizon, 0.0f, 0.0f, 0, sky[i], statistics);
+            }
+            image.at(x, y) = glm::vec4(color, 1.0f);
+        }
+    }
+}
+
+void renderTileScalar(const TracerParameters &params, const ImageRegion &image, const TileScheduler::Tile &tile,
+                      const std::vector<Geodesic::PrimaryRay> &rays, std::vector<glm::vec3> &sky, RayStatistics &statistics)
+{
+    std::size_t i = 0;
+    for (int y = tile.y0; y < tile.y1; ++y)
+    {
+        for (int x = tile.x0; x < tile.x1; ++x, ++i)
+        {
+            Geodesic::PrimaryRay ray = rays[i];
+
+            float u;
+            float phi;
+            Termination termination;
+            unsigned int steps = 0;
+            if (!resolveDirectly(params, ray, termination, u, phi))
+            {
+                termination = Geodesic::integrateRay(params, ray, u, phi, steps);
+            }
+
+            const glm::vec3 color = shadePixel(params, ray, termination, u, phi, steps, sky[i], statistics);
+            image.at(x, y) = glm::vec4(color, 1.0f);
+        }
+    }
+}
+
+void renderTilePacketed(const TracerParameters &params, PacketKernel::Isa isa, const PacketKernel::Constants &constants,
+                        const ImageRegion &image, const TileScheduler::Tile &tile,
+                        const std::vector<Geodesic::PrimaryRay> &rays, RayBatch &batch, std::vector<glm::vec3> &sky,
+                        RayStatistics &statistics)
+{
+    const int tileWidth = tile.x1 - tile.x0;
+    batch.resize(static_cast<std::size_t>(tileWidth * (tile.y1 - tile.y0)));
+
+    // The whole tile goes through the kernel as one batch so lanes freed by cheap
+    // rays are refilled from the same tile instead of idling until the row ends.
+    std::size_t count = 0;
+    std::size_t i = 0;
+    for (int y = tile.y0; y < tile.y1; ++y)
+    {
+        for (int x = tile.x0; x < tile.x1; ++x, ++i)
+        {
+            Geodesic::PrimaryRay ray = rays[i];
+
+            float u;
+            float phi;
+            Termination termination;
+            if (resolveDirectly(params, ray, termination, u, phi))
+            {
+                image.at(x, y) = glm::vec4(shadePixel(params, ray, termination, u, phi, 0, sky[i], statistics), 1.0f);
+                continue;
+            }
+            batch.store(count++, i, ray);
+        }
+    }
+    batch.resize(count);
+
+    PacketKernel::integrate(isa, constants, batch.streams());
+
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        const int x = tile.x0 + static_cast<int>(batch.pixel[i] % static_cast<std::size_t>(tileWidth));
+        const int y = tile.y0 + static_cast<int>(batch.pixel[i] / static_cast<std::size_t>(tileWidth));
+        const glm::vec3 color = shadePixel(params, batch.primary[i], static_cast<Termination>(batch.termination[i]),
+                                           batch.u[i], batch.phi[i], batch.steps[i], sky[batch.pixel[i]], statistics);
+        image.at(x, y) = glm::vec4(color, 1.0f);
+    }
+}
+}
+
+CpuTracer::CpuTracer(unsigned int threads, PacketKernel::Isa kernelIsa)
+    : threadCount(threads), isa(kernelIsa), lastFrameBackgroundTiles(0),
+      lastFrameShadowTiles(0)
+{
+    if (threadCount == 0)
+    {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    scheduler = std::make_unique<TileScheduler>(threadCount);
+}
+
+void CpuTracer::render(const TracerParameters &params, std::vector<glm::vec4> &image)
+{
+    render(params, TileScheduler::Tile{0, 0, params.resolution.x, params.resolution.y}, image);
+}
+
+void CpuTracer::render(const TracerParameters &params, const TileScheduler::Tile &region, std::vector<glm::vec4> &image)
+{
+    const int width = region.x1 - region.x0;
+    const int height = region.y1 - region.y0;
+    image.resize(static_cast<std::size_t>(std::max(width, 0)) * static_cast<std::size_t>(std::max(height, 0)));
+    lastFrameStatistics = RayStatistics{};
+    lastFrameBackgroundTiles = 0;
+    lastFrameShadowTiles = 0;
+    if (width <= 0 || height <= 0)
+    {
+        return;
+    }
+
+    const PacketKernel::Constants constants = kernelConstants(params);
+    std::vector<RayBatch> batches(scheduler->getWorkerCount());
+    std::vector<std::vector<Geodesic::PrimaryRay>> tileRays(scheduler->getWorkerCount());
+    std::vector<std::vector<glm::vec3>> tileSky(scheduler->getWorkerCount());
+    std::vector<RayStatistics> workerStatistics(scheduler->getWorkerCount());
+    std::vector<unsigned int> workerBackgroundTiles(scheduler->getWorkerCount(), 0);
+    std::vector<unsigned int> workerShadowTiles(scheduler->getWorkerCount(), 0);
+
+    // The packet kernels only know the crossing test; the slab reference runs scalar.
+    const bool scalar = isa == PacketKernel::Isa::Scalar || params.diskTest == DiskTest::Slab;
+    const ImageRegion target{image.data(), region.x0, region.y0, static_cast<std::size_t>(width)};
+    scheduler->run(region, [&](unsigned int worker, const TileScheduler::Tile &tile) {
+        std::vector<Geodesic::PrimaryRay> &rays = tileRays[worker];
+        std::vector<glm::vec3> &sky = tileSky[worker];
+        const TileClassifier::TileClass tileClass = setUpTile(params, tile, rays);
+        sky.assign(rays.size(), glm::vec3(0.0f));
+        if (tileClass != TileClassifier::TileClass::Trace)
+        {
+            shadeClassifiedTile(params, tileClass, rays, target, tile, sky, workerStatistics[worker]);
+            ++(tileClass == TileClassifier::TileClass::Background ? workerBackgroundTiles : workerShadowTiles)[worker];
+        }
+        else if (scalar)
+        {
+            renderTileScalar(params, target, tile, rays, sky, workerStatistics[worker]);
+        }
+        else
+        {
+            renderTilePacketed(params, isa, constants, target, tile, rays, batches[worker], sky, workerStatistics[worker]);
+        }
+
+        if (params.starfield != nullptr && params.debugView == DebugView::None)
+        {
+            shadeSky(params, tile, sky, target);
+        }
+    });
+
+    for (unsigned int worker = 0; worker < scheduler->getWorkerCount(); ++worker)
+    {
+        lastFrameStatistics.merge(workerStatistics[worker]);
+        lastFrameBackgroundTiles += workerBackgroundTiles[worker];
+        lastFrameShadowTiles += workerShadowTiles[worker];
+    }
+}
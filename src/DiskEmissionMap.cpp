@@ -0,0 +1,74 @@
+#include "DiskEmissionMap.h"
+
+#include <cmath>
+
+#include "Geodesic.h"
+
+namespace
+{
+constexpr float TWO_PI = 2.0f * Geodesic::PI;
+}
+
+DiskEmissionMap::DiskEmissionMap() : baked{}
+{
+}
+
+bool DiskEmissionMap::prepare(const DiskParameters &disk)
+{
+    if (isReady() && matches(disk))
+    {
+        return false;
+    }
+
+    bake(disk);
+    return true;
+}
+
+void DiskEmissionMap::bake(const DiskParameters &disk)
+{
+    baked = disk;
+    texels.resize(static_cast<std::size_t>(ANGLE_COUNT) * RADIUS_COUNT);
+
+    const glm::vec3 origin(0.0f);
+    const float width = disk.outerRadius - disk.innerRadius;
+    for (int i = 0; i < RADIUS_COUNT; ++i)
+    {
+        const float r = disk.innerRadius + (static_cast<float>(i) + 0.5f) / static_cast<float>(RADIUS_COUNT) * width;
+        for (int j = 0; j < ANGLE_COUNT; ++j)
+        {
+            const float angle = TWO_PI * (static_cast<float>(j) + 0.5f) / static_cast<float>(ANGLE_COUNT) - Geodesic::PI;
+            const glm::vec3 diskPos = r * (std::cos(angle) * disk.basisX + std::sin(angle) * disk.basisZ);
+            texels[static_cast<std::size_t>(i) * ANGLE_COUNT + j] = Geodesic::diskEmission(diskPos, origin, disk, r);
+        }
+    }
+}
+
+// Angles wrap around the disk; radii clamp to the first and last rows.
+glm::vec2 DiskEmissionMap::lookup(glm::vec3 radial, float r) const
+{
+    const float angle = std::atan2(glm::dot(radial, baked.basisZ), glm::dot(radial, baked.basisX));
+    const float x = (angle + Geodesic::PI) / TWO_PI * static_cast<float>(ANGLE_COUNT) - 0.5f;
+    const float y = glm::clamp((r - baked.innerRadius) / (baked.outerRadius - baked.innerRadius) *
+                                   static_cast<float>(RADIUS_COUNT) - 0.5f,
+                               0.0f, static_cast<float>(RADIUS_COUNT - 1));
+
+    const float column = std::floor(x);
+    const int x0 = (static_cast<int>(column) + ANGLE_COUNT) % ANGLE_COUNT;
+    const int x1 = (x0 + 1) % ANGLE_COUNT;
+    const int y0 = static_cast<int>(y);
+    const int y1 = glm::min(y0 + 1, RADIUS_COUNT - 1);
+    const float fx = x - column;
+    const float fy = y - static_cast<float>(y0);
+
+    const glm::vec2 *row0 = texels.data() + static_cast<std::size_t>(y0) * ANGLE_COUNT;
+    const glm::vec2 *row1 = texels.data() + static_cast<std::size_t>(y1) * ANGLE_COUNT;
+    return glm::mix(glm::mix(row0[x0], row0[x1], fx), glm::mix(row1[x0], row1[x1], fx), fy);
+}
+
+// Only the parameters diskEmission() reads; Doppler ones can change freely.
+bool DiskEmissionMap::matches(const DiskParameters &disk) const
+{
+    return disk.innerRadius == baked.innerRadius && disk.outerRadius == baked.outerRadius &&
+           disk.innerTemperature == baked.innerTemperature && disk.intensity == baked.intensity && disk.basisX == baked.basisX &&
+           disk.basisZ == baked.basisZ;
+}
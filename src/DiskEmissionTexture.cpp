@@ -0,0 +1,54 @@
+#include "DiskEmissionTexture.h"
+
+#include "Blackbody.h"
+#include "DiskEmissionMap.h"
+
+namespace
+{
+unsigned int createLinearTexture(GLint wrapS)
+{
+    unsigned int texture = 0;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrapS);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    return texture;
+}
+}
+
+DiskEmissionTexture::DiskEmissionTexture()
+    : emissionTexture(createLinearTexture(GL_REPEAT)), blackbodyTexture(createLinearTexture(GL_CLAMP_TO_EDGE))
+{
+    // The blackbody table never changes.
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glBindTexture(GL_TEXTURE_2D, blackbodyTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB32F, Blackbody::TABLE_SIZE, 1, 0, GL_RGB, GL_FLOAT, Blackbody::table().data());
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+DiskEmissionTexture::~DiskEmissionTexture()
+{
+    glDeleteTextures(1, &emissionTexture);
+    glDeleteTextures(1, &blackbodyTexture);
+}
+
+void DiskEmissionTexture::upload(const DiskEmissionMap &map) const
+{
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glBindTexture(GL_TEXTURE_2D, emissionTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RG32F, DiskEmissionMap::ANGLE_COUNT, DiskEmissionMap::RADIUS_COUNT, 0, GL_RG,
+                 GL_FLOAT, map.getTexels().data());
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void DiskEmissionTexture::bind(unsigned int emissionUnit, unsigned int blackbodyUnit) const
+{
+    glActiveTexture(GL_TEXTURE0 + emissionUnit);
+    glBindTexture(GL_TEXTURE_2D, emissionTexture);
+    glActiveTexture(GL_TEXTURE0 + blackbodyUnit);
+    glBindTexture(GL_TEXTURE_2D, blackbodyTexture);
+    glActiveTexture(GL_TEXTURE0);
+}
@@ -0,0 +1,321 @@
+#include "FrameCoordinator.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+
+#include <poll.h>
+#include <unistd.h>
+
+#include "FrameEncoder.h"
+
+namespace
+{
+constexpr int POLL_TIMEOUT_MS = 1000;   // how often exited workers are noticed
+}
+
+FrameCoordinator::~FrameCoordinator()
+{
+    finish();
+}
+
+std::string FrameCoordinator::manifestPath(const std::string &pattern)
+{
+    const std::filesystem::path path(pattern);
+    std::string stem = path.stem().string();
+    stem.erase(std::remove(stem.begin(), stem.end(), '#'), stem.end());
+    return (path.parent_path() / (stem + "manifest.txt")).string();
+}
+
+bool FrameCoordinator::open(const std::string &sequencePattern, std::uint64_t frameCount, const std::string &job,
+                            std::string &error)
+{
+    pattern = sequencePattern;
+    done.assign(frameCount, false);
+    attempts.assign(frameCount, 0);
+    resumedFrames = 0;
+
+    // A frame counts as done if it is listed and its file is still there; a line cut
+    // short by a crash doesn't parse and is skipped.
+    const std::string path = manifestPath(pattern);
+    std::ifstream existing(path);
+    std::string line;
+    const bool resuming = std::getline(existing, line) && !line.empty();
+    if (resuming)
+    {
+        if (line != job)
+        {
+            error = path + " was written for a different animation; delete it to start over.";
+            return false;
+        }
+        while (std::getline(existing, line))
+        {
+            char *end = nullptr;
+            const unsigned long long frame = std::strtoull(line.c_str(), &end, 10);
+            std::error_code exists;
+            if (!line.empty() && *end == '\0' && frame < frameCount && !done[frame] &&
+                std::filesystem::exists(FrameEncoder::framePath(pattern, frame), exists))
+            {
+                done[frame] = true;
+                ++resumedFrames;
+            }
+        }
+    }
+    existing.close();
+
+    manifest.open(path, resuming ? std::ios::app : std::ios::trunc);
+    if (!resuming)
+    {
+        manifest << job << '\n' << std::flush;
+    }
+    if (!manifest)
+    {
+        error = "Failed to write " + path;
+        return false;
+    }
+    remainingFrames = frameCount - resumedFrames;
+    return true;
+}
+
+bool FrameCoordinator::run(unsigned int workerCount, const std::vector<std::string> &arguments, std::string &error)
+{
+    if (remainingFrames == 0)
+    {
+        return true;
+    }
+
+    // Ranges small enough that every worker gets several, so the last ones even out
+    // the load, but not so small that workers mostly wait for the next one.
+    const std::uint64_t rangeSize = std::clamp<std::uint64_t>(
+        (remainingFrames + workerCount * RANGES_PER_WORKER - 1) / (workerCount * RANGES_PER_WORKER), 1, MAX_RANGE);
+    queue.clear();
+    for (std::uint64_t frame = 0; frame < done.size(); ++frame)
+    {
+        if (done[frame])
+        {
+            continue;
+        }
+        if (queue.empty() || queue.back().second != frame || queue.back().second - queue.back().first == rangeSize)
+        {
+            queue.emplace_back(frame, frame);
+        }
+        ++queue.back().second;
+    }
+
+    const std::filesystem::path socketPath =
+        std::filesystem::temp_directory_path() / ("blackholesim-" + std::to_string(::getpid()) + "-frames.sock");
+    const std::string address = "unix:" + socketPath.string();
+    listener = Socket::listen(address, error);
+    if (!listener.isValid())
+    {
+        return false;
+    }
+    unixSocketPath = socketPath.string();
+
+    std::vector<std::string> workerArguments = arguments;
+    workerArguments.push_back("--frame-worker");
+    workerArguments.push_back(address);
+    workerCount = static_cast<unsigned int>(std::min<std::size_t>(workerCount, queue.size()));
+    if (!processes.spawn(workerCount, workerArguments, error))
+    {
+        return false;
+    }
+    unsigned int replacements = workerCount * static_cast<unsigned int>(MAX_FRAME_ATTEMPTS);
+
+    std::vector<pollfd> fds;
+    while (remainingFrames > 0)
+    {
+        // Hand out ranges, then drop lost workers and queue their frames again, first.
+        for (Worker &worker : workers)
+        {
+            if (worker.waiting && !worker.lost && !queue.empty())
+            {
+                const Range range = queue.front();
+                if (!FrameProtocol::send(worker.socket, FrameProtocol::MessageType::Range,
+                                         FrameProtocol::encodeRange(range.first, range.second)))
+                {
+                    worker.lost = true;
+                    continue;
+                }
+                queue.pop_front();
+                worker.waiting = false;
+                for (std::uint64_t frame = range.first; frame < range.second; ++frame)
+                {
+                    ++attempts[frame];
+                    worker.assigned.push_back(frame);
+                }
+            }
+        }
+        for (Worker &worker : workers)
+        {
+            if (!worker.lost)
+            {
+                continue;
+            }
+            if (!worker.assigned.empty())
+            {
+                std::cerr << "Frame worker disconnected; " << worker.assigned.size() << " frames queued again."
+                          << std::endl;
+            }
+            if (!requeue(worker.assigned, error))
+            {
+                return false;
+            }
+        }
+        const std::size_t before = workers.size();
+        workers.erase(std::remove_if(workers.begin(), workers.end(), [](const Worker &worker) { return worker.lost; }),
+                      workers.end());
+        if (workers.size() != before)
+        {
+            continue;   // hand the requeued frames out before waiting
+        }
+
+        processes.reap(false);
+        if (!queue.empty() && processes.getRunningCount() < workerCount && replacements > 0)
+        {
+            --replacements;
+            if (!processes.spawn(1, workerArguments, error))
+            {
+                return false;
+            }
+        }
+        if (workers.empty() && processes.getRunningCount() == 0)
+        {
+            error = "Every frame worker exited before the animation was done.";
+            return false;
+        }
+
+        fds.assign(1, pollfd{listener.getFd(), POLLIN, 0});
+        for (const Worker &worker : workers)
+        {
+            fds.push_back(pollfd{worker.socket.getFd(), POLLIN, 0});
+        }
+        const int ready = ::poll(fds.data(), fds.size(), POLL_TIMEOUT_MS);
+        if (ready <= 0)
+        {
+            continue;   // timeout or a signal
+        }
+
+        // Workers accepted below have no entry in fds yet.
+        const std::size_t polled = workers.size();
+        if ((fds[0].revents & POLLIN) != 0)
+        {
+            Socket socket = listener.accept();
+            if (socket.isValid() && socket.setNonBlocking())
+            {
+                Worker worker;
+                worker.socket = std::move(socket);
+                workers.push_back(std::move(worker));
+            }
+        }
+        for (std::size_t i = 0; i < polled; ++i)
+        {
+            if (fds[i + 1].revents != 0 && !receive(workers[i], error))
+            {
+                if (!error.empty())
+                {
+                    return false;
+                }
+                workers[i].lost = true;
+            }
+        }
+    }
+    return true;
+}
+
+bool FrameCoordinator::receive(Worker &worker, std::string &error)
+{
+    if (!worker.reader.read(worker.socket))
+    {
+        return false;
+    }
+
+    std::uint32_t type = 0;
+    std::vector<std::uint8_t> payload;
+    while (worker.reader.next(type, payload))
+    {
+        if (!handleMessage(worker, static_cast<FrameProtocol::MessageType>(type), payload, error))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool FrameCoordinator::handleMessage(Worker &worker, FrameProtocol::MessageType type,
+                                     const std::vector<std::uint8_t> &payload, std::string &error)
+{
+    if (type == FrameProtocol::MessageType::NextRange)
+    {
+        // Frames of the last range that weren't reported couldn't be written.
+        if (!worker.assigned.empty())
+        {
+            std::cerr << "Frame worker failed " << worker.assigned.size() << " frames; queued again." << std::endl;
+            if (!requeue(worker.assigned, error))
+            {
+                return false;
+            }
+            worker.assigned.clear();
+        }
+        worker.waiting = true;
+        return true;
+    }
+
+    std::uint64_t frame = 0;
+    if (type != FrameProtocol::MessageType::FrameDone || !FrameProtocol::decodeFrame(payload, frame))
+    {
+        return false;
+    }
+    const auto assigned = std::find(worker.assigned.begin(), worker.assigned.end(), frame);
+    if (assigned == worker.assigned.end())
+    {
+        return false;
+    }
+    worker.assigned.erase(assigned);
+    done[frame] = true;
+    --remainingFrames;
+    ++renderedFrames;
+    manifest << frame << '\n' << std::flush;
+    return true;
+}
+
+bool FrameCoordinator::requeue(const std::vector<std::uint64_t> &frames, std::string &error)
+{
+    std::vector<std::uint64_t> sorted = frames;
+    std::sort(sorted.begin(), sorted.end());
+    std::vector<Range> ranges;
+    for (const std::uint64_t frame : sorted)
+    {
+        if (attempts[frame] >= MAX_FRAME_ATTEMPTS)
+        {
+            error = "Frame " + std::to_string(frame) + " failed on " + std::to_string(MAX_FRAME_ATTEMPTS) +
+                    " workers.";
+            return false;
+        }
+        if (ranges.empty() || ranges.back().second != frame)
+        {
+            ranges.emplace_back(frame, frame);
+        }
+        ++ranges.back().second;
+        ++retriedFrames;
+    }
+    queue.insert(queue.begin(), ranges.begin(), ranges.end());
+    return true;
+}
+
+void FrameCoordinator::finish()
+{
+    for (Worker &worker : workers)
+    {
+        FrameProtocol::send(worker.socket, FrameProtocol::MessageType::Finish, {});
+    }
+    workers.clear();
+    listener.close();
+    processes.reap(true);
+    if (!unixSocketPath.empty())
+    {
+        ::unlink(unixSocketPath.c_str());
+        unixSocketPath.clear();
+    }
+}
@@ -0,0 +1,401 @@
+#include "FrameEncoder.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+#include "ImageWriter.h"
+
+namespace
+{
+constexpr std::size_t LDR_BYTES_PER_PIXEL = 4;
+
+// BT.601 limited range, 8-bit fixed point.
+std::uint8_t lumaOf(int r, int g, int b)
+{
+    return static_cast<std::uint8_t>(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+}
+
+std::uint8_t blueDifferenceOf(int r, int g, int b)
+{
+    return static_cast<std::uint8_t>(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+}
+
+std::uint8_t redDifferenceOf(int r, int g, int b)
+{
+    return static_cast<std::uint8_t>(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+}
+
+void appendText(std::vector<std::uint8_t> &bytes, const std::string &text)
+{
+    bytes.insert(bytes.end(), text.begin(), text.end());
+}
+
+// Rows top to bottom, RGB.
+void appendRgb(std::vector<std::uint8_t> &bytes, const std::uint8_t *pixels, int width, int height)
+{
+    for (int y = height - 1; y >= 0; --y)
+    {
+        const std::uint8_t *row =
+            pixels + static_cast<std::size_t>(y) * static_cast<std::size_t>(width) * LDR_BYTES_PER_PIXEL;
+        for (int x = 0; x < width; ++x)
+        {
+            bytes.insert(bytes.end(), row + static_cast<std::size_t>(x) * LDR_BYTES_PER_PIXEL,
+                         row + static_cast<std::size_t>(x) * LDR_BYTES_PER_PIXEL + 3);
+        }
+    }
+}
+}
+
+FrameEncoder::FrameEncoder(Output output, const std::string &path, int width, int height, unsigned int fps,
+                           unsigned int workerCount)
+    : output(output), path(path), width(width), height(height), fps(fps), stream(nullptr), stopping(false),
+      nextStreamFrame(0), failed(false)
+{
+    workerCount = std::max(workerCount, 1u);
+    workers.reserve(workerCount);
+    for (unsigned int i = 0; i < workerCount; ++i)
+    {
+        workers.emplace_back(&FrameEncoder::workerLoop, this);
+    }
+}
+
+FrameEncoder::~FrameEncoder()
+{
+    finish();
+}
+
+bool FrameEncoder::parseStreamFormat(const char *name, Output &output)
+{
+    if (std::string(name) == "y4m")
+    {
+        output = Output::Y4m;
+        return true;
+    }
+    if (std::string(name) == "rgb")
+    {
+        output = Output::RawRgb;
+        return true;
+    }
+    return false;
+}
+
+bool FrameEncoder::outputFor(const std::string &path, Output streamFormat, Output &output)
+{
+    if (path == "-")
+    {
+        output = streamFormat;
+        return true;
+    }
+
+    const std::string extension = std::filesystem::path(path).extension().string();
+    if (extension == ".ppm")
+    {
+        output = Output::Ppm;
+    }
+    else if (extension == ".pfm")
+    {
+        output = Output::Pfm;
+    }
+    else if (extension == ".exr")
+    {
+        output = Output::Exr;
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
+
+std::size_t FrameEncoder::bytesPerPixel(Output output)
+{
+    switch (output)
+    {
+    case Output::Pfm:
+        return 3 * sizeof(float);
+    case Output::Exr:
+        return 3 * sizeof(std::uint16_t);
+    default:
+        return LDR_BYTES_PER_PIXEL;
+    }
+}
+
+bool FrameEncoder::open()
+{
+    if (output == Output::Y4m || output == Output::RawRgb)
+    {
+        stream = stdout;
+        if (output == Output::Y4m)
+        {
+            std::fprintf(stream, "YUV4MPEG2 W%d H%d F%u:1 Ip A1:1 C444\n", width, height, fps);
+        }
+        return true;
+    }
+
+    const std::filesystem::path pattern(path);
+    if (path.find('#') == std::string::npos)
+    {
+        std::cerr << "Image sequence paths need '#' for the frame number, e.g. frames/####.exr: " << path
+                  << std::endl;
+        return false;
+    }
+
+    std::error_code error;
+    if (pattern.has_parent_path() && !std::filesystem::is_directory(pattern.parent_path(), error))
+    {
+        std::cerr << "Output directory does not exist: " << pattern.parent_path().string() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void FrameEncoder::submit(std::uint64_t frame, const std::uint8_t *pixels)
+{
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        PendingFrame &pending = pendingFrames[frame];
+        if (output == Output::Exr && pixels != nullptr)
+        {
+            const int blocks = ImageWriter::exrBlockCount(height);
+            pending.remainingTasks = static_cast<unsigned int>(blocks);
+            pending.chunks.resize(static_cast<std::size_t>(blocks));
+            for (int block = 0; block < blocks; ++block)
+            {
+                tasks.push_back(Task{frame, pixels, block});
+            }
+        }
+        else
+        {
+            pending.remainingTasks = 1;
+            tasks.push_back(Task{frame, pixels, -1});
+        }
+    }
+    queueChanged.notify_all();
+}
+
+void FrameEncoder::wait(std::uint64_t frame)
+{
+    std::unique_lock<std::mutex> lock(queueMutex);
+    queueChanged.wait(lock, [&] { return pendingFrames.find(frame) == pendingFrames.end(); });
+}
+
+bool FrameEncoder::finish()
+{
+    if (workers.empty())
+    {
+        return !failed;
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(queueMutex);
+        queueChanged.wait(lock, [&] { return pendingFrames.empty(); });
+        stopping = true;
+    }
+    queueChanged.notify_all();
+    for (std::thread &worker : workers)
+    {
+        worker.join();
+    }
+    workers.clear();
+
+    if (stream != nullptr && std::fflush(stream) != 0)
+    {
+        std::cerr << "Failed while writing the frame stream." << std::endl;
+        failed = true;
+    }
+    return !failed;
+}
+
+std::string FrameEncoder::framePath(const std::string &pattern, std::uint64_t frame)
+{
+    const std::size_t first = pattern.find('#');
+    if (first == std::string::npos)
+    {
+        return pattern;
+    }
+
+    const std::size_t last = pattern.find_first_not_of('#', first);
+    const std::size_t digits = (last == std::string::npos ? pattern.size() : last) - first;
+    std::string number = std::to_string(frame);
+    if (number.size() < digits)
+    {
+        number.insert(0, digits - number.size(), '0');
+    }
+    return pattern.substr(0, first) + number + pattern.substr(first + digits);
+}
+
+void FrameEncoder::workerLoop()
+{
+    std::vector<std::uint8_t> encoded;
+    for (;;)
+    {
+        Task task;
+        PendingFrame *pending = nullptr;
+        {
+            std::unique_lock<std::mutex> lock(queueMutex);
+            queueChanged.wait(lock, [&] { return stopping || !tasks.empty(); });
+            if (tasks.empty())
+            {
+                return;
+            }
+            task = tasks.front();
+            tasks.pop_front();
+            pending = &pendingFrames[task.frame];
+        }
+
+        if (task.block >= 0)
+        {
+            // Blocks write to their own chunk; the last one done writes the file.
+            encodeExrBlock(task, *pending);
+            {
+                std::lock_guard<std::mutex> lock(queueMutex);
+                if (--pending->remainingTasks != 0)
+                {
+                    continue;
+                }
+            }
+            if (ImageWriter::writeExrChunks(framePath(path, task.frame), ImageWriter::exrHeader(width, height),
+                                            pending->chunks))
+            {
+                reportWritten(task.frame);
+            }
+            else
+            {
+                failed = true;
+            }
+        }
+        else if (encodeFrame(task, encoded))
+        {
+            reportWritten(task.frame);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            pendingFrames.erase(task.frame);
+        }
+        queueChanged.notify_all();
+    }
+}
+
+bool FrameEncoder::encodeFrame(const Task &task, std::vector<std::uint8_t> &encoded)
+{
+    const std::size_t pixelCount = static_cast<std::size_t>(width) * static_cast<std::size_t>(height);
+    encoded.clear();
+
+    if (task.pixels == nullptr)
+    {
+        // Streams still move past it, so the frames behind it aren't held back.
+        std::cerr << "Frame " << task.frame << " could not be read back." << std::endl;
+        failed = true;
+        if (stream != nullptr)
+        {
+            write(task.frame, encoded);
+        }
+        return false;
+    }
+
+    switch (output)
+    {
+    case Output::Ppm:
+        encoded.reserve(pixelCount * 3 + 32);
+        appendText(encoded, "P6\n" + std::to_string(width) + " " + std::to_string(height) + "\n255\n");
+        appendRgb(encoded, task.pixels, width, height);
+        break;
+    case Output::Pfm:
+        // Already in the file's sample format; written straight from the mapped buffer.
+        if (!ImageWriter::writePfm(framePath(path, task.frame), reinterpret_cast<const float *>(task.pixels), width,
+                                   height))
+        {
+            failed = true;
+            return false;
+        }
+        return true;
+    case Output::Exr:
+        return false;   // split into blocks by submit()
+    case Output::RawRgb:
+        encoded.reserve(pixelCount * 3);
+        appendRgb(encoded, task.pixels, width, height);
+        break;
+    case Output::Y4m:
+    {
+        appendText(encoded, "FRAME\n");
+        const std::size_t header = encoded.size();
+        encoded.resize(header + pixelCount * 3);
+        std::uint8_t *luma = encoded.data() + header;
+        std::uint8_t *blueDifference = luma + pixelCount;
+        std::uint8_t *redDifference = blueDifference + pixelCount;
+        std::size_t out = 0;
+        for (int y = height - 1; y >= 0; --y)
+        {
+            const std::uint8_t *row =
+                task.pixels + static_cast<std::size_t>(y) * static_cast<std::size_t>(width) * LDR_BYTES_PER_PIXEL;
+            for (int x = 0; x < width; ++x, ++out)
+            {
+                const int r = row[static_cast<std::size_t>(x) * LDR_BYTES_PER_PIXEL + 0];
+                const int g = row[static_cast<std::size_t>(x) * LDR_BYTES_PER_PIXEL + 1];
+                const int b = row[static_cast<std::size_t>(x) * LDR_BYTES_PER_PIXEL + 2];
+                luma[out] = lumaOf(r, g, b);
+                blueDifference[out] = blueDifferenceOf(r, g, b);
+                redDifference[out] = redDifferenceOf(r, g, b);
+            }
+        }
+        break;
+    }
+    }
+
+    return write(task.frame, encoded);
+}
+
+void FrameEncoder::encodeExrBlock(const Task &task, PendingFrame &pending) const
+{
+    const int linesPerBlock = ImageWriter::exrLinesPerBlock();
+    const int firstLine = task.block * linesPerBlock;
+    const std::size_t rowStride = static_cast<std::size_t>(width) * 3;
+    const std::uint16_t *rows =
+        reinterpret_cast<const std::uint16_t *>(task.pixels) + static_cast<std::size_t>(firstLine) * rowStride;
+    ImageWriter::encodeExrBlock(rows, rowStride, width, firstLine, std::min(linesPerBlock, height - firstLine),
+                                pending.chunks[static_cast<std::size_t>(task.block)]);
+}
+
+bool FrameEncoder::write(std::uint64_t frame, std::vector<std::uint8_t> &encoded)
+{
+    if (stream == nullptr)
+    {
+        const std::string framePathName = framePath(path, frame);
+        std::ofstream file(framePathName, std::ios::binary);
+        file.write(reinterpret_cast<const char *>(encoded.data()), static_cast<std::streamsize>(encoded.size()));
+        file.close();
+        if (!file)
+        {
+            std::cerr << "Failed to write " << framePathName << std::endl;
+            failed = true;
+            return false;
+        }
+        return true;
+    }
+
+    std::lock_guard<std::mutex> lock(streamMutex);
+    finishedFrames[frame] = std::move(encoded);
+    for (auto next = finishedFrames.find(nextStreamFrame); next != finishedFrames.end();
+         next = finishedFrames.find(nextStreamFrame))
+    {
+        if (!failed && std::fwrite(next->second.data(), 1, next->second.size(), stream) != next->second.size())
+        {
+            std::cerr << "Failed while writing the frame stream." << std::endl;
+            failed = true;
+        }
+        finishedFrames.erase(next);
+        ++nextStreamFrame;
+    }
+    return false;   // stream frames aren't files of their own
+}
+
+void FrameEncoder::reportWritten(std::uint64_t frame)
+{
+    if (frameWritten)
+    {
+        frameWritten(frame);
+    }
+}
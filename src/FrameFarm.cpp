@@ -0,0 +1,89 @@
+#include "FrameFarm.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+
+#include "FrameCoordinator.h"
+#include "OfflineRenderer.h"
+#include "RenderSetup.h"
+#include "StarfieldCubemap.h"
+
+std::vector<std::string> FrameFarm::workerArguments(int argc, char **argv)
+{
+    std::vector<std::string> arguments;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::string(argv[i]) == "--animation-workers")
+        {
+            ++i;
+            continue;
+        }
+        arguments.push_back(argv[i]);
+    }
+    return arguments;
+}
+
+int FrameFarm::renderAnimation(const CommandLine::Options &options, const std::vector<std::string> &arguments,
+                               const CameraPath *path)
+{
+    const unsigned int frames = OfflineRenderer::framesFor(options.animationFrames, path, options.fps);
+    std::string job = "frames " + std::to_string(frames) + ":";
+    for (const std::string &argument : arguments)
+    {
+        job += " " + argument;
+    }
+
+    FrameCoordinator coordinator;
+    std::string error;
+    if (!coordinator.open(options.animationPath, frames, job, error))
+    {
+        std::cerr << error << std::endl;
+        return 1;
+    }
+    if (coordinator.getResumedFrames() == frames)
+    {
+        std::cout << "All " << frames << " frames are already rendered (" << FrameCoordinator::manifestPath(
+                         options.animationPath) << ")." << std::endl;
+        return 0;
+    }
+    if (coordinator.getResumedFrames() > 0)
+    {
+        std::cout << "Resuming: " << coordinator.getResumedFrames() << " of " << frames
+                  << " frames are already rendered." << std::endl;
+    }
+
+    // Baked once here, so the workers load the cache instead of all baking it.
+    {
+        StarfieldCubemap starfield;
+        RenderSetup::prepareStarfield(starfield, options);
+    }
+
+    std::vector<std::string> workerArguments = arguments;
+    if (options.useCpuRenderer && options.cpuThreads == 0)
+    {
+        const unsigned int threads =
+            std::max(1u, std::thread::hardware_concurrency() / std::max(1u, options.animationWorkers));
+        workerArguments.insert(workerArguments.end(), {"--threads", std::to_string(threads)});
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    if (!coordinator.run(options.animationWorkers, workerArguments, error))
+    {
+        std::cerr << error << std::endl;
+        return 1;
+    }
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    coordinator.finish();
+
+    std::cout << "Rendered " << coordinator.getRenderedFrames() << " frames on " << options.animationWorkers
+              << " workers in " << std::fixed << std::setprecision(2) << seconds << std::defaultfloat << " s";
+    if (coordinator.getRetriedFrames() > 0)
+    {
+        std::cout << " (" << coordinator.getRetriedFrames() << " frames retried)";
+    }
+    std::cout << "." << std::endl;
+    return 0;
+}
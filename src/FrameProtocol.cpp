@@ -0,0 +1,57 @@
+#include "FrameProtocol.h"
+
+#include <cstring>
+
+#include "Socket.h"
+
+bool FrameProtocol::send(Socket &socket, MessageType type, const std::vector<std::uint8_t> &payload)
+{
+    return socket.sendMessage(static_cast<std::uint32_t>(type), payload);
+}
+
+bool FrameProtocol::receive(Socket &socket, MessageType &type, std::vector<std::uint8_t> &payload)
+{
+    std::uint32_t rawType = 0;
+    if (!socket.receiveMessage(rawType, payload))
+    {
+        return false;
+    }
+    type = static_cast<MessageType>(rawType);
+    return true;
+}
+
+std::vector<std::uint8_t> FrameProtocol::encodeRange(std::uint64_t first, std::uint64_t end)
+{
+    std::vector<std::uint8_t> bytes(2 * sizeof(std::uint64_t));
+    std::memcpy(bytes.data(), &first, sizeof(first));
+    std::memcpy(bytes.data() + sizeof(first), &end, sizeof(end));
+    return bytes;
+}
+
+bool FrameProtocol::decodeRange(const std::vector<std::uint8_t> &payload, std::uint64_t &first, std::uint64_t &end)
+{
+    if (payload.size() != 2 * sizeof(std::uint64_t))
+    {
+        return false;
+    }
+    std::memcpy(&first, payload.data(), sizeof(first));
+    std::memcpy(&end, payload.data() + sizeof(first), sizeof(end));
+    return first < end;
+}
+
+std::vector<std::uint8_t> FrameProtocol::encodeFrame(std::uint64_t frame)
+{
+    std::vector<std::uint8_t> bytes(sizeof(frame));
+    std::memcpy(bytes.data(), &frame, sizeof(frame));
+    return bytes;
+}
+
+bool FrameProtocol::decodeFrame(const std::vector<std::uint8_t> &payload, std::uint64_t &frame)
+{
+    if (payload.size() != sizeof(frame))
+    {
+        return false;
+    }
+    std::memcpy(&frame, payload.data(), sizeof(frame));
+    return true;
+}
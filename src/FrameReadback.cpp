@@ -0,0 +1,120 @@
+#include "FrameReadback.h"
+
+#include <iostream>
+
+namespace
+{
+constexpr GLuint64 FENCE_TIMEOUT = 1000000000;  // ns between checks while waiting
+}
+
+FrameReadback::FrameReadback(int width, int height, FrameEncoder::Output output, FrameEncoder &encoder)
+    : width(width), height(height), output(output),
+      frameSize(static_cast<GLsizeiptr>(width) * height * static_cast<GLsizeiptr>(FrameEncoder::bytesPerPixel(output))),
+      encoder(encoder), buffers{}, fences{}, slotFrames{}, mapped{}, frame(0), submittedFrames(0)
+{
+    glGenBuffers(RING_SIZE, buffers);
+    for (unsigned int slot = 0; slot < RING_SIZE; ++slot)
+    {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, buffers[slot]);
+        glBufferData(GL_PIXEL_PACK_BUFFER, frameSize, nullptr, GL_STREAM_READ);
+        fences[slot] = nullptr;
+        slotFrames[slot] = -1;
+        mapped[slot] = false;
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+FrameReadback::~FrameReadback()
+{
+    flush();
+    for (unsigned int slot = 0; slot < RING_SIZE; ++slot)
+    {
+        if (fences[slot] != nullptr)
+        {
+            glDeleteSync(fences[slot]);
+        }
+    }
+    glDeleteBuffers(RING_SIZE, buffers);
+}
+
+void FrameReadback::capture(GLuint texture, std::uint64_t frameNumber)
+{
+    const unsigned int slot = static_cast<unsigned int>(frame % RING_SIZE);
+    release(slot);
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, buffers[slot]);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    if (FrameEncoder::isHdr(output))
+    {
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glGetTexImage(GL_TEXTURE_2D, 0, GL_RGB, output == FrameEncoder::Output::Exr ? GL_HALF_FLOAT : GL_FLOAT,
+                      nullptr);
+    }
+    else
+    {
+        glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    fences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    slotFrames[slot] = static_cast<std::int64_t>(frameNumber);
+    ++frame;
+
+    // Counted from the last submitted frame, so captures after a flush() start the delay over.
+    if (frame - submittedFrames > MAP_DELAY)
+    {
+        submit(static_cast<unsigned int>(submittedFrames % RING_SIZE));
+    }
+}
+
+void FrameReadback::flush()
+{
+    while (submittedFrames < frame)
+    {
+        submit(static_cast<unsigned int>(submittedFrames % RING_SIZE));
+    }
+    for (unsigned int slot = 0; slot < RING_SIZE; ++slot)
+    {
+        release(slot);
+    }
+}
+
+void FrameReadback::submit(unsigned int slot)
+{
+    GLenum status = glClientWaitSync(fences[slot], GL_SYNC_FLUSH_COMMANDS_BIT, FENCE_TIMEOUT);
+    while (status == GL_TIMEOUT_EXPIRED)
+    {
+        status = glClientWaitSync(fences[slot], 0, FENCE_TIMEOUT);
+    }
+    glDeleteSync(fences[slot]);
+    fences[slot] = nullptr;
+
+    const void *pixels = nullptr;
+    if (status != GL_WAIT_FAILED)
+    {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, buffers[slot]);
+        pixels = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, frameSize, GL_MAP_READ_BIT);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    }
+    mapped[slot] = pixels != nullptr;
+    encoder.submit(static_cast<std::uint64_t>(slotFrames[slot]), static_cast<const std::uint8_t *>(pixels));
+    ++submittedFrames;
+}
+
+void FrameReadback::release(unsigned int slot)
+{
+    if (slotFrames[slot] < 0)
+    {
+        return;
+    }
+
+    encoder.wait(static_cast<std::uint64_t>(slotFrames[slot]));
+    if (mapped[slot])
+    {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, buffers[slot]);
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        mapped[slot] = false;
+    }
+    slotFrames[slot] = -1;
+}
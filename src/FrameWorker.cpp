@@ -0,0 +1,49 @@
+#include "FrameWorker.h"
+
+#include <iostream>
+
+#include "FrameProtocol.h"
+
+bool FrameWorker::connect(const std::string &address, std::string &error)
+{
+    socket = Socket::connect(address, error);
+    return socket.isValid();
+}
+
+bool FrameWorker::nextRange(std::uint64_t &first, std::uint64_t &end)
+{
+    {
+        std::lock_guard<std::mutex> lock(sendMutex);
+        if (lost || !FrameProtocol::send(socket, FrameProtocol::MessageType::NextRange, {}))
+        {
+            lost = true;
+            return false;
+        }
+    }
+
+    FrameProtocol::MessageType type;
+    std::vector<std::uint8_t> payload;
+    if (FrameProtocol::receive(socket, type, payload))
+    {
+        if (type == FrameProtocol::MessageType::Finish)
+        {
+            return false;
+        }
+        if (type == FrameProtocol::MessageType::Range && FrameProtocol::decodeRange(payload, first, end))
+        {
+            return true;
+        }
+    }
+    std::cerr << "Lost the connection to the frame coordinator." << std::endl;
+    lost = true;
+    return false;
+}
+
+void FrameWorker::frameWritten(std::uint64_t frame)
+{
+    std::lock_guard<std::mutex> lock(sendMutex);
+    if (!lost && !FrameProtocol::send(socket, FrameProtocol::MessageType::FrameDone, FrameProtocol::encodeFrame(frame)))
+    {
+        lost = true;
+    }
+}
@@ -0,0 +1,956 @@
+#include "Geodesic.h"
+
+#include <cmath>
+#include <limits>
+
+#include "Blackbody.h"
+#include "DiskEmissionMap.h"
+
+namespace
+{
+const glm::vec3 BACKGROUND_COLOR(0.003f, 0.004f, 0.008f);
+
+glm::vec3 yzx(glm::vec3 v)
+{
+    return glm::vec3(v.y, v.z, v.x);
+}
+
+float hash13(glm::vec3 p)
+{
+    p = glm::fract(p * 0.1031f);
+    p += glm::dot(p, yzx(p) + 33.33f);
+    return glm::fract((p.x + p.y) * p.z);
+}
+
+float hash12(glm::vec2 p)
+{
+    glm::vec3 p3 = glm::fract(glm::vec3(p.x, p.y, p.x) * 0.1031f);
+    p3 += glm::dot(p3, yzx(p3) + 33.33f);
+    return glm::fract((p3.x + p3.y) * p3.z);
+}
+
+float noise2(glm::vec2 p)
+{
+    const glm::vec2 i = glm::floor(p);
+    const glm::vec2 f = glm::fract(p);
+    const glm::vec2 u = f * f * (3.0f - 2.0f * f);
+
+    const float a = hash12(i);
+    const float b = hash12(i + glm::vec2(1.0f, 0.0f));
+    const float c = hash12(i + glm::vec2(0.0f, 1.0f));
+    const float d = hash12(i + glm::vec2(1.0f, 1.0f));
+
+    return glm::mix(glm::mix(a, b, u.x), glm::mix(c, d, u.x), u.y);
+}
+
+// 8 point Gauss-Legendre rule on [-1, 1], symmetric halves
+const float GAUSS_NODES[4] = {0.1834346424956498f, 0.5255324099163290f, 0.7966664774136267f, 0.9602898564975363f};
+const float GAUSS_WEIGHTS[4] = {0.3626837833783620f, 0.3137066458778873f, 0.2223810344533745f, 0.1012285362903763f};
+
+// Integral of du / sqrt(1/b^2 - u^2 (1 - Rs u)) over [u0, u1], no turning point inside.
+float orbitAngle(float u0, float u1, float inverseImpactSq, float Rs)
+{
+    const float halfSpan = 0.5f * (u1 - u0);
+    float angle = 0.0f;
+    for (int i = 0; i < 8; ++i)
+    {
+        const float node = i < 4 ? -GAUSS_NODES[i] : GAUSS_NODES[i - 4];
+        const float u = u0 + halfSpan * (1.0f + node);
+        const float radicand = glm::max(inverseImpactSq - u * u * (1.0f - Rs * u), Geodesic::EPSILON);
+        angle += GAUSS_WEIGHTS[i % 4] * halfSpan / std::sqrt(radicand);
+    }
+    return angle;
+}
+
+// y = [u, up] where u = 1/r, up = du/dphi; u'' = -u + 3*M*u^2
+glm::vec2 f(glm::vec2 y, float M)
+{
+    return glm::vec2(y.y, -y.x + 3.0f * M * y.x * y.x);
+}
+
+// b u - sin(psi) of the weak-field orbit (see Geodesic.h) and its derivative, for
+// epsilon = M / b.
+glm::vec2 weakFieldCorrection(float psi, float epsilon)
+{
+    const float s = std::sin(psi);
+    const float c = std::cos(psi);
+    const float lever = 0.5f * Geodesic::PI - psi;
+    const float value = epsilon * (1.0f + c * c) +
+                        epsilon * epsilon * ((37.0f / 16.0f) * s + 3.75f * lever * c - (3.0f / 16.0f) * std::sin(3.0f * psi));
+    const float slope = -2.0f * epsilon * c * s +
+                        epsilon * epsilon * (-(23.0f / 16.0f) * c - 3.75f * lever * s - (9.0f / 16.0f) * std::cos(3.0f * psi));
+    return glm::vec2(value, slope);
+}
+}
+
+void Geodesic::generatePrimaryRay(glm::vec2 ndc, const glm::mat4 &invProj, const glm::mat4 &invView,
+                                  glm::vec3 &direction)
+{
+    const glm::vec4 clip(ndc.x, ndc.y, -1.0f, 1.0f);
+    glm::vec4 view = invProj * clip;
+    view = glm::vec4(view.x, view.y, -1.0f, 0.0f);
+    const glm::vec4 world = invView * view;
+    direction = glm::normalize(glm::vec3(world));
+}
+
+void Geodesic::buildPlaneBasis(glm::vec3 camPos, glm::vec3 rayDir, glm::vec3 bhCenter,
+                               glm::vec3 &e1, glm::vec3 &e2)
+{
+    const glm::vec3 toBh = bhCenter - camPos;
+    e1 = glm::normalize(rayDir);
+
+    glm::vec3 tmp = toBh - e1 * glm::dot(toBh, e1);
+    if (glm::length(tmp) < 1e-8f)
+    {
+        // Degenerate case: choose stable perpendicular
+        tmp = std::abs(e1.y) < 0.9f ? glm::vec3(0.0f, 1.0f, 0.0f) : glm::vec3(1.0f, 0.0f, 0.0f);
+        tmp = tmp - e1 * glm::dot(tmp, e1);
+    }
+    e2 = glm::normalize(tmp);
+}
+
+void Geodesic::radialAngularVel(glm::vec3 rayDir, glm::vec3 e1, glm::vec3 e2, float r, float phi,
+                                float &vr, float &vphi)
+{
+    const glm::vec3 er = std::cos(phi) * e1 + std::sin(phi) * e2;
+    const glm::vec3 ephi = -std::sin(phi) * e1 + std::cos(phi) * e2;
+
+    vr = glm::dot(rayDir, er);
+    vphi = glm::dot(rayDir, ephi) / glm::max(r, EPSILON);
+}
+
+glm::vec2 Geodesic::rk4Step(glm::vec2 y, float h, float M)
+{
+    const glm::vec2 k1 = f(y, M);
+    const glm::vec2 k2 = f(y + 0.5f * h * k1, M);
+    const glm::vec2 k3 = f(y + 0.5f * h * k2, M);
+    const glm::vec2 k4 = f(y + h * k3, M);
+
+    return y + (h / 6.0f) * (k1 + 2.0f * k2 + 2.0f * k3 + k4);
+}
+
+// Dormand-Prince 5(4). Returns the fifth order solution; error receives the
+// difference to the embedded fourth order one.
+glm::vec2 Geodesic::dormandPrinceStep(glm::vec2 y, float h, float M, glm::vec2 &error)
+{
+    const glm::vec2 k1 = f(y, M);
+    const glm::vec2 k2 = f(y + h * (1.0f / 5.0f) * k1, M);
+    const glm::vec2 k3 = f(y + h * ((3.0f / 40.0f) * k1 + (9.0f / 40.0f) * k2), M);
+    const glm::vec2 k4 = f(y + h * ((44.0f / 45.0f) * k1 - (56.0f / 15.0f) * k2 + (32.0f / 9.0f) * k3), M);
+    const glm::vec2 k5 = f(y + h * ((19372.0f / 6561.0f) * k1 - (25360.0f / 2187.0f) * k2 +
+                                    (64448.0f / 6561.0f) * k3 - (212.0f / 729.0f) * k4), M);
+    const glm::vec2 k6 = f(y + h * ((9017.0f / 3168.0f) * k1 - (355.0f / 33.0f) * k2 + (46732.0f / 5247.0f) * k3 +
+                                    (49.0f / 176.0f) * k4 - (5103.0f / 18656.0f) * k5), M);
+    const glm::vec2 next = y + h * ((35.0f / 384.0f) * k1 + (500.0f / 1113.0f) * k3 + (125.0f / 192.0f) * k4 -
+                                    (2187.0f / 6784.0f) * k5 + (11.0f / 84.0f) * k6);
+    const glm::vec2 k7 = f(next, M);
+
+    error = h * ((71.0f / 57600.0f) * k1 - (71.0f / 16695.0f) * k3 + (71.0f / 1920.0f) * k4 -
+                 (17253.0f / 339200.0f) * k5 + (22.0f / 525.0f) * k6 - (1.0f / 40.0f) * k7);
+    return next;
+}
+
+// Step size multiplier for a step whose error was errorNorm times the tolerance.
+float Geodesic::stepScale(float errorNorm)
+{
+    if (errorNorm <= 0.0f)
+    {
+        return 5.0f;
+    }
+    return glm::clamp(0.9f * std::pow(errorNorm, -0.2f), 0.2f, 5.0f);
+}
+
+float Geodesic::nextDiskCrossing(const TracerParameters &params, const PrimaryRay &ray, float phi)
+{
+    const float n1 = glm::dot(ray.e1, params.disk.normal);
+    const float n2 = glm::dot(ray.e2, params.disk.normal);
+    if (n1 * n1 + n2 * n2 <= EPSILON * glm::dot(params.disk.normal, params.disk.normal))
+    {
+        return INFINITY;
+    }
+
+    const float line = std::atan2(n2, n1) + 0.5f * PI;
+    return line + PI * (std::floor((phi - line) / PI) + 1.0f);
+}
+
+bool Geodesic::crossesAnnulus(const DiskParameters &disk, float u)
+{
+    const float r = 1.0f / glm::max(u, EPSILON);
+    return r >= disk.innerRadius && r <= disk.outerRadius;
+}
+
+float Geodesic::inverseImpactParameterSq(float u, float up, float Rs)
+{
+    return up * up + u * u * (1.0f - Rs * u);
+}
+
+Termination Geodesic::classifyRay(const TracerParameters &params, float inverseImpactSq, float u, float up)
+{
+    const float r = 1.0f / glm::max(u, EPSILON);
+
+    // b < 3*sqrt(3)/2 * Rs: no turning point, so an ingoing ray falls straight in.
+    // Inside the inner edge it can no longer reach the disk on the way.
+    const float criticalInverseImpactSq = 4.0f / (27.0f * params.Rs * params.Rs);
+    if (up > 0.0f && inverseImpactSq > criticalInverseImpactSq && r < params.disk.innerRadius)
+    {
+        return Termination::Horizon;
+    }
+
+    // Outgoing outside the photon sphere: r grows monotonically from here on, and
+    // past the outer edge the disk is out of reach.
+    if (up < 0.0f && r > glm::max(params.disk.outerRadius, 1.5f * params.Rs))
+    {
+        return Termination::Escape;
+    }
+
+    return Termination::StepLimit;
+}
+
+// Angle still to go until u falls to 1 / r_escape on an outgoing ray:
+// the integral of du / sqrt(1/b^2 - u^2 (1 - Rs u)). Substituting
+// u = u_escape + (u - u_escape)(1 - t^2) removes the square root singularity a ray
+// just past its turning point would have, leaving a smooth integrand for an
+// 8 point Gauss-Legendre rule.
+float Geodesic::escapeAngle(float u, float up, float Rs)
+{
+    const float uEscape = 1.0f / R_ESCAPE;
+    const float span = glm::max(u - uEscape, 0.0f);
+    const float inverseImpactSq = inverseImpactParameterSq(u, up, Rs);
+
+    float angle = 0.0f;
+    for (int i = 0; i < 8; ++i)
+    {
+        const float node = i < 4 ? -GAUSS_NODES[i] : GAUSS_NODES[i - 4];
+        const float t = 0.5f * (1.0f + node);
+        const float ut = uEscape + span * (1.0f - t * t);
+        const float radicand = glm::max(inverseImpactSq - ut * ut * (1.0f - Rs * ut), EPSILON);
+        angle += GAUSS_WEIGHTS[i % 4] * span * t / std::sqrt(radicand);
+    }
+    return angle;
+}
+
+float Geodesic::weakFieldImpactParameter(float Rs, float pixelAngle, float budgetPixels)
+{
+    if (!(budgetPixels > 0.0f) || !(pixelAngle > 0.0f))
+    {
+        return std::numeric_limits<float>::max();
+    }
+
+    // 16/3 (Rs/b)^3 <= budget * pixel angle
+    const float multiple = std::cbrt(16.0f / (3.0f * budgetPixels * pixelAngle));
+    return Rs * glm::max(multiple, WEAK_FIELD_MIN_IMPACT);
+}
+
+bool Geodesic::weakFieldEscape(const TracerParameters &params, const PrimaryRay &ray, float &phi)
+{
+    const float inverseImpactSq = inverseImpactParameterSq(ray.u0, ray.up0, params.Rs);
+    if (inverseImpactSq * params.weakFieldImpact * params.weakFieldImpact >= 1.0f)
+    {
+        return false;
+    }
+
+    const float b = 1.0f / std::sqrt(inverseImpactSq);
+    const float epsilon = 0.5f * params.Rs / b;
+
+    // Orbit phase at the camera, from sin and cos of psi = b (u, u') less the
+    // corrections, and the overshoot past pi where u returns to zero. Each pass
+    // gains a factor epsilon, so three reach the order of the expansion.
+    float psi = std::atan2(b * ray.u0, b * ray.up0);
+    float overshoot = 0.0f;
+    for (int i = 0; i < 3; ++i)
+    {
+        const glm::vec2 correction = weakFieldCorrection(psi, epsilon);
+        psi = std::atan2(b * ray.u0 - correction.x, b * ray.up0 - correction.y);
+        overshoot = std::asin(glm::clamp(weakFieldCorrection(PI + overshoot, epsilon).x, -1.0f, 1.0f));
+    }
+
+    const float end = ray.phi0 + PI + overshoot - psi;
+    for (float crossing = nextDiskCrossing(params, ray, ray.phi0); crossing < end; crossing += PI)
+    {
+        const float angle = psi + (crossing - ray.phi0);
+        const float r = b / glm::max(std::sin(angle) + weakFieldCorrection(angle, epsilon).x, EPSILON);
+        if (r * (1.0f + WEAK_FIELD_DISK_MARGIN) >= params.disk.innerRadius &&
+            r * (1.0f - WEAK_FIELD_DISK_MARGIN) <= params.disk.outerRadius)
+        {
+            return false;
+        }
+    }
+
+    phi = end;
+    return true;
+}
+
+float Geodesic::influenceRadius(const TracerParameters &params)
+{
+    return glm::max(params.disk.outerRadius, 1.5f * params.Rs) * (1.0f + INFLUENCE_MARGIN);
+}
+
+// u grows monotonically on the way in, so the angle outside the sphere is a
+// difference of escapeAngle() integrals: down to the sphere for rays that enter
+// it, or to the turning point and back out for rays that miss it.
+bool Geodesic::enterInfluenceSphere(const TracerParameters &params, PrimaryRay &ray, float &phi)
+{
+    phi = ray.phi0;
+    const float uSphere = 1.0f / influenceRadius(params);
+    if (ray.u0 >= uSphere || ray.up0 <= 0.0f)
+    {
+        return true;
+    }
+
+    const float inverseImpactSq = inverseImpactParameterSq(ray.u0, ray.up0, params.Rs);
+    const float startAngle = escapeAngle(ray.u0, ray.up0, params.Rs);
+    const float upSphereSq = inverseImpactSq - uSphere * uSphere * (1.0f - params.Rs * uSphere);
+    if (upSphereSq > 0.0f)
+    {
+        const float upSphere = std::sqrt(upSphereSq);
+        ray.phi0 += escapeAngle(uSphere, upSphere, params.Rs) - startAngle;
+        ray.u0 = uSphere;
+        ray.up0 = upSphere;
+        phi = ray.phi0;
+        return true;
+    }
+
+    phi = freeEscapeAngle(ray, params.Rs);
+    return false;
+}
+
+// Newton from the flat space 1/b approaches the root from below, where u^2 (1 - Rs u)
+// is still increasing, for any b outside the critical one.
+float Geodesic::turningPoint(float inverseImpactSq, float Rs)
+{
+    float turn = std::sqrt(inverseImpactSq);
+    for (int i = 0; i < 6; ++i)
+    {
+        turn -= (turn * turn * (1.0f - Rs * turn) - inverseImpactSq) / (turn * (2.0f - 3.0f * Rs * turn));
+    }
+    return turn;
+}
+
+float Geodesic::freeEscapeAngle(const PrimaryRay &ray, float Rs)
+{
+    const float startAngle = escapeAngle(ray.u0, ray.up0, Rs);
+    if (ray.up0 <= 0.0f)
+    {
+        return ray.phi0 + startAngle;
+    }
+    const float turn = turningPoint(inverseImpactParameterSq(ray.u0, ray.up0, Rs), Rs);
+    return ray.phi0 + 2.0f * escapeAngle(turn, 0.0f, Rs) - startAngle;
+}
+
+// Split at the photon sphere, where the integrand peaks for b close to critical.
+float Geodesic::captureAngle(float u, float inverseImpactSq, float Rs)
+{
+    const float uHorizon = 1.0f / Rs;
+    const float uPhotonSphere = 2.0f / (3.0f * Rs);
+    if (u >= uPhotonSphere)
+    {
+        return orbitAngle(u, uHorizon, inverseImpactSq, Rs);
+    }
+    return orbitAngle(u, uPhotonSphere, inverseImpactSq, Rs) + orbitAngle(uPhotonSphere, uHorizon, inverseImpactSq, Rs);
+}
+
+namespace
+{
+constexpr int CARLSON_ITERATIONS = 10;
+constexpr int LANDEN_LEVELS = 13;
+constexpr float LANDEN_TOLERANCE = 3e-4f;   // sn and cn come out to its square
+
+// Carlson's symmetric R_F(x, y, z). Each duplication step brings the arguments four
+// times closer together, and a fifth order series around their mean finishes off.
+float carlsonRF(float x, float y, float z)
+{
+    for (int i = 0; i < CARLSON_ITERATIONS; ++i)
+    {
+        const float sx = std::sqrt(x);
+        const float sy = std::sqrt(y);
+        const float sz = std::sqrt(z);
+        const float lambda = sx * (sy + sz) + sy * sz;
+        x = 0.25f * (x + lambda);
+        y = 0.25f * (y + lambda);
+        z = 0.25f * (z + lambda);
+    }
+    const float mean = (x + y + z) / 3.0f;
+    const float dx = 1.0f - x / mean;
+    const float dy = 1.0f - y / mean;
+    const float dz = -dx - dy;
+    const float e2 = dx * dy - dz * dz;
+    const float e3 = dx * dy * dz;
+    return (1.0f - e2 / 10.0f + e3 / 14.0f + e2 * e2 / 24.0f - 3.0f * e2 * e3 / 44.0f) / std::sqrt(mean);
+}
+
+// Incomplete elliptic integral of the first kind at sin^2 = sinSq, cos^2 = cosSq of
+// its amplitude, for the complementary parameter 1 - k^2. Taking the complements
+// as they are keeps the precision near k = 1 that 1 - k^2 would cancel away.
+float ellipticF(float sinSq, float cosSq, float complement)
+{
+    return std::sqrt(sinSq) * carlsonRF(cosSq, cosSq + complement * sinSq, 1.0f);
+}
+
+// Jacobi sn and cn of w for the complementary parameter 1 - k^2, by descending Landen
+// transformations: the arithmetic-geometric mean down to a circular sine, then back up.
+void jacobiSnCn(float w, float complement, float &sn, float &cn)
+{
+    float means[LANDEN_LEVELS];
+    float roots[LANDEN_LEVELS];
+    float a = 1.0f;
+    float c = 1.0f;
+    int levels = 0;
+    while (levels < LANDEN_LEVELS)
+    {
+        means[levels] = a;
+        complement = std::sqrt(complement);
+        roots[levels] = complement;
+        c = 0.5f * (a + complement);
+        ++levels;
+        if (std::abs(a - complement) <= LANDEN_TOLERANCE * a)
+        {
+            break;
+        }
+        complement *= a;
+        a = c;
+    }
+
+    w *= c;
+    sn = std::sin(w);
+    cn = std::cos(w);
+    if (sn == 0.0f)
+    {
+        return;
+    }
+
+    float ratio = cn / sn;
+    c *= ratio;
+    float dn = 1.0f;
+    for (int level = levels - 1; level >= 0; --level)
+    {
+        const float mean = means[level];
+        ratio *= c;
+        c *= dn;
+        dn = (roots[level] + ratio) / (mean + ratio);
+        ratio = c / mean;
+    }
+    ratio = 1.0f / std::sqrt(c * c + 1.0f);
+    sn = sn >= 0.0f ? ratio : -ratio;
+    cn = c * sn;
+}
+
+// x = Rs u along an orbit as a function of the elliptic argument w, which grows by
+// rate per radian of phi. With three real roots x1 < 0 < x2 < x3 of the cubic,
+//   x = x1 + (x2 - x1) sn^2(w),  k^2 = (x2 - x1) / (x3 - x1),  rate = sqrt(x3 - x1) / 2,
+// periodic in w with period 2K; with one, x1 < 0 and a complex pair m +- i n,
+//   x = x1 + A (1 - cn(w)) / (1 + cn(w)),  A = sqrt((m - x1)^2 + n^2),
+//   1 - k^2 = (A - m + x1) / (2 A),  rate = sqrt(A),
+// running from x1 at w = 0 to infinity at w = 2K. Both are even in w.
+struct EllipticOrbit
+{
+    bool bounded;       // three real roots: turns around at x2
+    float root;         // x1
+    float scale;        // x2 - x1, or A
+    float complement;   // 1 - k^2
+    float rate;
+    float quarter;      // K(k)
+};
+
+// The roots come from the angle or hyperbolic angle of the trigonometric solution,
+// written so that neither small beta (far rays) nor beta close to 4/27 cancels:
+// x3 - x2 and n^2 are what sets 1 - k^2, and both vanish at the critical orbit.
+EllipticOrbit ellipticOrbit(float beta)
+{
+    const float criticalBeta = 4.0f / 27.0f;
+    const float twoOverRoot3 = 1.1547005384f;
+    EllipticOrbit orbit;
+    orbit.bounded = beta < criticalBeta;
+    if (orbit.bounded)
+    {
+        // x_k = 1/3 + 2/3 cos(t - 2 pi k / 3) for k = 0, 1, 2 is x3, x2, x1, where
+        // t = (2/3) asin(sqrt(27 beta / 4)) and gap = pi / 3 - t.
+        const float t = (2.0f / 3.0f) * std::asin(glm::min(std::sqrt(6.75f * beta), 1.0f));
+        const float gap = (2.0f / 3.0f) * std::asin(glm::min(std::sqrt(6.75f * (criticalBeta - beta)), 1.0f));
+        const float span = twoOverRoot3 * std::sin(t);
+        const float upper = twoOverRoot3 * std::sin(gap);   // x3 - x2
+        orbit.root = -(4.0f / 3.0f) * std::sin(0.5f * t) * std::sin(gap + 0.5f * t);
+        orbit.scale = span;
+        orbit.complement = upper / (span + upper);
+        orbit.rate = 0.5f * std::sqrt(span + upper);
+    }
+    else
+    {
+        // x1 = 1/3 - 2/3 cosh(h), with h = (2/3) asinh(sqrt(27 (beta - 4/27) / 4));
+        // the complex pair sits at m = (1 - x1) / 2, n^2 = (3 x1 + 1)(x1 - 1) / 4.
+        const float h = (2.0f / 3.0f) * std::asinh(std::sqrt(6.75f * (beta - criticalBeta)));
+        const float sinhHalf = std::sinh(0.5f * h);
+        const float x1 = 1.0f / 3.0f - (2.0f / 3.0f) * std::cosh(h);
+        const float mOffset = 0.5f * (1.0f - 3.0f * x1);    // m - x1
+        const float nSq = sinhHalf * sinhHalf * (1.0f - x1);
+        const float a = std::sqrt(mOffset * mOffset + nSq);
+        orbit.root = x1;
+        orbit.scale = a;
+        orbit.complement = nSq / (2.0f * a * (a + mOffset));
+        orbit.rate = std::sqrt(a);
+    }
+    orbit.quarter = carlsonRF(0.0f, orbit.complement, 1.0f);
+    return orbit;
+}
+
+// w in [0, K] (bounded) or [0, 2K) of the orbit point x with slope x'^2 = slopeSq.
+// Close to the turning point 1 - sn^2 = (x2 - x) / (x2 - x1) is better taken from
+// the slope, x'^2 = (x - x1)(x2 - x)(x3 - x), than from x.
+float orbitArgument(const EllipticOrbit &orbit, float x, float slopeSq)
+{
+    const float offset = glm::max(x - orbit.root, 0.0f);
+    if (orbit.bounded)
+    {
+        const float sinSq = glm::min(offset / orbit.scale, 1.0f);
+        const float outer = 4.0f * orbit.rate * orbit.rate;   // x3 - x1
+        const float cosSq = sinSq > 0.5f ? glm::min(slopeSq / (offset * (outer - offset) * orbit.scale), 1.0f)
+                                         : 1.0f - sinSq;
+        return ellipticF(sinSq, cosSq, orbit.complement);
+    }
+    const float sum = orbit.scale + offset;
+    const float cn = (orbit.scale - offset) / sum;
+    const float half = ellipticF(4.0f * orbit.scale * offset / (sum * sum), cn * cn, orbit.complement);
+    return cn >= 0.0f ? half : 2.0f * orbit.quarter - half;
+}
+
+float orbitPoint(const EllipticOrbit &orbit, float w)
+{
+    float sn;
+    float cn;
+    jacobiSnCn(w, orbit.complement, sn, cn);
+    if (orbit.bounded)
+    {
+        return orbit.root + orbit.scale * sn * sn;
+    }
+    return orbit.root + orbit.scale * (1.0f - cn) / glm::max(1.0f + cn, Geodesic::EPSILON);
+}
+}
+
+// Ingoing rays run w up from the camera's argument, outgoing ones down from its
+// negative, so x(w) and phi advance together either way. The orbit ends where x
+// returns to 0 (escape at the asymptotic phi) or reaches 1 (the horizon), and the
+// disk crossings before that are read off x(w) directly.
+bool Geodesic::analyticTrace(const TracerParameters &params, const PrimaryRay &ray, Termination &termination, float &u,
+                             float &phi)
+{
+    const float x0 = params.Rs * ray.u0;
+    const float xp0 = params.Rs * ray.up0;
+    const float beta = xp0 * xp0 + x0 * x0 * (1.0f - x0);
+    const float criticalBeta = 4.0f / 27.0f;
+    if (x0 >= 2.0f / 3.0f || std::abs(beta - criticalBeta) <= ANALYTIC_CRITICAL_MARGIN * criticalBeta)
+    {
+        return false;
+    }
+
+    const EllipticOrbit orbit = ellipticOrbit(beta);
+    const bool ingoing = ray.up0 > 0.0f;
+    const float start = ingoing ? orbitArgument(orbit, x0, xp0 * xp0) : -orbitArgument(orbit, x0, xp0 * xp0);
+    float end;
+    if (!ingoing)
+    {
+        end = -orbitArgument(orbit, 0.0f, beta);
+        termination = Termination::Escape;
+    }
+    else if (orbit.bounded)
+    {
+        end = 2.0f * orbit.quarter - orbitArgument(orbit, 0.0f, beta);
+        termination = Termination::Escape;
+    }
+    else
+    {
+        end = orbitArgument(orbit, 1.0f, beta);
+        termination = Termination::Horizon;
+    }
+    const float endPhi = ray.phi0 + (end - start) / orbit.rate;
+
+    for (float crossing = nextDiskCrossing(params, ray, ray.phi0); crossing < endPhi; crossing += PI)
+    {
+        const float x = orbitPoint(orbit, start + orbit.rate * (crossing - ray.phi0));
+        if (crossesAnnulus(params.disk, x / params.Rs))
+        {
+            termination = Termination::Disk;
+            u = x / params.Rs;
+            phi = crossing;
+            return true;
+        }
+    }
+
+    u = termination == Termination::Horizon ? 1.0f / params.Rs : 0.0f;
+    phi = endPhi;
+    return true;
+}
+
+glm::vec3 Geodesic::backgroundStarfield(glm::vec3 rayDir)
+{
+    const glm::vec3 dir = glm::normalize(rayDir);
+    const glm::vec3 scaled = dir * STARFIELD_CELLS;
+    const glm::vec3 cell = glm::floor(scaled);
+    const glm::vec3 local = glm::fract(scaled) - 0.5f;
+
+    const float starSeed = hash13(cell);
+    const float starMask = glm::smoothstep(0.9945f, 0.9995f, starSeed);
+
+    const float distanceFromCellCenter = glm::length(local);
+    const float core = glm::smoothstep(0.26f, 0.0f, distanceFromCellCenter);
+    const float glow = glm::smoothstep(0.45f, 0.0f, distanceFromCellCenter);
+    const float brightness = starMask * (1.4f * core + 0.35f * glow);
+
+    const float colorSeed = hash13(cell + glm::vec3(19.7f, 7.3f, 3.1f));
+    const glm::vec3 starColor = glm::mix(glm::vec3(1.0f, 0.82f, 0.72f), glm::vec3(0.72f, 0.82f, 1.0f), colorSeed);
+
+    const float band = std::exp(-18.0f * dir.y * dir.y);
+    const glm::vec3 galacticGlow = glm::vec3(0.025f, 0.02f, 0.035f) * band;
+
+    return BACKGROUND_COLOR + galacticGlow + starColor * brightness;
+}
+
+bool Geodesic::hitDisk(glm::vec3 pos3, glm::vec3 bhCenter, const DiskParameters &disk,
+                       float &diskR, glm::vec3 &diskPos)
+{
+    const glm::vec3 toPos = pos3 - bhCenter;
+    const float height = glm::dot(toPos, disk.normal);
+
+    // Thin disk approximation
+    if (std::abs(height) > 0.01f * disk.outerRadius)
+    {
+        return false;
+    }
+
+    projectOntoDisk(pos3, bhCenter, disk, diskR, diskPos);
+    return diskR >= disk.innerRadius && diskR <= disk.outerRadius;
+}
+
+void Geodesic::projectOntoDisk(glm::vec3 pos3, glm::vec3 bhCenter, const DiskParameters &disk,
+                               float &diskR, glm::vec3 &diskPos)
+{
+    const float height = glm::dot(pos3 - bhCenter, disk.normal);
+    diskPos = pos3 - height * disk.normal;
+    diskR = glm::length(diskPos - bhCenter);
+}
+
+glm::vec2 Geodesic::diskEmission(glm::vec3 diskPos, glm::vec3 bhCenter, const DiskParameters &disk, float r)
+{
+    const float innerR = disk.innerRadius;
+    const float outerR = disk.outerRadius;
+
+    const glm::vec3 radial = diskPos - bhCenter;
+    const glm::vec2 localUv = glm::vec2(glm::dot(radial, disk.basisX), glm::dot(radial, disk.basisZ)) / outerR;
+
+    const float radialCoord = (r - innerR) / glm::max(outerR - innerR, EPSILON);
+    float turbulence = noise2(localUv * 12.0f);
+    turbulence += 0.5f * noise2(localUv * 24.0f);
+    turbulence /= 1.5f;
+    const float warpedRadius = radialCoord + (turbulence * 0.06f);
+
+    float banding = 0.5f + 0.5f * std::sin(warpedRadius * 45.0f);
+    banding *= 0.5f + 0.5f * std::sin(warpedRadius * 15.0f + 0.8f);
+    banding = std::pow(banding, 1.2f);
+
+    const float variation = glm::mix(0.65f, 1.4f, banding) * glm::mix(0.8f, 1.2f, turbulence);
+
+    // Thin disk temperature profile, T ~ r^(-3/4), with the bands a little hotter
+    const float temperature = disk.innerTemperature * std::pow(glm::max(r, innerR) / innerR, -0.75f) *
+                              glm::mix(0.94f, 1.06f, banding);
+    const float brightness = disk.intensity * variation / Blackbody::luminance(disk.innerTemperature);
+    return glm::vec2(temperature, brightness);
+}
+
+float Geodesic::diskDopplerFactor(glm::vec3 diskPos, glm::vec3 bhCenter, glm::vec3 cameraPos,
+                                  const DiskParameters &disk, float diskR)
+{
+    const glm::vec3 radial = diskPos - bhCenter;
+    const float radialLen = glm::length(radial);
+    if (radialLen <= EPSILON)
+    {
+        return 1.0f;
+    }
+
+    const glm::vec3 radialDir = radial / radialLen;
+    const glm::vec3 normalDir = glm::normalize(disk.normal);
+    glm::vec3 tangentialDir = glm::cross(normalDir, radialDir);
+    const float tangentialLen = glm::length(tangentialDir);
+    if (tangentialLen <= EPSILON)
+    {
+        return 1.0f;
+    }
+
+    tangentialDir /= tangentialLen;
+
+    const float beta = glm::clamp(std::abs(disk.betaInner) * std::sqrt(disk.innerRadius / glm::max(diskR, disk.innerRadius)),
+                                  0.0f,
+                                  disk.betaMax);
+    tangentialDir *= glm::sign(disk.betaInner == 0.0f ? 1.0f : disk.betaInner);
+
+    // A crossing at the camera itself (it sits in the disk plane) has no view direction.
+    const glm::vec3 toCamera = cameraPos - diskPos;
+    const float viewLen = glm::length(toCamera);
+    if (viewLen <= EPSILON)
+    {
+        return 1.0f;
+    }
+
+    const glm::vec3 viewDir = toCamera / viewLen;
+    const float cosTheta = glm::clamp(glm::dot(tangentialDir, viewDir), -0.999f, 0.999f);
+    const float numerator = std::sqrt(glm::max(1.0f - beta * beta, 1e-4f));
+    const float denominator = glm::max(1.0f - beta * cosTheta, 0.05f);
+    const float dopplerFactor = glm::min(numerator / denominator, MAX_DOPPLER_FACTOR);
+
+    return glm::mix(1.0f, dopplerFactor, glm::clamp(disk.dopplerStrength, 0.0f, 1.0f));
+}
+
+Geodesic::PrimaryRay Geodesic::setupPrimaryRay(const TracerParameters &params, glm::vec2 pixel)
+{
+    PrimaryRay ray{};
+
+    // 1) Map pixel to NDC coordinates
+    const glm::vec2 uv = (pixel + 0.5f) / glm::vec2(params.resolution);
+    const glm::vec2 ndc(uv.x * 2.0f - 1.0f, -(uv.y * 2.0f - 1.0f));
+
+    // 2) Generate primary ray
+    generatePrimaryRay(ndc, params.invProjection, params.invView, ray.direction);
+
+    // 3) Build plane basis
+    buildPlaneBasis(params.cameraPos, ray.direction, params.bhCenter, ray.e1, ray.e2);
+
+    // 4) Initial polar coordinates
+    const glm::vec3 p = params.cameraPos - params.bhCenter;
+    const float x0 = glm::dot(p, ray.e1);
+    const float y0 = glm::dot(p, ray.e2);
+    const float r0 = std::sqrt(x0 * x0 + y0 * y0);
+    ray.phi0 = std::atan2(y0, x0);
+
+    // 5) Initial velocities converted to u, u'
+    float vr;
+    float vphi;
+    radialAngularVel(ray.direction, ray.e1, ray.e2, r0, ray.phi0, vr, vphi);
+
+    const float dphidl = glm::max(vphi, EPSILON);
+    ray.u0 = 1.0f / glm::max(r0, EPSILON);
+    ray.up0 = -(1.0f / (r0 * r0)) * (vr / dphidl);
+    return ray;
+}
+
+namespace
+{
+// Horizon and escape tests of trace_ray(), plus the slab disk test when asked for;
+// StepLimit means keep integrating.
+Termination testTermination(const TracerParameters &params, glm::vec3 pos3, float r)
+{
+    if (r <= params.Rs * (1.0f + Geodesic::EPSILON_HORIZON))
+    {
+        return Termination::Horizon;
+    }
+
+    float diskR;
+    glm::vec3 diskPos;
+    if (params.diskTest == DiskTest::Slab && Geodesic::hitDisk(pos3, params.bhCenter, params.disk, diskR, diskPos))
+    {
+        return Termination::Disk;
+    }
+
+    if (r >= Geodesic::R_ESCAPE)
+    {
+        return Termination::Escape;
+    }
+
+    return Termination::StepLimit;
+}
+
+// Stops a ray whose fate classifyRay() has settled. Escapes are moved to their
+// asymptotic angle so shadeRay() picks the right background direction.
+Termination finishEarly(const TracerParameters &params, float inverseImpactSq, glm::vec2 y, float &u, float &phi)
+{
+    const Termination outcome = Geodesic::classifyRay(params, inverseImpactSq, y.x, y.y);
+    if (outcome == Termination::Escape)
+    {
+        phi += Geodesic::escapeAngle(y.x, y.y, params.Rs);
+        u = 0.0f;
+    }
+    return outcome;
+}
+
+Termination integrateRayAdaptive(const TracerParameters &params, const Geodesic::PrimaryRay &ray, float &u, float &phi,
+                                 unsigned int &steps)
+{
+    using namespace Geodesic;
+
+    glm::vec2 y(ray.u0, ray.up0);
+    phi = ray.phi0;
+    const float M = 0.5f * params.Rs;
+    float h = ADAPTIVE_INITIAL_STEP;
+
+    const float inverseImpactSq = inverseImpactParameterSq(ray.u0, ray.up0, params.Rs);
+    float crossing = nextDiskCrossing(params, ray, ray.phi0);
+
+    bool moved = true;
+    for (steps = 0; steps < static_cast<unsigned int>(MAX_PHI_STEPS); ++steps)
+    {
+        if (moved)
+        {
+            u = y.x;
+            const float r = 1.0f / glm::max(y.x, EPSILON);
+            const Termination termination = testTermination(
+                params, params.bhCenter + ray.e1 * (r * std::cos(phi)) + ray.e2 * (r * std::sin(phi)), r);
+            if (termination != Termination::StepLimit)
+            {
+                return termination;
+            }
+            const Termination outcome = finishEarly(params, inverseImpactSq, y, u, phi);
+            if (outcome != Termination::StepLimit)
+            {
+                return outcome;
+            }
+            if (phi - ray.phi0 >= PHI_BUDGET)
+            {
+                break;
+            }
+            moved = false;
+        }
+
+        glm::vec2 error;
+        glm::vec2 next = dormandPrinceStep(y, h, M, error);
+        const float scale = params.tolerance * glm::max(std::abs(y.x) + std::abs(y.y), std::abs(next.x) + std::abs(next.y));
+        const float errorNorm = (std::abs(error.x) + std::abs(error.y)) / glm::max(scale, EPSILON);
+
+        if (errorNorm > 1.0f && h > ADAPTIVE_MIN_STEP)
+        {
+            h = glm::max(h * stepScale(errorNorm), ADAPTIVE_MIN_STEP);
+            continue;
+        }
+
+        float nextPhi = phi + h;
+        if (crossing <= nextPhi)
+        {
+            // A shorter step from the same point lands exactly on the disk plane;
+            // it is no longer than the accepted one, so no less accurate.
+            glm::vec2 crossingError;
+            const glm::vec2 onPlane = dormandPrinceStep(y, crossing - phi, M, crossingError);
+            if (crossesAnnulus(params.disk, onPlane.x))
+            {
+                u = onPlane.x;
+                phi = crossing;
+                return Termination::Disk;
+            }
+            crossing += PI;
+        }
+
+        // Escaping: pull phi back to where u reached 1 / r_escape, since a long
+        // step may have run past it.
+        if (next.x <= 1.0f / R_ESCAPE && next.y < 0.0f)
+        {
+            nextPhi -= (next.x - 1.0f / R_ESCAPE) / next.y;
+            next.x = 0.0f;
+        }
+
+        y = next;
+        phi = nextPhi;
+        h = glm::min(h * stepScale(errorNorm), ADAPTIVE_MAX_STEP);
+        moved = true;
+    }
+
+    u = y.x;
+    return Termination::StepLimit;
+}
+}
+
+Termination Geodesic::integrateRay(const TracerParameters &params, const PrimaryRay &ray, float &u, float &phi,
+                                   unsigned int &steps)
+{
+    if (params.integrator != Integrator::FixedRk4)
+    {
+        return integrateRayAdaptive(params, ray, u, phi, steps);
+    }
+
+    glm::vec2 y(ray.u0, ray.up0);
+    phi = ray.phi0;
+    const float M = 0.5f * params.Rs;
+    const float inverseImpactSq = inverseImpactParameterSq(ray.u0, ray.up0, params.Rs);
+    float crossing = params.diskTest == DiskTest::Slab ? INFINITY : nextDiskCrossing(params, ray, ray.phi0);
+
+    for (steps = 0; steps < static_cast<unsigned int>(MAX_PHI_STEPS); ++steps)
+    {
+        u = y.x;
+        const float r = 1.0f / glm::max(y.x, EPSILON);
+        const glm::vec3 pos3 = params.bhCenter + ray.e1 * (r * std::cos(phi)) + ray.e2 * (r * std::sin(phi));
+
+        const Termination termination = testTermination(params, pos3, r);
+        if (termination != Termination::StepLimit)
+        {
+            return termination;
+        }
+        const Termination outcome = finishEarly(params, inverseImpactSq, y, u, phi);
+        if (outcome != Termination::StepLimit)
+        {
+            return outcome;
+        }
+
+        if (crossing <= phi + DPHI)
+        {
+            const glm::vec2 onPlane = rk4Step(y, crossing - phi, M);
+            if (crossesAnnulus(params.disk, onPlane.x))
+            {
+                u = onPlane.x;
+                phi = crossing;
+                return Termination::Disk;
+            }
+            crossing += PI;
+        }
+
+        y = rk4Step(y, DPHI, M);
+        phi += DPHI;
+    }
+
+    u = y.x;
+    return Termination::StepLimit;
+}
+
+bool Geodesic::skyDirection(const PrimaryRay &ray, Termination termination, float phi, glm::vec3 &direction)
+{
+    if (termination == Termination::Escape)
+    {
+        direction = ray.e1 * std::cos(phi) + ray.e2 * std::sin(phi);
+        return true;
+    }
+    if (termination == Termination::StepLimit)
+    {
+        // Max steps reached - the unbent direction
+        direction = ray.direction;
+        return true;
+    }
+    return false;
+}
+
+glm::vec3 Geodesic::shadeRay(const TracerParameters &params, const PrimaryRay &ray, Termination termination, float u, float phi)
+{
+    glm::vec3 sky;
+    if (skyDirection(ray, termination, phi, sky))
+    {
+        return backgroundStarfield(sky);
+    }
+
+    const float r = 1.0f / glm::max(u, EPSILON);
+    const glm::vec3 pos3 = params.bhCenter + ray.e1 * (r * std::cos(phi)) + ray.e2 * (r * std::sin(phi));
+
+    switch (termination)
+    {
+    case Termination::Horizon:
+        return glm::vec3(0.0f);
+    case Termination::Disk:
+    {
+        float diskR;
+        glm::vec3 diskPos;
+        projectOntoDisk(pos3, params.bhCenter, params.disk, diskR, diskPos);
+
+        const glm::vec2 emission = params.diskEmission != nullptr
+                                       ? params.diskEmission->lookup(diskPos - params.bhCenter, diskR)
+                                       : diskEmission(diskPos, params.bhCenter, params.disk, diskR);
+        const float doppler = params.disk.enableDopplerBeaming
+                                  ? diskDopplerFactor(diskPos, params.bhCenter, params.cameraPos, params.disk, diskR)
+                                  : 1.0f;
+        return Blackbody::color(emission.x * doppler) * emission.y;
+    }
+    case Termination::Escape:
+    case Termination::StepLimit:
+        break;
+    }
+    return glm::vec3(0.0f);
+}
@@ -0,0 +1,237 @@
+#include "GpuTimer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+GpuTimer::GpuTimer(const std::vector<std::string> &phaseNames)
+    : phases(phaseNames), available(false), frame(0), dropped(0), recent(phaseNames.size())
+{
+    GLint bits = 0;
+    glGetQueryiv(GL_TIMESTAMP, GL_QUERY_COUNTER_BITS, &bits);
+    available = bits > 0;
+    if (!available)
+    {
+        std::cerr << "GPU timer queries are not supported by this driver." << std::endl;
+        return;
+    }
+
+    queries.resize(static_cast<std::size_t>(RING_SIZE) * phases.size() * 2);
+    glGenQueries(static_cast<GLsizei>(queries.size()), queries.data());
+    marked.assign(static_cast<std::size_t>(RING_SIZE) * phases.size(), 0);
+    slotFrames.assign(RING_SIZE, -1);
+}
+
+GpuTimer::~GpuTimer()
+{
+    if (!queries.empty())
+    {
+        glDeleteQueries(static_cast<GLsizei>(queries.size()), queries.data());
+    }
+}
+
+GLuint GpuTimer::query(unsigned int slot, std::size_t phase, bool end) const
+{
+    return queries[(static_cast<std::size_t>(slot) * phases.size() + phase) * 2 + (end ? 1 : 0)];
+}
+
+void GpuTimer::beginFrame()
+{
+    if (!available)
+    {
+        return;
+    }
+
+    const unsigned int slot = currentSlot();
+    if (slotFrames[slot] >= 0)
+    {
+        collect(slot, false);
+    }
+    std::fill_n(marked.begin() + static_cast<std::ptrdiff_t>(slot * phases.size()), phases.size(), 0);
+}
+
+void GpuTimer::beginPhase(std::size_t phase)
+{
+    if (available)
+    {
+        glQueryCounter(query(currentSlot(), phase, false), GL_TIMESTAMP);
+    }
+}
+
+void GpuTimer::endPhase(std::size_t phase)
+{
+    if (available)
+    {
+        glQueryCounter(query(currentSlot(), phase, true), GL_TIMESTAMP);
+        marked[currentSlot() * phases.size() + phase] = 1;
+    }
+}
+
+void GpuTimer::endFrame()
+{
+    if (available)
+    {
+        slotFrames[currentSlot()] = static_cast<std::int64_t>(frame);
+    }
+    ++frame;
+}
+
+void GpuTimer::finish()
+{
+    if (!available)
+    {
+        return;
+    }
+
+    // Oldest first, so the rows stay in frame order.
+    for (unsigned int i = 0; i < RING_SIZE; ++i)
+    {
+        const unsigned int slot = static_cast<unsigned int>((frame + i) % RING_SIZE);
+        if (slotFrames[slot] >= 0)
+        {
+            collect(slot, true);
+        }
+    }
+}
+
+void GpuTimer::collect(unsigned int slot, bool wait)
+{
+    const std::int64_t slotFrame = slotFrames[slot];
+    slotFrames[slot] = -1;
+
+    // Queries complete in order, so the slot is done once its last one is.
+    if (!wait)
+    {
+        for (std::size_t phase = phases.size(); phase-- > 0;)
+        {
+            if (!marked[slot * phases.size() + phase])
+            {
+                continue;
+            }
+
+            GLuint ready = GL_FALSE;
+            glGetQueryObjectuiv(query(slot, phase, true), GL_QUERY_RESULT_AVAILABLE, &ready);
+            if (ready == GL_FALSE)
+            {
+                ++dropped;
+                return;
+            }
+            break;
+        }
+    }
+
+    rowFrames.push_back(static_cast<std::uint64_t>(slotFrame));
+    for (std::size_t phase = 0; phase < phases.size(); ++phase)
+    {
+        if (!marked[slot * phases.size() + phase])
+        {
+            rowTimes.push_back(-1.0);
+            continue;
+        }
+
+        GLuint64 begin = 0;
+        GLuint64 end = 0;
+        glGetQueryObjectui64v(query(slot, phase, false), GL_QUERY_RESULT, &begin);
+        glGetQueryObjectui64v(query(slot, phase, true), GL_QUERY_RESULT, &end);
+        const double milliseconds = end > begin ? static_cast<double>(end - begin) * 1e-6 : 0.0;
+        rowTimes.push_back(milliseconds);
+
+        recent[phase].push_back(milliseconds);
+        if (recent[phase].size() > WINDOW)
+        {
+            recent[phase].pop_front();
+        }
+    }
+}
+
+GpuTimer::Stats GpuTimer::stats(std::size_t phase) const
+{
+    Stats result{0.0, 0.0, 0.0, 0};
+    const std::deque<double> &times = recent[phase];
+    if (times.empty())
+    {
+        return result;
+    }
+
+    std::vector<double> sorted(times.begin(), times.end());
+    std::sort(sorted.begin(), sorted.end());
+    double sum = 0.0;
+    for (const double time : sorted)
+    {
+        sum += time;
+    }
+
+    const std::size_t p99 = static_cast<std::size_t>(std::ceil(0.99 * static_cast<double>(sorted.size()))) - 1;
+    result.min = sorted.front();
+    result.average = sum / static_cast<double>(sorted.size());
+    result.p99 = sorted[p99];
+    result.samples = sorted.size();
+    return result;
+}
+
+void GpuTimer::printStats(std::ostream &out) const
+{
+    if (!available)
+    {
+        return;
+    }
+
+    out << "GPU ms (min/avg/p99):" << std::fixed << std::setprecision(3);
+    for (std::size_t phase = 0; phase < phases.size(); ++phase)
+    {
+        const Stats phaseStats = stats(phase);
+        out << "  " << phases[phase] << " " << phaseStats.min << "/" << phaseStats.average << "/" << phaseStats.p99;
+    }
+    out << std::defaultfloat << "  (" << recent.front().size() << " frames";
+    if (dropped > 0)
+    {
+        out << ", " << dropped << " dropped";
+    }
+    out << ")" << std::endl;
+}
+
+bool GpuTimer::writeCsv(const std::filesystem::path &path) const
+{
+    std::ofstream file(path);
+    if (!file)
+    {
+        std::cerr << "Failed to open " << path.string() << " for writing." << std::endl;
+        return false;
+    }
+
+    file << "frame";
+    for (const std::string &phase : phases)
+    {
+        file << "," << phase << "_ms";
+    }
+    file << "\n" << std::fixed << std::setprecision(6);
+
+    for (std::size_t row = 0; row < rowFrames.size(); ++row)
+    {
+        file << rowFrames[row];
+        for (std::size_t phase = 0; phase < phases.size(); ++phase)
+        {
+            const double time = rowTimes[row * phases.size() + phase];
+            file << ",";
+            if (time >= 0.0)
+            {
+                file << time;
+            }
+        }
+        file << "\n";
+    }
+
+    return static_cast<bool>(file);
+}
+
+double GpuTimer::getRowTotal(std::size_t row) const
+{
+    double total = 0.0;
+    for (std::size_t phase = 0; phase < phases.size(); ++phase)
+    {
+        total += std::max(rowTimes[row * phases.size() + phase], 0.0);
+    }
+    return total;
+}
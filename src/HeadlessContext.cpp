@@ -0,0 +1,160 @@
+#include "HeadlessContext.h"
+
+#include <cstring>
+
+#if defined(BLACK_HOLE_SIM_HEADLESS)
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+namespace
+{
+#if defined(BLACK_HOLE_SIM_HEADLESS)
+bool hasExtension(const char *extensions, const char *name)
+{
+    if (extensions == nullptr)
+    {
+        return false;
+    }
+
+    const std::size_t length = std::strlen(name);
+    for (const char *at = std::strstr(extensions, name); at != nullptr; at = std::strstr(at + length, name))
+    {
+        const bool starts = at == extensions || at[-1] == ' ';
+        const bool ends = at[length] == '\0' || at[length] == ' ';
+        if (starts && ends)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+#endif
+}
+
+HeadlessContext::HeadlessContext(unsigned int width, unsigned int height)
+    : width(width), height(height), display(nullptr), context(nullptr), framebuffer(0), colorBuffer(0)
+{
+}
+
+HeadlessContext::~HeadlessContext()
+{
+#if defined(BLACK_HOLE_SIM_HEADLESS)
+    if (framebuffer != 0)
+    {
+        glDeleteFramebuffers(1, &framebuffer);
+        glDeleteRenderbuffers(1, &colorBuffer);
+    }
+    if (context != nullptr)
+    {
+        eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        eglDestroyContext(display, context);
+    }
+    if (display != nullptr)
+    {
+        eglTerminate(display);
+    }
+#endif
+}
+
+bool HeadlessContext::create(int majorVersion, int minorVersion, std::string &error)
+{
+#if defined(BLACK_HOLE_SIM_HEADLESS)
+    // Client extensions, queried without a display.
+    if (!hasExtension(eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS), "EGL_MESA_platform_surfaceless"))
+    {
+        error = "EGL has no surfaceless platform (EGL_MESA_platform_surfaceless).";
+        return false;
+    }
+
+    const auto getPlatformDisplay =
+        reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(eglGetProcAddress("eglGetPlatformDisplayEXT"));
+    EGLDisplay eglDisplay =
+        getPlatformDisplay != nullptr ? getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr)
+                                      : EGL_NO_DISPLAY;
+    EGLint major = 0;
+    EGLint minor = 0;
+    if (eglDisplay == EGL_NO_DISPLAY || !eglInitialize(eglDisplay, &major, &minor))
+    {
+        error = "Failed to initialize the surfaceless EGL display.";
+        return false;
+    }
+    display = eglDisplay;
+
+    if (!hasExtension(eglQueryString(eglDisplay, EGL_EXTENSIONS), "EGL_KHR_surfaceless_context"))
+    {
+        error = "EGL can't make a context current without a surface (EGL_KHR_surfaceless_context).";
+        return false;
+    }
+
+    // The surfaceless platform only has pbuffer configs; no surface is made from it.
+    const EGLint configAttributes[] = {EGL_SURFACE_TYPE, EGL_PBUFFER_BIT, EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE};
+    EGLConfig config = nullptr;
+    EGLint configCount = 0;
+    if (!eglBindAPI(EGL_OPENGL_API) || !eglChooseConfig(eglDisplay, configAttributes, &config, 1, &configCount) ||
+        configCount == 0)
+    {
+        error = "EGL has no desktop OpenGL config.";
+        return false;
+    }
+
+    const EGLint contextAttributes[] = {
+        EGL_CONTEXT_MAJOR_VERSION, majorVersion,
+        EGL_CONTEXT_MINOR_VERSION, minorVersion,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+#ifdef DEBUG
+        EGL_CONTEXT_OPENGL_DEBUG, EGL_TRUE,
+#endif
+        EGL_NONE
+    };
+    context = eglCreateContext(eglDisplay, config, EGL_NO_CONTEXT, contextAttributes);
+    if (context == EGL_NO_CONTEXT)
+    {
+        context = nullptr;
+        error = "Failed to create an OpenGL " + std::to_string(majorVersion) + "." + std::to_string(minorVersion) +
+                " context on the surfaceless EGL display.";
+        return false;
+    }
+
+    if (!eglMakeCurrent(eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, context))
+    {
+        error = "Failed to make the headless OpenGL context current.";
+        return false;
+    }
+    return true;
+#else
+    (void)majorVersion;
+    (void)minorVersion;
+    error = "--headless needs a build with EGL (libEGL and its headers were not found).";
+    return false;
+#endif
+}
+
+bool HeadlessContext::createFramebuffer(std::string &error)
+{
+    glGenFramebuffers(1, &framebuffer);
+    glGenRenderbuffers(1, &colorBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, static_cast<GLsizei>(width), static_cast<GLsizei>(height));
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuffer);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+    {
+        error = "The headless framebuffer is incomplete.";
+        return false;
+    }
+
+    glViewport(0, 0, static_cast<GLsizei>(width), static_cast<GLsizei>(height));
+    return true;
+}
+
+void *HeadlessContext::getProcAddress(const char *name)
+{
+#if defined(BLACK_HOLE_SIM_HEADLESS)
+    return reinterpret_cast<void *>(eglGetProcAddress(name));
+#else
+    (void)name;
+    return nullptr;
+#endif
+}
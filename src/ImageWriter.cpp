@@ -0,0 +1,290 @@
+#include "ImageWriter.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#include <glm/gtc/packing.hpp>
+
+#if defined(BLACK_HOLE_SIM_ZLIB)
+#include <zlib.h>
+#endif
+
+namespace
+{
+constexpr int EXR_HALF = 1;
+constexpr std::uint8_t EXR_NO_COMPRESSION = 0;
+constexpr std::uint8_t EXR_ZIP_COMPRESSION = 3;     // blocks of 16 lines
+#if defined(BLACK_HOLE_SIM_ZLIB)
+constexpr int EXR_ZIP_LEVEL = 4;                    // OpenEXR's default since 3.1
+#endif
+
+template <typename T>
+void appendValue(std::vector<std::uint8_t> &bytes, T value)
+{
+    std::uint8_t raw[sizeof(T)];
+    std::memcpy(raw, &value, sizeof(T));    // EXR is little-endian, like every target we build for
+    bytes.insert(bytes.end(), raw, raw + sizeof(T));
+}
+
+void appendString(std::vector<std::uint8_t> &bytes, const char *text)
+{
+    bytes.insert(bytes.end(), text, text + std::strlen(text) + 1);
+}
+
+void appendAttribute(std::vector<std::uint8_t> &bytes, const char *name, const char *type, std::int32_t size)
+{
+    appendString(bytes, name);
+    appendString(bytes, type);
+    appendValue(bytes, size);
+}
+
+bool writeFile(const std::filesystem::path &path, const std::uint8_t *data, std::size_t size, std::ofstream &file)
+{
+    file.write(reinterpret_cast<const char *>(data), static_cast<std::streamsize>(size));
+    if (!file)
+    {
+        std::cerr << "Failed while writing " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+}
+
+bool ImageWriter::writePfm(const std::filesystem::path &path, const std::vector<glm::vec4> &pixels, int width, int height)
+{
+    if (width <= 0 || height <= 0 ||
+        pixels.size() < static_cast<std::size_t>(width) * static_cast<std::size_t>(height))
+    {
+        std::cerr << "Refusing to write an empty or truncated image to " << path << std::endl;
+        return false;
+    }
+
+    std::ofstream file(path, std::ios::binary);
+    if (!file)
+    {
+        std::cerr << "Error opening file for writing: " << path << std::endl;
+        return false;
+    }
+
+    // Negative scale marks little-endian data. PFM stores scanlines bottom to top.
+    file << "PF\n" << width << " " << height << "\n-1.0\n";
+
+    std::vector<float> scanline(static_cast<std::size_t>(width) * 3);
+    for (int y = height - 1; y >= 0; --y)
+    {
+        const glm::vec4 *row = pixels.data() + static_cast<std::size_t>(y) * static_cast<std::size_t>(width);
+        for (int x = 0; x < width; ++x)
+        {
+            scanline[static_cast<std::size_t>(x) * 3 + 0] = row[x].r;
+            scanline[static_cast<std::size_t>(x) * 3 + 1] = row[x].g;
+            scanline[static_cast<std::size_t>(x) * 3 + 2] = row[x].b;
+        }
+        file.write(reinterpret_cast<const char *>(scanline.data()),
+                   static_cast<std::streamsize>(scanline.size() * sizeof(float)));
+    }
+
+    if (!file)
+    {
+        std::cerr << "Failed while writing " << path << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+bool ImageWriter::writePfm(const std::filesystem::path &path, const float *rgb, int width, int height)
+{
+    std::ofstream file(path, std::ios::binary);
+    if (!file)
+    {
+        std::cerr << "Error opening file for writing: " << path << std::endl;
+        return false;
+    }
+
+    file << "PF\n" << width << " " << height << "\n-1.0\n";
+    const std::size_t rowSize = static_cast<std::size_t>(width) * 3 * sizeof(float);
+    for (int y = height - 1; y >= 0; --y)
+    {
+        if (!writeFile(path, reinterpret_cast<const std::uint8_t *>(rgb) + static_cast<std::size_t>(y) * rowSize, rowSize,
+                       file))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ImageWriter::writeExr(const std::filesystem::path &path, const std::vector<glm::vec4> &pixels, int width, int height)
+{
+    if (width <= 0 || height <= 0 ||
+        pixels.size() < static_cast<std::size_t>(width) * static_cast<std::size_t>(height))
+    {
+        std::cerr << "Refusing to write an empty or truncated image to " << path << std::endl;
+        return false;
+    }
+
+    const int linesPerBlock = exrLinesPerBlock();
+    std::vector<std::uint16_t> rows(static_cast<std::size_t>(width) * 3 * static_cast<std::size_t>(linesPerBlock));
+    std::vector<std::vector<std::uint8_t>> chunks(static_cast<std::size_t>(exrBlockCount(height)));
+    for (std::size_t block = 0; block < chunks.size(); ++block)
+    {
+        const int firstLine = static_cast<int>(block) * linesPerBlock;
+        const int lineCount = std::min(linesPerBlock, height - firstLine);
+        for (int line = 0; line < lineCount; ++line)
+        {
+            const glm::vec4 *row = pixels.data() + static_cast<std::size_t>(firstLine + line) * static_cast<std::size_t>(width);
+            std::uint16_t *out = rows.data() + static_cast<std::size_t>(line) * static_cast<std::size_t>(width) * 3;
+            for (int x = 0; x < width; ++x)
+            {
+                out[x * 3 + 0] = glm::packHalf1x16(row[x].r);
+                out[x * 3 + 1] = glm::packHalf1x16(row[x].g);
+                out[x * 3 + 2] = glm::packHalf1x16(row[x].b);
+            }
+        }
+        encodeExrBlock(rows.data(), static_cast<std::size_t>(width) * 3, width, firstLine, lineCount, chunks[block]);
+    }
+
+    return writeExrChunks(path, exrHeader(width, height), chunks);
+}
+
+int ImageWriter::exrLinesPerBlock()
+{
+#if defined(BLACK_HOLE_SIM_ZLIB)
+    return EXR_ZIP_LINES;
+#else
+    return 1;
+#endif
+}
+
+int ImageWriter::exrBlockCount(int height)
+{
+    return (height + exrLinesPerBlock() - 1) / exrLinesPerBlock();
+}
+
+std::vector<std::uint8_t> ImageWriter::exrHeader(int width, int height)
+{
+    std::vector<std::uint8_t> header;
+    appendValue<std::int32_t>(header, 20000630);    // magic number
+    appendValue<std::int32_t>(header, 2);           // version 2, single part scanline
+
+    // Channels in alphabetical order, as readers expect them.
+    const char *channels[] = {"B", "G", "R"};
+    appendAttribute(header, "channels", "chlist", static_cast<std::int32_t>(3 * (2 + 16) + 1));
+    for (const char *channel : channels)
+    {
+        appendString(header, channel);
+        appendValue<std::int32_t>(header, EXR_HALF);
+        appendValue<std::uint32_t>(header, 0);      // pLinear and reserved
+        appendValue<std::int32_t>(header, 1);       // x sampling
+        appendValue<std::int32_t>(header, 1);       // y sampling
+    }
+    header.push_back(0);
+
+    appendAttribute(header, "compression", "compression", 1);
+    header.push_back(exrLinesPerBlock() == 1 ? EXR_NO_COMPRESSION : EXR_ZIP_COMPRESSION);
+    for (const char *window : {"dataWindow", "displayWindow"})
+    {
+        appendAttribute(header, window, "box2i", 16);
+        appendValue<std::int32_t>(header, 0);
+        appendValue<std::int32_t>(header, 0);
+        appendValue<std::int32_t>(header, width - 1);
+        appendValue<std::int32_t>(header, height - 1);
+    }
+    appendAttribute(header, "lineOrder", "lineOrder", 1);
+    header.push_back(0);                            // increasing y
+    appendAttribute(header, "pixelAspectRatio", "float", 4);
+    appendValue(header, 1.0f);
+    appendAttribute(header, "screenWindowCenter", "v2f", 8);
+    appendValue(header, 0.0f);
+    appendValue(header, 0.0f);
+    appendAttribute(header, "screenWindowWidth", "float", 4);
+    appendValue(header, 1.0f);
+    header.push_back(0);
+    return header;
+}
+
+void ImageWriter::encodeExrBlock(const std::uint16_t *rows, std::size_t rowStride, int width, int firstLine,
+                                 int lineCount, std::vector<std::uint8_t> &chunk)
+{
+    // Each line holds all of its B values, then G, then R.
+    const std::size_t lineSize = static_cast<std::size_t>(width) * 3 * sizeof(std::uint16_t);
+    std::vector<std::uint8_t> planar(lineSize * static_cast<std::size_t>(lineCount));
+    for (int line = 0; line < lineCount; ++line)
+    {
+        const std::uint16_t *row = rows + static_cast<std::size_t>(line) * rowStride;
+        std::uint16_t *out = reinterpret_cast<std::uint16_t *>(planar.data() + static_cast<std::size_t>(line) * lineSize);
+        for (int channel = 0; channel < 3; ++channel)
+        {
+            for (int x = 0; x < width; ++x)
+            {
+                *out++ = row[x * 3 + 2 - channel];
+            }
+        }
+    }
+
+    chunk.clear();
+    appendValue<std::int32_t>(chunk, firstLine);
+
+#if defined(BLACK_HOLE_SIM_ZLIB)
+    // OpenEXR's ZIP predictor: bytes split into even and odd halves, then delta coded.
+    std::vector<std::uint8_t> reordered(planar.size());
+    const std::size_t half = (planar.size() + 1) / 2;
+    for (std::size_t i = 0; i < planar.size(); ++i)
+    {
+        reordered[(i % 2 == 0 ? 0 : half) + i / 2] = planar[i];
+    }
+    for (std::size_t i = reordered.size() - 1; i > 0; --i)
+    {
+        reordered[i] = static_cast<std::uint8_t>(reordered[i] - reordered[i - 1] + 128);
+    }
+
+    uLongf compressedSize = compressBound(static_cast<uLong>(reordered.size()));
+    std::vector<std::uint8_t> compressed(compressedSize);
+    if (compress2(compressed.data(), &compressedSize, reordered.data(), static_cast<uLong>(reordered.size()),
+                  EXR_ZIP_LEVEL) == Z_OK &&
+        compressedSize < planar.size())
+    {
+        appendValue<std::int32_t>(chunk, static_cast<std::int32_t>(compressedSize));
+        chunk.insert(chunk.end(), compressed.begin(), compressed.begin() + static_cast<std::ptrdiff_t>(compressedSize));
+        return;
+    }
+#endif
+
+    // Blocks that don't compress are stored as they are, which readers tell by the size.
+    appendValue<std::int32_t>(chunk, static_cast<std::int32_t>(planar.size()));
+    chunk.insert(chunk.end(), planar.begin(), planar.end());
+}
+
+bool ImageWriter::writeExrChunks(const std::filesystem::path &path, const std::vector<std::uint8_t> &header,
+                                 const std::vector<std::vector<std::uint8_t>> &chunks)
+{
+    std::ofstream file(path, std::ios::binary);
+    if (!file)
+    {
+        std::cerr << "Error opening file for writing: " << path << std::endl;
+        return false;
+    }
+
+    std::vector<std::uint8_t> offsets;
+    std::uint64_t offset = header.size() + chunks.size() * sizeof(std::uint64_t);
+    for (const std::vector<std::uint8_t> &chunk : chunks)
+    {
+        appendValue<std::uint64_t>(offsets, offset);
+        offset += chunk.size();
+    }
+
+    if (!writeFile(path, header.data(), header.size(), file) || !writeFile(path, offsets.data(), offsets.size(), file))
+    {
+        return false;
+    }
+    for (const std::vector<std::uint8_t> &chunk : chunks)
+    {
+        if (!writeFile(path, chunk.data(), chunk.size(), file))
+        {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,105 @@
+#include "OfflineRenderer.h"
+
+#include <algorithm>
+#include <iostream>
+#include <thread>
+
+#include "Camera.h"
+#include "CameraPath.h"
+#include "FrameReadback.h"
+#include "FrameWorker.h"
+#include "Profiler.h"
+
+namespace
+{
+// One thread is left to the render loop, which feeds the encoder.
+unsigned int encoderThreads()
+{
+    return std::max(std::thread::hardware_concurrency(), 2u) - 1;
+}
+}
+
+OfflineRenderer::OfflineRenderer(FrameEncoder::Output output, const std::string &path, unsigned int frameCount,
+                                 unsigned int fps, const glm::ivec2 &resolution, const glm::vec3 &start,
+                                 const CameraPath *cameraPath, FrameWorker *worker)
+    : frameCount(frameCount), fps(fps), start(start), cameraPath(cameraPath), worker(worker), frame(0),
+      rangeEnd(worker != nullptr ? 0 : frameCount), renderedFrames(0), startTime(std::chrono::steady_clock::now()),
+      encoder(output, path, resolution.x, resolution.y, fps, encoderThreads()),
+      readback(std::make_unique<FrameReadback>(resolution.x, resolution.y, output, encoder))
+{
+    if (worker != nullptr)
+    {
+        encoder.setFrameWritten([worker](std::uint64_t written) { worker->frameWritten(written); });
+    }
+}
+
+OfflineRenderer::~OfflineRenderer() = default;
+
+unsigned int OfflineRenderer::framesFor(unsigned int requested, const CameraPath *cameraPath, unsigned int fps)
+{
+    if (requested > 0)
+    {
+        return requested;
+    }
+    return cameraPath != nullptr ? static_cast<unsigned int>(cameraPath->frameCount(fps)) : DEFAULT_FRAMES;
+}
+
+bool OfflineRenderer::open()
+{
+    startTime = std::chrono::steady_clock::now();
+    return encoder.open();
+}
+
+bool OfflineRenderer::isFinished()
+{
+    if (frame < rangeEnd)
+    {
+        return false;
+    }
+    if (worker == nullptr)
+    {
+        return true;
+    }
+
+    readback->flush();
+    std::uint64_t first = 0;
+    std::uint64_t end = 0;
+    if (!worker->nextRange(first, end) || end > frameCount)
+    {
+        return true;
+    }
+    frame = first;
+    rangeEnd = end;
+    return false;
+}
+
+void OfflineRenderer::positionCamera(Camera &camera) const
+{
+    if (cameraPath != nullptr)
+    {
+        CameraPath::apply(cameraPath->evaluateFrame(frame, fps), camera);
+        return;
+    }
+
+    const float angle = 2.0f * 3.14159265358979f * static_cast<float>(frame) / static_cast<float>(frameCount);
+    camera.lookAt(Camera::orbitPosition(start, angle), glm::vec3(0.0f));
+}
+
+void OfflineRenderer::captureFrame(GLuint texture)
+{
+    PROFILE_ZONE("readback");
+    readback->capture(texture, frame);
+    ++frame;
+    ++renderedFrames;
+}
+
+bool OfflineRenderer::finish()
+{
+    readback->flush();
+    const bool written = encoder.finish();
+
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    std::cout << "Rendered " << renderedFrames << " frames in " << seconds << " s ("
+              << (seconds > 0.0 ? static_cast<double>(renderedFrames) / seconds : 0.0) << " frames/s)." << std::endl;
+    return written && !(worker != nullptr && worker->isLost());
+}
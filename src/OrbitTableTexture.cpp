@@ -0,0 +1,54 @@
+#include "OrbitTableTexture.h"
+
+#include "PhotonOrbitTable.h"
+
+namespace
+{
+unsigned int createTableTexture()
+{
+    unsigned int texture = 0;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    // The shader fetches texels itself, interpolating along the orbit with the slopes.
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    return texture;
+}
+}
+
+OrbitTableTexture::OrbitTableTexture() : samplesTexture(createTableTexture()), rowsTexture(createTableTexture())
+{
+}
+
+OrbitTableTexture::~OrbitTableTexture()
+{
+    glDeleteTextures(1, &samplesTexture);
+    glDeleteTextures(1, &rowsTexture);
+}
+
+void OrbitTableTexture::upload(const PhotonOrbitTable &table) const
+{
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    glBindTexture(GL_TEXTURE_2D, samplesTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RG32F, PhotonOrbitTable::COLUMN_COUNT, PhotonOrbitTable::ANGLE_COUNT, 0,
+                 GL_RG, GL_FLOAT, table.getSamples().data());
+
+    glBindTexture(GL_TEXTURE_2D, rowsTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB32F, PhotonOrbitTable::ANGLE_COUNT, 1, 0,
+                 GL_RGB, GL_FLOAT, table.getRows().data());
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void OrbitTableTexture::bind(unsigned int samplesUnit, unsigned int rowsUnit) const
+{
+    glActiveTexture(GL_TEXTURE0 + samplesUnit);
+    glBindTexture(GL_TEXTURE_2D, samplesTexture);
+    glActiveTexture(GL_TEXTURE0 + rowsUnit);
+    glBindTexture(GL_TEXTURE_2D, rowsTexture);
+    glActiveTexture(GL_TEXTURE0);
+}
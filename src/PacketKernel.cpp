@@ -0,0 +1,114 @@
+#include "PacketKernel.h"
+
+#include <cstring>
+
+#include "PacketKernelImpl.h"
+
+void PacketKernel::detail::integrateGeneric(const Constants &constants, const RayStreams &rays)
+{
+    integratePackets<4>(constants, rays);
+}
+
+bool PacketKernel::isSupported(Isa isa)
+{
+    switch (isa)
+    {
+    case Isa::Scalar:
+    case Isa::Generic:
+        return true;
+#if defined(BLACK_HOLE_SIM_X86_KERNELS)
+    case Isa::Sse:
+        return __builtin_cpu_supports("sse4.2");
+    case Isa::Avx2:
+        return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    case Isa::Avx512:
+        return __builtin_cpu_supports("avx512f");
+#endif
+    default:
+        return false;
+    }
+}
+
+PacketKernel::Isa PacketKernel::detectIsa()
+{
+    const Isa preference[] = {Isa::Avx512, Isa::Avx2, Isa::Sse};
+    for (const Isa isa : preference)
+    {
+        if (isSupported(isa))
+        {
+            return isa;
+        }
+    }
+
+    return Isa::Generic;
+}
+
+unsigned int PacketKernel::laneCount(Isa isa)
+{
+    switch (isa)
+    {
+    case Isa::Scalar:
+        return 1;
+    case Isa::Avx2:
+        return 8;
+    case Isa::Avx512:
+        return 16;
+    default:
+        return 4;
+    }
+}
+
+const char *PacketKernel::isaName(Isa isa)
+{
+    switch (isa)
+    {
+    case Isa::Scalar:
+        return "scalar";
+    case Isa::Generic:
+        return "generic";
+    case Isa::Sse:
+        return "sse";
+    case Isa::Avx2:
+        return "avx2";
+    case Isa::Avx512:
+        return "avx512";
+    }
+
+    return "unknown";
+}
+
+bool PacketKernel::parseIsa(const char *name, Isa &isa)
+{
+    const Isa all[] = {Isa::Scalar, Isa::Generic, Isa::Sse, Isa::Avx2, Isa::Avx512};
+    for (const Isa candidate : all)
+    {
+        if (std::strcmp(name, isaName(candidate)) == 0)
+        {
+            isa = candidate;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void PacketKernel::integrate(Isa isa, const Constants &constants, const RayStreams &rays)
+{
+    switch (isa)
+    {
+#if defined(BLACK_HOLE_SIM_X86_KERNELS)
+    case Isa::Sse:
+        detail::integrateSse(constants, rays);
+        return;
+    case Isa::Avx2:
+        detail::integrateAvx2(constants, rays);
+        return;
+    case Isa::Avx512:
+        detail::integrateAvx512(constants, rays);
+        return;
+#endif
+    default:
+        detail::integrateGeneric(constants, rays);
+        return;
+    }
+}
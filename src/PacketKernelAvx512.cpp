@@ -0,0 +1,7 @@
+// Compiled with the matching -m flags; see CMakeLists.txt.
+#include "PacketKernelImpl.h"
+
+void PacketKernel::detail::integrateAvx512(const Constants &constants, const RayStreams &rays)
+{
+    integratePackets<16>(constants, rays);
+}
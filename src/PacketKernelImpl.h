@@ -0,0 +1,404 @@
+#pragma once
+
+// Lane-width generic body of the packet integrator. Only the PacketKernel*.cpp
+// translation units include this, each one compiled for a single instruction set.
+// Everything below has internal linkage and avoids glm and the standard library,
+// so the linker can never fold an AVX-512 copy of a helper into code that runs on
+// a machine without it.
+
+#include <cstddef>
+#include <cstdint>
+
+#include "PacketKernel.h"
+#include "Termination.h"
+
+namespace
+{
+constexpr float KERNEL_EPSILON = 1e-12f;
+
+template <int W>
+struct Packet
+{
+    typedef float F __attribute__((vector_size(W * sizeof(float))));
+    typedef std::int32_t I __attribute__((vector_size(W * sizeof(float))));
+};
+
+template <int W>
+inline typename Packet<W>::F splat(float value)
+{
+    return typename Packet<W>::F{} + value;
+}
+
+template <int W>
+inline bool anyLane(typename Packet<W>::I mask)
+{
+    for (int i = 0; i < W; ++i)
+    {
+        if (mask[i] != 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// 0.9 * x^(-1/5) clamped to [0.2, 5], the adaptive step size multiplier. Uses a
+// cheap log2/exp2 pair; the controller only needs a few digits.
+template <int W>
+inline typename Packet<W>::F stepScale(typename Packet<W>::F errorNorm)
+{
+    typedef typename Packet<W>::F F;
+    typedef typename Packet<W>::I I;
+
+    const F x = errorNorm > 1e-20f ? errorNorm : splat<W>(1e-20f);
+    const I bits = (I)x;
+    const F exponent = __builtin_convertvector(((bits >> 23) & 255) - 127, F);
+    const F m = (F)((bits & 0x7fffff) | 0x3f800000);
+    const F log2x = exponent + (-1.7417939f + (2.8212026f + (-1.4699568f + (0.44717955f - 0.056570851f * m) * m) * m) * m);
+
+    const F y = -0.2f * log2x;
+    I whole = __builtin_convertvector(y, I);
+    whole += __builtin_convertvector(whole, F) > y;     // truncation to floor
+    const F frac = y - __builtin_convertvector(whole, F);
+    const F exp2Frac = 1.0f + frac * (0.6960656f + frac * (0.2244021f + frac * 0.0794402f));
+    const F power = (F)((I)exp2Frac + (whole << 23));
+
+    const F scale = 0.9f * power;
+    return scale < 0.2f ? splat<W>(0.2f) : (scale > 5.0f ? splat<W>(5.0f) : scale);
+}
+
+template <int W>
+inline typename Packet<W>::F absolute(typename Packet<W>::F x)
+{
+    return x < 0.0f ? -x : x;
+}
+
+template <int W>
+inline typename Packet<W>::F minimum(typename Packet<W>::F a, typename Packet<W>::F b)
+{
+    return a < b ? a : b;
+}
+
+template <int W>
+inline typename Packet<W>::F maximum(typename Packet<W>::F a, typename Packet<W>::F b)
+{
+    return a > b ? a : b;
+}
+
+// Scalar twin of Geodesic::escapeAngle for lanes retired as early escapes.
+inline float escapeAngle(float u, float up, float Rs, float escapeU)
+{
+    static const float nodes[4] = {0.1834346424956498f, 0.5255324099163290f, 0.7966664774136267f, 0.9602898564975363f};
+    static const float weights[4] = {0.3626837833783620f, 0.3137066458778873f, 0.2223810344533745f, 0.1012285362903763f};
+
+    const float span = u > escapeU ? u - escapeU : 0.0f;
+    const float inverseImpactSq = up * up + u * u * (1.0f - Rs * u);
+
+    float angle = 0.0f;
+    for (int i = 0; i < 8; ++i)
+    {
+        const float node = i < 4 ? -nodes[i] : nodes[i - 4];
+        const float t = 0.5f * (1.0f + node);
+        const float ut = escapeU + span * (1.0f - t * t);
+        const float radicand = inverseImpactSq - ut * ut * (1.0f - Rs * ut);
+        angle += weights[i % 4] * span * t / __builtin_sqrtf(radicand > KERNEL_EPSILON ? radicand : KERNEL_EPSILON);
+    }
+    return angle;
+}
+
+// RK4 step of y = [u, up], u'' = -u + 3*M*u^2, each lane with its own h
+template <int W>
+inline void rk4Step(typename Packet<W>::F u, typename Packet<W>::F up, typename Packet<W>::F h, float M,
+                    typename Packet<W>::F &nextU, typename Packet<W>::F &nextUp)
+{
+    typedef typename Packet<W>::F F;
+
+    const F k1u = up;
+    const F k1p = -u + 3.0f * M * u * u;
+    const F u2 = u + 0.5f * h * k1u;
+    const F k2u = up + 0.5f * h * k1p;
+    const F k2p = -u2 + 3.0f * M * u2 * u2;
+    const F u3 = u + 0.5f * h * k2u;
+    const F k3u = up + 0.5f * h * k2p;
+    const F k3p = -u3 + 3.0f * M * u3 * u3;
+    const F u4 = u + h * k3u;
+    const F k4u = up + h * k3p;
+    const F k4p = -u4 + 3.0f * M * u4 * u4;
+
+    nextU = u + (h / 6.0f) * (k1u + 2.0f * k2u + 2.0f * k3u + k4u);
+    nextUp = up + (h / 6.0f) * (k1p + 2.0f * k2p + 2.0f * k3p + k4p);
+}
+
+// Dormand-Prince 5(4) step; errorU/errorUp receive the difference to the embedded
+// fourth order solution.
+template <int W>
+inline void dormandPrinceStep(typename Packet<W>::F u, typename Packet<W>::F up, typename Packet<W>::F h, float M,
+                              typename Packet<W>::F &nextU, typename Packet<W>::F &nextUp,
+                              typename Packet<W>::F &errorU, typename Packet<W>::F &errorUp)
+{
+    typedef typename Packet<W>::F F;
+
+    const F k1u = up;
+    const F k1p = -u + 3.0f * M * u * u;
+    F su = u + h * (1.0f / 5.0f) * k1u;
+    const F k2u = up + h * (1.0f / 5.0f) * k1p;
+    const F k2p = -su + 3.0f * M * su * su;
+    su = u + h * ((3.0f / 40.0f) * k1u + (9.0f / 40.0f) * k2u);
+    const F k3u = up + h * ((3.0f / 40.0f) * k1p + (9.0f / 40.0f) * k2p);
+    const F k3p = -su + 3.0f * M * su * su;
+    su = u + h * ((44.0f / 45.0f) * k1u - (56.0f / 15.0f) * k2u + (32.0f / 9.0f) * k3u);
+    const F k4u = up + h * ((44.0f / 45.0f) * k1p - (56.0f / 15.0f) * k2p + (32.0f / 9.0f) * k3p);
+    const F k4p = -su + 3.0f * M * su * su;
+    su = u + h * ((19372.0f / 6561.0f) * k1u - (25360.0f / 2187.0f) * k2u + (64448.0f / 6561.0f) * k3u -
+                  (212.0f / 729.0f) * k4u);
+    const F k5u = up + h * ((19372.0f / 6561.0f) * k1p - (25360.0f / 2187.0f) * k2p +
+                            (64448.0f / 6561.0f) * k3p - (212.0f / 729.0f) * k4p);
+    const F k5p = -su + 3.0f * M * su * su;
+    su = u + h * ((9017.0f / 3168.0f) * k1u - (355.0f / 33.0f) * k2u + (46732.0f / 5247.0f) * k3u +
+                  (49.0f / 176.0f) * k4u - (5103.0f / 18656.0f) * k5u);
+    const F k6u = up + h * ((9017.0f / 3168.0f) * k1p - (355.0f / 33.0f) * k2p + (46732.0f / 5247.0f) * k3p +
+                            (49.0f / 176.0f) * k4p - (5103.0f / 18656.0f) * k5p);
+    const F k6p = -su + 3.0f * M * su * su;
+
+    nextU = u + h * ((35.0f / 384.0f) * k1u + (500.0f / 1113.0f) * k3u + (125.0f / 192.0f) * k4u -
+                     (2187.0f / 6784.0f) * k5u + (11.0f / 84.0f) * k6u);
+    nextUp = up + h * ((35.0f / 384.0f) * k1p + (500.0f / 1113.0f) * k3p + (125.0f / 192.0f) * k4p -
+                       (2187.0f / 6784.0f) * k5p + (11.0f / 84.0f) * k6p);
+    const F k7u = nextUp;
+    const F k7p = -nextU + 3.0f * M * nextU * nextU;
+
+    errorU = h * ((71.0f / 57600.0f) * k1u - (71.0f / 16695.0f) * k3u + (71.0f / 1920.0f) * k4u -
+                  (17253.0f / 339200.0f) * k5u + (22.0f / 525.0f) * k6u - (1.0f / 40.0f) * k7u);
+    errorUp = h * ((71.0f / 57600.0f) * k1p - (71.0f / 16695.0f) * k3p + (71.0f / 1920.0f) * k4p -
+                   (17253.0f / 339200.0f) * k5p + (22.0f / 525.0f) * k6p - (1.0f / 40.0f) * k7p);
+}
+
+// Scalar twin of Geodesic::nextDiskCrossing, from the lane's n1 and n2.
+inline float nextDiskCrossing(float n1, float n2, float phi, float normalLengthSq)
+{
+    const float pi = 3.14159265358979f;
+    if (n1 * n1 + n2 * n2 <= KERNEL_EPSILON * normalLengthSq)
+    {
+        return __builtin_inff();
+    }
+
+    const float line = __builtin_atan2f(n2, n1) + 0.5f * pi;
+    return line + pi * (__builtin_floorf((phi - line) / pi) + 1.0f);
+}
+
+template <int W>
+void integratePackets(const PacketKernel::Constants &k, const PacketKernel::RayStreams &rays)
+{
+    typedef typename Packet<W>::F F;
+    typedef typename Packet<W>::I I;
+
+    // Lane state
+    F u = splat<W>(0.0f);
+    F up = splat<W>(0.0f);
+    F phi = splat<W>(0.0f);
+    F crossing = splat<W>(0.0f);    // next angle where the path meets the disk plane
+    F h = splat<W>(k.initialStep);
+    F phiStart = splat<W>(0.0f);
+    F inverseImpactSq = splat<W>(0.0f);
+    I steps = I{};
+    I live = I{};
+    I landed = I{};             // state moved onto a disk crossing inside the annulus
+    std::size_t slot[W];
+
+    const float normalLengthSq = k.diskNormal[0] * k.diskNormal[0] +
+                                 k.diskNormal[1] * k.diskNormal[1] +
+                                 k.diskNormal[2] * k.diskNormal[2];
+    std::size_t next = 0;
+    int liveCount = 0;
+
+    auto load = [&](int lane) {
+        landed[lane] = 0;
+        if (next >= rays.count)
+        {
+            live[lane] = 0;
+            u[lane] = 0.0f;
+            up[lane] = 0.0f;
+            phi[lane] = 0.0f;
+            return;
+        }
+
+        const std::size_t i = next++;
+        slot[lane] = i;
+        live[lane] = -1;
+        u[lane] = rays.u[i];
+        up[lane] = rays.up[i];
+        phi[lane] = rays.phi[i];
+        phiStart[lane] = rays.phi[i];
+        h[lane] = k.initialStep;
+        inverseImpactSq[lane] = rays.up[i] * rays.up[i] + rays.u[i] * rays.u[i] * (1.0f - k.Rs * rays.u[i]);
+        const float n1 = rays.e1x[i] * k.diskNormal[0] + rays.e1y[i] * k.diskNormal[1] + rays.e1z[i] * k.diskNormal[2];
+        const float n2 = rays.e2x[i] * k.diskNormal[0] + rays.e2y[i] * k.diskNormal[1] + rays.e2z[i] * k.diskNormal[2];
+        crossing[lane] = nextDiskCrossing(n1, n2, rays.phi[i], normalLengthSq);
+        steps[lane] = 0;
+        ++liveCount;
+    };
+
+    auto retire = [&](int lane, Termination reason) {
+        const std::size_t i = slot[lane];
+        rays.u[i] = u[lane];
+        rays.up[i] = up[lane];
+        rays.phi[i] = phi[lane];
+        rays.termination[i] = static_cast<std::uint8_t>(reason);
+        rays.steps[i] = static_cast<std::uint32_t>(steps[lane]);
+        --liveCount;
+        load(lane);
+    };
+
+    for (int lane = 0; lane < W; ++lane)
+    {
+        load(lane);
+    }
+
+    const float M = k.M;
+    const bool adaptive = k.adaptive != 0;
+    const float escapeU = 1.0f / k.escapeRadius;
+
+    // Crossed lanes whose crossing lies inside the annulus move onto it and retire as
+    // disk hits; the others wait for the next crossing, pi further on.
+    auto landCrossings = [&](I crossed, F planeU, F planeUp, F &nextU, F &nextUp, F &nextPhi) {
+        const F planeR = 1.0f / (planeU > KERNEL_EPSILON ? planeU : splat<W>(KERNEL_EPSILON));
+        landed = crossed & (planeR >= k.diskInnerRadius) & (planeR <= k.diskOuterRadius);
+        nextU = landed ? planeU : nextU;
+        nextUp = landed ? planeUp : nextUp;
+        nextPhi = landed ? crossing : nextPhi;
+        crossing = crossed & ~landed ? crossing + 3.14159265358979f : crossing;
+    };
+
+    while (liveCount > 0)
+    {
+        // Termination tests on the current state, same order as trace_ray()
+        const F uc = u > KERNEL_EPSILON ? u : splat<W>(KERNEL_EPSILON);
+        const F r = 1.0f / uc;
+
+        const I horizon = r <= k.horizonRadius;
+        const I disk = landed;
+        const I escape = r >= k.escapeRadius;
+        const I captured = (up > 0.0f) & (inverseImpactSq > k.criticalInverseImpactSq) & (r < k.earlyCaptureRadius);
+        const I flung = (up < 0.0f) & (r > k.earlyEscapeRadius);
+        const I overBudget = adaptive ? (phi - phiStart >= k.phiBudget) : I{};
+        const I done = (horizon | disk | escape | captured | flung | overBudget) & live;
+
+        if (anyLane<W>(done))
+        {
+            for (int lane = 0; lane < W; ++lane)
+            {
+                if (done[lane] == 0)
+                {
+                    continue;
+                }
+
+                Termination reason = Termination::StepLimit;
+                if (horizon[lane] != 0)
+                {
+                    reason = Termination::Horizon;
+                }
+                else if (disk[lane] != 0)
+                {
+                    reason = Termination::Disk;
+                }
+                else if (escape[lane] != 0)
+                {
+                    reason = Termination::Escape;
+                }
+                else if (captured[lane] != 0)
+                {
+                    reason = Termination::Horizon;
+                }
+                else if (flung[lane] != 0)
+                {
+                    phi[lane] += escapeAngle(u[lane], up[lane], k.Rs, escapeU);
+                    u[lane] = 0.0f;
+                    reason = Termination::Escape;
+                }
+                retire(lane, reason);
+            }
+
+            // Refilled lanes must be tested before their first step.
+            continue;
+        }
+
+        if (adaptive)
+        {
+            F nextU;
+            F nextUp;
+            F errorU;
+            F errorUp;
+            dormandPrinceStep<W>(u, up, h, M, nextU, nextUp, errorU, errorUp);
+
+            const F scale = k.tolerance * maximum<W>(absolute<W>(u) + absolute<W>(up),
+                                                     absolute<W>(nextU) + absolute<W>(nextUp));
+            const F errorNorm = (absolute<W>(errorU) + absolute<W>(errorUp)) /
+                                maximum<W>(scale, splat<W>(KERNEL_EPSILON));
+            const F factor = stepScale<W>(errorNorm);
+            const I accepted = (errorNorm <= 1.0f) | (h <= k.minStep);
+
+            const I commit = accepted & live;
+            F nextPhi = phi + h;
+            const I crossed = commit & (crossing <= nextPhi);
+            if (anyLane<W>(crossed))
+            {
+                // A shorter step from the same point lands exactly on the disk plane.
+                F planeU;
+                F planeUp;
+                F planeErrorU;
+                F planeErrorUp;
+                dormandPrinceStep<W>(u, up, crossed ? crossing - phi : h, M, planeU, planeUp, planeErrorU, planeErrorUp);
+                landCrossings(crossed, planeU, planeUp, nextU, nextUp, nextPhi);
+            }
+
+            // Escaping lanes pull phi back to where u reached 1 / r_escape.
+            const I escaped = commit & ~landed & (nextU <= escapeU) & (nextUp < 0.0f);
+            nextPhi = escaped ? nextPhi - (nextU - escapeU) / nextUp : nextPhi;
+            nextU = escaped ? splat<W>(0.0f) : nextU;
+
+            const F grownStep = minimum<W>(h * factor, splat<W>(k.maxStep));
+            h = commit ? grownStep : maximum<W>(h * factor, splat<W>(k.minStep));
+
+            u = commit ? nextU : u;
+            up = commit ? nextUp : up;
+            phi = commit ? nextPhi : phi;
+        }
+        else
+        {
+            const F dphi = splat<W>(k.dphi);
+            F nextU;
+            F nextUp;
+            rk4Step<W>(u, up, dphi, M, nextU, nextUp);
+
+            F nextPhi = phi + dphi;
+            const I crossed = live & (crossing <= nextPhi);
+            if (anyLane<W>(crossed))
+            {
+                F planeU;
+                F planeUp;
+                rk4Step<W>(u, up, crossed ? crossing - phi : dphi, M, planeU, planeUp);
+                landCrossings(crossed, planeU, planeUp, nextU, nextUp, nextPhi);
+            }
+
+            u = nextU;
+            up = nextUp;
+            phi = nextPhi;
+        }
+        // Lanes moved onto a disk crossing retire without counting the partial step,
+        // as in Geodesic::integrateRay.
+        steps += 1 + landed;
+
+        const I exhausted = (steps >= k.maxSteps) & live & ~landed;
+        if (anyLane<W>(exhausted))
+        {
+            for (int lane = 0; lane < W; ++lane)
+            {
+                if (exhausted[lane] != 0)
+                {
+                    retire(lane, Termination::StepLimit);
+                }
+            }
+        }
+    }
+}
+}
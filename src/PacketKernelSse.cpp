@@ -0,0 +1,7 @@
+// Compiled with the matching -m flags; see CMakeLists.txt.
+#include "PacketKernelImpl.h"
+
+void PacketKernel::detail::integrateSse(const Constants &constants, const RayStreams &rays)
+{
+    integratePackets<4>(constants, rays);
+}
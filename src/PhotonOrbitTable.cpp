@@ -0,0 +1,348 @@
+#include "PhotonOrbitTable.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <system_error>
+
+namespace
+{
+constexpr float PI = 3.14159265358979f;
+constexpr float ROW_SPACING = PI / static_cast<float>(PhotonOrbitTable::ANGLE_COUNT);
+constexpr std::uint32_t CACHE_VERSION = 1;
+const char CACHE_MAGIC[8] = {'B', 'H', 'O', 'R', 'B', 'I', 'T', 'S'};
+const char CACHE_PREFIX[] = "photon-orbits-r";
+
+struct CacheHeader
+{
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t angleCount;
+    std::uint32_t columnCount;
+    float phiSample;
+    float radius;
+};
+
+// phi0 at the centre of row i; the exactly radial rays at -pi and 0 are left out.
+float rowAngle(int row)
+{
+    return -PI + (static_cast<float>(row) + 0.5f) * ROW_SPACING;
+}
+
+// Keeps the most recently used tables and drops the rest.
+void pruneCache(const std::filesystem::path &cacheDirectory)
+{
+    std::error_code error;
+    std::vector<std::pair<std::filesystem::file_time_type, std::filesystem::path>> tables;
+    for (const auto &entry : std::filesystem::directory_iterator(cacheDirectory, error))
+    {
+        const std::string name = entry.path().filename().string();
+        if (name.rfind(CACHE_PREFIX, 0) == 0)
+        {
+            tables.emplace_back(entry.last_write_time(error), entry.path());
+        }
+    }
+
+    if (tables.size() <= static_cast<std::size_t>(PhotonOrbitTable::MAX_CACHED_TABLES))
+    {
+        return;
+    }
+
+    std::sort(tables.begin(), tables.end(), [](const auto &a, const auto &b) { return a.first > b.first; });
+    for (std::size_t i = PhotonOrbitTable::MAX_CACHED_TABLES; i < tables.size(); ++i)
+    {
+        std::filesystem::remove(tables[i].second, error);
+    }
+}
+}
+
+PhotonOrbitTable::PhotonOrbitTable() : radius(0.0f), loadedFromCache(false), saved(true)
+{
+}
+
+bool PhotonOrbitTable::prepare(float cameraRadius, const std::filesystem::path &cacheDirectory)
+{
+    if (isReady() && radius == cameraRadius)
+    {
+        return false;
+    }
+
+    if (!cacheDirectory.empty() && load(cachePath(cacheDirectory, cameraRadius), cameraRadius))
+    {
+        return true;
+    }
+
+    build(cameraRadius);
+    return true;
+}
+
+void PhotonOrbitTable::persist(const std::filesystem::path &cacheDirectory)
+{
+    if (saved || !isReady() || cacheDirectory.empty())
+    {
+        return;
+    }
+
+    std::error_code error;
+    std::filesystem::create_directories(cacheDirectory, error);
+    if (save(cachePath(cacheDirectory, radius)))
+    {
+        pruneCache(cacheDirectory);
+    }
+    saved = true;
+}
+
+void PhotonOrbitTable::build(float cameraRadius)
+{
+    radius = cameraRadius;
+    loadedFromCache = false;
+    saved = false;
+    rows.assign(ANGLE_COUNT, Row{});
+    samples.assign(static_cast<std::size_t>(ANGLE_COUNT) * COLUMN_COUNT, glm::vec2(0.0f));
+
+    // Binet equation with Rs = 1
+    const float M = 0.5f;
+    const float horizonU = 1.0f / (1.0f + Geodesic::EPSILON_HORIZON);
+    const float escapeU = 1.0f / std::max(cameraRadius, TABLE_RADIUS);
+    const float h = PHI_SAMPLE / static_cast<float>(SUBSTEPS);
+
+    for (int i = 0; i < ANGLE_COUNT; ++i)
+    {
+        // setupPrimaryRay() for a ray along e1 from polar angle phi0: vr = cos(phi0),
+        // vphi = -sin(phi0) / r0
+        const float phi0 = rowAngle(i);
+        glm::vec2 y(1.0f / cameraRadius, std::cos(phi0) / (cameraRadius * std::sin(phi0)));
+
+        glm::vec2 *rowSamples = samples.data() + static_cast<std::size_t>(i) * COLUMN_COUNT;
+        Row row{static_cast<float>(Termination::StepLimit), Geodesic::PHI_BUDGET, (COLUMN_COUNT - 1) * PHI_SAMPLE};
+        rowSamples[0] = y;
+
+        int column = 0;
+        for (;;)
+        {
+            // Escapes are only taken on a column, so the last sample is already
+            // outgoing beyond every disk the table can serve.
+            const float angle = static_cast<float>(column) * PHI_SAMPLE;
+            if (y.y < 0.0f && y.x <= escapeU)
+            {
+                row = Row{static_cast<float>(Termination::Escape), angle + Geodesic::escapeAngle(y.x, y.y, 1.0f), angle};
+                break;
+            }
+            if (column == COLUMN_COUNT - 1)
+            {
+                break;
+            }
+
+            bool captured = false;
+            for (int step = 0; step < SUBSTEPS; ++step)
+            {
+                const glm::vec2 next = Geodesic::rk4Step(y, h, M);
+                if (next.x >= horizonU)
+                {
+                    const float fraction = (horizonU - y.x) / (next.x - y.x);
+                    row = Row{static_cast<float>(Termination::Horizon),
+                              angle + (static_cast<float>(step) + fraction) * h, angle};
+                    captured = true;
+                    break;
+                }
+                y = next;
+            }
+            if (captured)
+            {
+                break;
+            }
+
+            rowSamples[++column] = y;
+        }
+
+        std::fill(rowSamples + column + 1, rowSamples + COLUMN_COUNT, rowSamples[column]);
+        rows[static_cast<std::size_t>(i)] = row;
+    }
+}
+
+bool PhotonOrbitTable::load(const std::filesystem::path &path, float cameraRadius)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+    {
+        return false;
+    }
+
+    CacheHeader header{};
+    file.read(reinterpret_cast<char *>(&header), sizeof(header));
+    if (!file || std::memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0 ||
+        header.version != CACHE_VERSION || header.angleCount != ANGLE_COUNT || header.columnCount != COLUMN_COUNT ||
+        header.phiSample != PHI_SAMPLE || header.radius != cameraRadius)
+    {
+        std::cerr << "Ignoring stale photon orbit table " << path << std::endl;
+        return false;
+    }
+
+    std::vector<Row> loadedRows(ANGLE_COUNT);
+    std::vector<glm::vec2> loadedSamples(static_cast<std::size_t>(ANGLE_COUNT) * COLUMN_COUNT);
+    file.read(reinterpret_cast<char *>(loadedRows.data()),
+              static_cast<std::streamsize>(loadedRows.size() * sizeof(Row)));
+    file.read(reinterpret_cast<char *>(loadedSamples.data()),
+              static_cast<std::streamsize>(loadedSamples.size() * sizeof(glm::vec2)));
+    if (!file)
+    {
+        std::cerr << "Truncated photon orbit table " << path << std::endl;
+        return false;
+    }
+
+    radius = cameraRadius;
+    loadedFromCache = true;
+    saved = true;
+    rows = std::move(loadedRows);
+    samples = std::move(loadedSamples);
+
+    // Marks the table as recently used for pruneCache().
+    std::error_code error;
+    std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now(), error);
+    return true;
+}
+
+bool PhotonOrbitTable::save(const std::filesystem::path &path) const
+{
+    std::ofstream file(path, std::ios::binary);
+    if (!file)
+    {
+        std::cerr << "Error opening file for writing: " << path << std::endl;
+        return false;
+    }
+
+    CacheHeader header{};
+    std::memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    header.version = CACHE_VERSION;
+    header.angleCount = ANGLE_COUNT;
+    header.columnCount = COLUMN_COUNT;
+    header.phiSample = PHI_SAMPLE;
+    header.radius = radius;
+
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char *>(rows.data()), static_cast<std::streamsize>(rows.size() * sizeof(Row)));
+    file.write(reinterpret_cast<const char *>(samples.data()),
+               static_cast<std::streamsize>(samples.size() * sizeof(glm::vec2)));
+    if (!file)
+    {
+        std::cerr << "Failed while writing " << path << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+std::filesystem::path PhotonOrbitTable::cachePath(const std::filesystem::path &cacheDirectory, float cameraRadius)
+{
+    // %.9g round-trips a float, so each cached table belongs to exactly one radius.
+    char name[64];
+    std::snprintf(name, sizeof(name), "%s%.9g.bin", CACHE_PREFIX, static_cast<double>(cameraRadius));
+    return cacheDirectory / name;
+}
+
+bool PhotonOrbitTable::trace(const TracerParameters &params, const Geodesic::PrimaryRay &ray,
+                             Termination &termination, float &u, float &phi) const
+{
+    const float r0 = 1.0f / std::max(ray.u0, Geodesic::EPSILON);
+    if (!isReady() || std::abs(r0 / params.Rs - radius) > 1e-4f * radius)
+    {
+        return false;
+    }
+
+    const DiskParameters &disk = params.disk;
+
+    // Neighbouring rows must agree on the outcome; near the critical impact
+    // parameter they wind around the photon sphere by very different amounts.
+    const float position = (glm::clamp(ray.phi0, -PI, 0.0f) + PI) / ROW_SPACING - 0.5f;
+    const int first = glm::clamp(static_cast<int>(std::floor(position)), 0, ANGLE_COUNT - 2);
+    const float weight = glm::clamp(position - static_cast<float>(first), 0.0f, 1.0f);
+    const Row &a = rows[static_cast<std::size_t>(first)];
+    const Row &b = rows[static_cast<std::size_t>(first) + 1];
+    if (a.termination != b.termination || a.termination == static_cast<float>(Termination::StepLimit) ||
+        std::abs(a.endAngle - b.endAngle) > MAX_ROW_GAP)
+    {
+        return false;
+    }
+    const float endAngle = glm::mix(a.endAngle, b.endAngle, weight);
+    const bool escapes = a.termination == static_cast<float>(Termination::Escape);
+
+    // (u, du/dphi) along the blended orbit, in units of 1/length; false past the
+    // last sample of either row.
+    auto orbitAt = [&](float angle, glm::vec2 &y) {
+        glm::vec2 ya;
+        glm::vec2 yb;
+        const bool sampledA = sampleAt(first, angle - ray.phi0, ya);
+        const bool sampledB = sampleAt(first + 1, angle - ray.phi0, yb);
+        y = glm::mix(ya, yb, weight) / params.Rs;
+        return sampledA && sampledB;
+    };
+
+    // Same crossings as the integrator; only the orbit's radius there comes from the
+    // table. The interpolated orbit is good to a fraction of a percent in r, so
+    // crossings that close to an annulus edge could go either way.
+    const float end = ray.phi0 + endAngle;
+    for (float crossing = Geodesic::nextDiskCrossing(params, ray, ray.phi0); crossing < end; crossing += PI)
+    {
+        glm::vec2 y;
+        const bool sampled = orbitAt(crossing, y);
+        const float crossingR = 1.0f / std::max(y.x, Geodesic::EPSILON);
+        if (!sampled)
+        {
+            // Past the last sample escapes only move outwards and captures inwards.
+            if (escapes ? crossingR > disk.outerRadius * (1.0f + EDGE_MARGIN)
+                        : crossingR < disk.innerRadius * (1.0f - EDGE_MARGIN))
+            {
+                continue;
+            }
+            return false;
+        }
+
+        if (crossingR >= disk.innerRadius * (1.0f + EDGE_MARGIN) && crossingR <= disk.outerRadius * (1.0f - EDGE_MARGIN))
+        {
+            termination = Termination::Disk;
+            u = y.x;
+            phi = crossing;
+            return true;
+        }
+        if (crossingR * (1.0f + EDGE_MARGIN) >= disk.innerRadius && crossingR * (1.0f - EDGE_MARGIN) <= disk.outerRadius)
+        {
+            return false;
+        }
+    }
+
+    termination = escapes ? Termination::Escape : Termination::Horizon;
+    u = 0.0f;
+    phi = end;
+    return true;
+}
+
+// Cubic Hermite interpolation of (u, du/dphi) between columns, with du/dphi as
+// the slopes. Past the row's last sample y holds that sample and the result is false.
+bool PhotonOrbitTable::sampleAt(int row, float angle, glm::vec2 &y) const
+{
+    const Row &info = rows[static_cast<std::size_t>(row)];
+    const glm::vec2 *rowSamples = samples.data() + static_cast<std::size_t>(row) * COLUMN_COUNT;
+    if (angle > info.sampledAngle)
+    {
+        y = rowSamples[static_cast<int>(info.sampledAngle / PHI_SAMPLE + 0.5f)];
+        return false;
+    }
+
+    const float position = std::max(angle, 0.0f) / PHI_SAMPLE;
+    const int column = std::min(static_cast<int>(position), COLUMN_COUNT - 2);
+    const float t = position - static_cast<float>(column);
+    const glm::vec2 y0 = rowSamples[column];
+    const glm::vec2 y1 = rowSamples[column + 1];
+
+    const float t2 = t * t;
+    const float t3 = t2 * t;
+    y.x = (2.0f * t3 - 3.0f * t2 + 1.0f) * y0.x + (t3 - 2.0f * t2 + t) * PHI_SAMPLE * y0.y +
+          (-2.0f * t3 + 3.0f * t2) * y1.x + (t3 - t2) * PHI_SAMPLE * y1.y;
+    y.y = (6.0f * t2 - 6.0f * t) * (y0.x - y1.x) / PHI_SAMPLE + (3.0f * t2 - 4.0f * t + 1.0f) * y0.y +
+          (3.0f * t2 - 2.0f * t) * y1.y;
+    return true;
+}
@@ -0,0 +1,130 @@
+#include "Profiler.h"
+
+#include <array>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace
+{
+struct Event
+{
+    const char *name;
+    std::uint64_t begin;
+    std::uint64_t end;
+};
+
+constexpr std::size_t BLOCK_EVENTS = 4096;
+constexpr std::size_t MAX_BLOCKS = 256;     // about a million zones per thread
+
+// Only its own thread writes a buffer. Blocks are allocated as they fill and never
+// move, and count is published after the event, so writeTrace() can read up to
+// count while the thread keeps going.
+struct ThreadBuffer
+{
+    unsigned int threadId = 0;
+    std::array<std::unique_ptr<Event[]>, MAX_BLOCKS> blocks;
+    std::atomic<std::size_t> count{0};
+    std::atomic<std::uint64_t> dropped{0};
+};
+
+std::mutex registryMutex;
+std::vector<std::unique_ptr<ThreadBuffer>> registry;
+std::atomic<std::uint64_t> origin{0};
+
+// Buffers belong to the registry so a trace can still include threads that exited.
+ThreadBuffer *registerThread()
+{
+    std::lock_guard<std::mutex> lock(registryMutex);
+    registry.push_back(std::make_unique<ThreadBuffer>());
+    registry.back()->threadId = static_cast<unsigned int>(registry.size() - 1);
+    return registry.back().get();
+}
+
+ThreadBuffer &threadBuffer()
+{
+    thread_local ThreadBuffer *buffer = registerThread();
+    return *buffer;
+}
+}
+
+void Profiler::enable()
+{
+    threadBuffer();
+    origin.store(now(), std::memory_order_relaxed);
+    detail::enabled.store(true, std::memory_order_relaxed);
+}
+
+void Profiler::record(const char *name, std::uint64_t begin, std::uint64_t end)
+{
+    ThreadBuffer &buffer = threadBuffer();
+    const std::size_t index = buffer.count.load(std::memory_order_relaxed);
+    if (index >= BLOCK_EVENTS * MAX_BLOCKS)
+    {
+        buffer.dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    std::unique_ptr<Event[]> &block = buffer.blocks[index / BLOCK_EVENTS];
+    if (!block)
+    {
+        block = std::make_unique<Event[]>(BLOCK_EVENTS);
+    }
+    block[index % BLOCK_EVENTS] = Event{name, begin, end};
+    buffer.count.store(index + 1, std::memory_order_release);
+}
+
+bool Profiler::writeTrace(const std::filesystem::path &path)
+{
+    std::ofstream file(path);
+    if (!file)
+    {
+        std::cerr << "Failed to open " << path.string() << " for writing." << std::endl;
+        return false;
+    }
+
+    const std::uint64_t start = origin.load(std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lock(registryMutex);
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n" << std::fixed << std::setprecision(3);
+    bool first = true;
+    for (const std::unique_ptr<ThreadBuffer> &buffer : registry)
+    {
+        file << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->threadId
+             << ",\"args\":{\"name\":\"" << (buffer->threadId == 0 ? "main" : "thread " + std::to_string(buffer->threadId))
+             << "\"}}";
+        first = false;
+
+        const std::size_t count = buffer->count.load(std::memory_order_acquire);
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            const Event &event = buffer->blocks[i / BLOCK_EVENTS][i % BLOCK_EVENTS];
+            if (event.begin < start)
+            {
+                continue;
+            }
+
+            // Trace timestamps and durations are in microseconds.
+            file << ",\n{\"name\":\"" << event.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->threadId
+                 << ",\"ts\":" << static_cast<double>(event.begin - start) * 1e-3
+                 << ",\"dur\":" << static_cast<double>(event.end - event.begin) * 1e-3 << "}";
+        }
+    }
+    file << "\n]}\n";
+
+    return static_cast<bool>(file);
+}
+
+std::uint64_t Profiler::getDroppedZones()
+{
+    std::lock_guard<std::mutex> lock(registryMutex);
+    std::uint64_t dropped = 0;
+    for (const std::unique_ptr<ThreadBuffer> &buffer : registry)
+    {
+        dropped += buffer->dropped.load(std::memory_order_relaxed);
+    }
+
+    return dropped;
+}
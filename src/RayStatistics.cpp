@@ -0,0 +1,104 @@
+#include "RayStatistics.h"
+
+#include <cmath>
+#include <cstring>
+
+#include "Geodesic.h"
+
+void RayStatistics::add(unsigned int raySteps, Termination termination)
+{
+    steps += raySteps;
+    ++rays;
+    ++terminations[static_cast<std::size_t>(termination)];
+    ++histogram[static_cast<std::size_t>(bin(raySteps))];
+}
+
+void RayStatistics::merge(const RayStatistics &other)
+{
+    steps += other.steps;
+    rays += other.rays;
+    for (int i = 0; i < TERMINATION_COUNT; ++i)
+    {
+        terminations[static_cast<std::size_t>(i)] += other.terminations[static_cast<std::size_t>(i)];
+    }
+    for (int i = 0; i < BIN_COUNT; ++i)
+    {
+        histogram[static_cast<std::size_t>(i)] += other.histogram[static_cast<std::size_t>(i)];
+    }
+}
+
+int RayStatistics::bin(unsigned int raySteps)
+{
+    int result = 0;
+    while (raySteps > 0 && result < BIN_COUNT - 1)
+    {
+        raySteps >>= 1;
+        ++result;
+    }
+    return result;
+}
+
+unsigned int RayStatistics::binStart(int bin)
+{
+    return bin == 0 ? 0u : 1u << (bin - 1);
+}
+
+const char *debugViewName(DebugView view)
+{
+    switch (view)
+    {
+    case DebugView::None:
+        return "none";
+    case DebugView::Steps:
+        return "steps";
+    case DebugView::Termination:
+        return "termination";
+    }
+
+    return "unknown";
+}
+
+bool parseDebugView(const char *name, DebugView &view)
+{
+    const DebugView all[] = {DebugView::None, DebugView::Steps, DebugView::Termination};
+    for (const DebugView candidate : all)
+    {
+        if (std::strcmp(name, debugViewName(candidate)) == 0)
+        {
+            view = candidate;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+glm::vec3 debugColor(DebugView view, unsigned int raySteps, Termination termination)
+{
+    if (termination == Termination::StepLimit)
+    {
+        return glm::vec3(1.0f, 0.0f, 1.0f);
+    }
+
+    if (view == DebugView::Termination)
+    {
+        switch (termination)
+        {
+        case Termination::Horizon:
+            return glm::vec3(0.15f);
+        case Termination::Disk:
+            return glm::vec3(1.0f, 0.55f, 0.1f);
+        default:
+            return glm::vec3(0.15f, 0.35f, 1.0f);
+        }
+    }
+
+    // Black, blue, red, yellow, white at even steps of log2(1 + steps)
+    const glm::vec3 stops[5] = {glm::vec3(0.0f), glm::vec3(0.1f, 0.1f, 0.6f), glm::vec3(0.8f, 0.1f, 0.2f),
+                                glm::vec3(1.0f, 0.8f, 0.1f), glm::vec3(1.0f)};
+    const float t = std::log2(1.0f + static_cast<float>(raySteps)) /
+                    std::log2(1.0f + static_cast<float>(Geodesic::MAX_PHI_STEPS));
+    const float position = glm::clamp(t, 0.0f, 1.0f) * 4.0f;
+    const int stop = glm::min(static_cast<int>(position), 3);
+    return glm::mix(stops[stop], stops[stop + 1], position - static_cast<float>(stop));
+}
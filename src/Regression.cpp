@@ -0,0 +1,68 @@
+#include "Regression.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+bool Regression::parseTest(const char *name, Test &test)
+{
+    if (std::strcmp(name, "disk-crossing") == 0)
+    {
+        test = Test::DiskCrossing;
+        return true;
+    }
+    if (std::strcmp(name, "analytic") == 0)
+    {
+        test = Test::Analytic;
+        return true;
+    }
+    return false;
+}
+
+const char *Regression::testName(Test test)
+{
+    switch (test)
+    {
+    case Test::None:
+        return "none";
+    case Test::DiskCrossing:
+        return "disk-crossing";
+    case Test::Analytic:
+        return "analytic";
+    }
+    return "unknown";
+}
+
+Regression::ImageDifference Regression::compare(const std::vector<glm::vec4> &reference, const std::vector<glm::vec4> &image)
+{
+    ImageDifference difference{};
+    difference.pixelCount = std::min(reference.size(), image.size());
+
+    double sumSq = 0.0;
+    for (std::size_t i = 0; i < difference.pixelCount; ++i)
+    {
+        const glm::vec3 delta = glm::abs(glm::vec3(reference[i]) - glm::vec3(image[i]));
+        const float largest = std::max({delta.r, delta.g, delta.b});
+        sumSq += static_cast<double>(largest) * static_cast<double>(largest);
+        difference.maxDifference = std::max(difference.maxDifference, largest);
+        if (largest > DIFFERENCE_THRESHOLD)
+        {
+            ++difference.differingPixels;
+        }
+    }
+
+    difference.rms = difference.pixelCount > 0 ? std::sqrt(sumSq / static_cast<double>(difference.pixelCount)) : 0.0;
+    return difference;
+}
+
+double Regression::differingFraction(const ImageDifference &difference)
+{
+    return difference.pixelCount > 0
+               ? static_cast<double>(difference.differingPixels) / static_cast<double>(difference.pixelCount)
+               : 0.0;
+}
+
+bool Regression::isWithin(const ImageDifference &difference, const Tolerance &tolerance)
+{
+    return difference.rms <= tolerance.rms && differingFraction(difference) <= tolerance.differingFraction;
+}
@@ -0,0 +1,157 @@
+#include "RenderSetup.h"
+
+#include <chrono>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "AppPaths.h"
+#include "Camera.h"
+#include "Geodesic.h"
+#include "ImageWriter.h"
+#include "PhotonOrbitTable.h"
+#include "RenderTarget.h"
+#include "StarfieldCubemap.h"
+#include "shader.h"
+
+glm::mat4 RenderSetup::inverseProjection(const glm::ivec2 &resolution, float fov)
+{
+    const glm::mat4 projection = glm::perspective(
+        glm::radians(fov),
+        static_cast<float>(resolution.x) / static_cast<float>(resolution.y),
+        0.1f,
+        100.0f);
+    return glm::inverse(projection);
+}
+
+float RenderSetup::weakFieldImpact(const glm::ivec2 &resolution, const glm::mat4 &invProjection,
+                                   const CommandLine::Options &options)
+{
+    const float pixelAngle = 2.0f * invProjection[1][1] / static_cast<float>(resolution.y);
+    return Geodesic::weakFieldImpactParameter(SCHWARZSCHILD_RADIUS, pixelAngle, options.weakFieldBudget);
+}
+
+TracerParameters RenderSetup::tracerParameters(const glm::ivec2 &resolution, const glm::mat4 &invProjection,
+                                               const Camera &camera, const DiskParameters &disk,
+                                               const CommandLine::Options &options, const PhotonOrbitTable *orbitTable,
+                                               const StarfieldCubemap *starfield, const DiskEmissionMap *diskEmission)
+{
+    TracerParameters params{};
+    params.resolution = resolution;
+    params.cameraPos = camera.getPosition();
+    params.invProjection = invProjection;
+    params.invView = camera.invViewMatrix();
+    params.bhCenter = BLACK_HOLE_POSITION;
+    params.Rs = SCHWARZSCHILD_RADIUS;
+    params.disk = disk;
+    params.integrator = options.integrator;
+    params.tolerance = options.tolerance;
+    params.orbitTable = orbitTable;
+    params.diskTest = DiskTest::Crossing;
+    params.weakFieldImpact = weakFieldImpact(resolution, invProjection, options);
+    params.classifyTiles = options.classifyTiles;
+    params.starfield = starfield;
+    params.diskEmission = diskEmission;
+    params.debugView = options.debugView;
+    return params;
+}
+
+const StarfieldCubemap *RenderSetup::prepareStarfield(StarfieldCubemap &starfield, const CommandLine::Options &options)
+{
+    if (options.skySize <= 0)
+    {
+        return nullptr;
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    starfield.prepare(options.skySize, AppPaths::cacheDirectory(), options.cpuThreads);
+    const double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Starfield cubemap " << starfield.getFaceSize() << "x" << starfield.getFaceSize() << " "
+              << (starfield.wasLoadedFromCache() ? "loaded" : "baked") << " in " << std::fixed << std::setprecision(1)
+              << milliseconds << std::defaultfloat << " ms." << std::endl;
+    return &starfield;
+}
+
+float RenderSetup::orbitTableRadius(const Camera &camera)
+{
+    return glm::length(camera.getPosition() - BLACK_HOLE_POSITION) / SCHWARZSCHILD_RADIUS;
+}
+
+void RenderSetup::prepareOrbitTable(PhotonOrbitTable &orbitTable, const Camera &camera)
+{
+    const auto start = std::chrono::steady_clock::now();
+    orbitTable.prepare(orbitTableRadius(camera), AppPaths::cacheDirectory());
+    const double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Photon orbit table for r = " << orbitTable.getRadius() << " Rs "
+              << (orbitTable.wasLoadedFromCache() ? "loaded" : "integrated") << " in " << std::fixed
+              << std::setprecision(1) << milliseconds << std::defaultfloat << " ms." << std::endl;
+    orbitTable.persist(AppPaths::cacheDirectory());
+}
+
+bool RenderSetup::countsSteps(const CommandLine::Options &options)
+{
+    return options.stepStats || !options.benchmarkPath.empty() || options.debugView == DebugView::Steps;
+}
+
+std::vector<std::string> RenderSetup::shaderDefines(const CommandLine::Options &options)
+{
+    std::vector<std::string> defines = RenderTarget::shaderDefines(options.outputFormat);
+    if (countsSteps(options))
+    {
+        defines.push_back("STEP_COUNTER 1");
+    }
+    return defines;
+}
+
+void RenderSetup::configureComputeShader(const Shader &computeShader, const glm::ivec2 &resolution,
+                                         const glm::mat4 &invProjection, const CommandLine::Options &options,
+                                         bool useStarfieldMap)
+{
+    computeShader.setUniform2i("resolutionVector", resolution);
+    computeShader.setUniformMatrix4fv("invProjection", invProjection);
+    computeShader.setUniform1f("weakFieldImpact", weakFieldImpact(resolution, invProjection, options));
+    computeShader.setUniform1i("integratorMode", static_cast<int>(options.integrator));
+    computeShader.setUniform1f("integratorTolerance", options.tolerance);
+    computeShader.setUniform1i("classifyTiles", options.classifyTiles ? 1 : 0);
+    computeShader.setUniform1i("debugView", static_cast<int>(options.debugView));
+    if (options.integrator == Integrator::OrbitTable)
+    {
+        computeShader.setUniform1i("orbitSamples", static_cast<int>(ORBIT_SAMPLES_UNIT));
+        computeShader.setUniform1i("orbitRows", static_cast<int>(ORBIT_ROWS_UNIT));
+    }
+
+    computeShader.setUniform1i("useStarfieldMap", useStarfieldMap ? 1 : 0);
+    if (useStarfieldMap)
+    {
+        computeShader.setUniform1i("starfieldMap", static_cast<int>(STARFIELD_UNIT));
+    }
+
+    computeShader.setUniform1i("diskEmissionMap", static_cast<int>(DISK_EMISSION_UNIT));
+    computeShader.setUniform1i("blackbodyColors", static_cast<int>(BLACKBODY_UNIT));
+}
+
+Camera RenderSetup::outputCamera(const CommandLine::Options &options)
+{
+    Camera camera(glm::vec3(0.0f, 0.0f, 5.0f));
+    if (options.preset > 0)
+    {
+        camera.applyPreset(options.preset - 1);
+    }
+    return camera;
+}
+
+bool RenderSetup::writeOutput(const CommandLine::Options &options, const std::vector<glm::vec4> &image,
+                              const glm::ivec2 &resolution)
+{
+    return std::filesystem::path(options.outputPath).extension() == ".exr"
+               ? ImageWriter::writeExr(options.outputPath, image, resolution.x, resolution.y)
+               : ImageWriter::writePfm(options.outputPath, image, resolution.x, resolution.y);
+}
+
+const char *RenderSetup::glString(GLenum name)
+{
+    const GLubyte *value = glGetString(name);
+    return value != nullptr ? reinterpret_cast<const char *>(value) : "";
+}
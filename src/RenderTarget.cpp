@@ -0,0 +1,97 @@
+#include "RenderTarget.h"
+
+#include <cstring>
+
+#include <glad/glad.h>
+
+const char *RenderTarget::formatName(Format format)
+{
+    switch (format)
+    {
+    case Format::Rgba32f:
+        return "rgba32f";
+    case Format::Rgba16f:
+        return "rgba16f";
+    case Format::R11g11b10f:
+        return "r11g11b10f";
+    case Format::Rgb10a2:
+        return "rgb10a2";
+    }
+
+    return "unknown";
+}
+
+bool RenderTarget::parseFormat(const char *name, Format &format)
+{
+    const Format all[] = {Format::Rgba32f, Format::Rgba16f, Format::R11g11b10f, Format::Rgb10a2};
+    for (const Format candidate : all)
+    {
+        if (std::strcmp(name, formatName(candidate)) == 0)
+        {
+            format = candidate;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+unsigned int RenderTarget::internalFormat(Format format)
+{
+    switch (format)
+    {
+    case Format::Rgba16f:
+        return GL_RGBA16F;
+    case Format::R11g11b10f:
+        return GL_R11F_G11F_B10F;
+    case Format::Rgb10a2:
+        return GL_RGB10_A2;
+    default:
+        return GL_RGBA32F;
+    }
+}
+
+const char *RenderTarget::imageQualifier(Format format)
+{
+    switch (format)
+    {
+    case Format::Rgba16f:
+        return "rgba16f";
+    case Format::R11g11b10f:
+        return "r11f_g11f_b10f";
+    case Format::Rgb10a2:
+        return "rgb10_a2";
+    default:
+        return "rgba32f";
+    }
+}
+
+unsigned int RenderTarget::bytesPerPixel(Format format)
+{
+    switch (format)
+    {
+    case Format::Rgba16f:
+        return 8;
+    case Format::R11g11b10f:
+    case Format::Rgb10a2:
+        return 4;
+    default:
+        return 16;
+    }
+}
+
+bool RenderTarget::isNormalized(Format format)
+{
+    return format == Format::Rgb10a2;
+}
+
+std::vector<std::string> RenderTarget::shaderDefines(Format format)
+{
+    std::vector<std::string> defines = {"OUTPUT_FORMAT " + std::string(imageQualifier(format))};
+    if (isNormalized(format))
+    {
+        defines.push_back("OUTPUT_NORMALIZED 1");
+    }
+
+    return defines;
+}
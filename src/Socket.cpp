@@ -0,0 +1,317 @@
+#include "Socket.h"
+
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace
+{
+const char UNIX_PREFIX[] = "unix:";
+constexpr int LISTEN_BACKLOG = 64;
+constexpr std::uint32_t MAX_PAYLOAD = 1u << 30;     // a 16k x 16k tile would still fit
+constexpr std::size_t HEADER_SIZE = 2 * sizeof(std::uint32_t);
+constexpr std::size_t READ_CHUNK = 64 * 1024;       // per MessageReader::read, so one peer can't flood the buffer
+
+bool isUnixAddress(const std::string &address)
+{
+    return address.compare(0, sizeof(UNIX_PREFIX) - 1, UNIX_PREFIX) == 0;
+}
+
+bool unixSocketAddress(const std::string &address, sockaddr_un &socketAddress, std::string &error)
+{
+    const std::string path = address.substr(sizeof(UNIX_PREFIX) - 1);
+    socketAddress = sockaddr_un{};
+    socketAddress.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(socketAddress.sun_path))
+    {
+        error = "Invalid Unix socket path: " + address;
+        return false;
+    }
+    std::memcpy(socketAddress.sun_path, path.c_str(), path.size() + 1);
+    return true;
+}
+
+// host:port, resolved for a listening (passive) or connecting socket; an empty host
+// listens on every interface.
+addrinfo *resolve(const std::string &address, bool passive, std::string &error)
+{
+    const std::size_t colon = address.rfind(':');
+    if (colon == std::string::npos || colon + 1 == address.size())
+    {
+        error = "Expected host:port or unix:/path: " + address;
+        return nullptr;
+    }
+
+    const std::string host = address.substr(0, colon);
+    const std::string port = address.substr(colon + 1);
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = passive ? AI_PASSIVE : 0;
+    addrinfo *results = nullptr;
+    const int status = getaddrinfo(host.empty() ? nullptr : host.c_str(), port.c_str(), &hints, &results);
+    if (status != 0)
+    {
+        error = "Failed to resolve " + address + ": " + gai_strerror(status);
+        return nullptr;
+    }
+    return results;
+}
+}
+
+Socket &Socket::operator=(Socket &&other) noexcept
+{
+    if (this != &other)
+    {
+        close();
+        fd = other.fd;
+        other.fd = -1;
+    }
+    return *this;
+}
+
+Socket Socket::listen(const std::string &address, std::string &error)
+{
+    if (isUnixAddress(address))
+    {
+        sockaddr_un socketAddress;
+        if (!unixSocketAddress(address, socketAddress, error))
+        {
+            return Socket();
+        }
+
+        Socket socket(::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0));
+        ::unlink(socketAddress.sun_path);
+        if (!socket.isValid() ||
+            ::bind(socket.fd, reinterpret_cast<const sockaddr *>(&socketAddress), sizeof(socketAddress)) != 0 ||
+            ::listen(socket.fd, LISTEN_BACKLOG) != 0)
+        {
+            error = "Failed to listen on " + address + ": " + std::strerror(errno);
+            return Socket();
+        }
+        return socket;
+    }
+
+    addrinfo *results = resolve(address, true, error);
+    if (results == nullptr)
+    {
+        return Socket();
+    }
+
+    Socket socket;
+    for (addrinfo *candidate = results; candidate != nullptr && !socket.isValid(); candidate = candidate->ai_next)
+    {
+        Socket attempt(::socket(candidate->ai_family, candidate->ai_socktype | SOCK_CLOEXEC, candidate->ai_protocol));
+        const int reuse = 1;
+        if (attempt.isValid() && ::setsockopt(attempt.fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse)) == 0 &&
+            ::bind(attempt.fd, candidate->ai_addr, candidate->ai_addrlen) == 0 &&
+            ::listen(attempt.fd, LISTEN_BACKLOG) == 0)
+        {
+            socket = std::move(attempt);
+        }
+    }
+    freeaddrinfo(results);
+
+    if (!socket.isValid())
+    {
+        error = "Failed to listen on " + address + ": " + std::strerror(errno);
+    }
+    return socket;
+}
+
+Socket Socket::connect(const std::string &address, std::string &error)
+{
+    if (isUnixAddress(address))
+    {
+        sockaddr_un socketAddress;
+        if (!unixSocketAddress(address, socketAddress, error))
+        {
+            return Socket();
+        }
+
+        Socket socket(::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0));
+        if (!socket.isValid() ||
+            ::connect(socket.fd, reinterpret_cast<const sockaddr *>(&socketAddress), sizeof(socketAddress)) != 0)
+        {
+            error = "Failed to connect to " + address + ": " + std::strerror(errno);
+            return Socket();
+        }
+        return socket;
+    }
+
+    addrinfo *results = resolve(address, false, error);
+    if (results == nullptr)
+    {
+        return Socket();
+    }
+
+    Socket socket;
+    for (addrinfo *candidate = results; candidate != nullptr && !socket.isValid(); candidate = candidate->ai_next)
+    {
+        Socket attempt(::socket(candidate->ai_family, candidate->ai_socktype | SOCK_CLOEXEC, candidate->ai_protocol));
+        if (attempt.isValid() && ::connect(attempt.fd, candidate->ai_addr, candidate->ai_addrlen) == 0)
+        {
+            socket = std::move(attempt);
+        }
+    }
+    freeaddrinfo(results);
+
+    if (!socket.isValid())
+    {
+        error = "Failed to connect to " + address + ": " + std::strerror(errno);
+    }
+    return socket;
+}
+
+Socket Socket::accept()
+{
+    int connection = -1;
+    do
+    {
+        connection = ::accept4(fd, nullptr, nullptr, SOCK_CLOEXEC);
+    } while (connection < 0 && errno == EINTR);
+    return Socket(connection);
+}
+
+bool Socket::setNonBlocking()
+{
+    const int flags = ::fcntl(fd, F_GETFL);
+    return flags >= 0 && ::fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+void Socket::close()
+{
+    if (fd >= 0)
+    {
+        ::close(fd);
+        fd = -1;
+    }
+}
+
+bool Socket::sendAll(const void *data, std::size_t size)
+{
+    const char *bytes = static_cast<const char *>(data);
+    while (size > 0)
+    {
+        const ssize_t sent = ::send(fd, bytes, size, MSG_NOSIGNAL);
+        if (sent < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+        {
+            pollfd writable{fd, POLLOUT, 0};
+            ::poll(&writable, 1, -1);
+            continue;
+        }
+        if (sent <= 0)
+        {
+            return false;
+        }
+        bytes += sent;
+        size -= static_cast<std::size_t>(sent);
+    }
+    return true;
+}
+
+bool Socket::receiveAll(void *data, std::size_t size)
+{
+    char *bytes = static_cast<char *>(data);
+    while (size > 0)
+    {
+        const ssize_t received = ::recv(fd, bytes, size, 0);
+        if (received < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (received <= 0)
+        {
+            return false;
+        }
+        bytes += received;
+        size -= static_cast<std::size_t>(received);
+    }
+    return true;
+}
+
+bool Socket::sendMessage(std::uint32_t type, const std::vector<std::uint8_t> &payload)
+{
+    const std::uint32_t header[2] = {type, static_cast<std::uint32_t>(payload.size())};
+    return sendAll(header, sizeof(header)) && (payload.empty() || sendAll(payload.data(), payload.size()));
+}
+
+bool Socket::receiveMessage(std::uint32_t &type, std::vector<std::uint8_t> &payload)
+{
+    std::uint32_t header[2];
+    static_assert(sizeof(header) == HEADER_SIZE, "message header layout");
+    if (!receiveAll(header, sizeof(header)) || header[1] > MAX_PAYLOAD)
+    {
+        return false;
+    }
+
+    type = header[0];
+    payload.resize(header[1]);
+    return payload.empty() || receiveAll(payload.data(), payload.size());
+}
+
+bool MessageReader::read(Socket &socket)
+{
+    // Drop the messages already taken before reading more.
+    if (offset > 0)
+    {
+        buffer.erase(buffer.begin(), buffer.begin() + static_cast<std::ptrdiff_t>(offset));
+        offset = 0;
+    }
+
+    const std::size_t size = buffer.size();
+    buffer.resize(size + READ_CHUNK);
+    ssize_t received = -1;
+    do
+    {
+        received = ::recv(socket.getFd(), buffer.data() + size, READ_CHUNK, 0);
+    } while (received < 0 && errno == EINTR);
+    if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+    {
+        received = 0;   // poll() saw data another read already took
+    }
+    else if (received <= 0)
+    {
+        buffer.resize(size);
+        return false;
+    }
+    buffer.resize(size + static_cast<std::size_t>(received));
+
+    std::uint32_t header[2];
+    if (buffer.size() >= HEADER_SIZE)
+    {
+        std::memcpy(header, buffer.data(), HEADER_SIZE);
+        return header[1] <= maxPayload;
+    }
+    return true;
+}
+
+bool MessageReader::next(std::uint32_t &type, std::vector<std::uint8_t> &payload)
+{
+    std::uint32_t header[2];
+    if (buffer.size() - offset < HEADER_SIZE)
+    {
+        return false;
+    }
+    std::memcpy(header, buffer.data() + offset, HEADER_SIZE);
+    if (header[1] > maxPayload || buffer.size() - offset - HEADER_SIZE < header[1])
+    {
+        return false;   // read() turns down an oversized one once more arrives
+    }
+
+    type = header[0];
+    const auto first = buffer.begin() + static_cast<std::ptrdiff_t>(offset + HEADER_SIZE);
+    payload.assign(first, first + static_cast<std::ptrdiff_t>(header[1]));
+    offset += HEADER_SIZE + header[1];
+    return true;
+}
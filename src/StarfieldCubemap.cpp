@@ -0,0 +1,390 @@
+#include "StarfieldCubemap.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <system_error>
+#include <thread>
+
+#include "Geodesic.h"
+#include "TileScheduler.h"
+
+namespace
+{
+constexpr std::uint32_t CACHE_VERSION = 1;
+const char CACHE_MAGIC[8] = {'B', 'H', 'S', 'K', 'Y', 'M', 'A', 'P'};
+const char CACHE_PREFIX[] = "starfield-";
+
+// Shared exponent layout of EXT_texture_shared_exponent
+constexpr int RGB9E5_MANTISSA_BITS = 9;
+constexpr int RGB9E5_EXPONENT_BIAS = 15;
+constexpr float RGB9E5_MAX = 65408.0f;
+
+struct CacheHeader
+{
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t faceSize;
+    std::uint32_t levelCount;
+    float cells;
+    std::uint32_t starfieldVersion;
+};
+
+bool isPowerOfTwo(int value)
+{
+    return value > 0 && (value & (value - 1)) == 0;
+}
+
+// Levels from faceSize x faceSize down to 1x1.
+std::uint32_t levelCountFor(int faceSize)
+{
+    std::uint32_t count = 1;
+    for (int size = faceSize; size > 1; size /= 2)
+    {
+        ++count;
+    }
+    return count;
+}
+
+// Mean of the sky over a texel of face: 2x2 samples, or 4x4 where they disagree,
+// which is at stars and leaves the smooth background at four evaluations.
+glm::vec3 bakeTexel(int face, int x, int y, int faceSize)
+{
+    auto average = [&](int grid) {
+        glm::vec3 sum(0.0f);
+        glm::vec3 low(std::numeric_limits<float>::max());
+        glm::vec3 high(0.0f);
+        for (int j = 0; j < grid; ++j)
+        {
+            for (int i = 0; i < grid; ++i)
+            {
+                const float s = (static_cast<float>(x) + (static_cast<float>(i) + 0.5f) / static_cast<float>(grid)) /
+                                static_cast<float>(faceSize);
+                const float t = (static_cast<float>(y) + (static_cast<float>(j) + 0.5f) / static_cast<float>(grid)) /
+                                static_cast<float>(faceSize);
+                const glm::vec3 color = Geodesic::backgroundStarfield(StarfieldCubemap::faceDirection(face, s, t));
+                sum += color;
+                low = glm::min(low, color);
+                high = glm::max(high, color);
+            }
+        }
+        return std::make_pair(sum / static_cast<float>(grid * grid), high - low);
+    };
+
+    const auto coarse = average(2);
+    const glm::vec3 spread = coarse.second;
+    if (glm::max(spread.x, glm::max(spread.y, spread.z)) <= StarfieldCubemap::REFINE_SPREAD)
+    {
+        return coarse.first;
+    }
+    return average(4).first;
+}
+
+// Cache file name prefix of the current sky generator, ahead of the face size.
+std::string generatorPrefix()
+{
+    char prefix[64];
+    std::snprintf(prefix, sizeof(prefix), "%sc%.9g-v%u-", CACHE_PREFIX, static_cast<double>(Geodesic::STARFIELD_CELLS),
+                  Geodesic::STARFIELD_VERSION);
+    return prefix;
+}
+
+// Drops cached bakes of earlier generator versions once a new one is written.
+void pruneCache(const std::filesystem::path &cacheDirectory)
+{
+    const std::string current = generatorPrefix();
+    std::error_code error;
+    for (const auto &entry : std::filesystem::directory_iterator(cacheDirectory, error))
+    {
+        const std::string name = entry.path().filename().string();
+        if (name.rfind(CACHE_PREFIX, 0) == 0 && name.rfind(current, 0) != 0)
+        {
+            std::filesystem::remove(entry.path(), error);
+        }
+    }
+}
+}
+
+StarfieldCubemap::StarfieldCubemap() : faceSize(0), loadedFromCache(false)
+{
+}
+
+void StarfieldCubemap::prepare(int size, const std::filesystem::path &cacheDirectory, unsigned int threads)
+{
+    if (isReady() && faceSize == size)
+    {
+        return;
+    }
+
+    const std::filesystem::path path = cacheDirectory.empty() ? std::filesystem::path() : cachePath(cacheDirectory, size);
+    if (!path.empty() && load(path, size))
+    {
+        return;
+    }
+
+    bake(size, threads);
+    if (!path.empty())
+    {
+        std::error_code error;
+        std::filesystem::create_directories(cacheDirectory, error);
+        if (save(path))
+        {
+            pruneCache(cacheDirectory);
+        }
+    }
+}
+
+void StarfieldCubemap::bake(int size, unsigned int threads)
+{
+    faceSize = isPowerOfTwo(size) ? size : DEFAULT_FACE_SIZE;
+    loadedFromCache = false;
+    levels.clear();
+
+    // Faces stacked vertically make one faceSize x 6 faceSize image for the tile pool.
+    std::vector<glm::vec3> base(static_cast<std::size_t>(faceSize) * faceSize * FACE_COUNT);
+    TileScheduler scheduler(threads > 0 ? threads : std::max(1u, std::thread::hardware_concurrency()));
+    scheduler.run(faceSize, faceSize * FACE_COUNT, [&](unsigned int, const TileScheduler::Tile &tile) {
+        for (int y = tile.y0; y < tile.y1; ++y)
+        {
+            for (int x = tile.x0; x < tile.x1; ++x)
+            {
+                base[static_cast<std::size_t>(y) * faceSize + x] = bakeTexel(y / faceSize, x, y % faceSize, faceSize);
+            }
+        }
+    });
+
+    // Box filtered mip chain down to 1x1, averaged in linear HDR before packing.
+    for (int levelSize = faceSize;; levelSize /= 2)
+    {
+        std::vector<std::uint32_t> packed(base.size());
+        std::transform(base.begin(), base.end(), packed.begin(), packRgb9e5);
+        levels.push_back(std::move(packed));
+        if (levelSize == 1)
+        {
+            break;
+        }
+
+        const int half = levelSize / 2;
+        std::vector<glm::vec3> next(static_cast<std::size_t>(half) * half * FACE_COUNT);
+        for (int face = 0; face < FACE_COUNT; ++face)
+        {
+            const glm::vec3 *source = base.data() + static_cast<std::size_t>(face) * levelSize * levelSize;
+            glm::vec3 *target = next.data() + static_cast<std::size_t>(face) * half * half;
+            for (int y = 0; y < half; ++y)
+            {
+                for (int x = 0; x < half; ++x)
+                {
+                    const glm::vec3 *row = source + static_cast<std::size_t>(2 * y) * levelSize + 2 * x;
+                    target[static_cast<std::size_t>(y) * half + x] =
+                        0.25f * (row[0] + row[1] + row[levelSize] + row[levelSize + 1]);
+                }
+            }
+        }
+        base = std::move(next);
+    }
+}
+
+bool StarfieldCubemap::load(const std::filesystem::path &path, int size)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+    {
+        return false;
+    }
+
+    CacheHeader header{};
+    file.read(reinterpret_cast<char *>(&header), sizeof(header));
+    if (!file || std::memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0 ||
+        header.version != CACHE_VERSION || header.faceSize != static_cast<std::uint32_t>(size) ||
+        header.cells != Geodesic::STARFIELD_CELLS || header.starfieldVersion != Geodesic::STARFIELD_VERSION ||
+        !isPowerOfTwo(size) || header.levelCount != levelCountFor(size))
+    {
+        std::cerr << "Ignoring stale starfield cubemap " << path << std::endl;
+        return false;
+    }
+
+    std::vector<std::vector<std::uint32_t>> loadedLevels;
+    for (int levelSize = size; levelSize >= 1; levelSize /= 2)
+    {
+        std::vector<std::uint32_t> texels(static_cast<std::size_t>(levelSize) * levelSize * FACE_COUNT);
+        file.read(reinterpret_cast<char *>(texels.data()),
+                  static_cast<std::streamsize>(texels.size() * sizeof(std::uint32_t)));
+        loadedLevels.push_back(std::move(texels));
+    }
+    if (!file)
+    {
+        std::cerr << "Truncated starfield cubemap " << path << std::endl;
+        return false;
+    }
+
+    faceSize = size;
+    loadedFromCache = true;
+    levels = std::move(loadedLevels);
+    return true;
+}
+
+bool StarfieldCubemap::save(const std::filesystem::path &path) const
+{
+    std::ofstream file(path, std::ios::binary);
+    if (!file)
+    {
+        std::cerr << "Error opening file for writing: " << path << std::endl;
+        return false;
+    }
+
+    CacheHeader header{};
+    std::memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    header.version = CACHE_VERSION;
+    header.faceSize = static_cast<std::uint32_t>(faceSize);
+    header.levelCount = static_cast<std::uint32_t>(levels.size());
+    header.cells = Geodesic::STARFIELD_CELLS;
+    header.starfieldVersion = Geodesic::STARFIELD_VERSION;
+
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    for (const std::vector<std::uint32_t> &texels : levels)
+    {
+        file.write(reinterpret_cast<const char *>(texels.data()),
+                   static_cast<std::streamsize>(texels.size() * sizeof(std::uint32_t)));
+    }
+    if (!file)
+    {
+        std::cerr << "Failed while writing " << path << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+std::filesystem::path StarfieldCubemap::cachePath(const std::filesystem::path &cacheDirectory, int size)
+{
+    return cacheDirectory / (generatorPrefix() + std::to_string(size) + ".bin");
+}
+
+glm::vec3 StarfieldCubemap::sample(glm::vec3 direction, float lod) const
+{
+    float s;
+    float t;
+    const int face = faceCoordinates(direction, s, t);
+    const float level = glm::clamp(lod, 0.0f, static_cast<float>(levels.size() - 1));
+    const int fine = static_cast<int>(level);
+    const int coarse = std::min(fine + 1, static_cast<int>(levels.size()) - 1);
+    return glm::mix(sampleLevel(fine, face, s, t), sampleLevel(coarse, face, s, t), level - static_cast<float>(fine));
+}
+
+// A texel at the centre of a face spans 2 / faceSize radians.
+float StarfieldCubemap::levelOfDetail(float footprint) const
+{
+    const float texels = footprint * 0.5f * static_cast<float>(faceSize);
+    return glm::clamp(std::log2(std::max(texels, 1.0f)), 0.0f, static_cast<float>(levels.size() - 1));
+}
+
+std::uint32_t StarfieldCubemap::packRgb9e5(glm::vec3 color)
+{
+    const glm::vec3 clamped = glm::clamp(color, glm::vec3(0.0f), glm::vec3(RGB9E5_MAX));
+    const float maxComponent = glm::max(clamped.x, glm::max(clamped.y, clamped.z));
+
+    // floor(log2(maxComponent)) from frexp, which has it exactly
+    int exponent = 0;
+    std::frexp(maxComponent, &exponent);
+    int shared = std::max(-RGB9E5_EXPONENT_BIAS - 1, exponent - 1) + 1 + RGB9E5_EXPONENT_BIAS;
+    float scale = std::ldexp(1.0f, shared - RGB9E5_EXPONENT_BIAS - RGB9E5_MANTISSA_BITS);
+    if (std::floor(maxComponent / scale + 0.5f) == static_cast<float>(1 << RGB9E5_MANTISSA_BITS))
+    {
+        scale *= 2.0f;
+        ++shared;
+    }
+
+    const glm::uvec3 mantissa(glm::floor(clamped / scale + 0.5f));
+    return mantissa.x | (mantissa.y << 9) | (mantissa.z << 18) | (static_cast<std::uint32_t>(shared) << 27);
+}
+
+glm::vec3 StarfieldCubemap::unpackRgb9e5(std::uint32_t texel)
+{
+    const float scale = std::ldexp(1.0f, static_cast<int>(texel >> 27) - RGB9E5_EXPONENT_BIAS - RGB9E5_MANTISSA_BITS);
+    return glm::vec3(static_cast<float>(texel & 0x1ffu), static_cast<float>((texel >> 9) & 0x1ffu),
+                     static_cast<float>((texel >> 18) & 0x1ffu)) * scale;
+}
+
+// Inverse of the major axis selection in the OpenGL cube map table.
+glm::vec3 StarfieldCubemap::faceDirection(int face, float s, float t)
+{
+    const float sc = 2.0f * s - 1.0f;
+    const float tc = 2.0f * t - 1.0f;
+    switch (face)
+    {
+    case 0:
+        return glm::normalize(glm::vec3(1.0f, -tc, -sc));
+    case 1:
+        return glm::normalize(glm::vec3(-1.0f, -tc, sc));
+    case 2:
+        return glm::normalize(glm::vec3(sc, 1.0f, tc));
+    case 3:
+        return glm::normalize(glm::vec3(sc, -1.0f, -tc));
+    case 4:
+        return glm::normalize(glm::vec3(sc, -tc, 1.0f));
+    default:
+        return glm::normalize(glm::vec3(-sc, -tc, -1.0f));
+    }
+}
+
+int StarfieldCubemap::faceCoordinates(glm::vec3 direction, float &s, float &t)
+{
+    const glm::vec3 a = glm::abs(direction);
+    int face;
+    float sc;
+    float tc;
+    float major;
+    if (a.x >= a.y && a.x >= a.z)
+    {
+        face = direction.x >= 0.0f ? 0 : 1;
+        sc = direction.x >= 0.0f ? -direction.z : direction.z;
+        tc = -direction.y;
+        major = a.x;
+    }
+    else if (a.y >= a.z)
+    {
+        face = direction.y >= 0.0f ? 2 : 3;
+        sc = direction.x;
+        tc = direction.y >= 0.0f ? direction.z : -direction.z;
+        major = a.y;
+    }
+    else
+    {
+        face = direction.z >= 0.0f ? 4 : 5;
+        sc = direction.z >= 0.0f ? direction.x : -direction.x;
+        tc = -direction.y;
+        major = a.z;
+    }
+
+    const float inverse = 1.0f / std::max(major, Geodesic::EPSILON);
+    s = 0.5f * (sc * inverse + 1.0f);
+    t = 0.5f * (tc * inverse + 1.0f);
+    return face;
+}
+
+glm::vec3 StarfieldCubemap::texel(int level, int face, int x, int y) const
+{
+    const int size = faceSize >> level;
+    const std::size_t index = (static_cast<std::size_t>(face) * size + static_cast<std::size_t>(y)) * size + x;
+    return unpackRgb9e5(levels[static_cast<std::size_t>(level)][index]);
+}
+
+glm::vec3 StarfieldCubemap::sampleLevel(int level, int face, float s, float t) const
+{
+    const int size = faceSize >> level;
+    const float x = glm::clamp(s * static_cast<float>(size) - 0.5f, 0.0f, static_cast<float>(size - 1));
+    const float y = glm::clamp(t * static_cast<float>(size) - 0.5f, 0.0f, static_cast<float>(size - 1));
+    const int x0 = static_cast<int>(x);
+    const int y0 = static_cast<int>(y);
+    const int x1 = std::min(x0 + 1, size - 1);
+    const int y1 = std::min(y0 + 1, size - 1);
+    const float fx = x - static_cast<float>(x0);
+    const float fy = y - static_cast<float>(y0);
+    return glm::mix(glm::mix(texel(level, face, x0, y0), texel(level, face, x1, y0), fx),
+                    glm::mix(texel(level, face, x0, y1), texel(level, face, x1, y1), fx), fy);
+}
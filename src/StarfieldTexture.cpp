@@ -0,0 +1,48 @@
+#include "StarfieldTexture.h"
+
+#include <cstddef>
+
+#include "StarfieldCubemap.h"
+
+StarfieldTexture::StarfieldTexture() : texture(0)
+{
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, texture);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+    glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
+}
+
+StarfieldTexture::~StarfieldTexture()
+{
+    glDeleteTextures(1, &texture);
+}
+
+void StarfieldTexture::upload(const StarfieldCubemap &cubemap) const
+{
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, texture);
+    for (int level = 0; level < cubemap.getLevelCount(); ++level)
+    {
+        const int size = cubemap.getFaceSize() >> level;
+        const std::size_t faceTexels = static_cast<std::size_t>(size) * static_cast<std::size_t>(size);
+        for (int face = 0; face < StarfieldCubemap::FACE_COUNT; ++face)
+        {
+            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, level, GL_RGB9_E5, size, size, 0, GL_RGB,
+                         GL_UNSIGNED_INT_5_9_9_9_REV, cubemap.getLevel(level).data() + face * faceTexels);
+        }
+    }
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAX_LEVEL, cubemap.getLevelCount() - 1);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+}
+
+void StarfieldTexture::bind(unsigned int unit) const
+{
+    glActiveTexture(GL_TEXTURE0 + unit);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, texture);
+    glActiveTexture(GL_TEXTURE0);
+}
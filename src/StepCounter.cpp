@@ -0,0 +1,62 @@
+#include "StepCounter.h"
+
+namespace
+{
+// Mirrors the std430 StepCounter block in computeShader.glsl.
+struct CounterData
+{
+    GLuint totalStepsLow;
+    GLuint totalStepsHigh;
+    GLuint totalRays;
+    GLuint terminations[RayStatistics::TERMINATION_COUNT];
+    GLuint stepHistogram[RayStatistics::BIN_COUNT];
+};
+}
+
+StepCounter::StepCounter() : bufferID(0)
+{
+    const CounterData zero{};
+    glGenBuffers(1, &bufferID);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, bufferID);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(CounterData), &zero, GL_DYNAMIC_READ);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+StepCounter::~StepCounter()
+{
+    glDeleteBuffers(1, &bufferID);
+}
+
+void StepCounter::bind(unsigned int binding) const
+{
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding, bufferID);
+}
+
+void StepCounter::reset() const
+{
+    const CounterData zero{};
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, bufferID);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(CounterData), &zero);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+void StepCounter::read(RayStatistics &statistics) const
+{
+    CounterData data{};
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, bufferID);
+    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(CounterData), &data);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    statistics = RayStatistics{};
+    statistics.steps = (static_cast<std::uint64_t>(data.totalStepsHigh) << 32) | data.totalStepsLow;
+    statistics.rays = data.totalRays;
+    for (int i = 0; i < RayStatistics::TERMINATION_COUNT; ++i)
+    {
+        statistics.terminations[static_cast<std::size_t>(i)] = data.terminations[i];
+    }
+    for (int i = 0; i < RayStatistics::BIN_COUNT; ++i)
+    {
+        statistics.histogram[static_cast<std::size_t>(i)] = data.stepHistogram[i];
+    }
+}
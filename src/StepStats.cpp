@@ -0,0 +1,143 @@
+#include "StepStats.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+
+#include "CpuTracer.h"
+#include "RenderSetup.h"
+#include "StepCounter.h"
+
+StepStats::StepStats(const CommandLine::Options &options, bool gpu)
+    : options(options), frameCount(0), intervalStart(std::chrono::steady_clock::now())
+{
+    if (gpu && RenderSetup::countsSteps(options))
+    {
+        counter = std::make_unique<StepCounter>();
+        counter->bind(RenderSetup::STEP_COUNTER_BINDING);
+    }
+}
+
+StepStats::~StepStats() = default;
+
+void StepStats::gpuFrameRendered()
+{
+    if (!options.stepStats || ++frameCount % INTERVAL != 0)
+    {
+        return;
+    }
+
+    RayStatistics statistics;
+    counter->read(statistics);
+    counter->reset();
+    const auto now = std::chrono::steady_clock::now();
+    printSteps(std::cout, options, statistics, std::chrono::duration<double>(now - intervalStart).count());
+    intervalStart = now;
+}
+
+void StepStats::cpuFrameRendered(const CpuTracer &tracer, double seconds)
+{
+    if (++frameCount % INTERVAL != 1)
+    {
+        return;
+    }
+
+    if (options.tileStats)
+    {
+        printTiles(std::cout, tracer);
+    }
+    if (options.stepStats)
+    {
+        printSteps(std::cout, options, tracer.getLastFrameStatistics(), seconds);
+    }
+}
+
+void StepStats::printTiles(std::ostream &out, const CpuTracer &tracer)
+{
+    const TileScheduler &scheduler = tracer.getScheduler();
+    const double frameSeconds = scheduler.getFrameSeconds();
+    const auto &stats = scheduler.getStats();
+
+    double totalBusy = 0.0;
+    double maxBusy = 0.0;
+    out << "Tile scheduler: " << stats.size() << " threads, frame " << std::fixed << std::setprecision(2)
+        << frameSeconds * 1000.0 << " ms\n"
+        << "  thread   busy ms   idle ms  tiles  steals\n";
+    for (std::size_t i = 0; i < stats.size(); ++i)
+    {
+        const TileScheduler::WorkerStats &worker = stats[i];
+        totalBusy += worker.busySeconds;
+        maxBusy = std::max(maxBusy, worker.busySeconds);
+        out << std::setw(8) << i
+            << std::setw(10) << worker.busySeconds * 1000.0
+            << std::setw(10) << worker.idleSeconds * 1000.0
+            << std::setw(7) << worker.tiles
+            << std::setw(8) << worker.steals << "\n";
+    }
+
+    // Fraction of the thread-time in this frame spent rendering; 1.0 is perfect balance.
+    const double efficiency = frameSeconds > 0.0 ? totalBusy / (frameSeconds * static_cast<double>(stats.size())) : 0.0;
+    const double meanBusy = stats.empty() ? 0.0 : totalBusy / static_cast<double>(stats.size());
+    out << "  utilization " << efficiency * 100.0 << "%, max/mean busy "
+        << (meanBusy > 0.0 ? maxBusy / meanBusy : 0.0) << std::defaultfloat << "\n"
+        << "  tiles shaded without integrating: " << tracer.getLastFrameBackgroundTiles() << " background, "
+        << tracer.getLastFrameShadowTiles() << " shadow" << std::endl;
+}
+
+void StepStats::printSteps(std::ostream &out, const CommandLine::Options &options, const RayStatistics &statistics,
+                           double seconds)
+{
+    const double rays = static_cast<double>(statistics.rays);
+    auto percent = [&](std::uint64_t count) { return rays > 0.0 ? 100.0 * static_cast<double>(count) / rays : 0.0; };
+
+    out << "Average steps per ray: " << std::fixed << std::setprecision(1)
+        << (rays > 0.0 ? static_cast<double>(statistics.steps) / rays : 0.0) << std::defaultfloat;
+    if (options.integrator == Integrator::AdaptiveRk45)
+    {
+        out << " (rk45, tolerance " << options.tolerance << ")" << std::endl;
+    }
+    else if (options.integrator == Integrator::OrbitTable)
+    {
+        out << " (orbit table, rk45 fallback with tolerance " << options.tolerance << ")" << std::endl;
+    }
+    else if (options.integrator == Integrator::Analytic)
+    {
+        out << " (analytic, rk45 fallback with tolerance " << options.tolerance << ")" << std::endl;
+    }
+    else
+    {
+        out << " (rk4)" << std::endl;
+    }
+
+    if (seconds > 0.0)
+    {
+        out << "  " << std::fixed << std::setprecision(2) << rays / seconds * 1e-6 << " M rays/s, "
+            << static_cast<double>(statistics.steps) / seconds * 1e-6 << " M steps/s" << std::defaultfloat << std::endl;
+    }
+
+    const char *outcomes[RayStatistics::TERMINATION_COUNT] = {"horizon", "disk", "escape", "step limit"};
+    out << "  outcome:" << std::fixed << std::setprecision(2);
+    for (int i = 0; i < RayStatistics::TERMINATION_COUNT; ++i)
+    {
+        out << "  " << outcomes[i] << " " << percent(statistics.terminations[static_cast<std::size_t>(i)]) << "%";
+    }
+    out << " (" << statistics.terminations[static_cast<std::size_t>(Termination::StepLimit)]
+        << " rays fell back to the unlensed sky)" << std::endl;
+
+    out << "  steps per ray:";
+    for (int bin = 0; bin < RayStatistics::BIN_COUNT; ++bin)
+    {
+        const unsigned int start = RayStatistics::binStart(bin);
+        out << "  " << start;
+        if (bin == RayStatistics::BIN_COUNT - 1)
+        {
+            out << "+";
+        }
+        else if (RayStatistics::binStart(bin + 1) - 1 > start)
+        {
+            out << "-" << RayStatistics::binStart(bin + 1) - 1;
+        }
+        out << ": " << percent(statistics.histogram[static_cast<std::size_t>(bin)]) << "%";
+    }
+    out << std::defaultfloat << std::endl;
+}
@@ -0,0 +1,86 @@
+#include "TileClassifier.h"
+
+#include <cmath>
+#include <limits>
+
+namespace
+{
+// Sine of the camera's elevation above the disk plane, as seen from the hole.
+float cameraElevation(const TracerParameters &params)
+{
+    const glm::vec3 offset = params.cameraPos - params.bhCenter;
+    return glm::dot(glm::normalize(offset), glm::normalize(params.disk.normal));
+}
+}
+
+TileClassifier::Bounds TileClassifier::emptyBounds()
+{
+    Bounds bounds;
+    bounds.minInverseImpactSq = std::numeric_limits<float>::max();
+    bounds.maxInverseImpactSq = 0.0f;
+    bounds.minClearance = std::numeric_limits<float>::max();
+    bounds.outgoing = false;
+    return bounds;
+}
+
+void TileClassifier::include(Bounds &bounds, const TracerParameters &params, const Geodesic::PrimaryRay &ray)
+{
+    const float inverseImpactSq = Geodesic::inverseImpactParameterSq(ray.u0, ray.up0, params.Rs);
+    const float side = cameraElevation(params) < 0.0f ? -1.0f : 1.0f;
+    const float clearance = side * glm::dot(ray.direction, glm::normalize(params.disk.normal));
+
+    bounds.minInverseImpactSq = glm::min(bounds.minInverseImpactSq, inverseImpactSq);
+    bounds.maxInverseImpactSq = glm::max(bounds.maxInverseImpactSq, inverseImpactSq);
+    bounds.minClearance = glm::min(bounds.minClearance, clearance);
+    bounds.outgoing = bounds.outgoing || ray.up0 <= 0.0f;
+}
+
+// A ray's position r^ = r / |r| sweeps a great circle from the camera's direction.
+// On a straight line it ends up along the ray's direction, pi - theta further on,
+// without leaving the camera's side of the disk plane; gravity only carries it on
+// by the deflection. So the ray stays clear of the disk if its direction clears the
+// plane by more than the deflection, and a captured ray does if its whole sweep to
+// the horizon is shorter than the camera's elevation. Both the deflection and the
+// capture sweep are monotonic in b, so the tile's extreme b bound every ray in it.
+TileClassifier::TileClass TileClassifier::classify(const TracerParameters &params, const Bounds &bounds)
+{
+    const float Rs = params.Rs;
+    const float elevation = cameraElevation(params);
+    const float u = 1.0f / glm::max(glm::length(params.cameraPos - params.bhCenter), Geodesic::EPSILON);
+    if (std::abs(elevation) <= 1e-4f || u * Rs >= 2.0f / 3.0f || bounds.minInverseImpactSq > bounds.maxInverseImpactSq)
+    {
+        return TileClass::Trace;
+    }
+
+    const float criticalInverseImpactSq = 4.0f / (27.0f * Rs * Rs);
+    const float below = (1.0f - CRITICAL_MARGIN) * (1.0f - CRITICAL_MARGIN);
+    const float above = (1.0f + CRITICAL_MARGIN) * (1.0f + CRITICAL_MARGIN);
+
+    if (!bounds.outgoing && bounds.minInverseImpactSq * below > criticalInverseImpactSq)
+    {
+        const float sweep = Geodesic::captureAngle(u, bounds.minInverseImpactSq, Rs);
+        return sweep < std::asin(std::abs(elevation)) ? TileClass::Shadow : TileClass::Trace;
+    }
+
+    if (bounds.maxInverseImpactSq * above < criticalInverseImpactSq)
+    {
+        const float deflection = glm::max(deflectionFromCamera(u, bounds.maxInverseImpactSq, Rs), 0.0f);
+        if (deflection < 0.5f * Geodesic::PI && bounds.minClearance > std::sin(deflection))
+        {
+            return TileClass::Background;
+        }
+    }
+    return TileClass::Trace;
+}
+
+// Sweep out through the turning point less the straight line's pi - theta, where
+// sin^2(theta) = u^2 / (1/b^2 + Rs u^3) for a ray leaving the camera at theta from
+// the direction to the hole. Outgoing rays of the same b bend less.
+float TileClassifier::deflectionFromCamera(float u, float inverseImpactSq, float Rs)
+{
+    const float up = std::sqrt(glm::max(inverseImpactSq - u * u * (1.0f - Rs * u), 0.0f));
+    const float sinTheta = std::sqrt(glm::clamp(u * u / (inverseImpactSq + Rs * u * u * u), 0.0f, 1.0f));
+    const float sweep = 2.0f * Geodesic::escapeAngle(Geodesic::turningPoint(inverseImpactSq, Rs), 0.0f, Rs) -
+                        Geodesic::escapeAngle(u, up, Rs);
+    return sweep - (Geodesic::PI - std::asin(sinTheta));
+}
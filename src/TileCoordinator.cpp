@@ -0,0 +1,275 @@
+#include "TileCoordinator.h"
+
+#include <algorithm>
+#include <deque>
+#include <filesystem>
+#include <iostream>
+
+#include <poll.h>
+#include <unistd.h>
+
+namespace
+{
+constexpr int POLL_TIMEOUT_MS = 1000;   // how often exited local workers are noticed
+const char UNIX_PREFIX[] = "unix:";
+}
+
+TileCoordinator::~TileCoordinator()
+{
+    finish();
+}
+
+bool TileCoordinator::listen(const std::string &listenAddress, std::string &error)
+{
+    acceptsRemoteWorkers = !listenAddress.empty();
+    address = listenAddress;
+    if (address.empty())
+    {
+        const std::filesystem::path path =
+            std::filesystem::temp_directory_path() / ("blackholesim-" + std::to_string(::getpid()) + ".sock");
+        address = UNIX_PREFIX + path.string();
+    }
+    if (address.compare(0, sizeof(UNIX_PREFIX) - 1, UNIX_PREFIX) == 0)
+    {
+        unixSocketPath = address.substr(sizeof(UNIX_PREFIX) - 1);
+    }
+
+    listener = Socket::listen(address, error);
+    return listener.isValid();
+}
+
+bool TileCoordinator::spawnWorkers(unsigned int count, const std::vector<std::string> &arguments, std::string &error)
+{
+    std::vector<std::string> workerArguments = {"--tile-worker", address};
+    workerArguments.insert(workerArguments.end(), arguments.begin(), arguments.end());
+    return processes.spawn(count, workerArguments, error);
+}
+
+bool TileCoordinator::render(const TileProtocol::Job &job, std::vector<glm::vec4> &image, std::string &error)
+{
+    const std::vector<TileScheduler::Tile> tiles = TileProtocol::splitFrame(job.resolution);
+    const std::vector<std::uint8_t> jobMessage = TileProtocol::encodeJob(job);
+    image.assign(static_cast<std::size_t>(job.resolution.x) * static_cast<std::size_t>(job.resolution.y),
+                 glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+
+    std::deque<std::uint32_t> queue;
+    for (std::uint32_t index = 0; index < tiles.size(); ++index)
+    {
+        queue.push_back(index);
+    }
+    std::vector<int> attempts(tiles.size(), 0);
+    std::size_t completed = 0;
+
+    // Workers that already rendered an earlier job get this one first.
+    for (Worker &worker : workers)
+    {
+        worker.hasJob = !worker.backend.empty() && TileProtocol::send(worker.socket, TileProtocol::MessageType::Job,
+                                                                      jobMessage);
+        worker.lost = !worker.backend.empty() && !worker.hasJob;
+    }
+
+    std::vector<pollfd> fds;
+    while (completed < tiles.size())
+    {
+        // Hand out tiles, then drop lost workers and queue their tiles again, first.
+        for (Worker &worker : workers)
+        {
+            while (worker.hasJob && !worker.lost && worker.inFlight.size() < TILES_IN_FLIGHT && !queue.empty())
+            {
+                const std::uint32_t index = queue.front();
+                if (!TileProtocol::send(worker.socket, TileProtocol::MessageType::Tile,
+                                        TileProtocol::encodeTile(index, tiles[index])))
+                {
+                    worker.lost = true;
+                    break;
+                }
+                queue.pop_front();
+                ++attempts[index];
+                worker.inFlight.push_back(index);
+            }
+        }
+        for (Worker &worker : workers)
+        {
+            if (!worker.lost)
+            {
+                continue;
+            }
+            for (auto index = worker.inFlight.rbegin(); index != worker.inFlight.rend(); ++index)
+            {
+                if (attempts[*index] >= MAX_TILE_ATTEMPTS)
+                {
+                    error = "Tile " + std::to_string(*index) + " was lost by " + std::to_string(MAX_TILE_ATTEMPTS) +
+                            " workers.";
+                    return false;
+                }
+                queue.push_front(*index);
+                ++retriedTiles;
+            }
+            if (!worker.inFlight.empty())
+            {
+                std::cerr << "Tile worker (" << (worker.backend.empty() ? "starting" : worker.backend)
+                          << ") disconnected; " << worker.inFlight.size() << " tiles queued again." << std::endl;
+            }
+        }
+        const std::size_t before = workers.size();
+        workers.erase(std::remove_if(workers.begin(), workers.end(), [](const Worker &worker) { return worker.lost; }),
+                      workers.end());
+        if (workers.size() != before)
+        {
+            continue;   // hand the requeued tiles out before waiting
+        }
+
+        processes.reap(false);
+        if (workers.empty() && processes.getRunningCount() == 0 && !acceptsRemoteWorkers)
+        {
+            error = "Every tile worker exited before the frame was done.";
+            return false;
+        }
+
+        fds.assign(1, pollfd{listener.getFd(), POLLIN, 0});
+        for (const Worker &worker : workers)
+        {
+            fds.push_back(pollfd{worker.socket.getFd(), POLLIN, 0});
+        }
+        const int ready = ::poll(fds.data(), fds.size(), POLL_TIMEOUT_MS);
+        if (ready <= 0)
+        {
+            continue;   // timeout or a signal
+        }
+
+        // Workers accepted below have no entry in fds yet.
+        const std::size_t polled = workers.size();
+        if ((fds[0].revents & POLLIN) != 0)
+        {
+            acceptWorker();
+        }
+        for (std::size_t i = 0; i < polled; ++i)
+        {
+            if (fds[i + 1].revents != 0 && !receive(workers[i], job, tiles, image, completed))
+            {
+                workers[i].lost = true;
+            }
+        }
+        for (Worker &worker : workers)
+        {
+            if (!worker.lost && !worker.backend.empty() && !worker.hasJob)
+            {
+                worker.hasJob = TileProtocol::send(worker.socket, TileProtocol::MessageType::Job, jobMessage);
+                worker.lost = !worker.hasJob;
+            }
+        }
+    }
+    return true;
+}
+
+unsigned int TileCoordinator::getWorkerCount() const
+{
+    return static_cast<unsigned int>(std::count_if(workers.begin(), workers.end(),
+                                                   [](const Worker &worker) { return !worker.backend.empty(); }));
+}
+
+void TileCoordinator::finish()
+{
+    for (Worker &worker : workers)
+    {
+        TileProtocol::send(worker.socket, TileProtocol::MessageType::Finish, {});
+    }
+    workers.clear();
+    listener.close();
+    processes.reap(true);
+    if (!unixSocketPath.empty())
+    {
+        ::unlink(unixSocketPath.c_str());
+        unixSocketPath.clear();
+    }
+}
+
+void TileCoordinator::acceptWorker()
+{
+    Socket socket = listener.accept();
+    if (socket.isValid() && socket.setNonBlocking())
+    {
+        Worker worker;
+        worker.socket = std::move(socket);
+        workers.push_back(std::move(worker));
+    }
+}
+
+bool TileCoordinator::receive(Worker &worker, const TileProtocol::Job &job,
+                              const std::vector<TileScheduler::Tile> &tiles, std::vector<glm::vec4> &image,
+                              std::size_t &completed)
+{
+    if (!worker.reader.read(worker.socket))
+    {
+        return false;
+    }
+
+    std::uint32_t type = 0;
+    std::vector<std::uint8_t> payload;
+    while (worker.reader.next(type, payload))
+    {
+        if (!handleMessage(worker, static_cast<TileProtocol::MessageType>(type), payload, job, tiles, image,
+                           completed))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool TileCoordinator::handleMessage(Worker &worker, TileProtocol::MessageType type,
+                                    const std::vector<std::uint8_t> &payload, const TileProtocol::Job &job,
+                                    const std::vector<TileScheduler::Tile> &tiles, std::vector<glm::vec4> &image,
+                                    std::size_t &completed)
+{
+    if (type == TileProtocol::MessageType::Hello)
+    {
+        std::uint32_t version = 0;
+        std::string backend;
+        if (!TileProtocol::decodeHello(payload, version, backend) || version != TileProtocol::VERSION ||
+            !worker.backend.empty())
+        {
+            std::cerr << "Rejected a tile worker speaking protocol " << version << " (expected "
+                      << TileProtocol::VERSION << ")." << std::endl;
+            return false;
+        }
+        worker.backend = backend.empty() ? "unknown" : backend;
+        worker.reader.setMaxPayload(TileProtocol::MAX_RESULT_PAYLOAD);
+        return true;
+    }
+    if (type != TileProtocol::MessageType::TileResult || worker.backend.empty())
+    {
+        return false;
+    }
+
+    std::uint32_t jobId = 0;
+    std::uint32_t index = 0;
+    std::size_t pixelCount = 0;
+    const float *rgb = nullptr;
+    if (!TileProtocol::decodeTileResult(payload, jobId, index, pixelCount, rgb) || jobId != job.id)
+    {
+        return false;
+    }
+    const auto inFlight = std::find(worker.inFlight.begin(), worker.inFlight.end(), index);
+    if (inFlight == worker.inFlight.end())
+    {
+        return false;
+    }
+    const TileScheduler::Tile &tile = tiles[index];
+    if (pixelCount != static_cast<std::size_t>(tile.x1 - tile.x0) * static_cast<std::size_t>(tile.y1 - tile.y0))
+    {
+        return false;
+    }
+
+    for (int y = tile.y0; y < tile.y1; ++y)
+    {
+        glm::vec4 *row = image.data() + static_cast<std::size_t>(y) * static_cast<std::size_t>(job.resolution.x);
+        for (int x = tile.x0; x < tile.x1; ++x, rgb += 3)
+        {
+            row[x] = glm::vec4(rgb[0], rgb[1], rgb[2], 1.0f);
+        }
+    }
+    worker.inFlight.erase(inFlight);
+    ++completed;
+    return true;
+}
@@ -0,0 +1,288 @@
+#include "TileFarm.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+
+#include "AppPaths.h"
+#include "BlackHole.h"
+#include "Camera.h"
+#include "CpuTracer.h"
+#include "DiskEmissionMap.h"
+#include "DiskEmissionTexture.h"
+#include "OrbitTableTexture.h"
+#include "PhotonOrbitTable.h"
+#include "RenderSetup.h"
+#include "RenderTarget.h"
+#include "StarfieldCubemap.h"
+#include "StarfieldTexture.h"
+#include "TileCoordinator.h"
+#include "TileWorker.h"
+#include "TracerParameters.h"
+#include "Window.h"
+#include "shader.h"
+
+namespace
+{
+// The options of a tile worker with the render settings of job in place of its own.
+CommandLine::Options jobOptions(const CommandLine::Options &options, const TileProtocol::Job &job)
+{
+    CommandLine::Options jobOptions = options;
+    jobOptions.integrator = job.integrator;
+    jobOptions.tolerance = job.tolerance;
+    jobOptions.weakFieldBudget = job.weakFieldBudget;
+    jobOptions.classifyTiles = job.classifyTiles;
+    jobOptions.skySize = job.skySize;
+    jobOptions.debugView = job.debugView;
+    return jobOptions;
+}
+
+// Arguments of the workers --tile-workers starts: the same backend, with the CPU
+// threads shared between them unless --threads says otherwise.
+std::vector<std::string> tileWorkerArguments(const CommandLine::Options &options)
+{
+    if (options.headless)
+    {
+        return {"--headless"};
+    }
+
+    unsigned int threads = options.cpuThreads;
+    if (threads == 0)
+    {
+        threads = std::max(1u, std::thread::hardware_concurrency() / std::max(1u, options.tileWorkers));
+    }
+    return {"--threads", std::to_string(threads), "--simd", PacketKernel::isaName(options.simd)};
+}
+
+// --tile-worker with the CPU tracer. The job's camera comes with its view matrix, so
+// a pose the Camera class can't express renders the same as on the coordinator.
+bool runCpuTileWorker(const CommandLine::Options &options, std::string &error)
+{
+    CpuTracer tracer(options.cpuThreads, options.simd);
+    const DiskParameters disk = DiskParameters::defaultsFor(RenderSetup::SCHWARZSCHILD_RADIUS);
+    DiskEmissionMap diskEmission;
+    diskEmission.prepare(disk);
+    PhotonOrbitTable orbitTable;
+    StarfieldCubemap starfield;
+    TracerParameters params{};
+    bool prepared = false;
+    std::uint32_t preparedJob = 0;
+
+    auto renderTile = [&](const TileProtocol::Job &job, const TileScheduler::Tile &tile, std::vector<glm::vec4> &pixels) {
+        if (!prepared || job.id != preparedJob)
+        {
+            const CommandLine::Options renderOptions = jobOptions(options, job);
+            Camera camera(job.cameraPosition);
+            if (job.integrator == Integrator::OrbitTable)
+            {
+                orbitTable.prepare(RenderSetup::orbitTableRadius(camera), AppPaths::cacheDirectory());
+            }
+            const glm::mat4 invProjection = RenderSetup::inverseProjection(job.resolution, job.fov);
+            params = RenderSetup::tracerParameters(job.resolution, invProjection, camera, disk, renderOptions,
+                                                   &orbitTable, RenderSetup::prepareStarfield(starfield, renderOptions),
+                                                   &diskEmission);
+            params.invView = job.invView;
+            prepared = true;
+            preparedJob = job.id;
+        }
+        tracer.render(params, tile, pixels);
+        return true;
+    };
+    return TileWorker::run(options.tileWorkerAddress, std::string("cpu ") + PacketKernel::isaName(tracer.getIsa()),
+                           renderTile, error);
+}
+
+// --tile-worker --headless: tiles from the compute shader into a tile sized output
+// texture, offset into the frame by the tileOrigin uniform.
+bool runGpuTileWorker(const CommandLine::Options &options, std::string &error)
+{
+    constexpr int TILE_SIZE = TileProtocol::TILE_SIZE;
+    Window window(static_cast<unsigned int>(TILE_SIZE), static_cast<unsigned int>(TILE_SIZE), true, true);
+    if (!window.initialize())
+    {
+        error = window.getLastError();
+        return false;
+    }
+    const auto computeShaderPath = AppPaths::findResource("computeShader.glsl");
+    if (computeShaderPath.empty())
+    {
+        error = "Failed to locate shader resources.";
+        return false;
+    }
+
+    const RenderTarget::Format format = RenderTarget::Format::Rgba32f;
+    Shader computeShader(computeShaderPath.string(), RenderTarget::shaderDefines(format));
+    if (computeShader.getID() == 0)
+    {
+        error = "Failed to build the compute shader.";
+        return false;
+    }
+    computeShader.bind();
+    BlackHole blackHole(&computeShader, RenderSetup::BLACK_HOLE_POSITION, RenderSetup::SCHWARZSCHILD_RADIUS, TILE_SIZE,
+                        TILE_SIZE, format);
+    DiskEmissionMap diskEmission;
+    diskEmission.prepare(blackHole.getDiskParameters());
+    DiskEmissionTexture diskEmissionTexture;
+    diskEmissionTexture.upload(diskEmission);
+    PhotonOrbitTable orbitTable;
+    OrbitTableTexture orbitTableTexture;
+    StarfieldCubemap starfield;
+    StarfieldTexture starfieldTexture;
+    const StarfieldCubemap *sky = nullptr;
+
+    std::vector<glm::vec4> texels(static_cast<std::size_t>(TILE_SIZE) * TILE_SIZE);
+    bool prepared = false;
+    std::uint32_t preparedJob = 0;
+    auto renderTile = [&](const TileProtocol::Job &job, const TileScheduler::Tile &tile, std::vector<glm::vec4> &pixels) {
+        const int width = tile.x1 - tile.x0;
+        const int height = tile.y1 - tile.y0;
+        if (width > TILE_SIZE || height > TILE_SIZE)
+        {
+            return false;
+        }
+
+        computeShader.bind();
+        if (!prepared || job.id != preparedJob)
+        {
+            const CommandLine::Options renderOptions = jobOptions(options, job);
+            sky = RenderSetup::prepareStarfield(starfield, renderOptions);
+            if (sky != nullptr)
+            {
+                starfieldTexture.upload(*sky);
+            }
+            // A job at the radius of the last one keeps its table, and its texture.
+            if (job.integrator == Integrator::OrbitTable)
+            {
+                if (orbitTable.prepare(RenderSetup::orbitTableRadius(Camera(job.cameraPosition)),
+                                       AppPaths::cacheDirectory()))
+                {
+                    orbitTableTexture.upload(orbitTable);
+                }
+                computeShader.setUniform1f("orbitTableRadius", orbitTable.getRadius());
+            }
+            RenderSetup::configureComputeShader(computeShader, job.resolution,
+                                                RenderSetup::inverseProjection(job.resolution, job.fov), renderOptions,
+                                                sky != nullptr);
+            computeShader.setUniform3fv("cameraPos", job.cameraPosition);
+            computeShader.setUniformMatrix4fv("invView", job.invView);
+            prepared = true;
+            preparedJob = job.id;
+        }
+
+        // The read back below rebinds a texture unit, so these go in again per tile.
+        if (job.integrator == Integrator::OrbitTable)
+        {
+            orbitTableTexture.bind(RenderSetup::ORBIT_SAMPLES_UNIT, RenderSetup::ORBIT_ROWS_UNIT);
+        }
+        if (sky != nullptr)
+        {
+            starfieldTexture.bind(RenderSetup::STARFIELD_UNIT);
+        }
+        diskEmissionTexture.bind(RenderSetup::DISK_EMISSION_UNIT, RenderSetup::BLACKBODY_UNIT);
+        computeShader.setUniform2i("tileOrigin", glm::ivec2(tile.x0, tile.y0));
+        computeShader.dispatch((width + 15) / 16, (height + 15) / 16, 1);
+        computeShader.memoryBarrier(GL_TEXTURE_UPDATE_BARRIER_BIT);
+        glBindTexture(GL_TEXTURE_2D, blackHole.getOutputTexture());
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_FLOAT, texels.data());
+
+        pixels.resize(static_cast<std::size_t>(width) * static_cast<std::size_t>(height));
+        for (int y = 0; y < height; ++y)
+        {
+            std::copy_n(texels.begin() + static_cast<std::ptrdiff_t>(y) * TILE_SIZE, width,
+                        pixels.begin() + static_cast<std::ptrdiff_t>(y) * width);
+        }
+        return true;
+    };
+    return TileWorker::run(options.tileWorkerAddress, std::string("gpu ") + RenderSetup::glString(GL_RENDERER),
+                           renderTile, error);
+}
+}
+
+int TileFarm::renderFrame(const CommandLine::Options &options)
+{
+    const glm::ivec2 resolution(options.width, options.height);
+    const Camera camera = RenderSetup::outputCamera(options);
+
+    // Filled once here, so the workers load the caches instead of all building them.
+    if (options.integrator == Integrator::OrbitTable)
+    {
+        PhotonOrbitTable orbitTable;
+        RenderSetup::prepareOrbitTable(orbitTable, camera);
+    }
+    {
+        StarfieldCubemap starfield;
+        RenderSetup::prepareStarfield(starfield, options);
+    }
+
+    TileCoordinator coordinator;
+    std::string error;
+    if (!coordinator.listen(options.listenAddress, error) ||
+        !coordinator.spawnWorkers(options.tileWorkers, tileWorkerArguments(options), error))
+    {
+        std::cerr << error << std::endl;
+        return 1;
+    }
+    if (!options.listenAddress.empty())
+    {
+        std::cout << "Waiting for tile workers on " << coordinator.getAddress() << "." << std::endl;
+    }
+
+    const TileProtocol::Job job{1,
+                                resolution,
+                                camera.getPosition(),
+                                camera.invViewMatrix(),
+                                camera.getFov(),
+                                options.integrator,
+                                options.tolerance,
+                                options.weakFieldBudget,
+                                options.classifyTiles,
+                                options.skySize,
+                                options.debugView};
+    std::vector<glm::vec4> image;
+    const auto start = std::chrono::steady_clock::now();
+    if (!coordinator.render(job, image, error))
+    {
+        std::cerr << error << std::endl;
+        return 1;
+    }
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    const unsigned int workerCount = coordinator.getWorkerCount();
+    coordinator.finish();
+
+    if (!RenderSetup::writeOutput(options, image, resolution))
+    {
+        return 1;
+    }
+
+    std::cout << "Wrote " << resolution.x << "x" << resolution.y << " frame to " << options.outputPath << " from "
+              << TileProtocol::splitFrame(resolution).size() << " tiles on " << workerCount << " workers in "
+              << std::fixed << std::setprecision(2) << seconds << std::defaultfloat << " s";
+    if (coordinator.getRetriedTiles() > 0)
+    {
+        std::cout << " (" << coordinator.getRetriedTiles() << " tiles retried)";
+    }
+    std::cout << "." << std::endl;
+    return 0;
+}
+
+int TileFarm::runWorker(const CommandLine::Options &options)
+{
+    std::string error;
+    const bool finished = options.headless ? runGpuTileWorker(options, error) : runCpuTileWorker(options, error);
+    if (!finished)
+    {
+        std::cerr << "Tile worker: " << error << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,185 @@
+#include "TileProtocol.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "Socket.h"
+
+namespace
+{
+constexpr std::size_t RESULT_HEADER = 2 * sizeof(std::uint32_t);
+
+// Appends and reads fixed-size values; the hosts we build for are little-endian.
+template <typename T>
+void put(std::vector<std::uint8_t> &bytes, const T &value)
+{
+    const std::size_t offset = bytes.size();
+    bytes.resize(offset + sizeof(T));
+    std::memcpy(bytes.data() + offset, &value, sizeof(T));
+}
+
+class Reader
+{
+public:
+    explicit Reader(const std::vector<std::uint8_t> &bytes) : bytes(bytes), offset(0) {}
+
+    template <typename T>
+    bool get(T &value)
+    {
+        if (bytes.size() - offset < sizeof(T))
+        {
+            return false;
+        }
+        std::memcpy(&value, bytes.data() + offset, sizeof(T));
+        offset += sizeof(T);
+        return true;
+    }
+
+    std::size_t remaining() const { return bytes.size() - offset; }
+    const std::uint8_t *current() const { return bytes.data() + offset; }
+
+private:
+    const std::vector<std::uint8_t> &bytes;
+    std::size_t offset;
+};
+}
+
+bool TileProtocol::send(Socket &socket, MessageType type, const std::vector<std::uint8_t> &payload)
+{
+    return socket.sendMessage(static_cast<std::uint32_t>(type), payload);
+}
+
+bool TileProtocol::receive(Socket &socket, MessageType &type, std::vector<std::uint8_t> &payload)
+{
+    std::uint32_t rawType = 0;
+    if (!socket.receiveMessage(rawType, payload))
+    {
+        return false;
+    }
+    type = static_cast<MessageType>(rawType);
+    return true;
+}
+
+std::vector<std::uint8_t> TileProtocol::encodeHello(const std::string &backend)
+{
+    std::vector<std::uint8_t> bytes;
+    put(bytes, VERSION);
+    bytes.insert(bytes.end(), backend.begin(), backend.begin() + static_cast<std::ptrdiff_t>(
+                                                                 std::min(backend.size(), MAX_BACKEND_NAME)));
+    return bytes;
+}
+
+bool TileProtocol::decodeHello(const std::vector<std::uint8_t> &payload, std::uint32_t &version, std::string &backend)
+{
+    Reader reader(payload);
+    if (!reader.get(version))
+    {
+        return false;
+    }
+    backend.assign(reinterpret_cast<const char *>(reader.current()), reader.remaining());
+    return true;
+}
+
+std::vector<std::uint8_t> TileProtocol::encodeJob(const Job &job)
+{
+    std::vector<std::uint8_t> bytes;
+    put(bytes, job.id);
+    put(bytes, job.resolution);
+    put(bytes, job.cameraPosition);
+    put(bytes, job.invView);
+    put(bytes, job.fov);
+    put(bytes, static_cast<std::int32_t>(job.integrator));
+    put(bytes, job.tolerance);
+    put(bytes, job.weakFieldBudget);
+    put(bytes, static_cast<std::uint8_t>(job.classifyTiles ? 1 : 0));
+    put(bytes, static_cast<std::int32_t>(job.skySize));
+    put(bytes, static_cast<std::int32_t>(job.debugView));
+    return bytes;
+}
+
+bool TileProtocol::decodeJob(const std::vector<std::uint8_t> &payload, Job &job)
+{
+    Reader reader(payload);
+    std::int32_t integrator = 0;
+    std::uint8_t classifyTiles = 0;
+    std::int32_t skySize = 0;
+    std::int32_t debugView = 0;
+    if (!reader.get(job.id) || !reader.get(job.resolution) || !reader.get(job.cameraPosition) ||
+        !reader.get(job.invView) || !reader.get(job.fov) || !reader.get(integrator) || !reader.get(job.tolerance) ||
+        !reader.get(job.weakFieldBudget) || !reader.get(classifyTiles) || !reader.get(skySize) ||
+        !reader.get(debugView) || reader.remaining() != 0)
+    {
+        return false;
+    }
+    if (integrator < static_cast<std::int32_t>(Integrator::FixedRk4) ||
+        integrator > static_cast<std::int32_t>(Integrator::Analytic) ||
+        debugView < static_cast<std::int32_t>(DebugView::None) ||
+        debugView > static_cast<std::int32_t>(DebugView::Termination) || job.resolution.x <= 0 ||
+        job.resolution.y <= 0)
+    {
+        return false;
+    }
+
+    job.integrator = static_cast<Integrator>(integrator);
+    job.classifyTiles = classifyTiles != 0;
+    job.skySize = skySize;
+    job.debugView = static_cast<DebugView>(debugView);
+    return true;
+}
+
+std::vector<std::uint8_t> TileProtocol::encodeTile(std::uint32_t index, const TileScheduler::Tile &tile)
+{
+    std::vector<std::uint8_t> bytes;
+    put(bytes, index);
+    put(bytes, tile);
+    return bytes;
+}
+
+bool TileProtocol::decodeTile(const std::vector<std::uint8_t> &payload, std::uint32_t &index, TileScheduler::Tile &tile)
+{
+    Reader reader(payload);
+    return reader.get(index) && reader.get(tile) && reader.remaining() == 0 && tile.x0 >= 0 && tile.y0 >= 0 &&
+           tile.x1 > tile.x0 && tile.y1 > tile.y0;
+}
+
+std::vector<std::uint8_t> TileProtocol::encodeTileResult(std::uint32_t jobId, std::uint32_t index,
+                                                         const std::vector<glm::vec4> &pixels)
+{
+    std::vector<std::uint8_t> bytes;
+    bytes.reserve(RESULT_HEADER + pixels.size() * 3 * sizeof(float));
+    put(bytes, jobId);
+    put(bytes, index);
+    for (const glm::vec4 &pixel : pixels)
+    {
+        put(bytes, glm::vec3(pixel));
+    }
+    return bytes;
+}
+
+bool TileProtocol::decodeTileResult(const std::vector<std::uint8_t> &payload, std::uint32_t &jobId,
+                                    std::uint32_t &index, std::size_t &pixelCount, const float *&rgb)
+{
+    constexpr std::size_t PIXEL_BYTES = 3 * sizeof(float);
+    Reader reader(payload);
+    if (!reader.get(jobId) || !reader.get(index) || reader.remaining() % PIXEL_BYTES != 0)
+    {
+        return false;
+    }
+    pixelCount = reader.remaining() / PIXEL_BYTES;
+    rgb = reinterpret_cast<const float *>(reader.current());
+    return true;
+}
+
+std::vector<TileScheduler::Tile> TileProtocol::splitFrame(const glm::ivec2 &resolution)
+{
+    std::vector<TileScheduler::Tile> tiles;
+    for (int y = 0; y < resolution.y; y += TILE_SIZE)
+    {
+        for (int x = 0; x < resolution.x; x += TILE_SIZE)
+        {
+            tiles.push_back(TileScheduler::Tile{x, y, std::min(x + TILE_SIZE, resolution.x),
+                                                std::min(y + TILE_SIZE, resolution.y)});
+        }
+    }
+    return tiles;
+}
@@ -0,0 +1,195 @@
+#include "TileScheduler.h"
+
+#include <algorithm>
+#include <chrono>
+
+namespace
+{
+typedef std::chrono::steady_clock Clock;
+
+double secondsBetween(Clock::time_point start, Clock::time_point end)
+{
+    return std::chrono::duration<double>(end - start).count();
+}
+}
+
+TileScheduler::TileScheduler(unsigned int workerCount)
+{
+    workerCount = std::max(1u, workerCount);
+    queues.reserve(workerCount);
+    for (unsigned int i = 0; i < workerCount; ++i)
+    {
+        queues.push_back(std::make_unique<TileQueue>());
+    }
+    stats.resize(workerCount);
+
+    helpers.reserve(workerCount - 1);
+    for (unsigned int i = 1; i < workerCount; ++i)
+    {
+        helpers.emplace_back(&TileScheduler::helperLoop, this, i);
+    }
+}
+
+TileScheduler::~TileScheduler()
+{
+    {
+        std::lock_guard<std::mutex> lock(frameMutex);
+        stopping = true;
+    }
+    frameStarted.notify_all();
+
+    for (auto &helper : helpers)
+    {
+        helper.join();
+    }
+}
+
+void TileScheduler::run(int width, int height, const TileTask &task)
+{
+    run(Tile{0, 0, width, height}, task);
+}
+
+void TileScheduler::run(const Tile &region, const TileTask &task)
+{
+    for (auto &workerStats : stats)
+    {
+        workerStats = WorkerStats{};
+    }
+
+    const int width = region.x1 - region.x0;
+    const int height = region.y1 - region.y0;
+    const int tilesX = (width + TILE_SIZE - 1) / TILE_SIZE;
+    const int tilesY = (height + TILE_SIZE - 1) / TILE_SIZE;
+    const int tileCount = std::max(0, tilesX * tilesY);
+    if (tileCount == 0)
+    {
+        frameSeconds = 0.0;
+        return;
+    }
+
+    // Seed each deque with a contiguous block in scanline order so owners keep
+    // neighbouring tiles and thieves take the far end of someone else's block.
+    const int workerCount = static_cast<int>(queues.size());
+    for (int worker = 0; worker < workerCount; ++worker)
+    {
+        std::deque<Tile> &tiles = queues[static_cast<std::size_t>(worker)]->tiles;
+        tiles.clear();
+
+        const int first = tileCount * worker / workerCount;
+        const int end = tileCount * (worker + 1) / workerCount;
+        for (int index = first; index < end; ++index)
+        {
+            const int x0 = region.x0 + (index % tilesX) * TILE_SIZE;
+            const int y0 = region.y0 + (index / tilesX) * TILE_SIZE;
+            tiles.push_back(Tile{x0, y0, std::min(x0 + TILE_SIZE, region.x1), std::min(y0 + TILE_SIZE, region.y1)});
+        }
+    }
+
+    const Clock::time_point start = Clock::now();
+    {
+        std::lock_guard<std::mutex> lock(frameMutex);
+        currentTask = &task;
+        pendingHelpers = static_cast<unsigned int>(helpers.size());
+        ++generation;
+    }
+    frameStarted.notify_all();
+
+    drain(0);
+
+    {
+        std::unique_lock<std::mutex> lock(frameMutex);
+        frameFinished.wait(lock, [this] { return pendingHelpers == 0; });
+        currentTask = nullptr;
+    }
+
+    frameSeconds = secondsBetween(start, Clock::now());
+    for (auto &workerStats : stats)
+    {
+        workerStats.idleSeconds = std::max(0.0, frameSeconds - workerStats.busySeconds);
+    }
+}
+
+void TileScheduler::helperLoop(unsigned int worker)
+{
+    std::uint64_t seenGeneration = 0;
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock(frameMutex);
+            frameStarted.wait(lock, [&] { return stopping || generation != seenGeneration; });
+            if (stopping)
+            {
+                return;
+            }
+            seenGeneration = generation;
+        }
+
+        drain(worker);
+
+        {
+            std::lock_guard<std::mutex> lock(frameMutex);
+            if (--pendingHelpers == 0)
+            {
+                frameFinished.notify_one();
+            }
+        }
+    }
+}
+
+void TileScheduler::drain(unsigned int worker)
+{
+    WorkerStats &workerStats = stats[worker];
+    Tile tile{};
+    for (;;)
+    {
+        if (!popOwn(worker, tile))
+        {
+            // Every tile is queued before the frame starts, so once all deques are
+            // empty there is nothing left to wait for.
+            if (!steal(worker, tile))
+            {
+                return;
+            }
+            ++workerStats.steals;
+        }
+
+        const Clock::time_point tileStart = Clock::now();
+        (*currentTask)(worker, tile);
+        workerStats.busySeconds += secondsBetween(tileStart, Clock::now());
+        ++workerStats.tiles;
+    }
+}
+
+bool TileScheduler::popOwn(unsigned int worker, Tile &tile)
+{
+    TileQueue &queue = *queues[worker];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.tiles.empty())
+    {
+        return false;
+    }
+
+    tile = queue.tiles.front();
+    queue.tiles.pop_front();
+    return true;
+}
+
+bool TileScheduler::steal(unsigned int worker, Tile &tile)
+{
+    const std::size_t workerCount = queues.size();
+    for (std::size_t offset = 1; offset < workerCount; ++offset)
+    {
+        TileQueue &victim = *queues[(worker + offset) % workerCount];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (victim.tiles.empty())
+        {
+            continue;
+        }
+
+        tile = victim.tiles.back();
+        victim.tiles.pop_back();
+        return true;
+    }
+
+    return false;
+}
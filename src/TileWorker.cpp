@@ -0,0 +1,72 @@
+#include "TileWorker.h"
+
+#include "Socket.h"
+
+bool TileWorker::run(const std::string &address, const std::string &backend, const RenderTile &renderTile,
+                     std::string &error)
+{
+    Socket socket = Socket::connect(address, error);
+    if (!socket.isValid())
+    {
+        return false;
+    }
+    if (!TileProtocol::send(socket, TileProtocol::MessageType::Hello, TileProtocol::encodeHello(backend)))
+    {
+        error = "Lost the connection to " + address + ".";
+        return false;
+    }
+
+    TileProtocol::Job job{};
+    bool hasJob = false;
+    TileProtocol::MessageType type;
+    std::vector<std::uint8_t> payload;
+    std::vector<glm::vec4> pixels;
+    while (TileProtocol::receive(socket, type, payload))
+    {
+        switch (type)
+        {
+        case TileProtocol::MessageType::Job:
+            if (!TileProtocol::decodeJob(payload, job))
+            {
+                error = "Received an invalid job from " + address + ".";
+                return false;
+            }
+            hasJob = true;
+            break;
+
+        case TileProtocol::MessageType::Tile:
+        {
+            std::uint32_t index = 0;
+            TileScheduler::Tile tile{};
+            if (!hasJob || !TileProtocol::decodeTile(payload, index, tile) || tile.x1 > job.resolution.x ||
+                tile.y1 > job.resolution.y)
+            {
+                error = "Received an invalid tile from " + address + ".";
+                return false;
+            }
+            if (!renderTile(job, tile, pixels))
+            {
+                error = "Failed to render tile " + std::to_string(index) + ".";
+                return false;
+            }
+            if (!TileProtocol::send(socket, TileProtocol::MessageType::TileResult,
+                                    TileProtocol::encodeTileResult(job.id, index, pixels)))
+            {
+                error = "Lost the connection to " + address + ".";
+                return false;
+            }
+            break;
+        }
+
+        case TileProtocol::MessageType::Finish:
+            return true;
+
+        default:
+            error = "Received an unknown message from " + address + ".";
+            return false;
+        }
+    }
+
+    error = "Lost the connection to " + address + ".";
+    return false;
+}
@@ -23,8 +23,9 @@ void APIENTRY Window::glDebugOutput(GLenum, GLenum type, unsigned int id,
     }
 }
 
-Window::Window(unsigned int width, unsigned int height)
-    : window(nullptr), width(width), height(height), glfwInitialized(false)
+Window::Window(unsigned int width, unsigned int height, bool requireComputeShaders, bool headless)
+    : window(nullptr), width(width), height(height), requireComputeShaders(requireComputeShaders), headless(headless),
+      glfwInitialized(false)
 {
 }
 
@@ -35,9 +36,70 @@ Window::~Window()
 
 bool Window::initialize()
 {
+    if (headless)
+    {
+        return createHeadlessContext() && initializeGlad() && validateRuntimeCapabilities();
+    }
     return initializeGlfw() && createContext() && initializeGlad() && validateRuntimeCapabilities();
 }
 
+void Window::setVsync(bool enabled)
+{
+    if (!headless)
+    {
+        glfwSwapInterval(enabled ? 1 : 0);
+    }
+}
+
+bool Window::shouldClose() const
+{
+    return !headless && glfwWindowShouldClose(window);
+}
+
+void Window::close()
+{
+    if (!headless)
+    {
+        glfwSetWindowShouldClose(window, true);
+    }
+}
+
+bool Window::isKeyPressed(int key) const
+{
+    return !headless && glfwGetKey(window, key) == GLFW_PRESS;
+}
+
+void Window::getFramebufferSize(int &framebufferWidth, int &framebufferHeight) const
+{
+    if (headless)
+    {
+        framebufferWidth = static_cast<int>(width);
+        framebufferHeight = static_cast<int>(height);
+        return;
+    }
+    glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+}
+
+// Without a swap chain nothing paces the CPU, so a headless frame is only flushed;
+// the driver throttles once too many are queued, as a swap without vsync would.
+void Window::swapBuffers()
+{
+    if (headless)
+    {
+        glFlush();
+        return;
+    }
+    glfwSwapBuffers(window);
+}
+
+void Window::pollEvents()
+{
+    if (!headless)
+    {
+        glfwPollEvents();
+    }
+}
+
 bool Window::initializeGlfw()
 {
     if (!glfwInit())
@@ -52,8 +114,9 @@ bool Window::initializeGlfw()
 
 bool Window::createContext()
 {
+    // Without compute shaders the window only presents a CPU-traced image.
     glfwWindowHint(GLFW_SAMPLES, 4);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, requireComputeShaders ? 4 : 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
@@ -74,9 +137,22 @@ bool Window::createContext()
     return true;
 }
 
+bool Window::createHeadlessContext()
+{
+    headlessContext = std::make_unique<HeadlessContext>(width, height);
+    if (!headlessContext->create(requireComputeShaders ? 4 : 3, 3, lastError))
+    {
+        shutdown();
+        return false;
+    }
+    return true;
+}
+
 bool Window::initializeGlad()
 {
-    if (!gladLoadGLLoader(reinterpret_cast<GLADloadproc>(glfwGetProcAddress)))
+    const GLADloadproc loader = headless ? reinterpret_cast<GLADloadproc>(HeadlessContext::getProcAddress)
+                                         : reinterpret_cast<GLADloadproc>(glfwGetProcAddress);
+    if (!gladLoadGLLoader(loader))
     {
         lastError = "Failed to initialize GLAD.";
         shutdown();
@@ -95,6 +171,16 @@ bool Window::initializeGlad()
     }
 #endif
 
+    if (headless)
+    {
+        if (!headlessContext->createFramebuffer(lastError))
+        {
+            shutdown();
+            return false;
+        }
+        return true;
+    }
+
     glViewport(0, 0, static_cast<GLsizei>(width), static_cast<GLsizei>(height));
     glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
     glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
@@ -103,10 +189,12 @@ bool Window::initializeGlad()
 
 bool Window::validateRuntimeCapabilities()
 {
-    if (!GLAD_GL_VERSION_4_3)
+    const bool supported = requireComputeShaders ? GLAD_GL_VERSION_4_3 : GLAD_GL_VERSION_3_3;
+    if (!supported)
     {
         const char *version = reinterpret_cast<const char *>(glGetString(GL_VERSION));
-        lastError = "OpenGL 4.3+ is required. Detected version: ";
+        lastError = requireComputeShaders ? "OpenGL 4.3+ is required (or run with --cpu). Detected version: "
+                                          : "OpenGL 3.3+ is required to display CPU-rendered frames. Detected version: ";
         lastError += (version != nullptr) ? version : "unknown";
         shutdown();
         return false;
@@ -117,6 +205,8 @@ bool Window::validateRuntimeCapabilities()
 
 void Window::shutdown()
 {
+    headlessContext.reset();
+
     if (window != nullptr)
     {
         glfwDestroyWindow(window);
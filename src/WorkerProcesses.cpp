@@ -0,0 +1,56 @@
+#include "WorkerProcesses.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <iostream>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+bool WorkerProcesses::spawn(unsigned int count, const std::vector<std::string> &arguments, std::string &error)
+{
+    std::vector<std::string> strings = {"BlackHoleSimulation"};
+    strings.insert(strings.end(), arguments.begin(), arguments.end());
+    std::vector<char *> argv;
+    for (std::string &argument : strings)
+    {
+        argv.push_back(argument.data());
+    }
+    argv.push_back(nullptr);
+
+    std::cout.flush();
+    std::cerr.flush();
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        const pid_t pid = ::fork();
+        if (pid < 0)
+        {
+            error = "Failed to start a worker process.";
+            return false;
+        }
+        if (pid == 0)
+        {
+            ::execv("/proc/self/exe", argv.data());
+            std::perror("Failed to start a worker process");
+            ::_exit(127);
+        }
+        children.push_back(pid);
+    }
+    return true;
+}
+
+void WorkerProcesses::reap(bool wait)
+{
+    children.erase(std::remove_if(children.begin(), children.end(),
+                                  [wait](pid_t child)
+                                  {
+                                      pid_t result = 0;
+                                      do
+                                      {
+                                          result = ::waitpid(child, nullptr, wait ? 0 : WNOHANG);
+                                      } while (result < 0 && errno == EINTR);
+                                      return result != 0;
+                                  }),
+                   children.end());
+}
@@ -1,33 +1,320 @@
+#include <chrono>
+#include <filesystem>
+#include <iomanip>
 #include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
 
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 #include <glm/glm.hpp>
-#include <glm/gtc/matrix_transform.hpp>
 
+#include "AnimationRun.h"
 #include "AppPaths.h"
+#include "BenchmarkRun.h"
 #include "BlackHole.h"
 #include "Camera.h"
+#include "CameraPath.h"
+#include "CommandLine.h"
+#include "ComputeBackend.h"
+#include "CpuTracer.h"
+#include "DiskEmissionMap.h"
+#include "DiskEmissionTexture.h"
+#include "FrameFarm.h"
+#include "GpuTimer.h"
+#include "ImageWriter.h"
+#include "OrbitTableTexture.h"
+#include "PhotonOrbitTable.h"
+#include "Profiler.h"
+#include "Regression.h"
+#include "RenderSetup.h"
+#include "RenderTarget.h"
+#include "StarfieldCubemap.h"
+#include "StarfieldTexture.h"
+#include "StepStats.h"
+#include "TileFarm.h"
+#include "TracerParameters.h"
 #include "Window.h"
 #include "shader.h"
 
 namespace
 {
-constexpr int INITIAL_RENDER_WIDTH = 1280;
-constexpr int INITIAL_RENDER_HEIGHT = 720;
+constexpr unsigned int STATS_INTERVAL = 60; // frames between --gpu-timers reports
+constexpr unsigned int FORMAT_BENCHMARK_WARMUP = 10;  // untimed frames per format
+constexpr unsigned int FORMAT_BENCHMARK_FRAMES = 200; // timed frames per format
 
-struct ComputeUniforms
+// Frame phases timed by --gpu-timers; the first is the dispatch, or the upload of
+// the CPU backend's image.
+constexpr std::size_t RENDER_PHASE = 0;
+constexpr std::size_t DRAW_PHASE = 1;
+constexpr std::size_t SWAP_PHASE = 2;
+
+// --format-benchmark: renders the start view with every output format and prints the
+// time per frame. Frames are timed from the CPU around glFinish so the present pass,
+// which reads the output texture back, is included; the swap is left out so vsync
+// doesn't hide the difference.
+int runFormatBenchmark(const CommandLine::Options &options, const std::filesystem::path &computeShaderPath,
+                       Shader &screenShader, const Camera &camera, const glm::ivec2 &resolution)
+{
+    const glm::mat4 invProjection = RenderSetup::inverseProjection(resolution, camera.getFov());
+
+    StarfieldCubemap starfield;
+    const StarfieldCubemap *sky = RenderSetup::prepareStarfield(starfield, options);
+    StarfieldTexture starfieldTexture;
+    if (sky != nullptr)
+    {
+        starfieldTexture.upload(*sky);
+        starfieldTexture.bind(RenderSetup::STARFIELD_UNIT);
+    }
+
+    PhotonOrbitTable orbitTable;
+    OrbitTableTexture orbitTableTexture;
+    if (options.integrator == Integrator::OrbitTable)
+    {
+        orbitTable.prepare(RenderSetup::orbitTableRadius(camera), AppPaths::cacheDirectory());
+        orbitTableTexture.upload(orbitTable);
+        orbitTableTexture.bind(RenderSetup::ORBIT_SAMPLES_UNIT, RenderSetup::ORBIT_ROWS_UNIT);
+    }
+
+    DiskEmissionMap diskEmission;
+    diskEmission.prepare(DiskParameters::defaultsFor(RenderSetup::SCHWARZSCHILD_RADIUS));
+    DiskEmissionTexture diskEmissionTexture;
+    diskEmissionTexture.upload(diskEmission);
+    diskEmissionTexture.bind(RenderSetup::DISK_EMISSION_UNIT, RenderSetup::BLACKBODY_UNIT);
+
+    std::cout << "Output format benchmark at " << resolution.x << "x" << resolution.y << ", "
+              << FORMAT_BENCHMARK_FRAMES << " frames each:" << std::endl;
+
+    const RenderTarget::Format formats[] = {RenderTarget::Format::Rgba32f, RenderTarget::Format::Rgba16f,
+                                            RenderTarget::Format::R11g11b10f, RenderTarget::Format::Rgb10a2};
+    for (const RenderTarget::Format format : formats)
+    {
+        Shader computeShader(computeShaderPath.string(), RenderTarget::shaderDefines(format));
+        if (computeShader.getID() == 0)
+        {
+            return 1;
+        }
+
+        computeShader.bind();
+        RenderSetup::configureComputeShader(computeShader, resolution, invProjection, options, sky != nullptr);
+        computeShader.setUniform3fv("cameraPos", camera.getPosition());
+        computeShader.setUniformMatrix4fv("invView", camera.invViewMatrix());
+        if (options.integrator == Integrator::OrbitTable)
+        {
+            computeShader.setUniform1f("orbitTableRadius", orbitTable.getRadius());
+        }
+        BlackHole blackHole(&computeShader, RenderSetup::BLACK_HOLE_POSITION, RenderSetup::SCHWARZSCHILD_RADIUS, resolution.x, resolution.y, format);
+
+        std::chrono::steady_clock::time_point start;
+        for (unsigned int frame = 0; frame < FORMAT_BENCHMARK_WARMUP + FORMAT_BENCHMARK_FRAMES; ++frame)
+        {
+            if (frame == FORMAT_BENCHMARK_WARMUP)
+            {
+                glFinish();
+                start = std::chrono::steady_clock::now();
+            }
+
+            computeShader.dispatch((resolution.x + 15) / 16, (resolution.y + 15) / 16, 1);
+            computeShader.memoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+            blackHole.draw(screenShader);
+        }
+        glFinish();
+
+        const double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        const double megabytes = static_cast<double>(RenderTarget::bytesPerPixel(format)) * resolution.x * resolution.y / 1.0e6;
+        std::cout << "  " << std::left << std::setw(12) << RenderTarget::formatName(format) << std::right
+                  << std::setw(3) << RenderTarget::bytesPerPixel(format) << " B/pixel  " << std::fixed
+                  << std::setprecision(1) << std::setw(6) << megabytes << " MB/frame  " << std::setprecision(3)
+                  << std::setw(8) << milliseconds / FORMAT_BENCHMARK_FRAMES << " ms/frame" << std::defaultfloat
+                  << std::endl;
+    }
+
+    return 0;
+}
+
+// Renders a single frame without creating any OpenGL context, for machines without a GPU.
+int renderFrameToFile(const CommandLine::Options &options)
 {
-    GLint resolutionVector;
-    GLint invProjection;
-    GLint cameraPos;
-    GLint invView;
-};
+    const glm::ivec2 resolution(options.width, options.height);
+    const Camera camera = RenderSetup::outputCamera(options);
+    PhotonOrbitTable orbitTable;
+    if (options.integrator == Integrator::OrbitTable)
+    {
+        RenderSetup::prepareOrbitTable(orbitTable, camera);
+    }
+
+    const DiskParameters disk = DiskParameters::defaultsFor(RenderSetup::SCHWARZSCHILD_RADIUS);
+    DiskEmissionMap diskEmission;
+    diskEmission.prepare(disk);
+    StarfieldCubemap starfield;
+    const TracerParameters params = RenderSetup::tracerParameters(resolution, RenderSetup::inverseProjection(resolution, camera.getFov()), camera,
+                                                     disk, options, &orbitTable, RenderSetup::prepareStarfield(starfield, options),
+                                                     &diskEmission);
+
+    CpuTracer tracer(options.cpuThreads, options.simd);
+    std::vector<glm::vec4> image;
+    const auto start = std::chrono::steady_clock::now();
+    tracer.render(params, image);
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (options.tileStats)
+    {
+        StepStats::printTiles(std::cout, tracer);
+    }
+    if (options.stepStats)
+    {
+        StepStats::printSteps(std::cout, options, tracer.getLastFrameStatistics(), seconds);
+    }
+
+    if (!RenderSetup::writeOutput(options, image, resolution))
+    {
+        return 1;
+    }
+
+    std::cout << "Wrote " << resolution.x << "x" << resolution.y << " frame to " << options.outputPath
+              << " using " << tracer.getThreadCount() << " CPU threads ("
+              << PacketKernel::isaName(tracer.getIsa()) << " kernel)." << std::endl;
+    return 0;
 }
 
-int main()
+// Prints the comparison and whether it stayed within tolerance, which it returns.
+bool checkDifference(std::ostream &out, const std::string &label, const Regression::ImageDifference &difference,
+                     const Regression::Tolerance &tolerance)
 {
-    Window window(INITIAL_RENDER_WIDTH, INITIAL_RENDER_HEIGHT);
+    const bool passed = Regression::isWithin(difference, tolerance);
+    out << "  " << std::left << std::setw(26) << label << std::right << std::fixed << std::setprecision(4)
+        << "rms " << difference.rms << "  max " << difference.maxDifference << std::setprecision(2) << "  "
+        << Regression::differingFraction(difference) * 100.0 << "% of pixels off by > "
+        << Regression::DIFFERENCE_THRESHOLD;
+    if (!passed)
+    {
+        out << "  FAILED (tolerance rms " << std::setprecision(4) << tolerance.rms << ", " << std::setprecision(2)
+            << tolerance.differingFraction * 100.0 << "% of pixels)";
+    }
+    out << std::defaultfloat << std::endl;
+    return passed;
+}
+
+// Renders every camera preset both ways the regression test asks for and prints how
+// far apart they are; fails when any comparison exceeds Regression's tolerances. With
+// --output the images are kept in that directory.
+int runRegression(const CommandLine::Options &options)
+{
+    const glm::ivec2 resolution(options.width, options.height);
+    const std::filesystem::path outputDirectory = options.outputPath;
+    if (!outputDirectory.empty())
+    {
+        std::error_code error;
+        std::filesystem::create_directories(outputDirectory, error);
+        if (error)
+        {
+            std::cerr << "Failed to create " << outputDirectory << ": " << error.message() << std::endl;
+            return 1;
+        }
+    }
+
+    CpuTracer tracer(options.cpuThreads, options.simd);
+    StarfieldCubemap starfield;
+    const StarfieldCubemap *sky = RenderSetup::prepareStarfield(starfield, options);
+    const DiskParameters disk = DiskParameters::defaultsFor(RenderSetup::SCHWARZSCHILD_RADIUS);
+    DiskEmissionMap diskEmission;
+    diskEmission.prepare(disk);
+    const bool analytic = options.regression == Regression::Test::Analytic;
+    std::cout << "Regression " << Regression::testName(options.regression) << " at " << resolution.x << "x"
+              << resolution.y << " (" << PacketKernel::isaName(tracer.getIsa()) << " kernel)" << std::endl;
+
+    bool written = true;
+    unsigned int failed = 0;
+    auto check = [&](const std::string &label, const Regression::ImageDifference &difference,
+                     const Regression::Tolerance &tolerance) {
+        if (!checkDifference(std::cout, label, difference, tolerance))
+        {
+            ++failed;
+        }
+    };
+    auto keep = [&](const std::vector<glm::vec4> &image, const std::string &name, std::size_t preset) {
+        if (!outputDirectory.empty())
+        {
+            written = ImageWriter::writePfm(outputDirectory / (name + "-p" + std::to_string(preset + 1) + ".pfm"),
+                                            image, resolution.x, resolution.y) && written;
+        }
+    };
+
+    for (std::size_t preset = 0; preset < Camera::PRESET_COUNT; ++preset)
+    {
+        Camera camera(glm::vec3(0.0f, 0.0f, 5.0f));
+        camera.applyPreset(preset);
+
+        PhotonOrbitTable orbitTable;
+        if (analytic || options.integrator == Integrator::OrbitTable)
+        {
+            orbitTable.prepare(RenderSetup::orbitTableRadius(camera), AppPaths::cacheDirectory());
+            orbitTable.persist(AppPaths::cacheDirectory());
+        }
+        TracerParameters params = RenderSetup::tracerParameters(resolution, RenderSetup::inverseProjection(resolution, camera.getFov()), camera,
+                                                   disk, options, &orbitTable, sky, &diskEmission);
+        std::cout << "Preset " << preset + 1 << std::endl;
+
+        // The closed form orbits are exact up to float rounding, so every integrator
+        // is measured against them with the rest of its fast paths as they are.
+        if (analytic)
+        {
+            params.integrator = Integrator::Analytic;
+            std::vector<glm::vec4> reference;
+            tracer.render(params, reference);
+            keep(reference, "analytic", preset);
+            for (const Integrator integrator : {Integrator::FixedRk4, Integrator::AdaptiveRk45, Integrator::OrbitTable})
+            {
+                params.integrator = integrator;
+                std::vector<glm::vec4> integrated;
+                tracer.render(params, integrated);
+                keep(integrated, CommandLine::integratorName(integrator), preset);
+                check(std::string("analytic -> ") + CommandLine::integratorName(integrator),
+                      Regression::compare(reference, integrated), Regression::INTEGRATOR_TOLERANCE);
+            }
+            continue;
+        }
+
+        // The slab test only holds up with the fixed dphi steps it was written for.
+        params.integrator = Integrator::FixedRk4;
+        params.diskTest = DiskTest::Slab;
+        std::vector<glm::vec4> slab;
+        tracer.render(params, slab);
+        keep(slab, "disk-slab", preset);
+
+        params.diskTest = DiskTest::Crossing;
+        std::vector<glm::vec4> crossing;
+        tracer.render(params, crossing);
+        keep(crossing, "disk-crossing-rk4", preset);
+        check("slab -> crossing (rk4)", Regression::compare(slab, crossing), Regression::SLAB_TOLERANCE);
+
+        if (options.integrator != Integrator::FixedRk4)
+        {
+            params.integrator = options.integrator;
+            std::vector<glm::vec4> integrated;
+            tracer.render(params, integrated);
+            keep(integrated, std::string("disk-crossing-") + CommandLine::integratorName(options.integrator), preset);
+            check(std::string("crossing rk4 -> ") + CommandLine::integratorName(options.integrator),
+                  Regression::compare(crossing, integrated), Regression::INTEGRATOR_TOLERANCE);
+        }
+    }
+
+    if (failed > 0)
+    {
+        std::cerr << "Regression " << Regression::testName(options.regression) << " failed: " << failed
+                  << " comparisons exceeded their tolerances." << std::endl;
+        return 1;
+    }
+    return written ? 0 : 1;
+}
+
+// The window, or the --headless framebuffer, rendered every frame until it is closed
+// or the benchmark or --animation is done.
+int runWindow(const CommandLine::Options &options, const CameraPath *path)
+{
+    const bool useCpuRenderer = options.useCpuRenderer;
+    Window window(static_cast<unsigned int>(options.width), static_cast<unsigned int>(options.height), !useCpuRenderer,
+                  options.headless);
     if (!window.initialize())
     {
         std::cerr << window.getLastError() << std::endl;
@@ -38,7 +325,7 @@ int main()
     const auto vertexShaderPath = AppPaths::findResource("vertexShader.glsl");
     const auto fragmentShaderPath = AppPaths::findResource("fragmentShader.glsl");
 
-    if (computeShaderPath.empty() || vertexShaderPath.empty() || fragmentShaderPath.empty())
+    if ((!useCpuRenderer && computeShaderPath.empty()) || vertexShaderPath.empty() || fragmentShaderPath.empty())
     {
         std::cerr << "Failed to locate shader resources." << std::endl;
         return 1;
@@ -46,7 +333,7 @@ int main()
 
     int framebufferWidth = 0;
     int framebufferHeight = 0;
-    glfwGetFramebufferSize(window.p_GLFWwindow(), &framebufferWidth, &framebufferHeight);
+    window.getFramebufferSize(framebufferWidth, framebufferHeight);
     if (framebufferWidth <= 0 || framebufferHeight <= 0)
     {
         std::cerr << "Invalid framebuffer size reported by GLFW." << std::endl;
@@ -55,84 +342,364 @@ int main()
 
     glm::ivec2 resolutionVector(framebufferWidth, framebufferHeight);
     Camera camera(glm::vec3(0.0f, 0.0f, 5.0f));
+    if (path != nullptr)
+    {
+        CameraPath::apply(path->evaluate(0.0), camera);
+    }
+    else if (options.preset > 0)
+    {
+        camera.applyPreset(options.preset - 1);
+    }
 
-    glfwSetWindowUserPointer(window.p_GLFWwindow(), &camera);
-    glfwSetCursorPosCallback(window.p_GLFWwindow(), Camera::mouse_callback);
+    if (!window.isHeadless())
+    {
+        glfwSetWindowUserPointer(window.p_GLFWwindow(), &camera);
+        glfwSetCursorPosCallback(window.p_GLFWwindow(), Camera::mouse_callback);
+    }
 
-    Shader computeShader(computeShaderPath.string());
     Shader screenShader(vertexShaderPath.string(), fragmentShaderPath.string());
+    screenShader.bind();
+    screenShader.setUniform1i(screenShader.getUniformLocation("screenTexture"), 0);
 
-    computeShader.bind();
-    const ComputeUniforms computeUniforms{
-        computeShader.getUniformLocation("resolutionVector"),
-        computeShader.getUniformLocation("invProjection"),
-        computeShader.getUniformLocation("cameraPos"),
-        computeShader.getUniformLocation("invView")
-    };
+    if (options.formatBenchmark)
+    {
+        return runFormatBenchmark(options, computeShaderPath, screenShader, camera, resolutionVector);
+    }
 
-    glm::mat4 projection = glm::perspective(
-        glm::radians(45.0f),
-        static_cast<float>(resolutionVector.x) / static_cast<float>(resolutionVector.y),
-        0.1f,
-        100.0f);
-    glm::mat4 invProjection = glm::inverse(projection);
+    PhotonOrbitTable orbitTable;
+    DiskEmissionMap diskEmission;
+    StarfieldCubemap starfield;
+    const StarfieldCubemap *sky = RenderSetup::prepareStarfield(starfield, options);
+    const std::filesystem::path cacheDirectory = AppPaths::cacheDirectory();
+    const bool useOrbitTable = options.integrator == Integrator::OrbitTable;
+    glm::mat4 invProjection = RenderSetup::inverseProjection(resolutionVector, camera.getFov());
+    float projectionFov = camera.getFov();
 
-    computeShader.setUniform2i(computeUniforms.resolutionVector, resolutionVector);
-    computeShader.setUniformMatrix4fv(computeUniforms.invProjection, invProjection);
+    std::unique_ptr<ComputeBackend> compute;
+    if (!useCpuRenderer)
+    {
+        compute = std::make_unique<ComputeBackend>(computeShaderPath, options, resolutionVector, invProjection, sky);
+    }
 
-    BlackHole blackHole(&computeShader, glm::vec3(0.0f, 0.0f, 0.0f), 0.5f, resolutionVector.x, resolutionVector.y);
+    BlackHole blackHole(compute ? &compute->getShader() : nullptr, RenderSetup::BLACK_HOLE_POSITION,
+                        RenderSetup::SCHWARZSCHILD_RADIUS, resolutionVector.x, resolutionVector.y, options.outputFormat);
 
-    screenShader.bind();
-    screenShader.setUniform1i(screenShader.getUniformLocation("screenTexture"), 0);
+    std::unique_ptr<CpuTracer> cpuTracer;
+    if (useCpuRenderer)
+    {
+        cpuTracer = std::make_unique<CpuTracer>(options.cpuThreads, options.simd);
+    }
+    std::vector<glm::vec4> cpuImage;
+    double cpuFrameSeconds = 0.0;
+    StepStats stepStats(options, compute != nullptr);
+
+    std::unique_ptr<BenchmarkRun> benchmark;
+    if (!options.benchmarkPath.empty())
+    {
+        benchmark = std::make_unique<BenchmarkRun>(options, path, stepStats.getCounter());
+        window.setVsync(false);
+    }
+
+    std::unique_ptr<AnimationRun> animation;
+    if (!options.animationPath.empty())
+    {
+        animation = std::make_unique<AnimationRun>();
+        if (!animation->open(options, resolutionVector, camera.getPosition(), path))
+        {
+            return 1;
+        }
+        window.setVsync(false);
+    }
+
+    std::unique_ptr<GpuTimer> gpuTimer;
+    if (options.gpuTimers || !options.gpuTimersCsv.empty() || benchmark)
+    {
+        gpuTimer = std::make_unique<GpuTimer>(std::vector<std::string>{useCpuRenderer ? "upload" : "dispatch", "draw", "swap"});
+    }
 
     float lastFrame = 0.0f;
+    bool traceKeyPressed = false;
+    if (!options.profilePath.empty())
+    {
+        Profiler::enable();
+    }
 
-    while (!glfwWindowShouldClose(window.p_GLFWwindow()))
+    while (!window.shouldClose() && !(benchmark && benchmark->isFinished()) &&
+           !(animation && animation->isFinished()))
     {
+        PROFILE_ZONE("frame");
+        if (benchmark)
+        {
+            benchmark->beginFrame();
+        }
         const float currentFrame = static_cast<float>(glfwGetTime());
         const float deltaTime = currentFrame - lastFrame;
         lastFrame = currentFrame;
 
-        if (glfwGetKey(window.p_GLFWwindow(), GLFW_KEY_ESCAPE) == GLFW_PRESS)
+        if (window.isKeyPressed(GLFW_KEY_ESCAPE))
+        {
+            window.close();
+        }
+
+        // F9 writes the trace recorded so far, e.g. right after a hitch.
+        const bool traceKeyDown = window.isKeyPressed(GLFW_KEY_F9);
+        if (traceKeyDown && !traceKeyPressed && !options.profilePath.empty() && Profiler::writeTrace(options.profilePath))
         {
-            glfwSetWindowShouldClose(window.p_GLFWwindow(), true);
+            std::cout << "Profile written to " << options.profilePath << "." << std::endl;
         }
+        traceKeyPressed = traceKeyDown;
 
-        camera.processInput(window.p_GLFWwindow(), deltaTime);
+        if (benchmark)
+        {
+            benchmark->positionCamera(camera);
+        }
+        else if (animation)
+        {
+            animation->positionCamera(camera);
+        }
+        else
+        {
+            camera.processInput(window.p_GLFWwindow(), deltaTime);
+        }
+
+        // Only rebaked when the disk's emission parameters change
+        if (diskEmission.prepare(blackHole.getDiskParameters()) && compute)
+        {
+            compute->uploadDiskEmission(diskEmission);
+        }
+
+        // A new camera radius needs a new orbit table; it is only cached once the
+        // radius has held for a frame.
+        if (useOrbitTable && !orbitTable.prepare(RenderSetup::orbitTableRadius(camera), cacheDirectory))
+        {
+            PROFILE_ZONE("orbit table persist");
+            orbitTable.persist(cacheDirectory);
+        }
+        else if (useOrbitTable && compute)
+        {
+            compute->uploadOrbitTable(orbitTable);
+        }
 
         int currentFramebufferWidth = 0;
         int currentFramebufferHeight = 0;
-        glfwGetFramebufferSize(window.p_GLFWwindow(), &currentFramebufferWidth, &currentFramebufferHeight);
+        window.getFramebufferSize(currentFramebufferWidth, currentFramebufferHeight);
         if (currentFramebufferWidth > 0 && currentFramebufferHeight > 0 &&
             (currentFramebufferWidth != resolutionVector.x || currentFramebufferHeight != resolutionVector.y))
         {
+            PROFILE_ZONE("resize");
             resolutionVector = glm::ivec2(currentFramebufferWidth, currentFramebufferHeight);
-            projection = glm::perspective(
-                glm::radians(45.0f),
-                static_cast<float>(resolutionVector.x) / static_cast<float>(resolutionVector.y),
-                0.1f,
-                100.0f);
-            invProjection = glm::inverse(projection);
-
-            computeShader.bind();
-            computeShader.setUniform2i(computeUniforms.resolutionVector, resolutionVector);
-            computeShader.setUniformMatrix4fv(computeUniforms.invProjection, invProjection);
+            invProjection = RenderSetup::inverseProjection(resolutionVector, projectionFov);
+
+            if (compute)
+            {
+                compute->setProjection(resolutionVector, invProjection);
+            }
             blackHole.resizeOutputTexture(resolutionVector.x, resolutionVector.y);
         }
 
-        computeShader.bind();
-        computeShader.setUniform3fv(computeUniforms.cameraPos, camera.getPosition());
-        computeShader.setUniformMatrix4fv(computeUniforms.invView, camera.invViewMatrix());
-        computeShader.dispatch((resolutionVector.x + 15) / 16, (resolutionVector.y + 15) / 16, 1);
-        computeShader.memoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+        // Camera paths can change the field of view.
+        if (camera.getFov() != projectionFov)
+        {
+            projectionFov = camera.getFov();
+            invProjection = RenderSetup::inverseProjection(resolutionVector, projectionFov);
+            if (compute)
+            {
+                compute->setProjection(resolutionVector, invProjection);
+            }
+        }
+
+        if (gpuTimer)
+        {
+            gpuTimer->beginFrame();
+        }
+
+        if (compute)
+        {
+            compute->prepareFrame(camera);
+            if (gpuTimer)
+            {
+                gpuTimer->beginPhase(RENDER_PHASE);
+            }
+            compute->dispatch(resolutionVector);
+            if (gpuTimer)
+            {
+                gpuTimer->endPhase(RENDER_PHASE);
+            }
+            stepStats.gpuFrameRendered();
+        }
+        else
+        {
+            {
+                PROFILE_ZONE("CpuTracer::render");
+                const auto renderStart = std::chrono::steady_clock::now();
+                cpuTracer->render(RenderSetup::tracerParameters(resolutionVector, invProjection, camera, blackHole.getDiskParameters(),
+                                                   options, &orbitTable, sky, &diskEmission),
+                                  cpuImage);
+                cpuFrameSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - renderStart).count();
+            }
+            if (benchmark)
+            {
+                benchmark->cpuFrameRendered(*cpuTracer);
+            }
+            if (gpuTimer)
+            {
+                gpuTimer->beginPhase(RENDER_PHASE);
+            }
+            {
+                PROFILE_ZONE("upload");
+                blackHole.uploadImage(cpuImage);
+            }
+            if (gpuTimer)
+            {
+                gpuTimer->endPhase(RENDER_PHASE);
+            }
+            stepStats.cpuFrameRendered(*cpuTracer, cpuFrameSeconds);
+        }
 
-        glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT);
-        blackHole.draw(screenShader);
+        if (gpuTimer)
+        {
+            gpuTimer->beginPhase(DRAW_PHASE);
+        }
+        {
+            PROFILE_ZONE("draw");
+            glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+            glClear(GL_COLOR_BUFFER_BIT);
+            blackHole.draw(screenShader);
+        }
+        if (animation)
+        {
+            animation->captureFrame(blackHole.getOutputTexture());
+        }
 
-        glfwSwapBuffers(window.p_GLFWwindow());
-        glfwPollEvents();
+        if (gpuTimer)
+        {
+            gpuTimer->endPhase(DRAW_PHASE);
+            gpuTimer->beginPhase(SWAP_PHASE);
+        }
+        if (benchmark)
+        {
+            benchmark->beginSwap();
+        }
+        {
+            PROFILE_ZONE("swapBuffers");
+            window.swapBuffers();
+        }
+        if (benchmark)
+        {
+            benchmark->endSwap();
+        }
+        if (gpuTimer)
+        {
+            gpuTimer->endPhase(SWAP_PHASE);
+            gpuTimer->endFrame();
+            if (options.gpuTimers && gpuTimer->getFrameCount() % STATS_INTERVAL == 0)
+            {
+                gpuTimer->printStats(std::cout);
+            }
+        }
+        {
+            PROFILE_ZONE("pollEvents");
+            window.pollEvents();
+        }
+
+        if (benchmark)
+        {
+            benchmark->endFrame();
+        }
+    }
+
+    if (!options.profilePath.empty() && Profiler::writeTrace(options.profilePath))
+    {
+        std::cout << "Profile written to " << options.profilePath << "." << std::endl;
+        if (Profiler::getDroppedZones() > 0)
+        {
+            std::cout << Profiler::getDroppedZones() << " zones didn't fit the profiler's buffers." << std::endl;
+        }
+    }
+
+    if (gpuTimer)
+    {
+        gpuTimer->finish();
+        if (options.gpuTimers)
+        {
+            gpuTimer->printStats(std::cout);
+        }
+        if (!options.gpuTimersCsv.empty() && gpuTimer->isAvailable() && gpuTimer->writeCsv(options.gpuTimersCsv))
+        {
+            std::cout << "GPU timings written to " << options.gpuTimersCsv << "." << std::endl;
+        }
+    }
+
+    if (animation && !animation->finish())
+    {
+        return 1;
+    }
+
+    if (benchmark)
+    {
+        return benchmark->write(gpuTimer.get(), cpuTracer.get(), resolutionVector) ? 0 : 1;
     }
 
     return 0;
 }
+}
+
+int main(int argc, char **argv)
+{
+    CommandLine::Options options;
+    std::string optionsError;
+    if (!CommandLine::parse(argc, argv, options, optionsError))
+    {
+        std::cerr << optionsError << std::endl;
+        CommandLine::printUsage(std::cerr, argv[0]);
+        return 1;
+    }
+
+    if (options.showHelp)
+    {
+        CommandLine::printUsage(std::cout, argv[0]);
+        return 0;
+    }
+
+    // Frames or a benchmark report streamed to stdout must not mix with messages.
+    if (options.animationPath == "-" || options.benchmarkPath == "-")
+    {
+        std::cout.rdbuf(std::cerr.rdbuf());
+    }
+
+    if (options.regression != Regression::Test::None)
+    {
+        return runRegression(options);
+    }
+
+    if (!options.tileWorkerAddress.empty())
+    {
+        return TileFarm::runWorker(options);
+    }
+
+    if (!options.outputPath.empty() && (options.tileWorkers > 0 || !options.listenAddress.empty()))
+    {
+        return TileFarm::renderFrame(options);
+    }
+
+    if (!options.outputPath.empty())
+    {
+        return renderFrameToFile(options);
+    }
+
+    CameraPath cameraPath;
+    std::string cameraPathError;
+    if (!options.cameraPathFile.empty() && !cameraPath.load(options.cameraPathFile, cameraPathError))
+    {
+        std::cerr << cameraPathError << std::endl;
+        return 1;
+    }
+    const CameraPath *path = cameraPath.isEmpty() ? nullptr : &cameraPath;
+
+    if (options.animationWorkers > 0)
+    {
+        return FrameFarm::renderAnimation(options, FrameFarm::workerArguments(argc, argv), path);
+    }
+
+    return runWindow(options, path);
+}
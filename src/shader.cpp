@@ -3,6 +3,38 @@
 #include <iostream>
 #include <vector>
 
+namespace
+{
+// #version has to stay the first statement, so defines go on the line after it.
+std::string insertDefines(const std::string &source, const std::vector<std::string> &defineList)
+{
+    if (defineList.empty())
+    {
+        return source;
+    }
+
+    std::string defines;
+    for (const std::string &define : defineList)
+    {
+        defines += "#define " + define + "\n";
+    }
+
+    const std::size_t version = source.find("#version");
+    if (version == std::string::npos)
+    {
+        return defines + source;
+    }
+
+    const std::size_t lineEnd = source.find('\n', version);
+    if (lineEnd == std::string::npos)
+    {
+        return source + "\n" + defines;
+    }
+
+    return source.substr(0, lineEnd + 1) + defines + source.substr(lineEnd + 1);
+}
+}
+
 Shader::Shader(const std::string &vertexPath, const std::string &fragmentPath)
     : ID(0), isComputeShader(false)
 {
@@ -13,10 +45,10 @@ Shader::Shader(const std::string &vertexPath, const std::string &fragmentPath)
     }
 }
 
-Shader::Shader(const std::string &computePath)
+Shader::Shader(const std::string &computePath, const std::vector<std::string> &defines)
     : ID(0), isComputeShader(true)
 {
-    ID = createComputeShader(readFromFile(computePath));
+    ID = createComputeShader(insertDefines(readFromFile(computePath), defines));
     if (ID == 0)
     {
         std::cerr << "Failed to create compute shader program." << std::endl;